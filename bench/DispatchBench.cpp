@@ -0,0 +1,134 @@
+// Fakelang dispatch benchmarks: how fast the calls CodeGen emits run.
+//
+// Each benchmark compiles a dispatch workload (generateDispatchWorkload: a
+// chain of virtual calls through receivers whose static type has `targets`
+// concrete classes, 1 = monomorphic, 2 = bimorphic, more = megamorphic)
+// through Sema, reachability and CodeGen with one dispatch strategy, loads it
+// into an ORC JIT once, and then times runs of its `main`. items_per_second
+// is virtual calls per second and `time_per_call` its inverse. The module is
+// not run through -O, which would inline the whole chain away; the JIT's
+// backend optimizes as for --jit.
+//
+// Strategies:
+// - vtable: every call loads its slot from the vtable (no partial evaluation)
+// - relative_vtable: the same through 32-bit relative slots
+//   (CodeGen::setRelativeVtables)
+// - direct: calls on receivers of known class are direct, as the partial
+//   evaluator makes them, without folding the chain to a constant
+//   (PartialEvaluator::setLocalOnly)
+// - class_id_compare, class_id_switch: the class ID stored in each object is
+//   compared with each implementation's classes, or switched on, before a
+//   direct call (CodeGen::setClassIdDispatch, with thresholds that always
+//   pick the one or the other)
+//
+// Run with `make bench-dispatch`, or
+//   fakelang_dispatch_bench --benchmark_filter=targets:16
+// and compare runs with bench/compare.py as for fakelang_bench.
+
+#include "CodeGen.h"
+#include "JIT.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PartialEval.h"
+#include "Reachability.h"
+#include "Sema.h"
+#include "WorkloadGen.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+using namespace fakelang;
+
+namespace {
+
+/// Virtual calls per run of main. Every call of the chain is nested in the
+/// previous one, so a longer chain would overflow the CPU's return stack
+/// buffer and time mispredicted returns instead of calls.
+constexpr size_t kCalls = 16;
+/// More implementations than any call of the workloads reaches.
+constexpr uint32_t kMaxTargets = 64;
+
+enum class Dispatch { Vtable, RelativeVtable, Direct, ClassIdCompare, ClassIdSwitch };
+
+/// A dispatch workload loaded into its own JIT.
+struct Loaded {
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  int32_t (*main)(){nullptr};
+};
+
+Loaded load(const std::string& source, Dispatch strategy) {
+  Program prog = Parser(Lexer(source, "dispatch.fakelang").lexAll()).parseProgram();
+  const ProgramInfo info = Sema("dispatch.fakelang").analyze(prog);
+  if (strategy == Dispatch::Direct) {
+    PartialEvaluator evaluator(info);
+    evaluator.setLocalOnly(true);
+    evaluator.run(prog);
+  }
+  // Only the C classes are instantiated, as with the driver's dead code
+  // elimination
+  const LiveSet live = ReachabilityAnalysis(info).run(prog);
+  CodeGen cg;
+  cg.setLiveSet(&live);
+  cg.setRelativeVtables(strategy == Dispatch::RelativeVtable);
+  if (strategy == Dispatch::ClassIdCompare) cg.setClassIdDispatch(true, DispatchPolicy{kMaxTargets, 0});
+  if (strategy == Dispatch::ClassIdSwitch) cg.setClassIdDispatch(true, DispatchPolicy{1, kMaxTargets});
+  cg.generate(prog, info, "dispatch.fakelang");
+  auto [context, module] = cg.takeModule();
+  Loaded loaded;
+  loaded.jit = createHostJIT();
+  addModule(*loaded.jit, std::move(context), std::move(module));
+  loaded.main = reinterpret_cast<int32_t (*)()>(lookupAddress(*loaded.jit, "main"));
+  return loaded;
+}
+
+void runDispatch(benchmark::State& state, Dispatch strategy) {
+  DispatchParams params;
+  params.calls = kCalls;
+  params.targets = static_cast<size_t>(state.range(0));
+  const Loaded loaded = load(generateDispatchWorkload(params), strategy);
+  if (loaded.main() != 1) {
+    state.SkipWithError("main did not return 1");
+    return;
+  }
+  for (auto _ : state) benchmark::DoNotOptimize(loaded.main());
+  const auto calls = static_cast<double>(state.iterations()) * static_cast<double>(kCalls);
+  state.SetItemsProcessed(static_cast<int64_t>(calls));
+  state.counters["time_per_call"] =
+      benchmark::Counter(calls, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void BM_DispatchVtable(benchmark::State& state) { runDispatch(state, Dispatch::Vtable); }
+void BM_DispatchRelativeVtable(benchmark::State& state) { runDispatch(state, Dispatch::RelativeVtable); }
+void BM_DispatchDirect(benchmark::State& state) { runDispatch(state, Dispatch::Direct); }
+void BM_DispatchClassIdCompare(benchmark::State& state) { runDispatch(state, Dispatch::ClassIdCompare); }
+void BM_DispatchClassIdSwitch(benchmark::State& state) { runDispatch(state, Dispatch::ClassIdSwitch); }
+
+/// Monomorphic, bimorphic, and two megamorphic hierarchies.
+void addTargets(benchmark::internal::Benchmark* b) {
+  b->ArgName("targets");
+  for (int targets : {1, 2, 4, 16}) b->Arg(targets);
+  b->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_DispatchVtable)->Apply(addTargets);
+BENCHMARK(BM_DispatchRelativeVtable)->Apply(addTargets);
+BENCHMARK(BM_DispatchDirect)->Apply(addTargets);
+BENCHMARK(BM_DispatchClassIdCompare)->Apply(addTargets);
+BENCHMARK(BM_DispatchClassIdSwitch)->Apply(addTargets);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,407 @@
+// Fakelang benchmark suite: one Google Benchmark per compiler phase.
+//
+// Each benchmark runs over the same set of generated program shapes, each of
+// which scales one dimension (classes, hierarchy depth, methods per class,
+// statements in main) away from a common midpoint. CodeGen::generate also
+// reports the time of each internal pass as per-iteration counters.
+//
+// Save a baseline with
+//   fakelang_bench --benchmark_out=base.json --benchmark_out_format=json
+// and compare a later run against it with bench/compare.py.
+//
+// BM_Emit* and BM_Load* compare annotated textual IR with plain and
+// compressed bitcode: the time to write each form, its size, and the time a
+// downstream tool needs to parse it back into a module.
+//
+// In builds configured with -DFAKELANG_ALLOC_PROFILE=ON, BM_CompileSource
+// also reports heap allocations per compile; compare them against a baseline
+// with `compare.py --metric allocs`.
+//
+// BM_RunInterp / BM_RunJIT time source-to-result latency of the two in-process
+// execution paths; BM_VMExecute times the bytecode VM alone and reports calls
+// per second. bench/run_paths.py compares these paths with ahead-of-time
+// compilation from the command line.
+//
+// BM_EditBody times one keystroke in a method body in the middle of a large
+// file through the incremental front end the language server uses, with
+// (BM_EditAndCheckBody) and without rechecking the edited body, and
+// BM_CheckDeclarations the whole-program Sema pass an edit to a declaration
+// still needs.
+//
+// BM_HotSwapReload times reloading a running JIT session (HotSwap.h) after a
+// method body in the middle of a large file changed, with the time to
+// analyze, compile and patch as counters; `patch_us` is the window in which
+// calls may still see the old method.
+
+#include "BitcodeEmitter.h"
+#include "Bytecode.h"
+#include "CodeGen.h"
+#include "CompileStats.h"
+#include "Driver.h"
+#include "HotSwap.h"
+#include "IncrementalParser.h"
+#include "Interpreter.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Sema.h"
+#include "WorkloadGen.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace fakelang;
+
+namespace {
+
+/// Shape of a benchmark program: chains of `depth` classes in which every
+/// subclass overrides all `methods` virtual methods of its chain root, and a
+/// `main` of `stmts` statements.
+struct ProgramShape {
+  size_t classes;
+  size_t depth;
+  size_t methods;
+  size_t stmts;
+};
+
+/// Generate the program for the benchmark arguments registered by addShapes().
+std::string programFor(const benchmark::State& state) {
+  WorkloadParams p;
+  p.classes = static_cast<size_t>(state.range(0));
+  p.depth = static_cast<size_t>(state.range(1));
+  p.fanOut = 1;
+  p.methodsPerClass = static_cast<size_t>(state.range(2));
+  p.overrideRatio = 1.0;
+  p.mainStmts = static_cast<size_t>(state.range(3));
+  return generateWorkload(p);
+}
+
+/// Register the program shapes: the midpoint, then a sweep of each dimension
+/// with the others held at the midpoint.
+void addShapes(benchmark::internal::Benchmark* b) {
+  const ProgramShape mid{256, 4, 4, 256};
+  b->ArgNames({"classes", "depth", "methods", "stmts"});
+  auto add = [&](ProgramShape s) {
+    b->Args({static_cast<int64_t>(s.classes), static_cast<int64_t>(s.depth),
+             static_cast<int64_t>(s.methods), static_cast<int64_t>(s.stmts)});
+  };
+  add(mid);
+  for (size_t v : {16, 4096}) { ProgramShape s = mid; s.classes = v; add(s); }
+  for (size_t v : {1, 32}) { ProgramShape s = mid; s.depth = v; add(s); }
+  for (size_t v : {1, 32}) { ProgramShape s = mid; s.methods = v; add(s); }
+  for (size_t v : {16, 8192}) { ProgramShape s = mid; s.stmts = v; add(s); }
+  b->Unit(benchmark::kMicrosecond);
+}
+
+Program parse(const std::string& src) {
+  Lexer lex(src, "bench.fakelang");
+  return Parser(lex.lexAll()).parseProgram();
+}
+
+void BM_Lex(benchmark::State& state) {
+  const std::string src = programFor(state);
+  size_t tokens = 0;
+  for (auto _ : state) {
+    Lexer lex(src, "bench.fakelang");
+    auto toks = lex.lexAll();
+    tokens = toks.size();
+    benchmark::DoNotOptimize(toks.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+  state.counters["tokens"] = static_cast<double>(tokens);
+}
+BENCHMARK(BM_Lex)->Apply(addShapes);
+
+void BM_Parse(benchmark::State& state) {
+  const std::string src = programFor(state);
+  const std::vector<Token> tokens = Lexer(src, "bench.fakelang").lexAll();
+  for (auto _ : state) {
+    // Parser consumes its token vector; copying it is not part of parsing.
+    state.PauseTiming();
+    std::vector<Token> copy = tokens;
+    state.ResumeTiming();
+    Program prog = Parser(std::move(copy)).parseProgram();
+    benchmark::DoNotOptimize(prog.classes.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+}
+BENCHMARK(BM_Parse)->Apply(addShapes);
+
+void BM_Sema(benchmark::State& state) {
+  const std::string src = programFor(state);
+  Program prog = parse(src);
+  for (auto _ : state) {
+    ProgramInfo info = Sema("bench.fakelang").analyze(prog);
+    benchmark::DoNotOptimize(info.layouts.impl(0).data());
+  }
+}
+BENCHMARK(BM_Sema)->Apply(addShapes);
+
+/// A file of `state.range(0)` classes, about six lines each.
+std::string editWorkload(benchmark::State& state) {
+  WorkloadParams params;
+  params.classes = static_cast<size_t>(state.range(0));
+  return generateWorkload(params);
+}
+
+/// Type one character into, and then delete it from, a string literal in the
+/// middle of the file.
+void editBody(benchmark::State& state, bool check) {
+  IncrementalParser doc(editWorkload(state));
+  const size_t at = doc.text().find("\"str", doc.text().size() / 2) + 1;
+  ProgramInfo info;
+  Sema("bench.fakelang").checkDeclarations(doc.program(), info);
+  auto recheck = [&] {
+    for (ClassId id : doc.lastChange().classes) {
+      benchmark::DoNotOptimize(Sema("bench.fakelang").checkClassBodies(doc.program(), info, id).size());
+    }
+  };
+  for (auto _ : state) {
+    doc.edit(at, at, "x");
+    if (check) recheck();
+    doc.edit(at, at + 1, "");
+    if (check) recheck();
+  }
+  if (doc.lastChange().declarations) state.SkipWithError("the edit changed a declaration");
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 2));
+  state.counters["lines"] = static_cast<double>(std::count(doc.text().begin(), doc.text().end(), '\n'));
+  state.counters["bytesLexed"] = static_cast<double>(doc.lastWork().bytesLexed);
+}
+void BM_EditBody(benchmark::State& state) { editBody(state, false); }
+void BM_EditAndCheckBody(benchmark::State& state) { editBody(state, true); }
+BENCHMARK(BM_EditBody)->Arg(1000)->Arg(16000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_EditAndCheckBody)->Arg(1000)->Arg(16000)->Unit(benchmark::kMicrosecond);
+
+void BM_CheckDeclarations(benchmark::State& state) {
+  IncrementalParser doc(editWorkload(state));
+  ProgramInfo info;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Sema("bench.fakelang").checkDeclarations(doc.program(), info).size());
+  }
+}
+BENCHMARK(BM_CheckDeclarations)->Arg(1000)->Arg(16000)->Unit(benchmark::kMicrosecond);
+
+void BM_HotSwapReload(benchmark::State& state) {
+  const std::string original = editWorkload(state);
+  const size_t at = original.find("\"str", original.size() / 2) + 1;
+  const std::string edited = std::string(original).insert(at, "x");
+  HotSwapSession session(original, "bench.fakelang");
+  double analyzeUs = 0, compileUs = 0, patchUs = 0, slots = 0;
+  bool toEdited = true;
+  for (auto _ : state) {
+    const ReloadReport r = session.reload(toEdited ? edited : original);
+    toEdited = !toEdited;
+    analyzeUs += std::chrono::duration<double, std::micro>(r.analyze).count();
+    compileUs += std::chrono::duration<double, std::micro>(r.compile).count();
+    patchUs += std::chrono::duration<double, std::micro>(r.patch).count();
+    slots += static_cast<double>(r.slotsPatched + r.stubsPatched);
+  }
+  state.counters["analyze_us"] = benchmark::Counter(analyzeUs, benchmark::Counter::kAvgIterations);
+  state.counters["compile_us"] = benchmark::Counter(compileUs, benchmark::Counter::kAvgIterations);
+  state.counters["patch_us"] = benchmark::Counter(patchUs, benchmark::Counter::kAvgIterations);
+  state.counters["patched"] = benchmark::Counter(slots, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_HotSwapReload)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+void BM_CodeGen(benchmark::State& state) {
+  const std::string src = programFor(state);
+  Program prog = parse(src);
+  const ProgramInfo info = Sema("bench.fakelang").analyze(prog);
+  std::map<std::string, double> passSeconds;
+  CompileStats stats;
+  for (auto _ : state) {
+    PhaseTimers timers;
+    CodeGen cg;
+    cg.setSource(src, "bench.fakelang");
+    cg.setInstrumentation(&timers, &stats);
+    cg.generate(prog, info, "bench.fakelang");
+    benchmark::DoNotOptimize(cg.getModule());
+    for (const auto& p : timers.results()) passSeconds[p.name] += p.wall;
+  }
+  // Per-pass wall time, averaged over iterations, alongside the total.
+  for (const auto& [name, secs] : passSeconds) {
+    state.counters[name + "_us"] =
+        benchmark::Counter(secs * 1e6, benchmark::Counter::kAvgIterations);
+  }
+  state.counters["ir_instructions"] = static_cast<double>(stats.irInstructions);
+}
+BENCHMARK(BM_CodeGen)->Apply(addShapes);
+
+void BM_PrintIR(benchmark::State& state) {
+  const std::string src = programFor(state);
+  Program prog = parse(src);
+  CodeGen cg;
+  cg.setSource(src, "bench.fakelang");
+  cg.generate(prog, "bench.fakelang");
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    llvm::raw_string_ostream os(out);
+    printWithAnnotations(os, *cg.getModule(), src, "bench.fakelang");
+    os.flush();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+}
+BENCHMARK(BM_PrintIR)->Apply(addShapes);
+
+/// Generate the program for `state` and render it in `emit` form.
+std::string outputFor(const benchmark::State& state, EmitKind emit, BitcodeCompression compression) {
+  CompileOptions opts;
+  opts.emit = emit;
+  opts.compression = compression;
+  CompileResult res = compileSource(programFor(state), "bench.fakelang", opts);
+  if (!res.ok) throw std::runtime_error(res.error);
+  return std::move(res.output);
+}
+
+void emitBench(benchmark::State& state, BitcodeCompression compression) {
+  const std::string src = programFor(state);
+  Program prog = parse(src);
+  CodeGen cg;
+  cg.setSource(src, "bench.fakelang");
+  cg.generate(prog, "bench.fakelang");
+  std::string out;
+  for (auto _ : state) {
+    out.clear();
+    llvm::raw_string_ostream os(out);
+    writeBitcode(*cg.getModule(), compression, os);
+    os.flush();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * out.size()));
+  state.counters["output_bytes"] = static_cast<double>(out.size());
+}
+
+void BM_EmitBitcode(benchmark::State& state) { emitBench(state, BitcodeCompression::None); }
+BENCHMARK(BM_EmitBitcode)->Apply(addShapes);
+
+void BM_EmitCompressedBitcode(benchmark::State& state) { emitBench(state, defaultBitcodeCompression()); }
+BENCHMARK(BM_EmitCompressedBitcode)->Apply(addShapes);
+
+void loadBench(benchmark::State& state, EmitKind emit, BitcodeCompression compression) {
+  const std::string data = outputFor(state, emit, compression);
+  for (auto _ : state) {
+    llvm::LLVMContext ctx;
+    auto module = loadModule(llvm::MemoryBufferRef(data, "bench"), ctx);
+    benchmark::DoNotOptimize(module.get());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+  state.counters["input_bytes"] = static_cast<double>(data.size());
+}
+
+void BM_LoadIR(benchmark::State& state) { loadBench(state, EmitKind::LL, BitcodeCompression::None); }
+BENCHMARK(BM_LoadIR)->Apply(addShapes);
+
+void BM_LoadBitcode(benchmark::State& state) { loadBench(state, EmitKind::BC, BitcodeCompression::None); }
+BENCHMARK(BM_LoadBitcode)->Apply(addShapes);
+
+void BM_LoadCompressedBitcode(benchmark::State& state) {
+  loadBench(state, EmitKind::BC, defaultBitcodeCompression());
+}
+BENCHMARK(BM_LoadCompressedBitcode)->Apply(addShapes);
+
+void BM_CompileSource(benchmark::State& state) {
+  const std::string src = programFor(state);
+  CompileOptions opts;
+  opts.timePhases = kAllocProfiling;
+  AllocCounts allocs;
+  for (auto _ : state) {
+    CompileResult res = compileSource(src, "bench.fakelang", opts);
+    if (!res.ok) {
+      state.SkipWithError(res.error.c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(res.output.data());
+    for (const auto& p : res.report.phases) {
+      allocs.allocations += p.allocs.allocations;
+      allocs.bytes += p.allocs.bytes;
+      allocs.peakLiveBytes = std::max(allocs.peakLiveBytes, p.allocs.peakLiveBytes);
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+  if (kAllocProfiling) {
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocs.allocations),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] = benchmark::Counter(static_cast<double>(allocs.bytes),
+                                                       benchmark::Counter::kAvgIterations);
+    state.counters["peak_live_bytes"] = static_cast<double>(allocs.peakLiveBytes);
+  }
+}
+BENCHMARK(BM_CompileSource)->Apply(addShapes);
+
+/// Sends the process's stdout to /dev/null while alive; JIT-compiled programs
+/// print through the C library.
+class SilenceStdout {
+public:
+  SilenceStdout() {
+    std::fflush(stdout);
+    saved_ = ::dup(STDOUT_FILENO);
+    const int null = ::open("/dev/null", O_WRONLY);
+    ::dup2(null, STDOUT_FILENO);
+    ::close(null);
+  }
+  ~SilenceStdout() {
+    std::fflush(stdout);
+    ::dup2(saved_, STDOUT_FILENO);
+    ::close(saved_);
+  }
+
+private:
+  int saved_;
+};
+
+void runBench(benchmark::State& state, RunMode mode) {
+  const std::string src = programFor(state);
+  llvm::raw_null_ostream out;
+  SilenceStdout silence;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(runSource(src, "bench.fakelang", mode, out));
+  }
+}
+
+void BM_RunInterp(benchmark::State& state) { runBench(state, RunMode::Interp); }
+BENCHMARK(BM_RunInterp)->Apply(addShapes);
+
+void BM_RunJIT(benchmark::State& state) { runBench(state, RunMode::JIT); }
+BENCHMARK(BM_RunJIT)->Apply(addShapes);
+
+void BM_VMExecute(benchmark::State& state) {
+  const std::string src = programFor(state);
+  Program prog = parse(src);
+  const ProgramInfo info = Sema("bench.fakelang").analyze(prog);
+  // Without the partial evaluator every call goes through an inline cache.
+  const BytecodeModule mod = compileBytecode(prog, info);
+  VM vm(mod);
+  llvm::raw_null_ostream out;
+  for (auto _ : state) benchmark::DoNotOptimize(vm.run(out));
+  const VMStats& stats = vm.stats();
+  state.counters["calls"] = benchmark::Counter(static_cast<double>(stats.calls), benchmark::Counter::kIsRate);
+  const size_t virtualCalls = stats.inlineCacheHits + stats.inlineCacheMisses + stats.megamorphicCalls;
+  if (virtualCalls != 0) {
+    state.counters["ic_hit_ratio"] = static_cast<double>(stats.inlineCacheHits) / static_cast<double>(virtualCalls);
+  }
+}
+BENCHMARK(BM_VMExecute)->Apply(addShapes);
+
+} // namespace
+
+BENCHMARK_MAIN();
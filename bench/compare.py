@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Compare a fakelang_bench JSON run against a saved baseline.
+
+Usage:
+  compare.py BASELINE.json CURRENT.json [--threshold 0.10] [--metric real_time|cpu_time|COUNTER]
+
+Both files are produced with
+  fakelang_bench --benchmark_out=FILE --benchmark_out_format=json
+
+Benchmarks are matched by name. When a run used --benchmark_repetitions, the
+"median" aggregate is compared; otherwise the single iteration result is.
+Exits with status 1 if any benchmark slowed down by more than the threshold
+(a fraction: 0.10 = 10%), so the script can gate CI. A counter such as
+"allocs" (FAKELANG_ALLOC_PROFILE builds) can be compared instead of time;
+benchmarks without it are skipped.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path, metric):
+    with open(path) as f:
+        data = json.load(f)
+    plain, medians = {}, {}
+    for b in data.get("benchmarks", []):
+        if b.get("error_occurred") or metric not in b:
+            continue
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[b["run_name"]] = b[metric]
+        else:
+            plain.setdefault(b.get("run_name", b["name"]), b[metric])
+    plain.update(medians)
+    return plain
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("baseline")
+    ap.add_argument("current")
+    ap.add_argument("--threshold", type=float, default=0.10,
+                    help="allowed slowdown as a fraction (default 0.10)")
+    ap.add_argument("--metric", default="cpu_time",
+                    help="real_time, cpu_time (default) or a benchmark counter such as allocs")
+    args = ap.parse_args()
+
+    base = load(args.baseline, args.metric)
+    cur = load(args.current, args.metric)
+
+    regressions = 0
+    width = max((len(n) for n in cur), default=10)
+    print(f"{'Benchmark':<{width}}  {'Baseline':>12}  {'Current':>12}  {'Change':>8}")
+    for name, t in cur.items():
+        if name not in base:
+            print(f"{name:<{width}}  {'-':>12}  {t:>12.1f}  {'new':>8}")
+            continue
+        b = base[name]
+        change = (t - b) / b if b else 0.0
+        flag = ""
+        if change > args.threshold:
+            regressions += 1
+            flag = "  REGRESSION"
+        print(f"{name:<{width}}  {b:>12.1f}  {t:>12.1f}  {change:>+7.1%}{flag}")
+    for name in base.keys() - cur.keys():
+        print(f"{name:<{width}}  {base[name]:>12.1f}  {'-':>12}  {'gone':>8}")
+
+    if regressions:
+        print(f"\n{regressions} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
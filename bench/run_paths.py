@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Time each way of running a Fakelang program from the command line.
+
+Usage:
+  run_paths.py BUILD_DIR [--cc cc] [--repeat 3] [GEN_ARGS...]
+
+For a program written by BUILD_DIR/fakelang-gen (extra arguments are passed
+to it, e.g. --classes=2000 --main-stmts=20000), reports the best wall time of:
+  interp     fakelangc --interp
+  jit        fakelangc --jit
+  aot        fakelangc --emit=obj, link with CC, run the executable
+  aot-run    the linked executable alone
+and checks that all paths print the same output and exit with the same status.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def best_of(repeat, cmd):
+    """Run `cmd` `repeat` times; return (best wall seconds, stdout, status)."""
+    best = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, check=False)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best, proc.stdout, proc.returncode
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("build_dir")
+    ap.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    ap.add_argument("--repeat", type=int, default=3)
+    args, gen_args = ap.parse_known_args()
+
+    fakelangc = os.path.join(args.build_dir, "fakelangc")
+    gen = os.path.join(args.build_dir, "fakelang-gen")
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, "prog.fakelang")
+        obj = os.path.join(tmp, "prog.o")
+        exe = os.path.join(tmp, "prog")
+        subprocess.run([gen, *gen_args, "-o", src], check=True)
+
+        def aot():
+            subprocess.run([fakelangc, src, "--emit=obj", "-o", obj], check=True)
+            subprocess.run([args.cc, obj, "-o", exe], check=True)
+            return subprocess.run([exe], stdout=subprocess.PIPE, check=False)
+
+        results = {}
+        results["interp"] = best_of(args.repeat, [fakelangc, src, "--interp"])
+        results["jit"] = best_of(args.repeat, [fakelangc, src, "--jit"])
+        best = None
+        for _ in range(args.repeat):
+            start = time.perf_counter()
+            proc = aot()
+            elapsed = time.perf_counter() - start
+            best = elapsed if best is None else min(best, elapsed)
+        results["aot"] = (best, proc.stdout, proc.returncode)
+        results["aot-run"] = best_of(args.repeat, [exe])
+
+    _, ref_out, ref_status = results["aot-run"]
+    mismatches = 0
+    print(f"{'Path':<8}  {'Wall (s)':>9}  Output")
+    for name, (secs, out, status) in results.items():
+        same = out == ref_out and status == ref_status
+        mismatches += not same
+        print(f"{name:<8}  {secs:>9.3f}  {'same' if same else 'DIFFERS'}")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
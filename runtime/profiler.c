@@ -0,0 +1,464 @@
+// Fakelang sampling profiler runtime.
+//
+// Link this into a program compiled with `fakelangc -g`:
+//   fakelangc prog.fakelang -g --emit=obj -o prog.o
+//   cc prog.o -Wl,--whole-archive build/libfakelang_prof.a -Wl,--no-whole-archive -o prog
+// (nothing in prog.o references the runtime, so a plain archive on the link
+// line would contribute no members).
+// A constructor arms a SIGPROF interval timer; the handler records the
+// interrupted PC and a short backtrace. At exit the samples are mapped to
+// file:line through the DWARF line tables of the running executable
+// (/proc/self/exe) and a hot-line report is printed to stderr. A sample taken
+// in code without line info (e.g. puts in libc) is charged to the nearest
+// caller that has it: "self" counts samples in the line's own code, "total"
+// adds the library time it called into.
+//
+// Environment:
+//   FAKELANG_PROF_HZ   sampling rate in Hz of CPU time (default 1000)
+//   FAKELANG_PROF_TOP  lines in the report (default 20)
+//
+// Supports ELF64 executables on Linux (x86-64, AArch64) and DWARF 2-4 line
+// tables, which is what `fakelangc -g` emits. Elsewhere the runtime does
+// nothing.
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
+#include <elf.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <link.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+enum { kMaxSamples = 1 << 18, kMaxFrames = 16 };
+
+// DWARF line-number opcodes (DWARF 4, section 6.2.5)
+enum {
+  kLnsCopy = 1,
+  kLnsAdvancePc = 2,
+  kLnsAdvanceLine = 3,
+  kLnsSetFile = 4,
+  kLnsConstAddPc = 8,
+  kLnsFixedAdvancePc = 9,
+  kLneEndSequence = 1,
+  kLneSetAddress = 2,
+};
+
+/// Per sample: the interrupted PC, then return addresses (minus one, so they
+/// fall inside the call instruction) of its callers.
+static uintptr_t g_stacks[kMaxSamples][kMaxFrames];
+static uint8_t g_depths[kMaxSamples];
+static volatile size_t g_numSamples;
+static volatile size_t g_droppedSamples;
+static unsigned g_hz;
+
+// ---------------------------------------------------------------------------
+// Sampling
+
+static void onProfSignal(int sig, siginfo_t* info, void* uctx) {
+  (void)sig;
+  (void)info;
+  const ucontext_t* uc = (const ucontext_t*)uctx;
+#if defined(__x86_64__)
+  const uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+#else
+  const uintptr_t pc = (uintptr_t)uc->uc_mcontext.pc;
+#endif
+  const size_t i = __atomic_fetch_add(&g_numSamples, 1, __ATOMIC_RELAXED);
+  if (i >= kMaxSamples) {
+    __atomic_fetch_add(&g_droppedSamples, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  // The unwinder steps through the signal frame; the interrupted PC appears
+  // after the handler's own frames.
+  void* frames[kMaxFrames + 4];
+  const int n = backtrace(frames, kMaxFrames + 4);
+  int start = 0;
+  while (start < n && (uintptr_t)frames[start] != pc) ++start;
+  uintptr_t* stack = g_stacks[i];
+  unsigned depth = 0;
+  stack[depth++] = pc;
+  for (int k = start + 1; k < n && depth < kMaxFrames; ++k) stack[depth++] = (uintptr_t)frames[k] - 1;
+  g_depths[i] = (uint8_t)depth;
+}
+
+static unsigned envUnsigned(const char* name, unsigned fallback) {
+  const char* s = getenv(name);
+  if (!s || !*s) return fallback;
+  char* end;
+  const unsigned long v = strtoul(s, &end, 10);
+  return *end == '\0' && v > 0 && v <= 1000000 ? (unsigned)v : fallback;
+}
+
+static void stopTimer(void) {
+  struct itimerval off;
+  memset(&off, 0, sizeof off);
+  setitimer(ITIMER_PROF, &off, NULL);
+  signal(SIGPROF, SIG_IGN);
+}
+
+// ---------------------------------------------------------------------------
+// DWARF line tables
+
+/// One row of a line table. Rows with `end` set close an address range.
+typedef struct {
+  uint64_t address;
+  const char* file;
+  uint32_t line;
+  int end;
+} LineRow;
+
+typedef struct {
+  LineRow* rows;
+  size_t size;
+  size_t capacity;
+} LineTable;
+
+static int pushRow(LineTable* t, uint64_t address, const char* file, uint32_t line, int end) {
+  if (t->size == t->capacity) {
+    const size_t cap = t->capacity ? t->capacity * 2 : 1024;
+    LineRow* rows = (LineRow*)realloc(t->rows, cap * sizeof(LineRow));
+    if (!rows) return 0;
+    t->rows = rows;
+    t->capacity = cap;
+  }
+  t->rows[t->size++] = (LineRow){address, file, line, end};
+  return 1;
+}
+
+/// Bounds-checked reader over a section.
+typedef struct {
+  const uint8_t* p;
+  const uint8_t* end;
+  int ok;
+} Reader;
+
+static uint64_t readN(Reader* r, unsigned n) {
+  if (!r->ok || (size_t)(r->end - r->p) < n) {
+    r->ok = 0;
+    return 0;
+  }
+  uint64_t v = 0;
+  for (unsigned i = 0; i < n; ++i) v |= (uint64_t)r->p[i] << (8 * i); // little-endian targets only
+  r->p += n;
+  return v;
+}
+
+static uint64_t readULEB(Reader* r) {
+  uint64_t v = 0;
+  unsigned shift = 0;
+  for (;;) {
+    const uint8_t b = (uint8_t)readN(r, 1);
+    if (!r->ok) return 0;
+    if (shift < 64) v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if (!(b & 0x80)) return v;
+  }
+}
+
+static int64_t readSLEB(Reader* r) {
+  int64_t v = 0;
+  unsigned shift = 0;
+  uint8_t b;
+  do {
+    b = (uint8_t)readN(r, 1);
+    if (!r->ok) return 0;
+    if (shift < 64) v |= (int64_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  if (shift < 64 && (b & 0x40)) v |= -((int64_t)1 << shift);
+  return v;
+}
+
+static const char* readString(Reader* r) {
+  const char* s = (const char*)r->p;
+  const uint8_t* nul = (const uint8_t*)memchr(r->p, 0, (size_t)(r->end - r->p));
+  if (!r->ok || !nul) {
+    r->ok = 0;
+    return "";
+  }
+  r->p = nul + 1;
+  return s;
+}
+
+/// Run one line-number program (a unit of .debug_line) and append its rows.
+/// Units of unsupported versions are skipped.
+static void readLineUnit(const uint8_t* unit, const uint8_t* unitEnd, int offset64, LineTable* out) {
+  Reader r = {unit, unitEnd, 1};
+  const unsigned version = (unsigned)readN(&r, 2);
+  if (version < 2 || version > 4) return;
+  const uint64_t headerLength = readN(&r, offset64 ? 8 : 4);
+  if (!r.ok || headerLength > (uint64_t)(r.end - r.p)) return;
+  const uint8_t* program = r.p + headerLength;
+  const unsigned minInstLength = (unsigned)readN(&r, 1);
+  if (version >= 4) (void)readN(&r, 1); // maximum_operations_per_instruction (VLIW only)
+  (void)readN(&r, 1); // default_is_stmt
+  const int lineBase = (int8_t)readN(&r, 1);
+  const unsigned lineRange = (unsigned)readN(&r, 1);
+  const unsigned opcodeBase = (unsigned)readN(&r, 1);
+  if (!r.ok || lineRange == 0 || opcodeBase == 0) return;
+  const uint8_t* opcodeLengths = r.p;
+  r.p += opcodeBase - 1;
+  while (r.ok && r.p < program && *r.p) (void)readString(&r); // include_directories
+  if (r.ok && r.p < program) ++r.p;
+  const char* files[256];
+  unsigned numFiles = 0;
+  while (r.ok && r.p < program && *r.p) {
+    const char* name = readString(&r);
+    (void)readULEB(&r); // directory index
+    (void)readULEB(&r); // modification time
+    (void)readULEB(&r); // length
+    if (numFiles < 256) files[numFiles++] = name;
+  }
+  if (!r.ok) return;
+
+  r.p = program;
+  uint64_t address = 0;
+  uint64_t file = 1;
+  int64_t line = 1;
+#define FILE_NAME() (file >= 1 && file <= numFiles ? files[file - 1] : "?")
+  while (r.ok && r.p < r.end) {
+    const unsigned op = (unsigned)readN(&r, 1);
+    if (op >= opcodeBase) {
+      const unsigned adjusted = op - opcodeBase;
+      address += (uint64_t)(adjusted / lineRange) * minInstLength;
+      line += lineBase + (int)(adjusted % lineRange);
+      if (!pushRow(out, address, FILE_NAME(), (uint32_t)line, 0)) return;
+      continue;
+    }
+    switch (op) {
+      case 0: { // extended opcode
+        const uint64_t len = readULEB(&r);
+        if (!r.ok || len == 0 || len > (uint64_t)(r.end - r.p)) return;
+        const uint8_t* next = r.p + len;
+        const unsigned sub = (unsigned)readN(&r, 1);
+        if (sub == kLneEndSequence) {
+          if (!pushRow(out, address, FILE_NAME(), (uint32_t)line, 1)) return;
+          address = 0;
+          file = 1;
+          line = 1;
+        } else if (sub == kLneSetAddress && len - 1 <= 8) {
+          address = readN(&r, (unsigned)(len - 1));
+        }
+        r.p = next;
+        break;
+      }
+      case kLnsCopy:
+        if (!pushRow(out, address, FILE_NAME(), (uint32_t)line, 0)) return;
+        break;
+      case kLnsAdvancePc: address += readULEB(&r) * minInstLength; break;
+      case kLnsAdvanceLine: line += readSLEB(&r); break;
+      case kLnsSetFile: file = readULEB(&r); break;
+      case kLnsConstAddPc: address += (uint64_t)((255 - opcodeBase) / lineRange) * minInstLength; break;
+      case kLnsFixedAdvancePc: address += readN(&r, 2); break;
+      default:
+        // Other standard opcodes only set flags; skip their ULEB operands
+        for (unsigned i = 0; i < opcodeLengths[op - 1]; ++i) (void)readULEB(&r);
+        break;
+    }
+  }
+#undef FILE_NAME
+}
+
+/// Parse every unit of a .debug_line section.
+static void readLineSection(const uint8_t* p, const uint8_t* end, LineTable* out) {
+  while ((size_t)(end - p) >= 4) {
+    Reader r = {p, end, 1};
+    uint64_t length = readN(&r, 4);
+    int offset64 = 0;
+    if (length == 0xffffffffu) {
+      length = readN(&r, 8);
+      offset64 = 1;
+    }
+    if (!r.ok || length > (uint64_t)(end - r.p)) return;
+    readLineUnit(r.p, r.p + length, offset64, out);
+    p = r.p + length;
+  }
+}
+
+static int compareRows(const void* a, const void* b) {
+  const LineRow* x = (const LineRow*)a;
+  const LineRow* y = (const LineRow*)b;
+  if (x->address != y->address) return x->address < y->address ? -1 : 1;
+  return x->end - y->end; // an end row and a new sequence may share an address
+}
+
+/// Row covering `address`, or NULL if it falls outside every sequence.
+static const LineRow* lookupRow(const LineTable* t, uint64_t address) {
+  size_t lo = 0, hi = t->size;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (t->rows[mid].address <= address) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == 0) return NULL;
+  const LineRow* row = &t->rows[lo - 1];
+  return row->end ? NULL : row;
+}
+
+/// Map the running executable and collect its line tables.
+static int loadLineTable(LineTable* out, void** map, size_t* mapSize) {
+  const int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 0;
+  struct stat st;
+  void* base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Elf64_Ehdr)) {
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) return 0;
+  *map = base;
+  *mapSize = (size_t)st.st_size;
+
+  const uint8_t* file = (const uint8_t*)base;
+  const Elf64_Ehdr* eh = (const Elf64_Ehdr*)file;
+  if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64) return 0;
+  if (eh->e_shoff == 0 || eh->e_shentsize != sizeof(Elf64_Shdr) || eh->e_shstrndx >= eh->e_shnum ||
+      eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > *mapSize) {
+    return 0;
+  }
+  const Elf64_Shdr* sh = (const Elf64_Shdr*)(file + eh->e_shoff);
+  const Elf64_Shdr* strtab = &sh[eh->e_shstrndx];
+  if (strtab->sh_offset + strtab->sh_size > *mapSize) return 0;
+  for (unsigned i = 0; i < eh->e_shnum; ++i) {
+    if (sh[i].sh_name >= strtab->sh_size) continue;
+    const char* name = (const char*)file + strtab->sh_offset + sh[i].sh_name;
+    if (strcmp(name, ".debug_line") != 0) continue;
+    if ((sh[i].sh_flags & SHF_COMPRESSED) || sh[i].sh_offset + sh[i].sh_size > *mapSize) return 0;
+    readLineSection(file + sh[i].sh_offset, file + sh[i].sh_offset + sh[i].sh_size, out);
+  }
+  qsort(out->rows, out->size, sizeof(LineRow), compareRows);
+  return out->size != 0;
+}
+
+static int onFirstObject(struct dl_phdr_info* info, size_t size, void* data) {
+  (void)size;
+  *(uintptr_t*)data = (uintptr_t)info->dlpi_addr;
+  return 1; // the executable comes first
+}
+
+// ---------------------------------------------------------------------------
+// Report
+
+typedef struct {
+  const char* file;
+  uint32_t line;
+  size_t self;
+  size_t total;
+} HotLine;
+
+static int compareByLocation(const void* a, const void* b) {
+  const HotLine* x = (const HotLine*)a;
+  const HotLine* y = (const HotLine*)b;
+  if (x->file != y->file) {
+    const int c = strcmp(x->file, y->file);
+    if (c != 0) return c;
+  }
+  return x->line < y->line ? -1 : x->line > y->line;
+}
+
+static int compareByTotal(const void* a, const void* b) {
+  const HotLine* x = (const HotLine*)a;
+  const HotLine* y = (const HotLine*)b;
+  if (x->total != y->total) return x->total > y->total ? -1 : 1;
+  return compareByLocation(a, b);
+}
+
+static void report(void) {
+  stopTimer();
+  size_t n = g_numSamples;
+  if (n > kMaxSamples) n = kMaxSamples;
+  fprintf(stderr, "fakelang-prof: %zu samples at %u Hz", n, g_hz);
+  if (g_droppedSamples) fprintf(stderr, " (%zu dropped)", (size_t)g_droppedSamples);
+  fputc('\n', stderr);
+  if (n == 0) return;
+
+  LineTable table = {NULL, 0, 0};
+  void* map = NULL;
+  size_t mapSize = 0;
+  if (!loadLineTable(&table, &map, &mapSize)) {
+    fprintf(stderr, "fakelang-prof: no DWARF line table in the executable (compile with -g)\n");
+  }
+  uintptr_t bias = 0;
+  dl_iterate_phdr(onFirstObject, &bias);
+
+  // One entry per attributed sample, merged per line below
+  HotLine* lines = (HotLine*)malloc(n * sizeof(HotLine));
+  size_t numLines = 0, outside = 0;
+  for (size_t i = 0; lines && i < n; ++i) {
+    const LineRow* row = NULL;
+    unsigned d = 0;
+    for (; d < g_depths[i] && !row; ++d) {
+      row = lookupRow(&table, (uint64_t)(g_stacks[i][d] - bias));
+      if (row && row->line == 0) row = NULL;
+    }
+    if (row) lines[numLines++] = (HotLine){row->file, row->line, d == 1, 1};
+    else ++outside;
+  }
+  if (lines) {
+    qsort(lines, numLines, sizeof(HotLine), compareByLocation);
+    size_t unique = 0;
+    for (size_t i = 0; i < numLines; ++i) {
+      if (unique > 0 && compareByLocation(&lines[unique - 1], &lines[i]) == 0) {
+        lines[unique - 1].self += lines[i].self;
+        lines[unique - 1].total += lines[i].total;
+      } else {
+        lines[unique++] = lines[i];
+      }
+    }
+    qsort(lines, unique, sizeof(HotLine), compareByTotal);
+    const unsigned top = envUnsigned("FAKELANG_PROF_TOP", 20);
+    fprintf(stderr, "%8s  %8s  %6s  %s\n", "self", "total", "total%", "location");
+    for (size_t i = 0; i < unique && i < top; ++i) {
+      fprintf(stderr, "%8zu  %8zu  %5.1f%%  %s:%u\n", lines[i].self, lines[i].total,
+              100.0 * (double)lines[i].total / (double)n, lines[i].file, lines[i].line);
+    }
+    if (outside) {
+      fprintf(stderr, "%8zu  %8zu  %5.1f%%  (no line info on the stack)\n", outside, outside,
+              100.0 * (double)outside / (double)n);
+    }
+  }
+  free(lines);
+  free(table.rows);
+  if (map) munmap(map, mapSize);
+}
+
+__attribute__((constructor)) static void startProfiler(void) {
+  g_hz = envUnsigned("FAKELANG_PROF_HZ", 1000);
+  // Load the unwinder now; its first use may allocate, which a signal
+  // handler must not do.
+  void* warmup[1];
+  (void)backtrace(warmup, 1);
+  struct sigaction sa;
+  memset(&sa, 0, sizeof sa);
+  sa.sa_sigaction = onProfSignal;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if (sigaction(SIGPROF, &sa, NULL) != 0) return;
+  const unsigned periodUs = 1000000 / g_hz;
+  struct itimerval tv;
+  tv.it_interval.tv_sec = (time_t)(periodUs / 1000000);
+  tv.it_interval.tv_usec = (suseconds_t)(periodUs % 1000000);
+  tv.it_value = tv.it_interval;
+  if (setitimer(ITIMER_PROF, &tv, NULL) != 0) return;
+  atexit(report);
+}
+
+#else
+
+// Unsupported platform: linking the runtime has no effect.
+typedef int fakelang_prof_unsupported;
+
+#endif
@@ -2,6 +2,7 @@
 // A minimal, readable AST to support classes, methods, and a small main.
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -12,10 +13,39 @@
 
 namespace fakelang {
 
+// ---------------------------------------------------------------------------
+// Semantic annotations
+//
+// The parser leaves these fields at their defaults; Sema fills them in so
+// CodeGen can lower by index instead of looking names up. The optional
+// partial evaluator (PartialEval.h) adds facts known at compile time.
+// ---------------------------------------------------------------------------
+
+/// Dense class index: position of the class in Program::classes.
+using ClassId = uint32_t;
+/// Marks an unresolved class, slot, or local.
+inline constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+/// A resolved type: a builtin or a class.
+struct SemaType {
+  enum class Kind : uint8_t { Unresolved, Int, String, Class };
+  Kind kind{Kind::Unresolved};
+  /// Valid when kind == Class.
+  ClassId classId{kInvalidIndex};
+
+  static SemaType intTy() { return SemaType{Kind::Int, kInvalidIndex}; }
+  static SemaType stringTy() { return SemaType{Kind::String, kInvalidIndex}; }
+  static SemaType classTy(ClassId id) { return SemaType{Kind::Class, id}; }
+  bool isClass() const { return kind == Kind::Class; }
+  bool operator==(const SemaType&) const = default;
+};
+
 /// Type reference used by AST nodes.
 /// Types are referenced by name (e.g., "Int", "String", or a class name).
 struct TypeRef {
   std::string name;
+  /// Resolved by Sema.
+  SemaType resolved{};
 };
 
 // Forward declarations
@@ -27,6 +57,8 @@ struct Expr {
   virtual ~Expr() = default;
   // Source range covering this expression in the original file
   SourceRange loc{};
+  /// Static type, resolved by Sema.
+  SemaType type{};
 };
 
 /// A string literal expression "..."
@@ -42,17 +74,29 @@ struct IntExpr : Expr {
 /// Variable reference expression: `a`.
 struct VarExpr : Expr {
   std::string name;
+  /// Local slot of the referenced variable, resolved by Sema.
+  uint32_t slot{kInvalidIndex};
 };
 
 /// Object creation expression: `new ClassName()`.
 struct NewExpr : Expr {
   std::string className;
+  /// Resolved by Sema.
+  ClassId classId{kInvalidIndex};
 };
 
 /// Virtual method call with no arguments: `<recv>.<method>()`.
 struct MethodCallExpr : Expr {
   std::unique_ptr<Expr> receiver;
   std::string methodName;
+  /// Static class of the receiver and the vtable slot called, resolved by Sema.
+  ClassId classId{kInvalidIndex};
+  uint32_t vtableSlot{kInvalidIndex};
+  /// Exact dynamic class of the receiver, if the partial evaluator knows it.
+  ClassId exactClassId{kInvalidIndex};
+  /// Literal (StringExpr or IntExpr) the call always returns, if the callee
+  /// is side-effect free and the partial evaluator computed its result.
+  const Expr* folded{nullptr};
 };
 
 /// Base class for all statement nodes.
@@ -70,6 +114,8 @@ struct ReturnStmt : Stmt {
 /// Print statement: `print(expr);` emits a call to `puts` at codegen.
 struct PrintStmt : Stmt {
   std::unique_ptr<Expr> value; // expects string at runtime
+  /// The printed string, if the partial evaluator computed it.
+  const StringExpr* constant{nullptr};
 };
 
 /// Variable declaration: `var name: Type = init;`.
@@ -77,8 +123,23 @@ struct VarDeclStmt : Stmt {
   std::string name;
   TypeRef type;
   std::unique_ptr<Expr> init; // e.g., 'new Class()'
+  /// Local slot assigned by Sema (dense per function body).
+  uint32_t slot{kInvalidIndex};
 };
 
+/// Call `fn` with each statement of `body` before its first return, in
+/// order, and return that return statement (nullptr if there is none).
+/// Statements after a return are never lowered, so analyses that must agree
+/// with the generated code walk bodies through this.
+template <typename Fn>
+ReturnStmt* forEachStmtBeforeReturn(const std::vector<std::unique_ptr<Stmt>>& body, Fn&& fn) {
+  for (const auto& s : body) {
+    if (auto* r = dynamic_cast<ReturnStmt*>(s.get())) return r;
+    fn(*s);
+  }
+  return nullptr;
+}
+
 /// Method attribute: either none, virtual, or override.
 enum class MethodAttr { None, Virtual, Override };
 
@@ -91,6 +152,10 @@ struct MethodDecl {
   std::vector<std::unique_ptr<Stmt>> body;
   // Source range from the first token of the method header to the closing brace
   SourceRange loc{};
+  /// Vtable slot of a virtual/override method (kInvalidIndex otherwise), and
+  /// the number of local slots in the body; resolved by Sema.
+  uint32_t vtableSlot{kInvalidIndex};
+  uint32_t numLocals{0};
 };
 
 /// Class declaration with an optional base class and zero or more methods.
@@ -100,6 +165,11 @@ struct ClassDecl {
   std::vector<MethodDecl> methods;
   // Source range from 'class' to the closing brace
   SourceRange loc{};
+  /// Resolved by Sema: kInvalidIndex when there is no base class.
+  ClassId baseId{kInvalidIndex};
+  /// Declared by another file of the program (CompileOptions::imports). Its
+  /// methods have no bodies here: they are defined in that file's module.
+  bool imported{false};
 };
 
 /// Free function (only 'main' is expected for the demo).
@@ -109,6 +179,8 @@ struct FunctionDecl {
   std::vector<std::unique_ptr<Stmt>> body;
   // Source range from 'function' to the closing brace
   SourceRange loc{};
+  /// Number of local slots in the body; resolved by Sema.
+  uint32_t numLocals{0};
 };
 
 /// Root of the AST: a sequence of classes and free functions.
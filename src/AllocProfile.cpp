@@ -0,0 +1,120 @@
+#include "AllocProfile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace fakelang {
+
+namespace {
+
+/// Innermost region of this thread, and the bytes this thread has allocated
+/// and not freed.
+thread_local AllocScope* tCurrent = nullptr;
+thread_local int64_t tLive = 0;
+
+} // namespace
+
+AllocScope::AllocScope(AllocCounts* counts) : counts_(kAllocProfiling ? counts : nullptr) {
+  if (!counts_) return;
+  parent_ = tCurrent;
+  startLive_ = peakLive_ = tLive;
+  tCurrent = this;
+}
+
+AllocScope::~AllocScope() {
+  if (!counts_) return;
+  const auto peak = static_cast<uint64_t>(std::max<int64_t>(peakLive_ - startLive_, 0));
+  counts_->peakLiveBytes = std::max(counts_->peakLiveBytes, peak);
+  tCurrent = parent_;
+  if (parent_) parent_->peakLive_ = std::max(parent_->peakLive_, peakLive_);
+}
+
+void AllocScope::recordAllocation(size_t bytes) {
+  tLive += static_cast<int64_t>(bytes);
+  AllocScope* s = tCurrent;
+  if (!s) return;
+  ++s->counts_->allocations;
+  s->counts_->bytes += bytes;
+  s->peakLive_ = std::max(s->peakLive_, tLive);
+}
+
+void AllocScope::recordFree(size_t bytes) { tLive -= static_cast<int64_t>(bytes); }
+
+} // namespace fakelang
+
+#if defined(FAKELANG_ALLOC_PROFILE)
+
+namespace {
+
+/// Stored just below every block handed out: its size for the counters, and
+/// how far it is from what malloc returned.
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+  size_t size;
+  size_t offset;
+};
+
+void* allocate(size_t size, size_t align) noexcept {
+  align = std::max(align, alignof(BlockHeader));
+  const size_t offset = (sizeof(BlockHeader) + align - 1) / align * align;
+  void* base = nullptr;
+  if (align <= alignof(std::max_align_t)) {
+    base = std::malloc(offset + size);
+  } else {
+    base = std::aligned_alloc(align, (offset + size + align - 1) / align * align);
+  }
+  if (!base) return nullptr;
+  char* block = static_cast<char*>(base) + offset;
+  auto* header = reinterpret_cast<BlockHeader*>(block) - 1;
+  header->size = size;
+  header->offset = offset;
+  fakelang::AllocScope::recordAllocation(size);
+  return block;
+}
+
+void* allocateOrThrow(size_t size, size_t align) {
+  void* p = allocate(size, align);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void deallocate(void* p) noexcept {
+  if (!p) return;
+  const auto* header = static_cast<BlockHeader*>(p) - 1;
+  fakelang::AllocScope::recordFree(header->size);
+  std::free(static_cast<char*>(p) - header->offset);
+}
+
+constexpr size_t kDefaultAlign = alignof(std::max_align_t);
+
+} // namespace
+
+// Every replaceable form, so no block is allocated by one allocator and freed
+// by the other.
+void* operator new(size_t size) { return allocateOrThrow(size, kDefaultAlign); }
+void* operator new[](size_t size) { return allocateOrThrow(size, kDefaultAlign); }
+void* operator new(size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<size_t>(al)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, kDefaultAlign); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, kDefaultAlign); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+  return allocate(size, static_cast<size_t>(al));
+}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+  return allocate(size, static_cast<size_t>(al));
+}
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+
+#endif // FAKELANG_ALLOC_PROFILE
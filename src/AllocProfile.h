@@ -0,0 +1,58 @@
+// Fakelang allocation profiler: heap allocations made by the compiler,
+// attributed to the compiler phase that made them.
+//
+// Configuring with -DFAKELANG_ALLOC_PROFILE=ON replaces the global operator
+// new and delete with counting versions (AllocProfile.cpp). Each allocation
+// is charged to the innermost AllocScope alive on the allocating thread;
+// PhaseTimers::Scope opens one per phase, so `--time-phases` reports
+// allocations next to times. Memory LLVM gets from malloc directly (e.g.
+// SmallVector growth) is not seen. Without the option nothing is counted and
+// AllocScope does nothing.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fakelang {
+
+/// Whether this build counts allocations (FAKELANG_ALLOC_PROFILE).
+#if defined(FAKELANG_ALLOC_PROFILE)
+inline constexpr bool kAllocProfiling = true;
+#else
+inline constexpr bool kAllocProfiling = false;
+#endif
+
+/// Heap allocations charged to one phase, over every time it was entered.
+struct AllocCounts {
+  uint64_t allocations{0};
+  uint64_t bytes{0};
+  /// Most bytes allocated since the phase was entered and not yet freed, at
+  /// any point in it (nested phases included).
+  uint64_t peakLiveBytes{0};
+};
+
+/// RAII region charging the current thread's allocations to `counts`.
+/// Regions nest; a null `counts` (or a build without profiling) makes the
+/// region a no-op.
+class AllocScope {
+public:
+  explicit AllocScope(AllocCounts* counts);
+  ~AllocScope();
+  AllocScope(const AllocScope&) = delete;
+  AllocScope& operator=(const AllocScope&) = delete;
+
+  /// Called by the operator new and delete replacements.
+  static void recordAllocation(size_t bytes);
+  static void recordFree(size_t bytes);
+
+private:
+  AllocCounts* counts_;
+  AllocScope* parent_{nullptr};
+  /// Bytes live on this thread when the region began, and at most since.
+  /// Signed: blocks may be freed by another thread than the one that
+  /// allocated them.
+  int64_t startLive_{0};
+  int64_t peakLive_{0};
+};
+
+} // namespace fakelang
@@ -0,0 +1,153 @@
+#include "BatchCompiler.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace fakelang {
+
+std::string BatchCompiler::outputPathFor(const std::string& input, const std::string& outDir,
+                                         const char* ext) {
+  llvm::SmallString<256> path;
+  if (outDir.empty()) {
+    path = input;
+  } else {
+    path = outDir;
+    llvm::sys::path::append(path, llvm::sys::path::filename(input));
+  }
+  llvm::sys::path::replace_extension(path, ext);
+  return std::string(path.str());
+}
+
+/// Run the read -> compile -> write pipeline over the jobs of `all` with an
+/// output of their own. Results are written in completion order; the number
+/// of files buffered between the read and write stages is bounded by twice
+/// the worker count.
+size_t BatchCompiler::run(const std::vector<BatchJob>& all) {
+  // Jobs sharing an output fail up front; the rest run
+  auto outputKey = [](const BatchJob& job) {
+    llvm::SmallString<256> path(job.output);
+    llvm::sys::path::remove_dots(path, /*remove_dot_dot=*/true);
+    return std::string(path.str());
+  };
+  std::map<std::string, std::vector<const BatchJob*>> byOutput;
+  for (const BatchJob& job : all) byOutput[outputKey(job)].push_back(&job);
+  std::vector<const BatchJob*> batch;
+  size_t clashing = 0;
+  for (const BatchJob& job : all) {
+    const auto& sharing = byOutput[outputKey(job)];
+    if (sharing.size() == 1) {
+      batch.push_back(&job);
+      continue;
+    }
+    ++clashing;
+    const BatchJob* other = sharing[0] == &job ? sharing[1] : sharing[0];
+    diag_ << "error: " << job.input << ": output " << job.output << " is also the output of " << other->input
+          << "\n";
+  }
+  diag_.flush();
+  reports_.clear();
+  if (batch.empty()) return clashing;
+
+  llvm::ThreadPool pool(llvm::hardware_concurrency(jobs_));
+  const size_t maxInFlight = 2 * static_cast<size_t>(pool.getThreadCount());
+
+  struct Finished {
+    const BatchJob* job;
+    CompileResult result;
+  };
+
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<Finished> done; // compile stage -> write stage
+  size_t inFlight = 0;       // read but not yet written
+  size_t failed = 0;         // owned by the writer until join()
+  const bool wantReports = opts_.timePhases || opts_.collectStats;
+  // reports_ is owned by the writer until join()
+
+  auto finish = [&](const BatchJob& job, CompileResult result) {
+    {
+      std::lock_guard<std::mutex> lk(mu);
+      done.push_back(Finished{&job, std::move(result)});
+    }
+    cv.notify_all();
+  };
+
+  // Write stage: drain results until every job has been accounted for.
+  std::thread writer([&] {
+    for (size_t written = 0; written < batch.size(); ++written) {
+      Finished f;
+      {
+        std::unique_lock<std::mutex> lk(mu);
+        cv.wait(lk, [&] { return !done.empty(); });
+        f = std::move(done.front());
+        done.pop_front();
+      }
+      if (f.result.ok) {
+        std::error_code ec;
+        llvm::raw_fd_ostream os(f.job->output, ec, llvm::sys::fs::OF_None);
+        if (ec) {
+          f.result.ok = false;
+          f.result.error = "Failed to open output: " + ec.message();
+        } else {
+          os << f.result.output;
+        }
+      }
+      if (!f.result.ok) {
+        ++failed;
+        diag_ << "error: " << f.job->input << ": " << f.result.error << "\n";
+        diag_.flush();
+      }
+      if (wantReports) reports_.push_back(std::move(f.result.report));
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        --inFlight;
+      }
+      cv.notify_all();
+    }
+  });
+
+  // Read stage: runs on the calling thread, feeding the compile workers.
+  for (const BatchJob* next : batch) {
+    const BatchJob& job = *next;
+    {
+      std::unique_lock<std::mutex> lk(mu);
+      cv.wait(lk, [&] { return inFlight < maxInFlight; });
+      ++inFlight;
+    }
+    std::shared_ptr<llvm::MemoryBuffer> src;
+    try {
+      src = openInput(job.input);
+    } catch (const std::exception& ex) {
+      CompileResult res;
+      res.error = ex.what();
+      res.report.filename = job.input;
+      finish(job, std::move(res));
+      continue;
+    }
+    pool.async([this, &finish, &job, src = std::move(src)] {
+      finish(job, compileSource(src->getBuffer(), job.input, opts_));
+    });
+  }
+
+  pool.wait();
+  writer.join();
+  return failed + clashing;
+}
+
+} // namespace fakelang
@@ -0,0 +1,72 @@
+// Fakelang batch compiler: compiles many inputs in one process.
+// Reading, compilation, and output writing run as overlapping pipeline stages.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include "Driver.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+/// One unit of batch work: compile `input` and write the result to `output`.
+struct BatchJob {
+  std::string input;
+  std::string output;
+};
+
+/// Compiles a list of independent inputs on a worker pool.
+///
+/// The pipeline has three stages:
+/// - read: the calling thread reads input files, staying at most a bounded
+///   number of files ahead of the compile stage to cap memory use
+/// - compile: a pool of `jobs` workers, each compiling one file at a time
+///   with its own CodeGen/LLVMContext
+/// - write: a single writer thread that writes outputs and reports
+///   diagnostics as compilations complete
+///
+/// A failing input (unreadable file, syntax error, codegen error, unwritable
+/// output) is reported to `diag` and does not stop the remaining inputs.
+/// Inputs whose outputs are the same file (e.g. `a/main.fakelang` and
+/// `b/main.fakelang` with one output directory) all fail before anything is
+/// compiled, as the workers would race to write it.
+class BatchCompiler {
+public:
+  /// - jobs: number of compile workers (0 = one per hardware thread)
+  /// - opts: options applied to every input
+  /// - diag: stream for per-file diagnostics
+  BatchCompiler(unsigned jobs, CompileOptions opts, llvm::raw_ostream& diag)
+      : jobs_(jobs), opts_(opts), diag_(diag) {}
+
+  /// Run all jobs to completion and return the number that failed.
+  size_t run(const std::vector<BatchJob>& batch);
+
+  /// Per-input timings/statistics from the last run(), in completion order.
+  /// Empty unless the options requested phase timing or statistics.
+  const std::vector<CompileReport>& reports() const { return reports_; }
+
+  /// Derive the output path for `input`: `<outDir>/<stem><ext>` when `outDir`
+  /// is non-empty, otherwise `input` with its extension replaced by `ext`.
+  /// Inputs with the same file name map to the same output in `outDir`.
+  static std::string outputPathFor(const std::string& input, const std::string& outDir,
+                                   const char* ext = ".ll");
+
+private:
+  unsigned jobs_;
+  CompileOptions opts_;
+  llvm::raw_ostream& diag_;
+  std::vector<CompileReport> reports_;
+};
+
+} // namespace fakelang
@@ -0,0 +1,177 @@
+#include "BitcodeEmitter.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Compression.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/SourceMgr.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace fakelang {
+
+namespace {
+
+constexpr llvm::StringLiteral kMagic = "FLBZ";
+constexpr uint8_t kVersion = 1;
+/// Magic, version, format, reserved, bitcode size.
+constexpr size_t kHeaderSize = 4 + 1 + 1 + 2 + 8;
+
+llvm::compression::Format formatFor(BitcodeCompression c) {
+  return c == BitcodeCompression::Zstd ? llvm::compression::Format::Zstd : llvm::compression::Format::Zlib;
+}
+
+const char* nameOf(BitcodeCompression c) { return c == BitcodeCompression::Zstd ? "zstd" : "zlib"; }
+
+/// Throw unless this LLVM build can (de)compress `c`.
+void requireSupported(BitcodeCompression c) {
+  if (const char* reason = llvm::compression::getReasonIfUnsupported(formatFor(c))) {
+    throw std::runtime_error(std::string("Bitcode compression ") + nameOf(c) + " unavailable: " + reason);
+  }
+}
+
+} // namespace
+
+std::optional<BitcodeCompression> parseBitcodeCompression(std::string_view s) {
+  if (s == "zlib") return BitcodeCompression::Zlib;
+  if (s == "zstd") return BitcodeCompression::Zstd;
+  return std::nullopt;
+}
+
+BitcodeCompression defaultBitcodeCompression() {
+  if (!llvm::compression::getReasonIfUnsupported(llvm::compression::Format::Zstd)) return BitcodeCompression::Zstd;
+  if (!llvm::compression::getReasonIfUnsupported(llvm::compression::Format::Zlib)) return BitcodeCompression::Zlib;
+  return BitcodeCompression::None;
+}
+
+void writeBitcode(const llvm::Module& module, BitcodeCompression compression, llvm::raw_ostream& os) {
+  if (compression == BitcodeCompression::None) {
+    llvm::WriteBitcodeToFile(module, os);
+    return;
+  }
+  requireSupported(compression);
+  llvm::SmallVector<char, 0> bitcode;
+  {
+    llvm::raw_svector_ostream bos(bitcode);
+    llvm::WriteBitcodeToFile(module, bos);
+  }
+  llvm::SmallVector<uint8_t, 0> packed;
+  llvm::compression::compress(llvm::compression::Params(formatFor(compression)),
+                              llvm::arrayRefFromStringRef(llvm::StringRef(bitcode.data(), bitcode.size())), packed);
+
+  llvm::support::endian::Writer w(os, llvm::support::little);
+  os << kMagic;
+  w.write<uint8_t>(kVersion);
+  w.write<uint8_t>(compression == BitcodeCompression::Zstd ? 2 : 1);
+  w.write<uint16_t>(0);
+  w.write<uint64_t>(bitcode.size());
+  os.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+}
+
+void writeThinLTOBitcode(const llvm::Module& module, llvm::raw_ostream& os) {
+  // No profile, so no block frequencies: the summary counts calls, not heat
+  llvm::ProfileSummaryInfo psi(module);
+  const llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, nullptr, &psi);
+  llvm::WriteBitcodeToFile(module, os, /*ShouldPreserveUseListOrder=*/false, &index);
+}
+
+void BitcodeStreamWriter::write(const llvm::Module& module) {
+  llvm::SmallVector<char, 0> bitcode;
+  {
+    llvm::raw_svector_ostream bos(bitcode);
+    llvm::WriteBitcodeToFile(module, bos);
+  }
+  // The file starts with one magic number; later modules follow as blocks
+  const size_t skip = first_ ? 0 : 4;
+  os_.write(bitcode.data() + skip, bitcode.size() - skip);
+  first_ = false;
+}
+
+bool isCompressedBitcode(llvm::StringRef data) { return data.startswith(kMagic); }
+
+namespace {
+
+/// Parse every module of a multi-module bitcode buffer and link them into
+/// the first. Returns null if `buffer` holds a single module.
+std::unique_ptr<llvm::Module> linkBitcodeModules(llvm::MemoryBufferRef buffer, llvm::LLVMContext& context) {
+  auto fail = [&](llvm::Error err) -> std::runtime_error {
+    return std::runtime_error("Failed to load " + buffer.getBufferIdentifier().str() + ": " +
+                              llvm::toString(std::move(err)));
+  };
+  llvm::Expected<std::vector<llvm::BitcodeModule>> mods = llvm::getBitcodeModuleList(buffer);
+  if (!mods) throw fail(mods.takeError());
+  if (mods->size() < 2) return nullptr;
+  std::unique_ptr<llvm::Module> linked;
+  for (llvm::BitcodeModule& bm : *mods) {
+    llvm::Expected<std::unique_ptr<llvm::Module>> m = bm.parseModule(context);
+    if (!m) throw fail(m.takeError());
+    if (!linked) {
+      linked = std::move(*m);
+    } else if (llvm::Linker::linkModules(*linked, std::move(*m))) {
+      throw std::runtime_error("Failed to link the modules of " + buffer.getBufferIdentifier().str());
+    }
+  }
+  return linked;
+}
+
+} // namespace
+
+std::unique_ptr<llvm::Module> loadModule(llvm::MemoryBufferRef buffer, llvm::LLVMContext& context) {
+  llvm::SmallVector<uint8_t, 0> bitcode;
+  if (isCompressedBitcode(buffer.getBuffer())) {
+    const llvm::StringRef data = buffer.getBuffer();
+    if (data.size() < kHeaderSize) {
+      throw std::runtime_error("Truncated compressed bitcode: " + buffer.getBufferIdentifier().str());
+    }
+    const auto* hdr = reinterpret_cast<const uint8_t*>(data.data());
+    if (hdr[4] != kVersion) {
+      throw std::runtime_error("Unsupported compressed bitcode version " + std::to_string(hdr[4]));
+    }
+    BitcodeCompression compression;
+    switch (hdr[5]) {
+      case 1: compression = BitcodeCompression::Zlib; break;
+      case 2: compression = BitcodeCompression::Zstd; break;
+      default: throw std::runtime_error("Unknown bitcode compression " + std::to_string(hdr[5]));
+    }
+    requireSupported(compression);
+    const uint64_t size = llvm::support::endian::read64le(hdr + 8);
+    if (llvm::Error err = llvm::compression::decompress(formatFor(compression),
+                                                        llvm::arrayRefFromStringRef(data.drop_front(kHeaderSize)),
+                                                        bitcode, static_cast<size_t>(size))) {
+      throw std::runtime_error("Failed to decompress " + buffer.getBufferIdentifier().str() + ": " +
+                               llvm::toString(std::move(err)));
+    }
+    buffer = llvm::MemoryBufferRef(llvm::toStringRef(bitcode), buffer.getBufferIdentifier());
+  }
+
+  if (llvm::isBitcode(buffer.getBuffer().bytes_begin(), buffer.getBuffer().bytes_end())) {
+    if (auto linked = linkBitcodeModules(buffer, context)) return linked;
+  }
+  llvm::SMDiagnostic diag;
+  std::unique_ptr<llvm::Module> module = llvm::parseIR(buffer, diag, context);
+  if (!module) {
+    std::string msg;
+    llvm::raw_string_ostream os(msg);
+    diag.print(nullptr, os, /*ShowColors=*/false);
+    throw std::runtime_error("Failed to load " + buffer.getBufferIdentifier().str() + ": " + os.str());
+  }
+  return module;
+}
+
+} // namespace fakelang
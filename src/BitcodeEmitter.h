@@ -0,0 +1,81 @@
+// Fakelang bitcode emitter: writes a finished module as LLVM bitcode, either
+// plain (readable by every LLVM tool) or inside a compressed container, and
+// loads any of the driver's IR outputs back.
+//
+// The container is
+//   "FLBZ" u8 version(1) u8 format u16 reserved(0) u64 bitcodeSize payload
+// (little-endian), where format is 1 for zlib and 2 for zstd and payload is
+// the compressed bitcode. Instruction metadata, including the `fakelang.src`
+// source mapping, is part of the bitcode and survives both forms.
+//
+// A streamed compile (CodeGen::generateStreaming) writes plain bitcode holding
+// one module per part, which loadModule() links back into one module. A
+// ThinLTO compile writes plain bitcode with a module summary.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBufferRef.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace fakelang {
+
+/// How `--emit=bc` output is packaged.
+enum class BitcodeCompression {
+  /// Plain bitcode.
+  None,
+  Zlib,
+  Zstd,
+};
+
+/// Parse a `--compress=` value ("zlib", "zstd"); returns std::nullopt if unknown.
+std::optional<BitcodeCompression> parseBitcodeCompression(std::string_view s);
+
+/// The best compression this LLVM build supports: zstd, else zlib, else None.
+BitcodeCompression defaultBitcodeCompression();
+
+/// Write `module` as bitcode to `os`, compressed into the container unless
+/// `compression` is None. Throws std::runtime_error if LLVM was built without
+/// the requested compressor.
+void writeBitcode(const llvm::Module& module, BitcodeCompression compression, llvm::raw_ostream& os);
+
+/// Write `module` as plain bitcode together with its ThinLTO module summary
+/// (calls, references, and the `!type` metadata of vtables), the form
+/// runThinLTO() and other ThinLTO linkers expect.
+void writeThinLTOBitcode(const llvm::Module& module, llvm::raw_ostream& os);
+
+/// Writes modules one after another into a single multi-module bitcode file,
+/// so that only the module being written is held in memory. Every module
+/// carries its own string table, as in a binary concatenation of bitcode files.
+class BitcodeStreamWriter {
+public:
+  explicit BitcodeStreamWriter(llvm::raw_ostream& os) : os_(os) {}
+  void write(const llvm::Module& module);
+
+private:
+  llvm::raw_ostream& os_;
+  bool first_{true};
+};
+
+/// True if `data` starts with the compressed container's magic.
+bool isCompressedBitcode(llvm::StringRef data);
+
+/// Parse textual IR, plain bitcode, or a compressed container into a module
+/// owned by `context`; the modules of multi-module bitcode are linked into
+/// the first. Throws std::runtime_error on malformed input.
+std::unique_ptr<llvm::Module> loadModule(llvm::MemoryBufferRef buffer, llvm::LLVMContext& context);
+
+} // namespace fakelang
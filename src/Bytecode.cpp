@@ -0,0 +1,167 @@
+#include "Bytecode.h"
+
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace fakelang {
+
+namespace {
+
+/// Lowers function bodies into one BytecodeModule.
+class BytecodeCompiler {
+public:
+  BytecodeCompiler(const Program& program, const ProgramInfo& info)
+      : program_(program), info_(info) {}
+
+  BytecodeModule run() {
+    // Function indices: all methods in class order, then free functions
+    methodBase_.reserve(program_.classes.size());
+    for (const auto& c : program_.classes) {
+      methodBase_.push_back(static_cast<uint32_t>(mod_.functions.size()));
+      mod_.classNames.push_back(c.name);
+      for (const auto& m : c.methods) mod_.functions.push_back(BytecodeFunction{c.name + "." + m.name, 0, 0});
+    }
+    const uint32_t firstFree = static_cast<uint32_t>(mod_.functions.size());
+    for (const auto& f : program_.functions) {
+      if (f.name == "main") mod_.mainFunction = static_cast<uint32_t>(mod_.functions.size());
+      mod_.functions.push_back(BytecodeFunction{f.name, 0, 0});
+    }
+    if (mod_.mainFunction == kInvalidIndex) throw std::runtime_error("No main function");
+
+    mod_.vtables.resize(program_.classes.size());
+    for (ClassId id = 0; id < program_.classes.size(); ++id) {
+      for (const MethodRef& impl : info_.layouts.impl(id)) mod_.vtables[id].push_back(functionOf(impl));
+    }
+
+    for (ClassId id = 0; id < program_.classes.size(); ++id) {
+      const auto& methods = program_.classes[id].methods;
+      for (uint32_t m = 0; m < methods.size(); ++m) {
+        compileBody(methodBase_[id] + m, methods[m].body, methods[m].numLocals, methods[m].returnType.resolved);
+      }
+    }
+    for (uint32_t i = 0; i < program_.functions.size(); ++i) {
+      const FunctionDecl& f = program_.functions[i];
+      compileBody(firstFree + i, f.body, f.numLocals, f.returnType.resolved);
+    }
+    return std::move(mod_);
+  }
+
+private:
+  uint32_t functionOf(MethodRef m) const { return methodBase_[m.cls] + m.method; }
+
+  void emit(Op op, std::initializer_list<uint32_t> operands) {
+    mod_.code.push_back(static_cast<uint32_t>(op));
+    mod_.code.insert(mod_.code.end(), operands);
+  }
+
+  uint32_t stringConstant(std::string_view s) {
+    auto [it, inserted] = stringConsts_.try_emplace(s, 0);
+    if (inserted) {
+      it->second = static_cast<uint32_t>(mod_.constants.size());
+      mod_.constants.push_back(BytecodeConstant{SemaType::stringTy(), 0, static_cast<uint32_t>(mod_.strings.size())});
+      mod_.strings.emplace_back(s);
+    }
+    return it->second;
+  }
+  uint32_t intConstant(int32_t v) {
+    auto [it, inserted] = intConsts_.try_emplace(v, 0);
+    if (inserted) {
+      it->second = static_cast<uint32_t>(mod_.constants.size());
+      mod_.constants.push_back(BytecodeConstant{SemaType::intTy(), v, kInvalidIndex});
+    }
+    return it->second;
+  }
+
+  uint32_t newTemp() {
+    const uint32_t r = nextReg_++;
+    if (nextReg_ > maxReg_) maxReg_ = nextReg_;
+    return r;
+  }
+
+  void compileBody(uint32_t fn, const std::vector<std::unique_ptr<Stmt>>& body, uint32_t numLocals,
+                   SemaType retType) {
+    mod_.functions[fn].entry = static_cast<uint32_t>(mod_.code.size());
+    nextReg_ = maxReg_ = numLocals;
+    bool returned = false;
+    for (const auto& s : body) {
+      compileStmt(s.get());
+      if (dynamic_cast<const ReturnStmt*>(s.get())) {
+        returned = true;
+        break;
+      }
+    }
+    if (!returned) {
+      // Falling off the end returns 0 or an empty string, like the LLVM default
+      const uint32_t r = newTemp();
+      emit(Op::LoadConst, {r, retType.kind == SemaType::Kind::Int ? intConstant(0) : stringConstant("")});
+      emit(Op::Ret, {r});
+    }
+    mod_.functions[fn].numRegs = maxReg_;
+  }
+
+  void compileStmt(const Stmt* s) {
+    const uint32_t mark = nextReg_; // temporaries die at the end of a statement
+    if (auto* r = dynamic_cast<const ReturnStmt*>(s)) {
+      emit(Op::Ret, {compileOperand(r->value.get())});
+    } else if (auto* p = dynamic_cast<const PrintStmt*>(s)) {
+      emit(Op::Print, {compileOperand(p->value.get())});
+    } else if (auto* vd = dynamic_cast<const VarDeclStmt*>(s)) {
+      compileInto(vd->init.get(), vd->slot);
+    } else {
+      throw std::runtime_error("Unhandled statement node");
+    }
+    nextReg_ = mark;
+  }
+
+  /// Return a register holding the value of `e`.
+  uint32_t compileOperand(const Expr* e) {
+    if (auto* ve = dynamic_cast<const VarExpr*>(e)) return ve->slot;
+    const uint32_t r = newTemp();
+    compileInto(e, r);
+    return r;
+  }
+
+  /// Evaluate `e` into register `dst`.
+  void compileInto(const Expr* e, uint32_t dst) {
+    if (auto* se = dynamic_cast<const StringExpr*>(e)) {
+      emit(Op::LoadConst, {dst, stringConstant(se->value)});
+    } else if (auto* ie = dynamic_cast<const IntExpr*>(e)) {
+      emit(Op::LoadConst, {dst, intConstant(ie->value)});
+    } else if (auto* ve = dynamic_cast<const VarExpr*>(e)) {
+      emit(Op::Move, {dst, ve->slot});
+    } else if (auto* ne = dynamic_cast<const NewExpr*>(e)) {
+      emit(Op::New, {dst, ne->classId});
+    } else if (auto* me = dynamic_cast<const MethodCallExpr*>(e)) {
+      if (me->folded) {
+        compileInto(me->folded, dst);
+      } else if (me->exactClassId != kInvalidIndex) {
+        emit(Op::CallDirect, {dst, functionOf(info_.layouts.impl(me->exactClassId)[me->vtableSlot])});
+      } else {
+        const uint32_t recv = static_cast<const VarExpr*>(me->receiver.get())->slot;
+        const uint32_t site = static_cast<uint32_t>(mod_.callSites.size());
+        mod_.callSites.push_back(BytecodeCallSite{me->classId, me->vtableSlot});
+        emit(Op::CallVirtual, {dst, recv, site});
+      }
+    } else {
+      throw std::runtime_error("Unhandled expression node");
+    }
+  }
+
+  const Program& program_;
+  const ProgramInfo& info_;
+  BytecodeModule mod_;
+  std::vector<uint32_t> methodBase_;
+  std::unordered_map<std::string_view, uint32_t> stringConsts_;
+  std::unordered_map<int32_t, uint32_t> intConsts_;
+  uint32_t nextReg_{0};
+  uint32_t maxReg_{0};
+};
+
+} // namespace
+
+BytecodeModule compileBytecode(const Program& program, const ProgramInfo& info) {
+  return BytecodeCompiler(program, info).run();
+}
+
+} // namespace fakelang
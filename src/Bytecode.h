@@ -0,0 +1,95 @@
+// Fakelang bytecode: a compact register-based encoding of a checked Program
+// for the interpreter (Interpreter.h).
+//
+// Code is a flat array of 32-bit words. Each instruction is an opcode word
+// followed by a fixed number of operand words (see operandCount()). Registers
+// are per-frame: registers [0, numLocals) hold the locals in the slots Sema
+// assigned, and temporaries follow. Vtables are taken from Sema's
+// ClassLayoutTable, so slot numbers match the LLVM lowering.
+#pragma once
+
+#include "AST.h"
+#include "Sema.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+enum class Op : uint32_t {
+  /// LoadConst dst, const: dst = constants[const]
+  LoadConst,
+  /// Move dst, src: dst = src
+  Move,
+  /// New dst, class: dst = a new object of class `class`
+  New,
+  /// CallVirtual dst, recv, site: dst = call through the vtable of recv's
+  /// class, at the slot of callSites[site]
+  CallVirtual,
+  /// CallDirect dst, function: dst = functions[function]()
+  CallDirect,
+  /// Print src: write the string in src and a newline
+  Print,
+  /// Ret src: return src to the caller
+  Ret,
+};
+inline constexpr size_t kNumOps = static_cast<size_t>(Op::Ret) + 1;
+
+/// Number of operand words following each opcode.
+constexpr uint32_t operandCount(Op op) {
+  switch (op) {
+    case Op::LoadConst: return 2;
+    case Op::Move: return 2;
+    case Op::New: return 2;
+    case Op::CallVirtual: return 3;
+    case Op::CallDirect: return 2;
+    case Op::Print: return 1;
+    case Op::Ret: return 1;
+  }
+  return 0;
+}
+
+/// A constant-pool entry: an Int or an index into BytecodeModule::strings.
+struct BytecodeConstant {
+  SemaType type;
+  int32_t intValue{0};
+  uint32_t stringIndex{kInvalidIndex};
+};
+
+/// A method or free function.
+struct BytecodeFunction {
+  std::string name;
+  /// Locals plus temporaries.
+  uint32_t numRegs{0};
+  /// Start of the function's instructions in BytecodeModule::code.
+  uint32_t entry{0};
+};
+
+/// A virtual call site: the vtable slot it calls.
+struct BytecodeCallSite {
+  /// Static class of the receiver (for diagnostics).
+  ClassId staticClass{kInvalidIndex};
+  uint32_t slot{kInvalidIndex};
+};
+
+/// A whole compiled program.
+struct BytecodeModule {
+  std::vector<uint32_t> code;
+  std::vector<BytecodeFunction> functions;
+  std::vector<BytecodeConstant> constants;
+  std::vector<std::string> strings;
+  std::vector<BytecodeCallSite> callSites;
+  /// Per class: slot -> index into `functions`.
+  std::vector<std::vector<uint32_t>> vtables;
+  std::vector<std::string> classNames;
+  /// Index of `main` in `functions`.
+  uint32_t mainFunction{kInvalidIndex};
+};
+
+/// Compile a Sema-checked (and optionally partially evaluated) program.
+/// Folded calls become constants and calls on receivers of known exact class
+/// become CallDirect. Throws std::runtime_error if there is no `main`.
+BytecodeModule compileBytecode(const Program& program, const ProgramInfo& info);
+
+} // namespace fakelang
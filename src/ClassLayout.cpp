@@ -0,0 +1,101 @@
+#include "ClassLayout.h"
+
+#include <cassert>
+
+namespace fakelang {
+
+/// Follow each unvisited class up its base chain, then emit the chain from
+/// the top down. Every class is visited once, so this is O(classes).
+std::vector<ClassId> inheritanceOrder(const std::vector<ClassId>& baseOf,
+                                      std::vector<ClassId>& cycleBreaks) {
+  enum : uint8_t { kNew, kOnPath, kDone };
+  std::vector<uint8_t> state(baseOf.size(), kNew);
+  std::vector<ClassId> order;
+  order.reserve(baseOf.size());
+  std::vector<ClassId> path;
+  for (ClassId i = 0; i < baseOf.size(); ++i) {
+    path.clear();
+    ClassId c = i;
+    while (c != kInvalidIndex && state[c] == kNew) {
+      state[c] = kOnPath;
+      path.push_back(c);
+      c = baseOf[c];
+    }
+    // `c` is now a finished class, no class, or a class on this path (cycle).
+    // Break a cycle at `c`: it becomes a root and is emitted first.
+    const bool cycle = c != kInvalidIndex && state[c] == kOnPath;
+    if (cycle) {
+      cycleBreaks.push_back(c);
+      order.push_back(c);
+      state[c] = kDone;
+    }
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      if (state[*it] == kDone) continue;
+      order.push_back(*it);
+      state[*it] = kDone;
+    }
+  }
+  return order;
+}
+
+void ClassLayoutTable::reset(size_t numClasses) {
+  classes_.assign(numClasses, Entry{});
+  names_.clear();
+  impl_.clear();
+  introducers_.clear();
+  current_ = kInvalidIndex;
+}
+
+void ClassLayoutTable::begin(ClassId id, ClassId base) {
+  Entry& e = classes_[id];
+  e.base = base;
+  e.nameOffset = names_.size();
+  e.implOffset = impl_.size();
+  if (base != kInvalidIndex) {
+    const Entry& b = classes_[base];
+    e.firstSlot = e.numSlots = b.numSlots;
+    // Inherit the base's finished table; overrides patch it in place. Copy by
+    // index, as appending may reallocate impl_.
+    for (size_t i = 0; i < b.numSlots; ++i) {
+      const MethodRef inherited = impl_[b.implOffset + i];
+      impl_.push_back(inherited);
+    }
+  }
+  current_ = id;
+}
+
+uint32_t ClassLayoutTable::addSlot(std::string_view name, MethodRef impl) {
+  Entry& e = classes_[current_];
+  const uint32_t slot = e.numSlots++;
+  names_.push_back(name);
+  impl_.push_back(impl);
+  introducers_[name].push_back(Introduction{current_, slot});
+  return slot;
+}
+
+void ClassLayoutTable::overrideSlot(uint32_t slot, MethodRef impl) {
+  const Entry& e = classes_[current_];
+  assert(slot < e.numSlots);
+  impl_[e.implOffset + slot] = impl;
+}
+
+std::optional<uint32_t> ClassLayoutTable::findSlot(ClassId id, std::string_view name) const {
+  auto it = introducers_.find(name);
+  if (it == introducers_.end()) return std::nullopt;
+  const std::vector<Introduction>& intro = it->second;
+  for (ClassId c = id; c != kInvalidIndex; c = classes_[c].base) {
+    if (classes_[c].numSlots == classes_[c].firstSlot) continue; // introduces nothing
+    for (const Introduction& i : intro) {
+      if (i.cls == c) return i.slot;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string_view ClassLayoutTable::slotName(ClassId id, uint32_t slot) const {
+  ClassId c = id;
+  while (slot < classes_[c].firstSlot) c = classes_[c].base;
+  return names_[classes_[c].nameOffset + (slot - classes_[c].firstSlot)];
+}
+
+} // namespace fakelang
@@ -0,0 +1,96 @@
+// Fakelang class layout engine: vtable slot assignment and dispatch tables.
+//
+// Classes are laid out in topological (base-before-derived) order. A class
+// stores only the slots it introduces; inherited slots are found through its
+// base, so slot names are never copied down a hierarchy. Each class's
+// resolved implementation table (slot -> most-derived method) is built once,
+// by copying the base's finished table and patching overrides, so building
+// all tables costs O(total slots) regardless of hierarchy depth.
+#pragma once
+
+#include "AST.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fakelang {
+
+/// A method implementation: `Program::classes[cls].methods[method]`.
+struct MethodRef {
+  ClassId cls{kInvalidIndex};
+  uint32_t method{kInvalidIndex};
+  bool operator==(const MethodRef&) const = default;
+};
+
+/// Return every class index such that each class comes after its base.
+/// `baseOf[i]` is the base of class i or kInvalidIndex. An inheritance cycle
+/// is broken at one of its members, which is treated as a root and appended
+/// to `cycleBreaks`.
+std::vector<ClassId> inheritanceOrder(const std::vector<ClassId>& baseOf,
+                                      std::vector<ClassId>& cycleBreaks);
+
+/// Vtable layouts and implementation tables for all classes of a program.
+///
+/// Built one class at a time with begin()/addSlot()/overrideSlot(), in an
+/// order where every base is finished before its subclasses begin. Slot
+/// names are borrowed (typically from the AST) and must outlive the table.
+class ClassLayoutTable {
+public:
+  /// Prepare for `numClasses` classes; discards any previous layouts.
+  void reset(size_t numClasses);
+
+  /// Start laying out `id`, inheriting the slots and implementations of
+  /// `base` (kInvalidIndex for a root). `base` must already be finished.
+  void begin(ClassId id, ClassId base);
+  /// Append a new slot named `name` implemented by `impl` to the class being
+  /// laid out, and return its index.
+  uint32_t addSlot(std::string_view name, MethodRef impl);
+  /// Point inherited slot `slot` of the class being laid out at `impl`.
+  void overrideSlot(uint32_t slot, MethodRef impl);
+
+  /// Slot named `name` in `id` (own or inherited), if any.
+  std::optional<uint32_t> findSlot(ClassId id, std::string_view name) const;
+  /// Number of vtable slots of `id`, including inherited ones.
+  uint32_t numSlots(ClassId id) const { return classes_[id].numSlots; }
+  /// Name of the method in `slot` of `id`.
+  std::string_view slotName(ClassId id, uint32_t slot) const;
+  /// Resolved implementation of every slot of `id`, in slot order.
+  std::span<const MethodRef> impl(ClassId id) const {
+    return {impl_.data() + classes_[id].implOffset, classes_[id].numSlots};
+  }
+  /// Number of classes.
+  size_t size() const { return classes_.size(); }
+
+private:
+  struct Entry {
+    ClassId base{kInvalidIndex};
+    /// Slots [firstSlot, numSlots) are introduced by this class.
+    uint32_t firstSlot{0};
+    uint32_t numSlots{0};
+    /// Start of this class's names in names_ and table in impl_.
+    size_t nameOffset{0};
+    size_t implOffset{0};
+  };
+  struct Introduction {
+    ClassId cls;
+    uint32_t slot;
+  };
+
+  std::vector<Entry> classes_;
+  /// Names of introduced slots, grouped by class.
+  std::vector<std::string_view> names_;
+  /// Implementation tables of all classes, back to back.
+  std::vector<MethodRef> impl_;
+  /// Method name -> every class that introduces a slot with that name. A
+  /// name is usually introduced once, so lookups hash once and then only
+  /// compare class ids up the base chain.
+  std::unordered_map<std::string_view, std::vector<Introduction>> introducers_;
+  ClassId current_{kInvalidIndex};
+};
+
+} // namespace fakelang
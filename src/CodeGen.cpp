@@ -5,80 +5,220 @@
 #  pragma clang diagnostic push
 #  pragma clang diagnostic ignored "-Wdeprecated-declarations"
 #endif
+#include <llvm/ADT/SmallString.h>
+#include <llvm/BinaryFormat/Dwarf.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Metadata.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/raw_ostream.h>
 #if defined(__clang__)
 #  pragma clang diagnostic pop
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <map>
 #include <stdexcept>
-#include <sstream>
 
 namespace fakelang {
 
+/// Give a function or call the attributes that `e` allows. Nothing in
+/// Fakelang unwinds.
+template <typename FunctionOrCall>
+static void addEffectAttributes(FunctionOrCall* f, const Effects& e) {
+  f->setDoesNotThrow();
+  if (e.memory == MemoryEffect::None) f->setDoesNotAccessMemory();
+  else if (e.memory == MemoryEffect::Read) f->setOnlyReadsMemory();
+  if (e.willReturn) f->addFnAttr(llvm::Attribute::WillReturn);
+}
+
+/// Effects that assume nothing, for bodies that may be replaced.
+static const Effects kAnyEffects{MemoryEffect::Any, /*willReturn=*/false};
+
 /// Initialize an empty module and IRBuilder bound to our LLVMContext.
 CodeGen::CodeGen() {
-  module_ = std::make_unique<llvm::Module>("fakelang-module", ctx_);
-  builder_ = std::make_unique<llvm::IRBuilder<>>(ctx_);
+  module_ = std::make_unique<llvm::Module>("fakelang-module", *ctx_);
+  builder_ = std::make_unique<llvm::IRBuilder<>>(*ctx_);
 }
 
-void CodeGen::setSource(std::string sourceText, std::string filename) {
+std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> CodeGen::takeModule() {
+  builder_.reset();
+  dib_.reset();
+  return {std::move(context_), std::move(module_)};
+}
+
+void CodeGen::setSource(std::string_view sourceText, std::string filename) {
   sourceFilename_ = std::move(filename);
-  sourceText_ = std::move(sourceText);
-  // Split into lines for quick lookup; keep 1-based mapping via index+1
+  sourceText_ = sourceText;
+  // Split into line views for quick lookup; keep 1-based mapping via index+1
   sourceLines_.clear();
-  std::string cur;
-  std::istringstream iss(sourceText_);
-  while (std::getline(iss, cur)) {
+  for (size_t pos = 0; pos < sourceText_.size();) {
+    const size_t nl = sourceText_.find('\n', pos);
+    std::string_view line = sourceText_.substr(pos, nl == std::string_view::npos ? nl : nl - pos);
     // Drop trailing carriage returns for Windows-style newlines
-    if (!cur.empty() && cur.back() == '\r') cur.pop_back();
-    sourceLines_.push_back(cur);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    sourceLines_.push_back(line);
+    if (nl == std::string_view::npos) break;
+    pos = nl + 1;
   }
 }
 
-llvm::Type* CodeGen::tyVoid() { return llvm::Type::getVoidTy(ctx_); }
-llvm::Type* CodeGen::tyI32() { return llvm::Type::getInt32Ty(ctx_); }
-llvm::Type* CodeGen::tyI8() { return llvm::Type::getInt8Ty(ctx_); }
+llvm::Type* CodeGen::tyVoid() { return llvm::Type::getVoidTy(*ctx_); }
+llvm::Type* CodeGen::tyI32() { return llvm::Type::getInt32Ty(*ctx_); }
+llvm::Type* CodeGen::tyI8() { return llvm::Type::getInt8Ty(*ctx_); }
 llvm::PointerType* CodeGen::tyI8Ptr() {
-  return llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(ctx_));
+  return llvm::PointerType::getUnqual(llvm::Type::getInt8Ty(*ctx_));
 }
 
-/// Map fakelang type names to canonical LLVM types for returns.
-llvm::Type* CodeGen::retTypeFor(const std::string& typeName) {
-  if (typeName == "Int") return tyI32();
-  if (typeName == "String") return tyI8Ptr();
-  // Classes: for simplicity, methods return only String in this demo
+/// Map resolved fakelang types to canonical LLVM types.
+llvm::Type* CodeGen::llvmTypeFor(SemaType type) {
+  if (type.kind == SemaType::Kind::Int) return tyI32();
+  // Strings and objects are both pointers
   return tyI8Ptr();
 }
 
 /// Construct the LLVM function type for a method on `classTy` returning
-/// `retTypeName`. Methods take a single implicit `this` pointer parameter.
-llvm::FunctionType* CodeGen::methodFnTy(const std::string& retTypeName,
-                                        llvm::StructType* classTy) {
+/// `retType`. Methods take a single implicit `this` pointer parameter.
+llvm::FunctionType* CodeGen::methodFnTy(SemaType retType, llvm::StructType* classTy) {
   // Signature: ret (ptr)
   std::vector<llvm::Type*> params{llvm::PointerType::getUnqual(classTy)};
-  return llvm::FunctionType::get(retTypeFor(retTypeName), params, /*isVarArg=*/false);
+  return llvm::FunctionType::get(llvmTypeFor(retType), params, /*isVarArg=*/false);
 }
 
-/// Entry point: lower AST to LLVM IR and verify module correctness.
-void CodeGen::generate(const Program& program, const std::string& moduleName) {
+/// Entry point: resolve the program with Sema, then lower it.
+void CodeGen::generate(Program& program, const std::string& moduleName) {
+  Sema sema(sourceFilename_.empty() ? moduleName : sourceFilename_);
+  ProgramInfo info;
+  {
+    PhaseTimers::Scope t(timers_, "sema");
+    info = sema.analyze(program);
+  }
+  generate(program, info, moduleName);
+}
+
+/// Lower an analyzed AST to LLVM IR and verify module correctness.
+void CodeGen::generate(const Program& program, const ProgramInfo& info,
+                       const std::string& moduleName) {
   module_->setModuleIdentifier(moduleName);
-  classes_.clear();
+  // Names private symbols in summaries; must differ between a program's modules
+  module_->setSourceFileName(moduleName);
+  if (hotSwap_ && (relativeVtables_ || separate_ || live_)) {
+    throw std::runtime_error("Hot swapping needs pointer vtables and the whole program");
+  }
+  if (classIdDispatch_ && (separate_ || hotSwap_)) {
+    throw std::runtime_error("Class ID dispatch needs the whole program");
+  }
+  collectClasses(program, info);
+  inferEffects(program, info);
+  if (debugInfo_) beginDebugInfo();
 
-  computeClassLayouts(program);
-  declareTypes();
-  declareAndDefineMethods();
-  defineVTables();
-  defineFunctions(program);
+  { PhaseTimers::Scope t(timers_, "declare-types"); declareTypes(); }
+  { PhaseTimers::Scope t(timers_, "define-methods"); declareAndDefineMethods(); }
+  { PhaseTimers::Scope t(timers_, "emit-vtables"); defineVTables(); }
+  { PhaseTimers::Scope t(timers_, "define-functions"); defineFunctions(program); }
+  if (hotSwap_ && !patch_) defineStubs();
+  if (separate_) {
+    // Only now is every `new` of an imported class lowered
+    PhaseTimers::Scope t(timers_, "emit-vtables");
+    defineVTables(/*imported=*/true);
+  }
+  if (dib_) {
+    PhaseTimers::Scope t(timers_, "debug-info");
+    dib_->finalize();
+  }
 
   // Validate the module for sanity
+  verify();
+
+  if (stats_) {
+    stats_->classes = classes_.size();
+    stats_->vtableSlots = 0;
+    for (ClassId id = 0; id < classes_.size(); ++id) stats_->vtableSlots += layouts_->numSlots(id);
+    stats_->irInstructions = module_->getInstructionCount();
+    countEliminated();
+  }
+}
+
+/// Lower consecutive classes into a part until it reaches kPartSize, then
+/// release the part (and the bodies it was lowered from) before the next.
+void CodeGen::generateStreaming(Program& program, const ProgramInfo& info, ModuleSink& sink,
+                                const std::string& moduleName) {
+  if (debugInfo_) throw std::runtime_error("Debug info is not supported when streaming");
+  if (separate_) throw std::runtime_error("Separate compilation is not supported when streaming");
+  streaming_ = true;
+  moduleName_ = moduleName;
+  nextString_ = 0;
+  nextSingleton_ = 0;
+  collectClasses(program, info);
+  inferEffects(program, info);
+
+  {
+    PhaseTimers::Scope t(timers_, "declare-types");
+    beginPart();
+    declareTypes();
+    std::vector<llvm::StructType*> types;
+    types.reserve(2 * classes_.size());
+    for (ClassId id = 0; id < classes_.size(); ++id) {
+      if (live_ && !live_->referenced[id]) continue;
+      types.push_back(classes_[id].vtableTy);
+      types.push_back(classes_[id].classTy);
+    }
+    sink.begin(*module_, types);
+    discardPart();
+  }
+  size_t partSize = 0;
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    std::vector<MethodDecl>& methods = program.classes[id].methods;
+    // Classes with neither a vtable nor a live method have nothing to lower
+    bool anyLive = false;
+    for (uint32_t m = 0; m < methods.size() && !anyLive; ++m) anyLive = isLive(MethodRef{id, m});
+    if (anyLive || isInstantiated(id)) {
+      if (!module_) beginPart();
+      { PhaseTimers::Scope t(timers_, "define-methods"); declareMethods(id); }
+      if (emitsVTable(id)) {
+        PhaseTimers::Scope t(timers_, "emit-vtables");
+        defineVTable(id);
+        partSize += vtableSize(id);
+      }
+      { PhaseTimers::Scope t(timers_, "define-methods"); defineMethods(id); }
+      for (llvm::Function* fn : classes_[id].methods) {
+        if (fn) partSize += fn->getInstructionCount();
+      }
+    }
+    for (MethodDecl& m : methods) releaseBody(m.body);
+    if (partSize >= kPartSize) {
+      finishPart(sink);
+      partSize = 0;
+    }
+  }
+  if (module_) finishPart(sink);
+  beginPart();
+  { PhaseTimers::Scope t(timers_, "define-functions"); defineFunctions(program); }
+  finishPart(sink);
+
+  beginPart();
+  getOrDeclarePuts();
+  if (relativeVtables_) llvm::Intrinsic::getDeclaration(module_.get(), llvm::Intrinsic::load_relative, {tyI32()});
+  sink.externals(*module_);
+  discardPart();
+
+  if (stats_) {
+    stats_->classes = classes_.size();
+    stats_->vtableSlots = 0;
+    for (ClassId id = 0; id < classes_.size(); ++id) stats_->vtableSlots += layouts_->numSlots(id);
+    countEliminated();
+  }
+}
+
+void CodeGen::verify() {
+  PhaseTimers::Scope t(timers_, "verify");
   std::string err;
   llvm::raw_string_ostream os(err);
   if (llvm::verifyModule(*module_, &os)) {
@@ -87,6 +227,102 @@ void CodeGen::generate(const Program& program, const std::string& moduleName) {
   }
 }
 
+uint32_t CodeGen::vtableSize(ClassId id) const {
+  return live_ && live_->shrunk() ? static_cast<uint32_t>(live_->vtableSlots[id].size()) : layouts_->numSlots(id);
+}
+
+uint32_t CodeGen::vtableIndex(ClassId id, uint32_t slot) const {
+  return live_ && live_->shrunk() ? live_->slotIndex(id, slot) : slot;
+}
+
+void CodeGen::countEliminated() {
+  stats_->foldedVtables = 0;
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    if (isInstantiated(id) && !emitsVTable(id)) ++stats_->foldedVtables;
+  }
+  stats_->deadMethods = 0;
+  stats_->deadVtableSlots = 0;
+  if (!live_) return;
+  size_t methods = 0;
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    methods += classes_[id].ast->methods.size();
+    stats_->deadVtableSlots += layouts_->numSlots(id) - (isInstantiated(id) ? vtableSize(id) : 0);
+  }
+  stats_->deadMethods = methods - live_->numLiveMethods();
+}
+
+void CodeGen::inferEffects(const Program& program, const ProgramInfo& info) {
+  PhaseTimers::Scope t(timers_, "infer-attributes");
+  effects_.emplace(program, info, live_);
+}
+
+void CodeGen::addMethodAttributes(llvm::Function* fn, const MethodRef& ref) {
+  addEffectAttributes(fn, effectsOf(ref));
+  // Bodies have no `this`: receivers are always locals
+  for (auto kind : {llvm::Attribute::NoAlias, llvm::Attribute::NoCapture, llvm::Attribute::ReadNone,
+                    llvm::Attribute::NonNull, llvm::Attribute::NoUndef}) {
+    fn->addParamAttr(0, kind);
+  }
+}
+
+const Effects& CodeGen::effectsOf(const MethodRef& ref) const {
+  return hotSwap_ ? kAnyEffects : effects_->method(ref);
+}
+
+const Effects& CodeGen::functionEffects(size_t index) const {
+  return hotSwap_ ? kAnyEffects : effects_->function(index);
+}
+
+const Effects& CodeGen::virtualCallEffects(ClassId cls, uint32_t slot) const {
+  return hotSwap_ ? kAnyEffects : effects_->virtualCall(cls, slot);
+}
+
+void CodeGen::beginPart() {
+  discardPart(); // modules must die before their context
+  context_ = std::make_unique<llvm::LLVMContext>();
+  ctx_ = context_.get();
+  module_ = std::make_unique<llvm::Module>(moduleName_, *ctx_);
+  builder_ = std::make_unique<llvm::IRBuilder<>>(*ctx_);
+}
+
+void CodeGen::finishPart(ModuleSink& sink) {
+  verify();
+  if (stats_) stats_->irInstructions += module_->getInstructionCount();
+  sink.part(*module_);
+  discardPart();
+}
+
+void CodeGen::discardPart() {
+  for (ClassId id : partClasses_) {
+    ClassInfo& ci = classes_[id];
+    ci.classTy = nullptr;
+    ci.vtableTy = nullptr;
+    ci.vtableGlobal = nullptr;
+    ci.singleton = nullptr;
+    ci.methods.clear();
+  }
+  partClasses_.clear();
+  builder_.reset();
+  module_.reset();
+  context_.reset();
+  ctx_ = nullptr;
+}
+
+void CodeGen::releaseBody(std::vector<std::unique_ptr<Stmt>>& body) {
+  // A folded call points at the literal its callee returns, which sits in a
+  // return statement or a local's initializer of that callee (or deeper).
+  auto retain = [this](std::unique_ptr<Expr>& e) {
+    if (dynamic_cast<StringExpr*>(e.get()) || dynamic_cast<IntExpr*>(e.get())) {
+      retainedLiterals_.push_back(std::move(e));
+    }
+  };
+  for (auto& s : body) {
+    if (auto* r = dynamic_cast<ReturnStmt*>(s.get())) retain(r->value);
+    else if (auto* vd = dynamic_cast<VarDeclStmt*>(s.get())) retain(vd->init);
+  }
+  std::vector<std::unique_ptr<Stmt>>().swap(body);
+}
+
 // Attach a simple metadata string to an instruction capturing source info.
 void CodeGen::annotate(llvm::Value* v, const SourceRange& rng, std::string_view kind) {
   if (!v) return;
@@ -99,20 +335,50 @@ void CodeGen::annotate(llvm::Value* v, const SourceRange& rng, std::string_view
     auto snippet = srcSnippet(rng);
     if (!snippet.empty()) ss << " | " << snippet;
     ss.flush();
-    auto* s = llvm::MDString::get(ctx_, msg);
-    auto* md = llvm::MDNode::get(ctx_, s);
+    auto* s = llvm::MDString::get(*ctx_, msg);
+    auto* md = llvm::MDNode::get(*ctx_, s);
     I->setMetadata("fakelang.src", md);
   }
 }
 
+void CodeGen::beginDebugInfo() {
+  dib_ = std::make_unique<llvm::DIBuilder>(*module_);
+  const std::string& path = sourceFilename_.empty() ? module_->getModuleIdentifier() : sourceFilename_;
+  diFile_ = dib_->createFile(llvm::sys::path::filename(path), llvm::sys::path::parent_path(path));
+  // DWARF has no language code for Fakelang; C is the closest match for
+  // plain functions with mangling-free names.
+  dib_->createCompileUnit(llvm::dwarf::DW_LANG_C, diFile_, "fakelangc", /*isOptimized=*/false,
+                          /*Flags=*/"", /*RV=*/0);
+  // Signatures are not described; debuggers only need names and lines.
+  diFnTy_ = dib_->createSubroutineType(dib_->getOrCreateTypeArray({}));
+  module_->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+  // Version 4 line tables, which the profiling runtime reads
+  module_->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+}
+
+void CodeGen::beginDebugFunction(llvm::Function* fn, const SourceRange& loc) {
+  if (!dib_) return;
+  const unsigned line = static_cast<unsigned>(loc.start.line);
+  diScope_ = dib_->createFunction(diFile_, fn->getName(), /*LinkageName=*/"", diFile_, line, diFnTy_,
+                                  line, llvm::DINode::FlagPrototyped, llvm::DISubprogram::SPFlagDefinition);
+  fn->setSubprogram(diScope_);
+  setDebugLoc(loc);
+}
+
+void CodeGen::setDebugLoc(const SourceRange& loc) {
+  if (!dib_) return;
+  builder_->SetCurrentDebugLocation(llvm::DILocation::get(*ctx_, static_cast<unsigned>(loc.start.line),
+                                                          static_cast<unsigned>(loc.start.column), diScope_));
+}
+
 std::string CodeGen::srcSnippet(const SourceRange& rng) const {
   // Return a single-line snippet (first line) trimmed to 80 chars
   if (rng.start.line <= 0 || static_cast<size_t>(rng.start.line) > sourceLines_.size()) return {};
-  const std::string& line = sourceLines_[static_cast<size_t>(rng.start.line) - 1];
+  const std::string_view line = sourceLines_[static_cast<size_t>(rng.start.line) - 1];
   // Columns are 1-based; clamp
   size_t startCol = rng.start.column > 0 ? static_cast<size_t>(rng.start.column - 1) : 0;
-  if (startCol >= line.size()) return line;
-  std::string s = line.substr(startCol);
+  if (startCol >= line.size()) return std::string(line);
+  std::string s(line.substr(startCol));
   // Trim
   if (s.size() > 80) s.resize(80);
   // Replace tabs with spaces for readability
@@ -120,120 +386,271 @@ std::string CodeGen::srcSnippet(const SourceRange& rng) const {
   return s;
 }
 
-/// Compute vtable slot layouts for all classes, honoring inheritance and
-/// override/virtual markers.
-void CodeGen::computeClassLayouts(const Program& p) {
-  // First, record classes and bases
-  for (const auto& c : p.classes) {
-    ClassInfo info;
-    info.ast = &c;
-    info.name = c.name;
-    info.base = c.baseName;
-    classes_.emplace(info.name, std::move(info));
-  }
-
-  // Compute vtable method layout with a simple DFS by declaration order.
-  // Assumes base classes appear before derived classes for this demo.
-  for (auto& [name, info] : classes_) {
-    ClassLayout layout;
-    if (info.base) {
-      auto it = classes_.find(*info.base);
-      if (it == classes_.end()) throw std::runtime_error("Unknown base class: " + *info.base);
-      layout = it->second.layout; // copy base layout
-    }
-    // Process methods
-    for (const auto& m : info.ast->methods) {
-      if (m.attr == MethodAttr::Override) {
-        auto it = layout.slotOf.find(m.name);
-        if (it == layout.slotOf.end()) {
-          throw std::runtime_error("Method '" + m.name + "' marked override but no base method");
-        }
-        // slot remains the same; implementation will be replaced
-      } else if (m.attr == MethodAttr::Virtual) {
-        layout.slotOf[m.name] = layout.methods.size();
-        layout.methods.push_back(m.name);
-      } else {
-        // Non-virtual methods are ignored for vtable purposes in this demo
-      }
+/// Pair each class with its Sema layout, indexed by ClassId.
+void CodeGen::collectClasses(const Program& program, const ProgramInfo& info) {
+  classes_.clear();
+  classes_.resize(program.classes.size());
+  for (size_t id = 0; id < program.classes.size(); ++id) classes_[id].ast = &program.classes[id];
+  layouts_ = &info.layouts;
+  foldVTables();
+  if (classIdDispatch_) {
+    // Class IDs are the preorder numbers ReachabilityAnalysis also uses
+    ClassNumbering numbering = numberClasses(program);
+    for (ClassId id = 0; id < classes_.size(); ++id) {
+      classes_[id].classNumber = numbering.number[id];
+      classes_[id].subtreeEnd = numbering.subtreeEnd[id];
     }
-    info.layout = std::move(layout);
+    byNumber_ = std::move(numbering.byNumber);
+  }
+}
+
+void CodeGen::foldVTables() {
+  // Entries as (class << 32 | method), dead ones all ones
+  std::map<std::vector<uint64_t>, ClassId> owners;
+  std::vector<uint64_t> key;
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    classes_[id].vtableOwner = id;
+    if (!isInstantiated(id) || separate_ || hotSwap_) continue;
+    key.clear();
+    for (const MethodRef& impl : vtableEntries(id)) key.push_back(uint64_t{impl.cls} << 32 | impl.method);
+    classes_[id].vtableOwner = owners.try_emplace(key, id).first->second;
   }
 }
 
+std::vector<MethodRef> CodeGen::vtableEntries(ClassId id) const {
+  const auto table = layouts_->impl(id);
+  std::vector<MethodRef> entries;
+  entries.reserve(vtableSize(id));
+  auto add = [&](const MethodRef& impl) { entries.push_back(isLive(impl) ? impl : MethodRef{}); };
+  if (live_ && live_->shrunk()) {
+    for (uint32_t slot : live_->vtableSlots[id]) add(table[slot]);
+  } else {
+    for (const MethodRef& impl : table) add(impl);
+  }
+  return entries;
+}
+
 /// Declare opaque struct types for each class and its vtable, and set their
 /// bodies (field types) once layouts are known.
 void CodeGen::declareTypes() {
-  // Create struct types for classes and vtables
-  for (auto& [name, info] : classes_) {
-    info.vtableTy = llvm::StructType::create(ctx_, "vtable." + name);
-    info.classTy = llvm::StructType::create(ctx_, "class." + name);
+  for (ClassId id = 0; id < classes_.size(); ++id) declareTypes(id);
+}
+
+void CodeGen::declareTypes(ClassId id) {
+  ClassInfo& info = classes_[id];
+  info.vtableTy = llvm::StructType::create(*ctx_, "vtable." + info.ast->name);
+  info.classTy = llvm::StructType::create(*ctx_, "class." + info.ast->name);
+  // vtable body: N x i8*, or N x i32 offsets
+  std::vector<llvm::Type*> vtElems(vtableSize(id), relativeVtables_ ? tyI32() : tyI8Ptr());
+  info.vtableTy->setBody(vtElems, /*isPacked=*/false);
+  // class body: { ptr to vtable }, then the class ID if calls test it
+  std::vector<llvm::Type*> clsElems{llvm::PointerType::getUnqual(info.vtableTy)};
+  if (classIdDispatch_) clsElems.push_back(tyI32());
+  info.classTy->setBody(clsElems, /*isPacked=*/false);
+  if (streaming_) partClasses_.push_back(id);
+}
+
+ClassInfo& CodeGen::typesOf(ClassId id) {
+  if (!classes_[id].classTy) declareTypes(id);
+  return classes_[id];
+}
+
+llvm::Function* CodeGen::methodFunction(const MethodRef& ref) {
+  ClassInfo& ci = classes_[ref.cls];
+  if (!ci.methods.empty()) return ci.methods[ref.method];
+  // Streaming: defined in the part of another class. Every inherited vtable
+  // slot lands here, so build the name without a heap allocation.
+  const MethodDecl& m = ci.ast->methods[ref.method];
+  llvm::SmallString<64> name(ci.ast->name);
+  name += '.';
+  name += m.name;
+  if (auto* fn = module_->getFunction(name)) return fn;
+  return createMethodFunction(ref, name);
+}
+
+llvm::Function* CodeGen::createMethodFunction(const MethodRef& ref, const llvm::Twine& name) {
+  const MethodDecl& m = classes_[ref.cls].ast->methods[ref.method];
+  auto* fn = llvm::Function::Create(methodFnTy(m.returnType.resolved, typesOf(ref.cls).classTy),
+                                    llvm::GlobalValue::ExternalLinkage, name, module_.get());
+  addMethodAttributes(fn, ref);
+  // Relative vtable entries are link-time constants only if the method
+  // cannot be preempted by another module's definition
+  if (relativeVtables_) fn->setDSOLocal(true);
+  return fn;
+}
+
+llvm::GlobalVariable* CodeGen::vtableOf(ClassId id) {
+  ClassInfo& ci = typesOf(classes_[id].vtableOwner);
+  if (!ci.vtableGlobal) {
+    // Streaming: defined in the part of class `id`; hot swapping: defined by
+    // the module the program was first loaded from
+    ci.vtableGlobal = new llvm::GlobalVariable(*module_, ci.vtableTy, /*isConstant=*/!hotSwap_,
+                                               llvm::GlobalValue::ExternalLinkage, nullptr,
+                                               "vtable." + ci.ast->name);
+    if (!hotSwap_) ci.vtableGlobal->setVisibility(llvm::GlobalValue::HiddenVisibility);
   }
-  for (auto& [name, info] : classes_) {
-    // vtable body: N x i8*
-    std::vector<llvm::Type*> vtElems(info.layout.methods.size(), tyI8Ptr());
-    info.vtableTy->setBody(vtElems, /*isPacked=*/false);
-    // class body: { ptr to vtable }
-    std::vector<llvm::Type*> clsElems{llvm::PointerType::getUnqual(info.vtableTy)};
-    info.classTy->setBody(clsElems, /*isPacked=*/false);
+  return ci.vtableGlobal;
+}
+
+bool CodeGen::isStateless(ClassId id) {
+  const unsigned header = classIdDispatch_ ? 2 : 1;
+  return typesOf(id).classTy->getNumElements() == header;
+}
+
+llvm::GlobalVariable* CodeGen::singletonOf(ClassId id) {
+  ClassInfo& ci = typesOf(id);
+  if (!ci.singleton) {
+    std::vector<llvm::Constant*> fields{vtableOf(id)};
+    if (classIdDispatch_) fields.push_back(llvm::ConstantInt::get(tyI32(), ci.classNumber));
+    // Nothing compares objects, so the address need not be unique; each
+    // module (streamed part, hot swap patch) may have its own copy. Streamed
+    // parts are printed into one file, where private names must differ.
+    std::string name = ci.ast->name + ".instance";
+    if (streaming_) name += "." + std::to_string(nextSingleton_++);
+    ci.singleton = new llvm::GlobalVariable(*module_, ci.classTy, /*isConstant=*/true,
+                                            llvm::GlobalValue::PrivateLinkage,
+                                            llvm::ConstantStruct::get(ci.classTy, fields), name);
+    ci.singleton->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+  }
+  return ci.singleton;
+}
+
+llvm::GlobalVariable* CodeGen::stubOf(const MethodRef& ref) {
+  ClassInfo& ci = classes_[ref.cls];
+  if (ci.stubs.empty()) ci.stubs.resize(ci.ast->methods.size());
+  llvm::GlobalVariable*& stub = ci.stubs[ref.method];
+  if (!stub) {
+    stub = new llvm::GlobalVariable(*module_, tyI8Ptr(), /*isConstant=*/false, llvm::GlobalValue::ExternalLinkage,
+                                    nullptr, "stub." + ci.ast->name + "." + ci.ast->methods[ref.method].name);
   }
+  return stub;
+}
+
+void CodeGen::defineStubs() {
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    for (uint32_t i = 0; i < classes_[id].ast->methods.size(); ++i) {
+      const MethodRef ref{id, i};
+      stubOf(ref)->setInitializer(llvm::ConstantExpr::getPointerCast(methodFunction(ref), tyI8Ptr()));
+    }
+  }
+}
+
+bool CodeGen::patches(ClassId id) const {
+  return !patch_ || std::find(patch_->classes.begin(), patch_->classes.end(), id) != patch_->classes.end();
+}
+
+bool CodeGen::patchesFunction(size_t index) const {
+  return !patch_ || std::find(patch_->functions.begin(), patch_->functions.end(), index) != patch_->functions.end();
 }
 
 /// Declare and define LLVM functions for each class method, emitting bodies
-/// by lowering statements. Methods have no parameters in this demo.
+/// by lowering statements. Methods have no parameters in this demo. All
+/// methods are declared before any body is lowered, so direct calls can refer
+/// to methods of classes declared later.
 void CodeGen::declareAndDefineMethods() {
-  // Create functions for each method
-  for (auto& [name, info] : classes_) {
-    for (const auto& m : info.ast->methods) {
-      auto* fty = methodFnTy(m.returnType.name, info.classTy);
-      auto* fn = llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage,
-                                        info.name + "." + m.name, module_.get());
-      info.methods[m.name] = fn;
-
-      // Define body
-      auto* entry = llvm::BasicBlock::Create(ctx_, "entry", fn);
-      builder_->SetInsertPoint(entry);
-
-      std::map<std::string, ScopeVar> scope; // no locals in methods in demo
-      // currentClassTy is used only for potential field access (not present)
-      for (const auto& s : m.body) {
-        codegenStmt(s.get(), scope, m.returnType.name, info.classTy);
-        if (builder_->GetInsertBlock()->getTerminator()) break;
-      }
-      // If control reaches here without an explicit return, insert default return
-      if (!builder_->GetInsertBlock()->getTerminator()) {
-        if (m.returnType.name == "Int") {
-          builder_->CreateRet(llvm::ConstantInt::get(tyI32(), 0));
-        } else {
-          builder_->CreateRet(llvm::UndefValue::get(retTypeFor(m.returnType.name)));
-        }
-      }
-    }
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    if (patches(id)) declareMethods(id);
+  }
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    if (patches(id)) defineMethods(id);
   }
 }
 
-/// Define and initialize vtable globals for each class using the previously
-/// computed layouts and method implementations.
-void CodeGen::defineVTables() {
-  for (auto& [name, info] : classes_) {
-    // Build initializer elements per slot
-    std::vector<llvm::Constant*> elems;
-    elems.reserve(info.layout.methods.size());
-    for (size_t i = 0; i < info.layout.methods.size(); ++i) {
-      const std::string& mname = info.layout.methods[i];
-      llvm::Function* impl = implementationFor(name, mname);
-      auto* c = llvm::ConstantExpr::getPointerCast(impl, tyI8Ptr());
-      elems.push_back(c);
-    }
-    llvm::Constant* init = nullptr;
-    if (elems.empty()) {
-      init = llvm::UndefValue::get(info.vtableTy);
-    } else {
-      init = llvm::ConstantStruct::get(info.vtableTy, elems);
+void CodeGen::declareMethods(ClassId id) {
+  ClassInfo& info = typesOf(id);
+  info.methods.reserve(info.ast->methods.size());
+  for (uint32_t i = 0; i < info.ast->methods.size(); ++i) {
+    const MethodDecl& m = info.ast->methods[i];
+    if (!isLive(MethodRef{id, i})) {
+      info.methods.push_back(nullptr);
+      continue;
     }
+    std::string name = info.ast->name + "." + m.name;
+    if (patch_) name += patch_->suffix;
+    // A streamed part may already have declared it for an earlier class
+    llvm::Function* fn = streaming_ ? module_->getFunction(name) : nullptr;
+    if (!fn) fn = createMethodFunction(MethodRef{id, i}, name);
+    info.methods.push_back(fn);
+  }
+}
+
+void CodeGen::defineMethods(ClassId id) {
+  ClassInfo& info = classes_[id];
+  if (info.ast->imported) return; // defined by the module of its own file
+  for (size_t i = 0; i < info.ast->methods.size(); ++i) {
+    if (!info.methods[i]) continue;
+    const MethodDecl& m = info.ast->methods[i];
+    auto* entry = llvm::BasicBlock::Create(*ctx_, "entry", info.methods[i]);
+    builder_->SetInsertPoint(entry);
+    beginDebugFunction(info.methods[i], m.loc);
+    codegenBody(m.body, m.numLocals, m.returnType.resolved);
+  }
+}
+
+/// Define and initialize vtable globals for each class from the Sema
+/// implementation table.
+void CodeGen::defineVTables(bool imported) {
+  if (patch_) return; // the running program's are patched instead
+  for (ClassId id = 0; id < classes_.size(); ++id) {
+    if (!emitsVTable(id) || classes_[id].ast->imported != imported) continue;
+    // Imported classes' vtables are only emitted where objects of them are created
+    if (imported && !(classes_[id].vtableGlobal && classes_[id].vtableGlobal->isDeclaration())) continue;
+    defineVTable(id);
+  }
+}
+
+void CodeGen::defineVTable(ClassId id) {
+  ClassInfo& info = typesOf(id);
+  // Relative entries refer to the vtable itself, so create it first. A
+  // streamed part may have declared it already through vtableOf().
+  if (!info.vtableGlobal) {
+    // Streamed parts reference each other's vtables, and a hot-swapping JIT
+    // looks them up, so they cannot be private
     info.vtableGlobal = new llvm::GlobalVariable(
-        *module_, info.vtableTy, /*isConstant=*/true,
-        llvm::GlobalValue::PrivateLinkage, init, "vtable." + name);
+        *module_, info.vtableTy, /*isConstant=*/!hotSwap_,
+        streaming_ || hotSwap_ ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::PrivateLinkage, nullptr,
+        "vtable." + info.ast->name);
+    if (streaming_) info.vtableGlobal->setVisibility(llvm::GlobalValue::HiddenVisibility);
+  }
+  if (separate_) {
+    // Every module creating objects of the class emits the same vtable, and
+    // the linker keeps one
+    llvm::GlobalVariable* vt = info.vtableGlobal;
+    vt->setLinkage(llvm::GlobalValue::LinkOnceODRLinkage);
+    vt->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    vt->setComdat(module_->getOrInsertComdat(vt->getName()));
+    // The vptr of an object of any subclass of C points at a vtable typed C
+    for (ClassId c = id; c != kInvalidIndex; c = classes_[c].ast->baseId) vt->addTypeMetadata(0, typeId(c));
+    vt->setVCallVisibilityMetadata(llvm::GlobalObject::VCallVisibilityLinkageUnit);
+  }
+  // An entry whose implementation is not live is never called on this class
+  // and stays null
+  std::vector<llvm::Constant*> elems;
+  elems.reserve(vtableSize(id));
+  for (const MethodRef& impl : vtableEntries(id)) {
+    elems.push_back(vtableEntry(impl.cls == kInvalidIndex ? nullptr : methodFunction(impl), info.vtableGlobal));
+  }
+  if (elems.empty()) {
+    info.vtableGlobal->setInitializer(llvm::UndefValue::get(info.vtableTy));
+  } else {
+    info.vtableGlobal->setInitializer(llvm::ConstantStruct::get(info.vtableTy, elems));
+  }
+}
+
+llvm::Constant* CodeGen::vtableEntry(llvm::Function* fn, llvm::GlobalVariable* vtable) {
+  if (!relativeVtables_) {
+    return fn ? llvm::ConstantExpr::getPointerCast(fn, tyI8Ptr()) : llvm::ConstantPointerNull::get(tyI8Ptr());
   }
+  if (!fn) return llvm::ConstantInt::get(tyI32(), 0);
+  // trunc(fn - vtable): what llvm.load.relative adds back to the vtable address
+  auto* i64 = llvm::Type::getInt64Ty(*ctx_);
+  llvm::Constant* offset = llvm::ConstantExpr::getSub(llvm::ConstantExpr::getPtrToInt(fn, i64),
+                                                      llvm::ConstantExpr::getPtrToInt(vtable, i64));
+  return llvm::ConstantExpr::getTrunc(offset, tyI32());
+}
+
+llvm::MDString* CodeGen::typeId(ClassId id) {
+  return llvm::MDString::get(*ctx_, "fakelang.class." + classes_[id].ast->name);
 }
 
 /// Define free-standing functions like `main`, and declare `puts`.
@@ -242,183 +659,367 @@ void CodeGen::defineFunctions(const Program& p) {
   (void)getOrDeclarePuts();
 
   // Free functions: only 'main' is needed for the demo
-  for (const auto& f : p.functions) {
-    auto* fty = llvm::FunctionType::get(retTypeFor(f.returnType.name), /*params*/{}, false);
-    auto* fn = llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage, f.name, module_.get());
-    auto* entry = llvm::BasicBlock::Create(ctx_, "entry", fn);
+  for (size_t i = 0; i < p.functions.size(); ++i) {
+    if ((live_ && !live_->functions[i]) || !patchesFunction(i)) continue;
+    const FunctionDecl& f = p.functions[i];
+    auto* fty = llvm::FunctionType::get(llvmTypeFor(f.returnType.resolved), /*params*/{}, false);
+    auto* fn = llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage,
+                                      patch_ ? f.name + patch_->suffix : f.name, module_.get());
+    addEffectAttributes(fn, functionEffects(i));
+    auto* entry = llvm::BasicBlock::Create(*ctx_, "entry", fn);
     builder_->SetInsertPoint(entry);
+    beginDebugFunction(fn, f.loc);
+    codegenBody(f.body, f.numLocals, f.returnType.resolved);
+  }
+}
 
-    std::map<std::string, ScopeVar> scope;
-    // Codegen body statements
-    for (const auto& s : f.body) {
-      codegenStmt(s.get(), scope, f.returnType.name, /*currentClassTy*/ nullptr);
-      if (builder_->GetInsertBlock()->getTerminator()) break;
+/// Lower statements until the first terminator; if control reaches the end
+/// without an explicit return, insert a default one.
+void CodeGen::codegenBody(const std::vector<std::unique_ptr<Stmt>>& body, uint32_t numLocals,
+                          SemaType retType) {
+  Locals locals;
+  locals.reset(numLocals);
+  locals.sealBlock(builder_->GetInsertBlock()); // the entry block has no predecessors
+  for (size_t i = 0; i < body.size(); ++i) {
+    if (const size_t n = codegenConstantPrints(body, i); n > 0) {
+      i += n - 1;
+      continue;
     }
-    // If no explicit return
-    if (!builder_->GetInsertBlock()->getTerminator()) {
-      if (f.returnType.name == "Int") builder_->CreateRet(llvm::ConstantInt::get(tyI32(), 0));
-      else builder_->CreateRet(llvm::UndefValue::get(retTypeFor(f.returnType.name)));
+    codegenStmt(body[i].get(), locals);
+    if (builder_->GetInsertBlock()->getTerminator()) break;
+  }
+  if (!builder_->GetInsertBlock()->getTerminator()) {
+    if (retType.kind == SemaType::Kind::Int) {
+      builder_->CreateRet(llvm::ConstantInt::get(tyI32(), 0));
+    } else {
+      builder_->CreateRet(llvm::UndefValue::get(llvmTypeFor(retType)));
     }
   }
 }
 
+/// If body[first] starts a run of at least two prints of known strings, print
+/// them with a single puts of the joined text and return the run length.
+/// puts appends the final newline, as the last print of the run would have.
+size_t CodeGen::codegenConstantPrints(const std::vector<std::unique_ptr<Stmt>>& body, size_t first) {
+  auto printAt = [&](size_t i) -> const PrintStmt* {
+    auto* p = i < body.size() ? dynamic_cast<const PrintStmt*>(body[i].get()) : nullptr;
+    return p && p->constant ? p : nullptr;
+  };
+  size_t end = first;
+  while (printAt(end)) ++end;
+  if (end - first < 2) return 0;
+
+  setDebugLoc(body[first]->loc);
+  std::string text;
+  for (size_t i = first; i < end; ++i) {
+    const PrintStmt* p = printAt(i);
+    if (i != first) text += '\n';
+    text += p->constant->value;
+    auto* me = dynamic_cast<const MethodCallExpr*>(p->value.get());
+    if (stats_ && me && me->folded) ++stats_->foldedCalls;
+  }
+  auto* call = builder_->CreateCall(getOrDeclarePuts(), {stringConstant(text)});
+  annotate(call, SourceRange{body[first]->loc.start, body[end - 1]->loc.end}, "print (merged)");
+  return end - first;
+}
+
 /// Lazily declare libc `puts(char const*)` and return the function.
 llvm::Function* CodeGen::getOrDeclarePuts() {
   if (auto* f = module_->getFunction("puts")) return f;
   auto* fty = llvm::FunctionType::get(tyI32(), {tyI8Ptr()}, false);
-  return llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage, "puts", module_.get());
+  auto* puts = llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage, "puts", module_.get());
+  // As LLVM annotates the C library's puts; it writes stdout and may block
+  puts->setDoesNotThrow();
+  for (auto kind : {llvm::Attribute::NoCapture, llvm::Attribute::ReadOnly, llvm::Attribute::NoUndef}) {
+    puts->addParamAttr(0, kind);
+  }
+  return puts;
+}
+
+llvm::Constant* CodeGen::stringConstant(llvm::StringRef text) {
+  if (!streaming_ && !separate_) return builder_->CreateGlobalStringPtr(text);
+  // Unnamed globals are numbered per module, so streamed parts would clash,
+  // and ThinLTO summaries identify globals by name
+  return builder_->CreateGlobalStringPtr(text, "str." + std::to_string(nextString_++));
 }
 
 /// Lower an expression in the current function/method context and return the
-/// resulting LLVM value. The optional `expectedType` is used to guide codegen
-/// (e.g., for method-call return types).
-llvm::Value* CodeGen::codegenExpr(const Expr* e,
-                                  std::map<std::string, ScopeVar>& scope,
-                                  const std::string& expectedType) {
+/// resulting LLVM value. Names and types were resolved by Sema.
+llvm::Value* CodeGen::codegenExpr(const Expr* e, Locals& locals) {
   if (auto* se = dynamic_cast<const StringExpr*>(e)) {
     // Global string emission does not create an instruction to annotate
-    return builder_->CreateGlobalStringPtr(se->value);
+    return stringConstant(se->value);
   }
   if (auto* ie = dynamic_cast<const IntExpr*>(e)) {
     return llvm::ConstantInt::get(tyI32(), ie->value);
   }
   if (auto* ve = dynamic_cast<const VarExpr*>(e)) {
-    auto it = scope.find(ve->name);
-    if (it == scope.end()) throw std::runtime_error("Unknown variable: " + ve->name);
-    auto* ld = builder_->CreateLoad(tyI8Ptr(), it->second.allocaPtr, ve->name + ".val");
-    annotate(ld, ve->loc, "load var");
-    return ld;
+    return locals.readVariable(ve->slot, llvmTypeFor(ve->type), builder_->GetInsertBlock());
   }
   if (auto* ne = dynamic_cast<const NewExpr*>(e)) {
+    setDebugLoc(ne->loc);
+    // Every object of a stateless class is the same
+    if (isStateless(ne->classId)) return singletonOf(ne->classId);
     // Alloca object and set vptr
-    ClassInfo& ci = requireClass(ne->className);
+    ClassInfo& ci = typesOf(ne->classId);
     auto* obj = builder_->CreateAlloca(ci.classTy, /*ArraySize=*/nullptr, ne->className + ".obj");
     annotate(obj, ne->loc, "alloca object");
     // GEP to first field (vptr)
     auto* vptrAddr = builder_->CreateStructGEP(ci.classTy, obj, 0, ne->className + ".vptr.addr");
     annotate(vptrAddr, ne->loc, "vptr addr");
-    auto* st = builder_->CreateStore(ci.vtableGlobal, vptrAddr);
+    auto* st = builder_->CreateStore(vtableOf(ne->classId), vptrAddr);
     annotate(st, ne->loc, "store vptr");
+    if (classIdDispatch_) {
+      auto* idAddr = builder_->CreateStructGEP(ci.classTy, obj, 1, ne->className + ".id.addr");
+      annotate(idAddr, ne->loc, "class id addr");
+      auto* id = builder_->CreateStore(llvm::ConstantInt::get(tyI32(), ci.classNumber), idAddr);
+      annotate(id, ne->loc, "store class id");
+    }
     return obj;
   }
   if (auto* me = dynamic_cast<const MethodCallExpr*>(e)) {
-    // Only 'recv.method()' w/o args
-    // Resolve receiver var type from scope
-    if (auto* recvVar = dynamic_cast<const VarExpr*>(me->receiver.get())) {
-      auto it = scope.find(recvVar->name);
-      if (it == scope.end()) throw std::runtime_error("Unknown variable: " + recvVar->name);
-      llvm::Value* thisPtr = builder_->CreateLoad(tyI8Ptr(), it->second.allocaPtr, recvVar->name + ".val");
-      annotate(thisPtr, me->loc, "load this");
-      return codegenVirtualCall(thisPtr, it->second.typeName, me->methodName,
-                                expectedType.empty() ? std::string("String") : expectedType,
-                                &me->loc);
+    // Only 'recv.method()' w/o args; Sema guarantees the receiver is a variable
+    if (me->folded) {
+      if (stats_) ++stats_->foldedCalls;
+      return codegenExpr(me->folded, locals);
     }
-    throw std::runtime_error("Unsupported method receiver expression");
+    auto* recvVar = static_cast<const VarExpr*>(me->receiver.get());
+    llvm::Value* thisPtr = codegenExpr(recvVar, locals);
+    setDebugLoc(me->loc);
+    if (me->exactClassId != kInvalidIndex) {
+      // The partial evaluator knows the receiver's class: call its implementation
+      const MethodRef impl = layouts_->impl(me->exactClassId)[me->vtableSlot];
+      llvm::CallInst* call = nullptr;
+      if (hotSwap_) {
+        // Through the stub, which a reload repoints at the new version
+        auto* target = builder_->CreateLoad(tyI8Ptr(), stubOf(impl), me->methodName + ".stub");
+        target->setAtomic(llvm::AtomicOrdering::Unordered);
+        annotate(target, me->loc, "load stub");
+        auto* fnTy = methodFnTy(me->type, typesOf(impl.cls).classTy);
+        call = builder_->CreateCall(fnTy, target, {thisPtr}, me->methodName + ".call");
+        addEffectAttributes(call, kAnyEffects);
+      } else {
+        call = builder_->CreateCall(methodFunction(impl), {thisPtr}, me->methodName + ".call");
+      }
+      annotate(call, me->loc, "direct call");
+      if (stats_) ++stats_->devirtualizedCalls;
+      return call;
+    }
+    if (classIdDispatch_) {
+      if (llvm::Value* v = codegenClassIdDispatch(thisPtr, me, locals)) return v;
+    }
+    return codegenVirtualCall(thisPtr, me->classId, me->vtableSlot, me->type, &me->loc);
   }
   throw std::runtime_error("Unhandled expression node");
 }
 
 /// Lower a statement. Handles return, print, and variable declarations.
-void CodeGen::codegenStmt(const Stmt* s,
-                          std::map<std::string, ScopeVar>& scope,
-                          const std::string& currentRetType,
-                          llvm::StructType* currentClassTy) {
-  (void)currentClassTy;
+void CodeGen::codegenStmt(const Stmt* s, Locals& locals) {
+  setDebugLoc(s->loc);
   if (auto* r = dynamic_cast<const ReturnStmt*>(s)) {
-    llvm::Value* v = codegenExpr(r->value.get(), scope, currentRetType);
+    llvm::Value* v = codegenExpr(r->value.get(), locals);
+    setDebugLoc(r->loc);
     auto* ret = builder_->CreateRet(v);
     annotate(ret, r->loc, "return");
     // Note: caller should ensure no further instructions are emitted after return
     return;
   }
   if (auto* p = dynamic_cast<const PrintStmt*>(s)) {
-    llvm::Value* v = codegenExpr(p->value.get(), scope, "String");
+    llvm::Value* v = codegenExpr(p->value.get(), locals);
+    setDebugLoc(p->loc);
     auto* call = builder_->CreateCall(getOrDeclarePuts(), {v});
     annotate(call, p->loc, "print");
     return;
   }
   if (auto* vd = dynamic_cast<const VarDeclStmt*>(s)) {
-    // Variable is a pointer ('ptr') to an object (or string/int but demo uses objects)
-    auto* allocaPtr = builder_->CreateAlloca(llvm::PointerType::getUnqual(tyI8Ptr()), /*ArraySize=*/nullptr, vd->name + ".addr");
-    annotate(allocaPtr, vd->loc, "alloca var");
-    llvm::Value* init = codegenExpr(vd->init.get(), scope, vd->type.name);
-    // Store the object pointer into the variable slot (both are 'ptr' under opaque pointers)
-    auto* st = builder_->CreateStore(init, allocaPtr);
-    annotate(st, vd->loc, "store var");
-    scope.emplace(vd->name, ScopeVar{allocaPtr, vd->type.name});
+    // The variable is simply its initializer's value (a 'ptr' to an object)
+    llvm::Value* init = codegenExpr(vd->init.get(), locals);
+    locals.writeVariable(vd->slot, builder_->GetInsertBlock(), init);
     return;
   }
   throw std::runtime_error("Unhandled statement node");
 }
 
-/// Emit a virtual call: load the vptr, read the slot for `methodName`, cast
-/// the function pointer to the right type, and call it with `thisPtr`.
-llvm::Value* CodeGen::codegenVirtualCall(llvm::Value* thisPtr,
-                                         const std::string& staticClassName,
-                                         const std::string& methodName,
-                                         const std::string& retTypeName,
-                                         const SourceRange* srcLoc) {
+/// Emit a virtual call: load the vptr, read slot `slot`, cast the function
+/// pointer to the right type, and call it with `thisPtr`.
+llvm::Value* CodeGen::codegenVirtualCall(llvm::Value* thisPtr, ClassId classId, uint32_t slot,
+                                         SemaType retType, const SourceRange* srcLoc) {
   // Load vptr: first field of class struct
-  ClassInfo& ci = requireClass(staticClassName);
-  auto* vptrAddr = builder_->CreateStructGEP(ci.classTy, thisPtr, 0, staticClassName + ".vptr.addr");
+  ClassInfo& ci = typesOf(classId);
+  const std::string& className = ci.ast->name;
+  const std::string methodName(layouts_->slotName(classId, slot));
+  auto* vptrAddr = builder_->CreateStructGEP(ci.classTy, thisPtr, 0, className + ".vptr.addr");
   if (srcLoc) annotate(vptrAddr, *srcLoc, "vptr addr");
-  llvm::Value* vptr = builder_->CreateLoad(llvm::PointerType::getUnqual(ci.vtableTy), vptrAddr, staticClassName + ".vptr");
+  llvm::Value* vptr = builder_->CreateLoad(llvm::PointerType::getUnqual(ci.vtableTy), vptrAddr, className + ".vptr");
   if (srcLoc) annotate(vptr, *srcLoc, "load vptr");
+  if (separate_) {
+    // Tells link-time devirtualization which vtables the vptr may point to
+    auto* test = builder_->CreateCall(llvm::Intrinsic::getDeclaration(module_.get(), llvm::Intrinsic::type_test),
+                                      {vptr, llvm::MetadataAsValue::get(*ctx_, typeId(classId))},
+                                      className + ".vptr.test");
+    builder_->CreateCall(llvm::Intrinsic::getDeclaration(module_.get(), llvm::Intrinsic::assume), {test});
+    if (srcLoc) annotate(test, *srcLoc, "type test");
+  }
 
   // Get function pointer from slot
-  size_t slot = slotOf(staticClassName, methodName);
-  auto* slotAddr = builder_->CreateStructGEP(ci.vtableTy, vptr, static_cast<unsigned>(slot), methodName + ".slot.addr");
-  if (srcLoc) annotate(slotAddr, *srcLoc, "slot addr");
-  llvm::Value* fnI8 = builder_->CreateLoad(tyI8Ptr(), slotAddr, methodName + ".slot");
-  if (srcLoc) annotate(fnI8, *srcLoc, "load slot");
+  llvm::Value* fnI8 = nullptr;
+  if (relativeVtables_) {
+    // vptr + the i32 offset stored at byte 4 * index of the vtable
+    llvm::Function* loadRelative =
+        llvm::Intrinsic::getDeclaration(module_.get(), llvm::Intrinsic::load_relative, {tyI32()});
+    auto* byteOffset = llvm::ConstantInt::get(tyI32(), 4 * vtableIndex(classId, slot));
+    auto* call = builder_->CreateCall(loadRelative, {vptr, byteOffset}, methodName + ".slot");
+    if (srcLoc) annotate(call, *srcLoc, "load relative slot");
+    fnI8 = call;
+  } else {
+    auto* slotAddr = builder_->CreateStructGEP(ci.vtableTy, vptr, vtableIndex(classId, slot), methodName + ".slot.addr");
+    if (srcLoc) annotate(slotAddr, *srcLoc, "slot addr");
+    auto* load = builder_->CreateLoad(tyI8Ptr(), slotAddr, methodName + ".slot");
+    // A hot swap may store a new address while the program runs
+    if (hotSwap_) load->setAtomic(llvm::AtomicOrdering::Unordered);
+    fnI8 = load;
+    if (srcLoc) annotate(fnI8, *srcLoc, "load slot");
+  }
 
   // Cast to function pointer type and call
-  auto* fnTy = methodFnTy(retTypeName, ci.classTy);
+  auto* fnTy = methodFnTy(retType, ci.classTy);
   auto* fnPtrTy = llvm::PointerType::getUnqual(fnTy);
   llvm::Value* fn = builder_->CreatePointerCast(fnI8, fnPtrTy, methodName + ".fn");
   if (srcLoc) annotate(fn, *srcLoc, "bitcast fn");
   auto* call = builder_->CreateCall(fnTy, fn, {thisPtr}, methodName + ".call");
+  // Whichever implementation runs, the call can do no more than this
+  addEffectAttributes(call, virtualCallEffects(classId, slot));
   if (srcLoc) annotate(call, *srcLoc, "vcall");
+  if (stats_) ++stats_->virtualCalls;
   return call;
 }
 
-/// Lookup a ClassInfo by name or throw a diagnostic if unknown.
-ClassInfo& CodeGen::requireClass(const std::string& name) {
-  auto it = classes_.find(name);
-  if (it == classes_.end()) throw std::runtime_error("Unknown class: " + name);
-  return it->second;
-}
+namespace {
 
-/// Return the base class of `c` if present; otherwise nullptr.
-const ClassInfo* CodeGen::maybeBaseOf(const ClassInfo& c) const {
-  if (!c.base) return nullptr;
-  auto it = classes_.find(*c.base);
-  if (it == classes_.end()) throw std::runtime_error("Unknown base class: " + *c.base);
-  return &it->second;
-}
+/// One implementation a virtual call may reach, and the class IDs of the
+/// instantiated classes that have it.
+struct DispatchTarget {
+  MethodRef impl;
+  std::vector<uint32_t> numbers;
+  /// Inclusive ranges of class IDs that cover `numbers` and no class with
+  /// another implementation; the classes in between are never instantiated.
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+};
 
-/// Return the vtable slot index for `methodName` in `className` or throw.
-size_t CodeGen::slotOf(const std::string& className, const std::string& methodName) const {
-  auto it = classes_.find(className);
-  if (it == classes_.end()) throw std::runtime_error("Unknown class: " + className);
-  auto jt = it->second.layout.slotOf.find(methodName);
-  if (jt == it->second.layout.slotOf.end()) throw std::runtime_error("No virtual method '" + methodName + "' in class '" + className + "'");
-  return jt->second;
-}
+} // namespace
+
+/// Find the implementations the call may reach by walking the receiver's
+/// subtree in class ID order, and give up on the class ID once there are
+/// more than the policy tells apart.
+llvm::Value* CodeGen::codegenClassIdDispatch(llvm::Value* thisPtr, const MethodCallExpr* me, Locals& locals) {
+  const ClassInfo& receiver = classes_[me->classId];
+  const size_t limit = std::max({dispatchPolicy_.maxCompare, dispatchPolicy_.maxSwitch, 1u});
+  std::vector<DispatchTarget> targets;
+  size_t previous = 0; // target of the last instantiated class seen
+  for (uint32_t n = receiver.classNumber; n < receiver.subtreeEnd; ++n) {
+    if (!isInstantiated(byNumber_[n])) continue;
+    const MethodRef impl = layouts_->impl(byNumber_[n])[me->vtableSlot];
+    if (!targets.empty() && targets[previous].impl == impl) {
+      targets[previous].numbers.push_back(n);
+      targets[previous].ranges.back().second = n;
+      continue;
+    }
+    auto it = std::find_if(targets.begin(), targets.end(), [&](const DispatchTarget& t) { return t.impl == impl; });
+    if (it == targets.end()) {
+      if (targets.size() == limit) return nullptr;
+      it = targets.insert(targets.end(), DispatchTarget{impl, {}, {}});
+    }
+    it->numbers.push_back(n);
+    it->ranges.emplace_back(n, n);
+    previous = static_cast<size_t>(it - targets.begin());
+  }
+  if (targets.empty()) return nullptr; // nothing instantiated reaches the call
+  if (targets.size() == 1) {
+    auto* call = builder_->CreateCall(methodFunction(targets[0].impl), {thisPtr}, me->methodName + ".call");
+    annotate(call, me->loc, "direct call (one implementation)");
+    if (stats_) ++stats_->devirtualizedCalls;
+    return call;
+  }
+  const bool useSwitch = targets.size() > dispatchPolicy_.maxCompare;
+  if (useSwitch && targets.size() > dispatchPolicy_.maxSwitch) return nullptr;
+
+  // Load the class ID, which lies in the receiver's subtree
+  ClassInfo& ci = typesOf(me->classId);
+  auto* idAddr = builder_->CreateStructGEP(ci.classTy, thisPtr, 1, ci.ast->name + ".id.addr");
+  annotate(idAddr, me->loc, "class id addr");
+  auto* id = builder_->CreateLoad(tyI32(), idAddr, ci.ast->name + ".id");
+  // Streamed parts are printed without their metadata nodes, so the range
+  // is only attached to whole modules
+  if (!streaming_) {
+    llvm::Metadata* range[] = {
+        llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(tyI32(), ci.classNumber)),
+        llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(tyI32(), ci.subtreeEnd))};
+    id->setMetadata(llvm::LLVMContext::MD_range, llvm::MDNode::get(*ctx_, range));
+  }
+  annotate(id, me->loc, "load class id");
+
+  // The implementation with the most classes is what remains when no test
+  // matches, so it needs neither compares nor cases
+  const auto last = std::max_element(targets.begin(), targets.end(), [](const auto& a, const auto& b) {
+    return std::pair(a.ranges.size(), a.numbers.size()) < std::pair(b.ranges.size(), b.numbers.size());
+  });
+  std::rotate(last, last + 1, targets.end());
+  llvm::Function* fn = builder_->GetInsertBlock()->getParent();
+  std::vector<llvm::BasicBlock*> blocks{builder_->GetInsertBlock()};
+  std::vector<llvm::BasicBlock*> callBlocks;
+  for (const DispatchTarget& t : targets) {
+    const ClassDecl& c = *classes_[t.impl.cls].ast;
+    callBlocks.push_back(llvm::BasicBlock::Create(*ctx_, me->methodName + "." + c.name, fn));
+  }
+  if (useSwitch) {
+    auto* sw = builder_->CreateSwitch(id, callBlocks.back());
+    for (size_t i = 0; i + 1 < targets.size(); ++i) {
+      for (uint32_t n : targets[i].numbers) sw->addCase(builder_->getInt32(n), callBlocks[i]);
+    }
+    annotate(sw, me->loc, "switch on class id");
+  } else {
+    for (size_t i = 0; i + 1 < targets.size(); ++i) {
+      llvm::Value* match = nullptr;
+      for (const auto& [lo, hi] : targets[i].ranges) {
+        llvm::Value* in = nullptr;
+        if (lo == hi) {
+          in = builder_->CreateICmpEQ(id, llvm::ConstantInt::get(tyI32(), lo));
+        } else {
+          llvm::Value* offset = builder_->CreateSub(id, llvm::ConstantInt::get(tyI32(), lo));
+          in = builder_->CreateICmpULE(offset, llvm::ConstantInt::get(tyI32(), hi - lo));
+        }
+        match = match ? builder_->CreateOr(match, in) : in;
+      }
+      llvm::BasicBlock* next = i + 2 < targets.size() ? llvm::BasicBlock::Create(*ctx_, me->methodName + ".next", fn)
+                                                      : callBlocks.back();
+      auto* br = builder_->CreateCondBr(match, callBlocks[i], next);
+      annotate(br, me->loc, "compare class id");
+      if (i + 2 < targets.size()) {
+        blocks.push_back(next);
+        builder_->SetInsertPoint(next);
+      }
+    }
+  }
 
-/// Find the most-derived implementation for `methodName` starting at
-/// `className`, walking up the inheritance chain as needed.
-llvm::Function* CodeGen::implementationFor(const std::string& className, const std::string& methodName) {
-  // Walk up to find the most-derived implementation in this class
-  auto it = classes_.find(className);
-  if (it == classes_.end()) throw std::runtime_error("Unknown class: " + className);
-  const ClassInfo* c = &it->second;
-  while (c) {
-    auto mt = c->methods.find(methodName);
-    if (mt != c->methods.end()) return mt->second;
-    c = maybeBaseOf(*c);
+  // A direct call of each implementation, joined by a phi
+  auto* done = llvm::BasicBlock::Create(*ctx_, me->methodName + ".done", fn);
+  std::vector<std::pair<llvm::Value*, llvm::BasicBlock*>> results;
+  for (size_t i = 0; i < targets.size(); ++i) {
+    builder_->SetInsertPoint(callBlocks[i]);
+    auto* call = builder_->CreateCall(methodFunction(targets[i].impl), {thisPtr}, me->methodName + ".call");
+    annotate(call, me->loc, "direct call");
+    builder_->CreateBr(done);
+    results.emplace_back(call, callBlocks[i]);
   }
-  throw std::runtime_error("No implementation for method '" + methodName + "' in class '" + className + "'");
+  builder_->SetInsertPoint(done);
+  auto* phi = builder_->CreatePHI(llvmTypeFor(me->type), static_cast<unsigned>(results.size()), me->methodName + ".result");
+  for (const auto& [value, block] : results) phi->addIncoming(value, block);
+  // Every new block's predecessors are known
+  for (size_t i = 1; i < blocks.size(); ++i) locals.sealBlock(blocks[i]);
+  for (llvm::BasicBlock* b : callBlocks) locals.sealBlock(b);
+  locals.sealBlock(done);
+  if (stats_) ++stats_->classIdCalls;
+  return phi;
 }
 
 } // namespace fakelang
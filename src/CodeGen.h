@@ -1,18 +1,59 @@
 // Fakelang LLVM IR code generator (LLVM 17)
 // This module lowers the AST to LLVM IR with a minimal object model:
 // - Each object is a struct with a single field: a pointer to a vtable
+// - Objects of a class with no per-object state, which is every class until
+//   classes have fields, are all one constant global per class: `new` yields
+//   its address and neither allocates nor stores
 // - Each vtable is a struct of slots (i8* function pointers)
 // - Dynamic dispatch loads the slot from the vtable and calls it
+// - Classes whose vtables would hold the same functions share one vtable
+// - Optionally (setRelativeVtables), slots are 32-bit offsets from the vtable
+//   to the function, as with Clang's relative vtables: half the size, and no
+//   dynamic relocations in position-independent code
 // - Strings are emitted as global constants; printing uses 'puts'
+// - Optionally (setDebugInfo), DWARF debug info: one compile unit, a
+//   subprogram per method and function, and a line location per instruction
+// - Optionally (generateStreaming), the program is lowered a few classes at a
+//   time into short-lived modules handed to a ModuleSink, so peak memory
+//   follows the largest class rather than the whole program
+// - Optionally (setLiveSet), only what a ReachabilityAnalysis found live:
+//   unreachable methods are not lowered, uninstantiated classes get no
+//   vtable, and vtables may keep only the slots that are ever called
+// - Function and call-site attributes from an EffectAnalysis of the program:
+//   everything is nounwind, `this` is never accessed by the callee, and
+//   methods that print nothing are memory(none) or memory(read), and
+//   willreturn unless they may recurse
+// - Optionally (setSeparateCompilation), the module is one file of a program
+//   whose other files are imported: imported classes' methods are only
+//   declared, every class gets its own vtable, emitted as a linkonce_odr
+//   COMDAT by each module that needs it, and vtables and virtual calls carry
+//   the type metadata LLVM's whole-program devirtualization reads at link time
+// - Optionally (setHotSwap), for a JIT session whose methods are replaced
+//   while it runs: vtables are mutable and unshared, direct calls go through
+//   a mutable stub pointer per method, and a later module may define just the
+//   new versions of some classes' methods (HotSwapPatch)
+// - Optionally (setClassIdDispatch), objects also hold a class ID, their
+//   class's preorder number in the class forest, and a virtual call picks
+//   its lowering from the implementations the instantiated classes it may
+//   reach have: a direct call to the only one, compares of the class ID that
+//   branch to direct calls of a few, a switch on it for some more, or the
+//   vtable (DispatchPolicy)
 #pragma once
 
 #include "AST.h"
+#include "CompileStats.h"
+#include "Effects.h"
+#include "Reachability.h"
+#include "SSABuilder.h"
+#include "Sema.h"
 
 // Suppress deprecation warnings originating from LLVM headers under C++23
 #if defined(__clang__)
 #  pragma clang diagnostic push
 #  pragma clang diagnostic ignored "-Wdeprecated-declarations"
 #endif
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
@@ -21,43 +62,85 @@
 #  pragma clang diagnostic pop
 #endif
 
-#include <map>
 #include <memory>
 #include <optional>
+#include <utility>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 namespace fakelang {
 
-/// Describes the vtable method layout for a class.
-struct ClassLayout {
-  /// Vtable order: slot i contains the method named methods[i].
-  std::vector<std::string> methods;
-  /// Map method name -> slot index.
-  std::unordered_map<std::string, size_t> slotOf;
-};
-
 /// Aggregates information for codegen about a single class.
 struct ClassInfo {
   /// AST node for this class declaration.
   const ClassDecl* ast{nullptr};
-  /// Class name.
-  std::string name;
-  /// Optional base class name, if the class extends another.
-  std::optional<std::string> base;
-  /// Computed vtable layout, including inherited slots.
-  ClassLayout layout;
-
-  /// %class.<Name> = type { ptr }
+
+  /// %class.<Name> = type { ptr }, or { ptr, i32 } with setClassIdDispatch()
   llvm::StructType* classTy{nullptr};
   /// %vtable.<Name> = type { i8*, ... }
   llvm::StructType* vtableTy{nullptr};
   /// @vtable.<Name>
   llvm::GlobalVariable* vtableGlobal{nullptr};
+  /// @<Name>.instance (@<Name>.instance.N when streaming), the object every
+  /// `new` of a stateless class yields; created in the current module on
+  /// first use.
+  llvm::GlobalVariable* singleton{nullptr};
+  /// The class whose vtable objects of this class point to: itself, or an
+  /// earlier class whose vtable holds the same functions.
+  ClassId vtableOwner{kInvalidIndex};
+
+  /// Defined function for each method, parallel to ast->methods; null for
+  /// methods that are not live.
+  std::vector<llvm::Function*> methods;
+  /// With setHotSwap(), @stub.<Name>.<method> for each method that has one,
+  /// parallel to ast->methods.
+  std::vector<llvm::GlobalVariable*> stubs;
 
-  /// Mapping from method name to the defined function in this class.
-  std::unordered_map<std::string, llvm::Function*> methods;
+  /// With setClassIdDispatch(), the class ID objects of this class hold: its
+  /// preorder number. Its subclasses' numbers follow it, up to `subtreeEnd`.
+  uint32_t classNumber{0};
+  uint32_t subtreeEnd{0};
+};
+
+/// Thresholds by which CodeGen::setClassIdDispatch() lowers a virtual call,
+/// given the number of distinct implementations of its slot among the
+/// instantiated classes its receiver may have. A call with one is always
+/// direct; with more, up to `maxCompare` are told apart by comparing the
+/// class ID, one compare per run of consecutively numbered classes, and up
+/// to `maxSwitch` by a switch on it; the class ID tests end in direct calls,
+/// which the optimizer can inline. Anything more uses the vtable.
+struct DispatchPolicy {
+  uint32_t maxCompare{2};
+  uint32_t maxSwitch{8};
+};
+
+/// The part of a hot-swapped program (CodeGen::setHotSwap) to lower into a
+/// module added to a running JIT: the methods of `classes` and the free
+/// functions `functions`, named with `suffix` appended so that they do not
+/// clash with the definitions they replace. Vtables, stubs and everything
+/// else are only declared; they resolve to the running program's.
+struct HotSwapPatch {
+  std::vector<ClassId> classes;
+  std::vector<size_t> functions;
+  std::string suffix;
+};
+
+/// Receives a program lowered by CodeGen::generateStreaming() one part at a
+/// time. Each part lives in its own LLVMContext, destroyed after the call.
+class ModuleSink {
+public:
+  virtual ~ModuleSink() = default;
+  /// Called first, with an empty module carrying the program's identifier
+  /// and the named struct types of every class and vtable.
+  virtual void begin(llvm::Module& header, llvm::ArrayRef<llvm::StructType*> types) = 0;
+  /// A verified part: the vtables and methods of some classes, or the free
+  /// functions.
+  /// Its declarations refer to definitions in other parts or to the C library.
+  virtual void part(llvm::Module& module) = 0;
+  /// Called last, with a module declaring the C library functions and
+  /// intrinsics the program calls.
+  virtual void externals(llvm::Module& module) = 0;
 };
 
 /// Lowers fakelang AST to LLVM IR using LLVM 17 APIs.
@@ -68,23 +151,108 @@ public:
 
   /// Provide the original source buffer and filename for annotation purposes.
   /// This enables mapping IR back to source lines in emitted comments.
-  void setSource(std::string sourceText, std::string filename);
+  /// The buffer is not copied; it must stay alive until generate() returns.
+  void setSource(std::string_view sourceText, std::string filename);
+
+  /// Optionally time each codegen pass into `timers` and record counters
+  /// into `stats`. Either may be null; both must outlive generate().
+  void setInstrumentation(PhaseTimers* timers, CompileStats* stats) {
+    timers_ = timers;
+    stats_ = stats;
+  }
+
+  /// Emit DWARF debug info (compile unit, subprograms, line locations) for
+  /// the file given to setSource(). Off by default.
+  void setDebugInfo(bool enabled) { debugInfo_ = enabled; }
 
-  /// Generate an LLVM module for the given program.
+  /// Lower only what `live` marks live, and lay out vtables as it says. Null
+  /// (the default) lowers everything. Not owned; must outlive generate().
+  void setLiveSet(const LiveSet* live) { live_ = live; }
+
+  /// Store each vtable slot as the i32 offset of the function from the
+  /// vtable, loaded with llvm.load.relative. Methods are then dso_local, as
+  /// the offsets are resolved at link time. Off by default.
+  void setRelativeVtables(bool enabled) { relativeVtables_ = enabled; }
+
+  /// Lower one file of a program linked from several modules: methods of
+  /// imported classes (ClassDecl::imported) are declared, not defined, and
+  /// vtables are not shared between classes, since another module may see
+  /// different classes. Each vtable is a hidden linkonce_odr COMDAT with
+  /// `!type` metadata for its class and every ancestor, and each virtual call
+  /// tests the vptr against its static class with llvm.type.test. Not
+  /// supported by generateStreaming(). Off by default.
+  void setSeparateCompilation(bool enabled) { separate_ = enabled; }
+
+  /// Lower for a JIT that replaces methods while the program runs
+  /// (HotSwap.h). Each class gets its own vtable, a mutable global with
+  /// external linkage, and each method a mutable @stub.<Class>.<method>
+  /// holding its address, through which exactly-typed calls go; slots and
+  /// stubs are loaded atomically, so that a store of a new address redirects
+  /// every later call. Effects are not turned into attributes, since a new
+  /// body may do more than the old one. With `patch`, lower only what it
+  /// names (not owned; must outlive generate()). Only for generate(), with
+  /// pointer vtables and everything live. Off by default.
+  void setHotSwap(bool enabled, const HotSwapPatch* patch = nullptr) {
+    hotSwap_ = enabled;
+    patch_ = patch;
+  }
+
+  /// Store a class ID in every object, and lower virtual calls as `policy`
+  /// chooses. Needs the whole program, as a class another module defines or
+  /// a hot swap compiles later could not be told apart; not for separate
+  /// compilation or hot swapping. Off by default.
+  void setClassIdDispatch(bool enabled, DispatchPolicy policy = {}) {
+    classIdDispatch_ = enabled;
+    dispatchPolicy_ = policy;
+  }
+
+  /// Generate an LLVM module for a program already annotated by Sema.
   /// Ownership stays in this class; use getModule() for a non-owning pointer.
-  void generate(const Program& program, const std::string& moduleName = "fakelang-module");
+  void generate(const Program& program, const ProgramInfo& info,
+                const std::string& moduleName = "fakelang-module");
+  /// Convenience: run Sema on `program`, then generate. Throws on errors.
+  void generate(Program& program, const std::string& moduleName = "fakelang-module");
+  /// Lower the program one part at a time into `sink`: parts holding the
+  /// vtables and methods of consecutive classes, then the free functions. Vtables get hidden
+  /// external linkage and strings unique names so the parts can be
+  /// concatenated or linked. Method bodies are freed as soon as they are
+  /// lowered. Debug info is not supported in this mode.
+  void generateStreaming(Program& program, const ProgramInfo& info, ModuleSink& sink,
+                         const std::string& moduleName = "fakelang-module");
   llvm::Module* getModule() const { return module_.get(); }
+  /// Hand the module, and the context that owns its types, to the caller
+  /// (e.g. a JIT). The CodeGen must not be used afterwards.
+  std::pair<std::unique_ptr<llvm::LLVMContext>, std::unique_ptr<llvm::Module>> takeModule();
 
 private:
   // Passes
-  /// Compute vtable layouts for all classes.
-  void computeClassLayouts(const Program&);
+  /// Create ClassInfo entries for all classes (indexed by ClassId).
+  void collectClasses(const Program&, const ProgramInfo&);
   /// Declare opaque struct types for classes and vtables.
   void declareTypes();
+  /// Create the class and vtable types of class `id` in the current context.
+  void declareTypes(ClassId id);
   /// Declare method functions and emit their bodies.
   void declareAndDefineMethods();
-  /// Emit vtable globals with initialized function pointers.
-  void defineVTables();
+  void declareMethods(ClassId id);
+  void defineMethods(ClassId id);
+  /// Point each instantiated class at the vtable of the first class whose
+  /// entries are the same. Nothing reads the class back out of a vtable, so
+  /// sharing is not observable.
+  void foldVTables();
+  /// Implementation in each entry of the vtable of `id`, in order; entries
+  /// whose implementation is not live have cls == kInvalidIndex.
+  std::vector<MethodRef> vtableEntries(ClassId id) const;
+  /// Emit vtable globals with initialized function pointers: those of the
+  /// program's own classes, or with `imported`, those of imported classes
+  /// that the module refers to.
+  void defineVTables(bool imported = false);
+  void defineVTable(ClassId id);
+  /// A vtable entry: a pointer to `fn`, or its offset from `vtable`; a
+  /// zero entry for null (never called).
+  llvm::Constant* vtableEntry(llvm::Function* fn, llvm::GlobalVariable* vtable);
+  /// Type identifier of class `id` in `!type` metadata and type tests.
+  llvm::MDString* typeId(ClassId id);
   /// Define free functions (e.g., main).
   void defineFunctions(const Program&);
 
@@ -96,60 +264,171 @@ private:
   llvm::PointerType* tyI8Ptr();
 
   /// Returns the LLVM function type for a method with the given return type.
-  llvm::FunctionType* methodFnTy(const std::string& retTypeName, llvm::StructType* classTy);
-  /// Map fakelang type name to LLVM type.
-  llvm::Type* retTypeFor(const std::string& typeName);
+  llvm::FunctionType* methodFnTy(SemaType retType, llvm::StructType* classTy);
+  /// Map a resolved fakelang type to its LLVM type.
+  llvm::Type* llvmTypeFor(SemaType type);
 
   /// Declare or fetch the libc `puts` function used by print().
   llvm::Function* getOrDeclarePuts();
+  /// Pointer to a global holding `text`.
+  llvm::Constant* stringConstant(llvm::StringRef text);
+
+  /// Class `id` with its types created in the current context.
+  ClassInfo& typesOf(ClassId id);
+  /// The function implementing `ref`; declared in the current module if it is
+  /// defined in another part.
+  llvm::Function* methodFunction(const MethodRef& ref);
+  /// Create the function for `ref`, named `name`, with its attributes.
+  llvm::Function* createMethodFunction(const MethodRef& ref, const llvm::Twine& name);
+  /// The vtable global of class `id`; declared in the current module if it is
+  /// defined in another part.
+  llvm::GlobalVariable* vtableOf(ClassId id);
+  /// Objects of class `id` hold only what every object of the class holds
+  /// alike (the vptr, and the class ID with setClassIdDispatch()), so that
+  /// one constant object can stand in for all of them. False once classes
+  /// have fields.
+  bool isStateless(ClassId id);
+  /// The constant object of stateless class `id`.
+  llvm::GlobalVariable* singletonOf(ClassId id);
+  /// The stub of `ref` (setHotSwap); declared in the current module until
+  /// defineStubs() gives it an initializer.
+  llvm::GlobalVariable* stubOf(const MethodRef& ref);
+  /// Point the stub of every method at the method.
+  void defineStubs();
+  /// With a HotSwapPatch: the methods of class `id`, or function `index`,
+  /// are lowered.
+  bool patches(ClassId id) const;
+  bool patchesFunction(size_t index) const;
+
+  // Streaming parts
+  /// Start a part: a fresh context, module and IRBuilder.
+  void beginPart();
+  /// Verify the current part, hand it to `sink`, and destroy it.
+  void finishPart(ModuleSink& sink);
+  /// Destroy the current part and forget everything created in it.
+  void discardPart();
+  /// Free a lowered body, keeping the literals that calls folded by the
+  /// partial evaluator may refer to from other bodies.
+  void releaseBody(std::vector<std::unique_ptr<Stmt>>& body);
+  /// Verify the current module; throws on errors.
+  void verify();
 
-  // Expression/statement codegen for a function/method
-  struct ScopeVar {
-    /// Alloca that holds a 'ptr' to the variable's value (object or string ptr).
-    llvm::AllocaInst* allocaPtr{nullptr};
-    /// Static type of the variable (e.g., class name or "String").
-    std::string typeName;
-  };
+  // Reachability (everything is live without setLiveSet())
+  bool isLive(const MethodRef& ref) const { return !live_ || live_->live(ref); }
+  bool isInstantiated(ClassId id) const { return !live_ || live_->instantiated[id]; }
+  /// Class `id` is instantiated and owns the vtable its objects point to.
+  bool emitsVTable(ClassId id) const { return isInstantiated(id) && classes_[id].vtableOwner == id; }
+  /// Number of vtable entries class `id` gets.
+  uint32_t vtableSize(ClassId id) const;
+  /// Position of Sema slot `slot` in the vtable of `id`.
+  uint32_t vtableIndex(ClassId id, uint32_t slot) const;
+  /// Record the live and dropped method and vtable counts in stats_.
+  void countEliminated();
+
+  // Attributes
+  /// Run the EffectAnalysis that the attributes below are derived from.
+  void inferEffects(const Program&, const ProgramInfo&);
+  /// Attributes of a method: its effects, and `this` never being accessed.
+  void addMethodAttributes(llvm::Function* fn, const MethodRef& ref);
+  /// What the attributes of a call to a method or function, or a virtual
+  /// call, may assume; anything under setHotSwap().
+  const Effects& effectsOf(const MethodRef& ref) const;
+  const Effects& functionEffects(size_t index) const;
+  const Effects& virtualCallEffects(ClassId cls, uint32_t slot) const;
+
+  /// Values of the locals of the function being lowered, indexed by the slot
+  /// Sema assigned. Locals are SSA values, never stack slots.
+  using Locals = SSABuilder;
 
   /// Lower an expression and return the resulting LLVM value.
-  llvm::Value* codegenExpr(const Expr*, std::map<std::string, ScopeVar>& scope,
-                           const std::string& expectedType = "");
+  llvm::Value* codegenExpr(const Expr*, Locals& locals);
   /// Lower a statement inside a function or method body.
-  void codegenStmt(const Stmt*, std::map<std::string, ScopeVar>& scope,
-                   const std::string& currentRetType,
-                   llvm::StructType* currentClassTy);
+  void codegenStmt(const Stmt*, Locals& locals);
+  /// Lower a run of prints of known strings starting at body[first] as one
+  /// puts; returns the number of statements lowered (0 if there is no run).
+  size_t codegenConstantPrints(const std::vector<std::unique_ptr<Stmt>>& body, size_t first);
+  /// Lower a function or method body, adding a default return if needed.
+  void codegenBody(const std::vector<std::unique_ptr<Stmt>>& body, uint32_t numLocals,
+                   SemaType retType);
+
+  // Debug info
+  /// Create the compile unit and module flags.
+  void beginDebugInfo();
+  /// Attach a subprogram for `fn`, declared at `loc`, and make it the scope
+  /// of subsequent locations.
+  void beginDebugFunction(llvm::Function* fn, const SourceRange& loc);
+  /// Give instructions created from now on the location `loc`.
+  void setDebugLoc(const SourceRange& loc);
 
   // Dynamic dispatch helper
-  /// Perform a virtual call through the vtable of `staticClassName` using
-  /// the given method name, returning the call result value.
-  llvm::Value* codegenVirtualCall(llvm::Value* thisPtr,
-                                  const std::string& staticClassName,
-                                  const std::string& methodName,
-                                  const std::string& retTypeName,
-                                  const SourceRange* srcLoc = nullptr);
-
-  // Utilities
-  /// Lookup a class by name or throw if unknown.
-  ClassInfo& requireClass(const std::string& name);
-  /// If `c` has a base class, return its ClassInfo; otherwise nullptr.
-  const ClassInfo* maybeBaseOf(const ClassInfo& c) const;
-  /// Return the vtable slot index for a class/method pair.
-  size_t slotOf(const std::string& className, const std::string& methodName) const;
-  /// Resolve the most-derived implementation function for a class/method pair.
-  llvm::Function* implementationFor(const std::string& className, const std::string& methodName);
+  /// Perform a virtual call through vtable slot `slot` of class `classId`,
+  /// returning the call result value.
+  llvm::Value* codegenVirtualCall(llvm::Value* thisPtr, ClassId classId, uint32_t slot,
+                                  SemaType retType, const SourceRange* srcLoc = nullptr);
+  /// Lower the virtual call `me` as dispatchPolicy_ chooses for the
+  /// implementations it may reach; null if that is the vtable.
+  llvm::Value* codegenClassIdDispatch(llvm::Value* thisPtr, const MethodCallExpr* me, Locals& locals);
 
   // State
-  llvm::LLVMContext ctx_;
+  std::unique_ptr<llvm::LLVMContext> context_{std::make_unique<llvm::LLVMContext>()};
+  llvm::LLVMContext* ctx_{context_.get()};
   std::unique_ptr<llvm::Module> module_;
   std::unique_ptr<llvm::IRBuilder<>> builder_;
 
-  // name -> ClassInfo
-  std::map<std::string, ClassInfo> classes_;
+  // ClassId -> ClassInfo
+  std::vector<ClassInfo> classes_;
+  // Vtable layouts computed by Sema (not owned)
+  const ClassLayoutTable* layouts_{nullptr};
+  // What to lower (not owned); null lowers everything
+  const LiveSet* live_{nullptr};
+  // Effects of calls, for attributes
+  std::optional<EffectAnalysis> effects_;
+  // Vtable entries are i32 offsets (setRelativeVtables)
+  bool relativeVtables_{false};
+  // One file of a multi-module program (setSeparateCompilation)
+  bool separate_{false};
+  // Methods may be replaced at run time (setHotSwap), and what to replace
+  bool hotSwap_{false};
+  const HotSwapPatch* patch_{nullptr};
+  // Objects hold class IDs that virtual calls may test (setClassIdDispatch)
+  bool classIdDispatch_{false};
+  DispatchPolicy dispatchPolicy_{};
+  // ClassId by preorder number (setClassIdDispatch)
+  std::vector<ClassId> byNumber_;
+
+  // Streaming (generateStreaming only)
+  /// A part is finished once its classes reach this many vtable slots plus
+  /// instructions. Declarations of methods inherited from classes in other
+  /// parts are repeated in every part, so tiny parts would be slow.
+  static constexpr size_t kPartSize = size_t{1} << 16;
+  bool streaming_{false};
+  std::string moduleName_{};
+  // Classes whose types were created in the current part
+  std::vector<ClassId> partClasses_;
+  // Literals kept alive by releaseBody()
+  std::vector<std::unique_ptr<Expr>> retainedLiterals_;
+  // Names the next string global (streamed strings must not collide across
+  // parts; ThinLTO needs every global named)
+  size_t nextString_{0};
+  // Numbers the copies of a singleton that streamed parts each define, for
+  // the same reason
+  size_t nextSingleton_{0};
+
+  // Instrumentation (optional, not owned)
+  PhaseTimers* timers_{nullptr};
+  CompileStats* stats_{nullptr};
+
+  // Debug info (only with setDebugInfo(true))
+  bool debugInfo_{false};
+  std::unique_ptr<llvm::DIBuilder> dib_;
+  llvm::DIFile* diFile_{nullptr};
+  llvm::DISubroutineType* diFnTy_{nullptr};
+  llvm::DISubprogram* diScope_{nullptr};
 
   // Source (for annotation)
   std::string sourceFilename_{};
-  std::string sourceText_{};
-  std::vector<std::string> sourceLines_{}; // 1-based lines stored 0-based here
+  std::string_view sourceText_{};               // borrowed; see setSource()
+  std::vector<std::string_view> sourceLines_{}; // 1-based lines stored 0-based here
 
   // Annotation helpers
   void annotate(llvm::Value* v, const SourceRange& rng, std::string_view kind);
@@ -0,0 +1,477 @@
+#include "CompileServer.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/xxhash.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fakelang {
+
+namespace {
+
+constexpr char kRequestMagic[4] = {'F', 'L', 'Q', '2'};
+constexpr char kResponseMagic[4] = {'F', 'L', 'R', '1'};
+constexpr size_t kHeaderSize = 4 + 4 + 8;      // magic + u32 + u64
+constexpr size_t kRequestHeaderSize = 4 + 4 + 4 + 8;
+/// Upper bound on a response payload; protects the client from allocating
+/// absurd buffers on a corrupt length prefix.
+constexpr uint64_t kMaxPayload = uint64_t{4} << 30;
+/// Upper bounds on the parts of a request. The server only grows its
+/// buffers as data arrives (readString), so a request that declares the
+/// maximum and sends less costs little.
+constexpr uint32_t kMaxOptions = uint32_t{1} << 20;
+constexpr uint32_t kMaxFilename = 4096;
+constexpr uint64_t kMaxSource = uint64_t{256} << 20;
+/// Bytes readString() adds to a buffer at a time.
+constexpr size_t kReadChunk = size_t{64} << 10;
+constexpr size_t kOptionsFixedSize = 1 + 1 + 2 + 4 + 4 + 4;
+
+/// Bits of the u16 flags word in an encoded CompileOptions.
+enum OptionFlag : uint16_t {
+  kFold = 1 << 0,
+  kDce = 1 << 1,
+  kShrinkVtables = 1 << 2,
+  kRelativeVtables = 1 << 3,
+  kClassIdDispatch = 1 << 4,
+  kOptimize = 1 << 5,
+  kDebugInfo = 1 << 6,
+  kStream = 1 << 7,
+  kThinLTO = 1 << 8,
+  kAllFlags = (1 << 9) - 1,
+};
+
+void appendLE32(std::string& out, uint32_t v) {
+  char buf[4];
+  llvm::support::endian::write32le(buf, v);
+  out.append(buf, sizeof(buf));
+}
+
+/// Encode the options a request is compiled with (see the wire format in
+/// CompileServer.h). timePhases and collectStats are not sent: responses
+/// carry no reports.
+std::string encodeOptions(const CompileOptions& opts) {
+  uint16_t flags = 0;
+  if (opts.fold) flags |= kFold;
+  if (opts.dce) flags |= kDce;
+  if (opts.shrinkVtables) flags |= kShrinkVtables;
+  if (opts.relativeVtables) flags |= kRelativeVtables;
+  if (opts.classIdDispatch) flags |= kClassIdDispatch;
+  if (opts.optimize) flags |= kOptimize;
+  if (opts.debugInfo) flags |= kDebugInfo;
+  if (opts.stream) flags |= kStream;
+  if (opts.thinLTO) flags |= kThinLTO;
+  const DispatchPolicy policy = opts.classIdDispatch.value_or(DispatchPolicy{});
+
+  std::string out;
+  out.push_back(static_cast<char>(opts.emit));
+  out.push_back(static_cast<char>(opts.compression));
+  char buf[2];
+  llvm::support::endian::write16le(buf, flags);
+  out.append(buf, sizeof(buf));
+  appendLE32(out, policy.maxCompare);
+  appendLE32(out, policy.maxSwitch);
+  appendLE32(out, static_cast<uint32_t>(opts.imports.size()));
+  for (const std::string& path : opts.imports) {
+    appendLE32(out, static_cast<uint32_t>(path.size()));
+    out += path;
+  }
+  return out;
+}
+
+/// Decode encodeOptions() output; throws std::runtime_error on a malformed
+/// or out-of-range encoding.
+CompileOptions decodeOptions(std::string_view in) {
+  if (in.size() < kOptionsFixedSize) throw std::runtime_error("Truncated compile options");
+  const auto* p = in.data();
+  const uint8_t emit = static_cast<uint8_t>(p[0]);
+  const uint8_t compression = static_cast<uint8_t>(p[1]);
+  const uint16_t flags = llvm::support::endian::read16le(p + 2);
+  if (emit > static_cast<uint8_t>(EmitKind::Interface)) {
+    throw std::runtime_error("Unknown emit kind " + std::to_string(emit));
+  }
+  if (compression > static_cast<uint8_t>(BitcodeCompression::Zstd)) {
+    throw std::runtime_error("Unknown bitcode compression " + std::to_string(compression));
+  }
+  if (flags & ~kAllFlags) throw std::runtime_error("Unknown compile option flags");
+
+  CompileOptions opts;
+  opts.emit = static_cast<EmitKind>(emit);
+  opts.compression = static_cast<BitcodeCompression>(compression);
+  opts.fold = flags & kFold;
+  opts.dce = flags & kDce;
+  opts.shrinkVtables = flags & kShrinkVtables;
+  opts.relativeVtables = flags & kRelativeVtables;
+  if (flags & kClassIdDispatch) {
+    opts.classIdDispatch = DispatchPolicy{llvm::support::endian::read32le(p + 4),
+                                          llvm::support::endian::read32le(p + 8)};
+  }
+  opts.optimize = flags & kOptimize;
+  opts.debugInfo = flags & kDebugInfo;
+  opts.stream = flags & kStream;
+  opts.thinLTO = flags & kThinLTO;
+
+  uint32_t imports = llvm::support::endian::read32le(p + 12);
+  size_t pos = kOptionsFixedSize;
+  for (; imports > 0; --imports) {
+    if (in.size() - pos < 4) throw std::runtime_error("Truncated compile options");
+    const uint32_t len = llvm::support::endian::read32le(p + pos);
+    pos += 4;
+    if (in.size() - pos < len) throw std::runtime_error("Truncated compile options");
+    opts.imports.emplace_back(in.substr(pos, len));
+    pos += len;
+  }
+  if (pos != in.size()) throw std::runtime_error("Trailing bytes after compile options");
+  return opts;
+}
+
+/// Read exactly `n` bytes. Returns false on EOF or error.
+bool readAll(int fd, void* buf, size_t n) {
+  auto* p = static_cast<char*>(buf);
+  while (n > 0) {
+    ssize_t r = ::read(fd, p, n);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) return false;
+    p += r;
+    n -= static_cast<size_t>(r);
+  }
+  return true;
+}
+
+/// Read exactly `n` bytes into `out`, growing it a chunk at a time rather
+/// than trusting `n` up front. Returns false on EOF or error.
+bool readString(int fd, std::string& out, uint64_t n) {
+  out.clear();
+  while (out.size() < n) {
+    const size_t have = out.size();
+    const size_t chunk = static_cast<size_t>(std::min<uint64_t>(n - have, kReadChunk));
+    out.resize(have + chunk);
+    if (!readAll(fd, out.data() + have, chunk)) return false;
+  }
+  return true;
+}
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0; // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+/// Mark `fd` close-on-exec and make writes to a vanished peer report EPIPE
+/// instead of raising SIGPIPE.
+void configureSocket(int fd) {
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#if defined(SO_NOSIGPIPE)
+  int one = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+/// Create a configured Unix stream socket; returns -1 on failure.
+int makeSocket() {
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0) configureSocket(fd);
+  return fd;
+}
+
+/// Write exactly `n` bytes. Returns false on error (e.g. peer went away).
+bool writeAll(int fd, const void* buf, size_t n) {
+  const auto* p = static_cast<const char*>(buf);
+  while (n > 0) {
+    ssize_t w = ::send(fd, p, n, kSendFlags);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    n -= static_cast<size_t>(w);
+  }
+  return true;
+}
+
+/// Fill a sockaddr_un for `path` or throw if it does not fit.
+sockaddr_un makeAddress(const std::string& path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error("Socket path too long: " + path);
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+std::runtime_error sysError(const std::string& what) {
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+bool writeResponse(int fd, const CompileResult& res) {
+  char hdr[kHeaderSize];
+  std::memcpy(hdr, kResponseMagic, 4);
+  const std::string& payload = res.ok ? res.output : res.error;
+  llvm::support::endian::write32le(hdr + 4, res.ok ? 0u : 1u);
+  llvm::support::endian::write64le(hdr + 8, payload.size());
+  return writeAll(fd, hdr, sizeof(hdr)) && writeAll(fd, payload.data(), payload.size());
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// CompileCache
+// ---------------------------------------------------------------------------
+
+std::string CompileCache::makeKey(const CompileOptions& opts, const std::string& filename,
+                                  std::string_view source) {
+  std::string key = encodeOptions(opts);
+  key.reserve(key.size() + filename.size() + source.size() + 1);
+  key += filename;
+  key.push_back('\0');
+  key += source;
+  return key;
+}
+
+bool CompileCache::lookup(const CompileOptions& opts, const std::string& filename,
+                          std::string_view source, CompileResult& out) {
+  if (capacity_ == 0) return false;
+  std::string key = makeKey(opts, filename, source);
+  const uint64_t h = llvm::xxHash64(key);
+  std::lock_guard<std::mutex> lk(mu_);
+  auto [b, e] = index_.equal_range(h);
+  for (auto it = b; it != e; ++it) {
+    if (it->second->key != key) continue;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->result;
+    ++hits_;
+    return true;
+  }
+  ++misses_;
+  return false;
+}
+
+void CompileCache::insert(const CompileOptions& opts, const std::string& filename,
+                          std::string_view source, const CompileResult& result) {
+  if (capacity_ == 0) return;
+  std::string key = makeKey(opts, filename, source);
+  const uint64_t h = llvm::xxHash64(key);
+  std::lock_guard<std::mutex> lk(mu_);
+  auto [b, e] = index_.equal_range(h);
+  for (auto it = b; it != e; ++it) {
+    if (it->second->key == key) return; // raced with another identical request
+  }
+  lru_.push_front(Entry{h, std::move(key), result});
+  index_.emplace(h, lru_.begin());
+  while (lru_.size() > capacity_) {
+    auto victim = std::prev(lru_.end());
+    auto [vb, ve] = index_.equal_range(victim->hash);
+    for (auto it = vb; it != ve; ++it) {
+      if (it->second == victim) { index_.erase(it); break; }
+    }
+    lru_.pop_back();
+  }
+}
+
+// ---------------------------------------------------------------------------
+// CompileServer
+// ---------------------------------------------------------------------------
+
+CompileServer::CompileServer(std::string socketPath, unsigned jobs, size_t cacheEntries)
+    : socketPath_(std::move(socketPath)),
+      pool_(llvm::hardware_concurrency(jobs)),
+      cache_(cacheEntries) {}
+
+CompileServer::~CompileServer() {
+  requestStop();
+  reapConnections(/*all=*/true);
+}
+
+void CompileServer::requestStop() {
+  stopping_.store(true);
+  const int fd = listenFd_.load();
+  if (fd >= 0) ::shutdown(fd, SHUT_RDWR); // wakes a blocked accept()
+}
+
+void CompileServer::serve() {
+  const sockaddr_un addr = makeAddress(socketPath_);
+  const int fd = makeSocket();
+  if (fd < 0) throw sysError("socket");
+  ::unlink(socketPath_.c_str());
+  if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      ::listen(fd, SOMAXCONN) < 0) {
+    auto err = sysError("Cannot listen on " + socketPath_);
+    ::close(fd);
+    throw err;
+  }
+  listenFd_.store(fd);
+  if (stopping_.load()) ::shutdown(fd, SHUT_RDWR);
+
+  while (!stopping_.load()) {
+    // Poll with a timeout so a stop request is noticed even on platforms
+    // where shutdown(2) does not wake a blocked accept().
+    pollfd pfd{fd, POLLIN, 0};
+    const int ready = ::poll(&pfd, 1, /*timeout ms=*/250);
+    if (ready < 0 && errno != EINTR) break;
+    if (ready <= 0 || stopping_.load()) continue;
+    const int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN) continue;
+      break; // shut down (EINVAL) or unrecoverable
+    }
+    configureSocket(client);
+    reapConnections(/*all=*/false);
+    {
+      std::lock_guard<std::mutex> lk(connMu_);
+      connFds_.insert(client);
+    }
+    Connection& conn = conns_.emplace_back();
+    conn.thread = std::thread([this, client, &conn] {
+      handleConnection(client);
+      {
+        std::lock_guard<std::mutex> lk(connMu_);
+        connFds_.erase(client);
+      }
+      ::close(client);
+      conn.done.store(true);
+    });
+  }
+
+  listenFd_.store(-1);
+  ::close(fd);
+  ::unlink(socketPath_.c_str());
+  {
+    // Unblock readers still waiting on idle clients.
+    std::lock_guard<std::mutex> lk(connMu_);
+    for (int c : connFds_) ::shutdown(c, SHUT_RDWR);
+  }
+  reapConnections(/*all=*/true);
+  pool_.wait();
+}
+
+void CompileServer::reapConnections(bool all) {
+  for (auto it = conns_.begin(); it != conns_.end();) {
+    if (all || it->done.load()) {
+      if (it->thread.joinable()) it->thread.join();
+      it = conns_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void CompileServer::handleConnection(int fd) {
+  while (true) {
+    char hdr[kRequestHeaderSize];
+    if (!readAll(fd, hdr, sizeof(hdr))) return;
+    if (std::memcmp(hdr, kRequestMagic, 4) != 0) {
+      writeResponse(fd, CompileResult{false, {}, "Malformed request", {}});
+      return;
+    }
+    const uint32_t optsLen = llvm::support::endian::read32le(hdr + 4);
+    const uint32_t nameLen = llvm::support::endian::read32le(hdr + 8);
+    const uint64_t srcLen = llvm::support::endian::read64le(hdr + 12);
+    if (optsLen > kMaxOptions || nameLen > kMaxFilename || srcLen > kMaxSource) {
+      writeResponse(fd, CompileResult{false, {}, "Request too large", {}});
+      return;
+    }
+    // Nothing thrown here may escape: it would end the whole daemon
+    std::string encodedOpts, filename, source;
+    try {
+      if (!readString(fd, encodedOpts, optsLen) || !readString(fd, filename, nameLen) ||
+          !readString(fd, source, srcLen)) {
+        return;
+      }
+    } catch (const std::exception& ex) {
+      // The rest of the request is unread, so the connection cannot go on
+      writeResponse(fd, CompileResult{false, {}, std::string("Cannot read request: ") + ex.what(), {}});
+      return;
+    }
+
+    CompileResult res;
+    try {
+      res = compile(decodeOptions(encodedOpts), filename, source);
+    } catch (const std::exception& ex) {
+      res = CompileResult{};
+      res.error = ex.what();
+    }
+    if (!writeResponse(fd, res)) return;
+  }
+}
+
+CompileResult CompileServer::compile(const CompileOptions& opts, const std::string& filename,
+                                     std::string_view source) {
+  // The key names imports by path only, so a result that read them could go
+  // stale when they are edited; such requests are always compiled.
+  const bool cacheable = opts.imports.empty();
+  CompileResult res;
+  if (cacheable && cache_.lookup(opts, filename, source, res)) return res;
+  res = pool_.async([&] { return compileSource(source, filename, opts); }).get();
+  if (cacheable) cache_.insert(opts, filename, source, res);
+  return res;
+}
+
+// ---------------------------------------------------------------------------
+// CompileClient
+// ---------------------------------------------------------------------------
+
+CompileClient::CompileClient(const std::string& socketPath) {
+  const sockaddr_un addr = makeAddress(socketPath);
+  fd_ = makeSocket();
+  if (fd_ < 0) throw sysError("socket");
+  if (::connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+    auto err = sysError("Cannot connect to " + socketPath);
+    ::close(fd_);
+    fd_ = -1;
+    throw err;
+  }
+}
+
+CompileClient::~CompileClient() {
+  if (fd_ >= 0) ::close(fd_);
+}
+
+CompileResult CompileClient::compile(std::string_view source, const std::string& filename,
+                                     const CompileOptions& opts) {
+  const std::string encodedOpts = encodeOptions(opts);
+  char hdr[kRequestHeaderSize];
+  std::memcpy(hdr, kRequestMagic, 4);
+  llvm::support::endian::write32le(hdr + 4, static_cast<uint32_t>(encodedOpts.size()));
+  llvm::support::endian::write32le(hdr + 8, static_cast<uint32_t>(filename.size()));
+  llvm::support::endian::write64le(hdr + 12, source.size());
+  if (!writeAll(fd_, hdr, sizeof(hdr)) || !writeAll(fd_, encodedOpts.data(), encodedOpts.size()) ||
+      !writeAll(fd_, filename.data(), filename.size()) || !writeAll(fd_, source.data(), source.size())) {
+    throw sysError("Failed to send request");
+  }
+
+  char rhdr[kHeaderSize];
+  if (!readAll(fd_, rhdr, sizeof(rhdr)) || std::memcmp(rhdr, kResponseMagic, 4) != 0) {
+    throw std::runtime_error("Malformed or missing response from compile server");
+  }
+  const uint32_t status = llvm::support::endian::read32le(rhdr + 4);
+  const uint64_t len = llvm::support::endian::read64le(rhdr + 8);
+  if (len > kMaxPayload) throw std::runtime_error("Response too large");
+  std::string payload(static_cast<size_t>(len), '\0');
+  if (!readAll(fd_, payload.data(), payload.size())) {
+    throw std::runtime_error("Truncated response from compile server");
+  }
+
+  CompileResult res;
+  res.ok = status == 0;
+  (res.ok ? res.output : res.error) = std::move(payload);
+  return res;
+}
+
+} // namespace fakelang
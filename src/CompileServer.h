@@ -0,0 +1,152 @@
+// Fakelang compile server: a long-lived daemon that answers compile requests
+// over a local Unix domain socket, and the thin client that talks to it.
+//
+// Wire format (all integers little-endian, one request/response pair at a
+// time per connection; a connection may carry any number of requests):
+//   request  := "FLQ2" u32 optionsLen u32 filenameLen u64 sourceLen options filename source
+//   options  := u8 emitKind u8 compression u16 flags u32 maxCompare u32 maxSwitch
+//               u32 importCount (u32 pathLen path)*
+//   response := "FLR1" u32 status u64 payloadLen payload
+// where flags are bit 0 fold, 1 dce, 2 shrinkVtables, 3 relativeVtables,
+// 4 classIdDispatch (with maxCompare/maxSwitch), 5 optimize, 6 debugInfo,
+// 7 stream, 8 thinLTO; import paths are resolved by the server. Status 0 means
+// success (payload = IR, object, or bitcode bytes) and status 1 means failure
+// (payload = diagnostic text). Phase timings and stats are not reported.
+// The server refuses sources over 256 MiB, filenames over 4 KiB and options
+// over 1 MiB, and answers any request it cannot read or compile with status 1.
+#pragma once
+
+#include "Driver.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/ThreadPool.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace fakelang {
+
+/// Bounded least-recently-used cache of compile results keyed by the full
+/// request (options, filename, and source text). Thread-safe. The server does
+/// not cache requests with imports, whose files the key does not cover.
+class CompileCache {
+public:
+  explicit CompileCache(size_t capacity) : capacity_(capacity) {}
+
+  /// Look up a previous result for this request; returns false on a miss.
+  bool lookup(const CompileOptions& opts, const std::string& filename,
+              std::string_view source, CompileResult& out);
+  /// Record a result, evicting the least recently used entry when full.
+  void insert(const CompileOptions& opts, const std::string& filename,
+              std::string_view source, const CompileResult& result);
+
+  size_t hits() const { return hits_.load(); }
+  size_t misses() const { return misses_.load(); }
+
+private:
+  struct Entry {
+    uint64_t hash;
+    std::string key;
+    CompileResult result;
+  };
+  static std::string makeKey(const CompileOptions& opts, const std::string& filename,
+                             std::string_view source);
+
+  size_t capacity_;
+  std::mutex mu_;
+  std::list<Entry> lru_; // front = most recently used
+  std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index_;
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+};
+
+/// Compile daemon listening on a Unix domain socket.
+///
+/// Each accepted connection is served by its own lightweight reader thread;
+/// the actual compilations run on one worker pool shared by all connections
+/// for the lifetime of the server, so concurrent requests from many clients
+/// are compiled in parallel without re-creating threads per request.
+/// Identical requests are answered from a CompileCache.
+class CompileServer {
+public:
+  /// - socketPath: filesystem path of the socket (an existing file is replaced)
+  /// - jobs: compile workers (0 = one per hardware thread)
+  /// - cacheEntries: results kept in the cache (0 disables caching)
+  CompileServer(std::string socketPath, unsigned jobs, size_t cacheEntries = 256);
+  ~CompileServer();
+
+  CompileServer(const CompileServer&) = delete;
+  CompileServer& operator=(const CompileServer&) = delete;
+
+  /// Bind and listen, then serve requests until requestStop() is called.
+  /// Throws std::runtime_error if the socket cannot be set up.
+  void serve();
+
+  /// Ask serve() to return. Only performs an atomic store and a shutdown(2)
+  /// call, so it is safe to invoke from a signal handler.
+  void requestStop();
+
+  const CompileCache& cache() const { return cache_; }
+
+private:
+  /// Read requests from `fd` until the peer disconnects.
+  void handleConnection(int fd);
+  /// Compile on the shared pool, consulting the cache first.
+  CompileResult compile(const CompileOptions& opts, const std::string& filename,
+                        std::string_view source);
+
+  std::string socketPath_;
+  llvm::ThreadPool pool_;
+  CompileCache cache_;
+  std::atomic<int> listenFd_{-1};
+  std::atomic<bool> stopping_{false};
+
+  /// A connection reader thread; `done` is set when it is ready to be joined.
+  struct Connection {
+    std::atomic<bool> done{false};
+    std::thread thread;
+  };
+  /// Join connection threads that have finished (called from serve() only).
+  void reapConnections(bool all);
+
+  std::list<Connection> conns_; // touched only by the serve() thread
+  std::mutex connMu_;
+  std::set<int> connFds_;       // open client sockets, for shutdown
+};
+
+/// Thin client for a running CompileServer.
+class CompileClient {
+public:
+  /// Connect to the server at `socketPath`; throws std::runtime_error on failure.
+  explicit CompileClient(const std::string& socketPath);
+  ~CompileClient();
+
+  CompileClient(const CompileClient&) = delete;
+  CompileClient& operator=(const CompileClient&) = delete;
+
+  /// Send one request and wait for its response. Compile errors come back as
+  /// !ok results; transport errors throw std::runtime_error.
+  CompileResult compile(std::string_view source, const std::string& filename,
+                        const CompileOptions& opts = {});
+
+private:
+  int fd_{-1};
+};
+
+} // namespace fakelang
@@ -0,0 +1,193 @@
+#include "CompileStats.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cstdint>
+
+namespace fakelang {
+
+// ---------------------------------------------------------------------------
+// PhaseTimers
+// ---------------------------------------------------------------------------
+
+PhaseTimers::PhaseTimers() : group_("fakelang", "Fakelang compile phases") {}
+
+PhaseTimers::~PhaseTimers() {
+  // Reset the timers so llvm::TimerGroup does not print its own report to
+  // stderr when the last timer is destroyed; results() is our reporting path.
+  group_.clear();
+}
+
+PhaseTimers::Phase& PhaseTimers::phaseFor(llvm::StringRef phase) {
+  for (auto& p : phases_) {
+    if (p->timer.getName() == phase) return *p;
+  }
+  phases_.push_back(std::make_unique<Phase>(phase, group_));
+  return *phases_.back();
+}
+
+// The phase is looked up (and created) before its allocations are counted
+PhaseTimers::Scope::Scope(PhaseTimers* timers, llvm::StringRef phase)
+    : phase_(timers ? &timers->phaseFor(phase) : nullptr),
+      allocs_(phase_ ? &phase_->allocs : nullptr) {
+  if (phase_) phase_->timer.startTimer();
+}
+
+PhaseTimers::Scope::~Scope() {
+  if (phase_) phase_->timer.stopTimer();
+}
+
+std::vector<PhaseTime> PhaseTimers::results() const {
+  std::vector<PhaseTime> out;
+  out.reserve(phases_.size());
+  for (const auto& p : phases_) {
+    const llvm::TimeRecord& tr = p->timer.getTotalTime();
+    out.push_back(PhaseTime{p->timer.getName(), tr.getWallTime(), tr.getUserTime(), tr.getSystemTime(), p->allocs});
+  }
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+// ---------------------------------------------------------------------------
+
+namespace {
+
+size_t countExpr(const Expr* e) {
+  if (!e) return 0;
+  if (auto* me = dynamic_cast<const MethodCallExpr*>(e)) return 1 + countExpr(me->receiver.get());
+  return 1;
+}
+
+size_t countStmt(const Stmt* s) {
+  if (auto* r = dynamic_cast<const ReturnStmt*>(s)) return 1 + countExpr(r->value.get());
+  if (auto* p = dynamic_cast<const PrintStmt*>(s)) return 1 + countExpr(p->value.get());
+  if (auto* v = dynamic_cast<const VarDeclStmt*>(s)) return 1 + countExpr(v->init.get());
+  return 1;
+}
+
+size_t countBody(const std::vector<std::unique_ptr<Stmt>>& body) {
+  size_t n = 0;
+  for (const auto& s : body) n += countStmt(s.get());
+  return n;
+}
+
+} // namespace
+
+size_t countAstNodes(const Program& program) {
+  size_t n = 0;
+  for (const auto& c : program.classes) {
+    n += 1;
+    for (const auto& m : c.methods) n += 1 + countBody(m.body);
+  }
+  for (const auto& f : program.functions) n += 1 + countBody(f.body);
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// Reporting
+// ---------------------------------------------------------------------------
+
+void printReportText(llvm::raw_ostream& os, const CompileReport& report) {
+  if (!report.phases.empty()) {
+    os << "===-- Phase timings: " << report.filename << " --===\n";
+    os << "    Wall (s)    User (s)     Sys (s)  ";
+    if (kAllocProfiling) os << "    Allocs         Bytes     Peak live  ";
+    os << "Phase\n";
+    auto row = [&](const PhaseTime& p) {
+      os << llvm::format("  %10.6f  %10.6f  %10.6f  ", p.wall, p.user, p.sys);
+      if (kAllocProfiling) {
+        os << llvm::format("%10llu  %12llu  %12llu  ", static_cast<unsigned long long>(p.allocs.allocations),
+                           static_cast<unsigned long long>(p.allocs.bytes),
+                           static_cast<unsigned long long>(p.allocs.peakLiveBytes));
+      }
+      os << p.name << "\n";
+    };
+    PhaseTime total{"total"};
+    for (const auto& p : report.phases) {
+      row(p);
+      total.wall += p.wall;
+      total.user += p.user;
+      total.sys += p.sys;
+      total.allocs.allocations += p.allocs.allocations;
+      total.allocs.bytes += p.allocs.bytes;
+      // Phases mostly run one after another: the overall peak is the largest
+      total.allocs.peakLiveBytes = std::max(total.allocs.peakLiveBytes, p.allocs.peakLiveBytes);
+    }
+    row(total);
+  }
+  if (report.stats) {
+    const CompileStats& s = *report.stats;
+    os << "===-- Statistics: " << report.filename << " --===\n";
+    auto row = [&](const char* name, size_t v) {
+      os << llvm::format("  %-22s %12zu\n", name, v);
+    };
+    row("tokens", s.tokens);
+    row("ast-nodes", s.astNodes);
+    row("classes", s.classes);
+    row("vtable-slots", s.vtableSlots);
+    row("virtual-calls", s.virtualCalls);
+    row("devirtualized-calls", s.devirtualizedCalls);
+    row("class-id-calls", s.classIdCalls);
+    row("folded-calls", s.foldedCalls);
+    row("dead-methods", s.deadMethods);
+    row("dead-vtable-slots", s.deadVtableSlots);
+    row("folded-vtables", s.foldedVtables);
+    row("ir-instructions", s.irInstructions);
+  }
+}
+
+void printReportJSON(llvm::raw_ostream& os, const CompileReport& report) {
+  auto num = [](size_t v) { return static_cast<int64_t>(v); };
+  llvm::json::OStream j(os);
+  j.object([&] {
+    j.attribute("file", report.filename);
+    if (!report.phases.empty()) {
+      j.attributeArray("phases", [&] {
+        for (const auto& p : report.phases) {
+          j.object([&] {
+            j.attribute("name", p.name);
+            j.attribute("wall", p.wall);
+            j.attribute("user", p.user);
+            j.attribute("sys", p.sys);
+            if (kAllocProfiling) {
+              j.attribute("allocs", static_cast<int64_t>(p.allocs.allocations));
+              j.attribute("allocBytes", static_cast<int64_t>(p.allocs.bytes));
+              j.attribute("peakLiveBytes", static_cast<int64_t>(p.allocs.peakLiveBytes));
+            }
+          });
+        }
+      });
+    }
+    if (report.stats) {
+      const CompileStats& s = *report.stats;
+      j.attributeObject("stats", [&] {
+        j.attribute("tokens", num(s.tokens));
+        j.attribute("astNodes", num(s.astNodes));
+        j.attribute("classes", num(s.classes));
+        j.attribute("vtableSlots", num(s.vtableSlots));
+        j.attribute("virtualCalls", num(s.virtualCalls));
+        j.attribute("devirtualizedCalls", num(s.devirtualizedCalls));
+        j.attribute("classIdCalls", num(s.classIdCalls));
+        j.attribute("foldedCalls", num(s.foldedCalls));
+        j.attribute("deadMethods", num(s.deadMethods));
+        j.attribute("deadVtableSlots", num(s.deadVtableSlots));
+        j.attribute("foldedVtables", num(s.foldedVtables));
+        j.attribute("irInstructions", num(s.irInstructions));
+      });
+    }
+  });
+  os << "\n";
+}
+
+} // namespace fakelang
@@ -0,0 +1,136 @@
+// Fakelang compile instrumentation: per-phase timers (and, in builds with
+// FAKELANG_ALLOC_PROFILE, per-phase allocation counts) and compiler
+// statistics, with human-readable and JSON reporting for build dashboards.
+#pragma once
+
+#include "AST.h"
+#include "AllocProfile.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Timer.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+/// Accumulated time for one compiler phase, in seconds, and its heap
+/// allocations (all zero unless kAllocProfiling).
+struct PhaseTime {
+  std::string name;
+  double wall{0};
+  double user{0};
+  double sys{0};
+  AllocCounts allocs{};
+};
+
+/// Named phase timers backed by an llvm::TimerGroup. Phases are reported in
+/// the order they were first entered; re-entering a phase accumulates. A
+/// phase entered while another is running is counted only in its own
+/// allocation counts, but in both phases' time.
+///
+/// User and system times come from getrusage() and are therefore
+/// process-wide: under `-j N` they include the other workers' CPU time.
+/// Wall time is always per phase.
+class PhaseTimers {
+  struct Phase;
+
+public:
+  PhaseTimers();
+  ~PhaseTimers();
+
+  PhaseTimers(const PhaseTimers&) = delete;
+  PhaseTimers& operator=(const PhaseTimers&) = delete;
+
+  /// RAII region that times `phase`, and counts its allocations, for its
+  /// lifetime. A null `timers` makes the scope a no-op, so instrumented code
+  /// needs no branches.
+  class Scope {
+  public:
+    Scope(PhaseTimers* timers, llvm::StringRef phase);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Phase* phase_;
+    AllocScope allocs_;
+  };
+
+  /// Snapshot of all phases in first-entered order.
+  std::vector<PhaseTime> results() const;
+
+private:
+  struct Phase {
+    Phase(llvm::StringRef name, llvm::TimerGroup& group) : timer(name, name, group) {}
+    llvm::Timer timer;
+    AllocCounts allocs;
+  };
+  Phase& phaseFor(llvm::StringRef phase);
+
+  llvm::TimerGroup group_;
+  std::vector<std::unique_ptr<Phase>> phases_;
+};
+
+/// Counters describing the size of one compilation.
+struct CompileStats {
+  size_t tokens{0};
+  /// Declarations, statements, and expressions in the AST.
+  size_t astNodes{0};
+  size_t classes{0};
+  /// Sum of vtable slot counts over all classes.
+  size_t vtableSlots{0};
+  /// Call sites lowered to an indirect call through a vtable.
+  size_t virtualCalls{0};
+  /// Call sites whose target was resolved at compile time instead.
+  size_t devirtualizedCalls{0};
+  /// Call sites lowered to tests of the class ID that branch to direct calls
+  /// (CodeGen::setClassIdDispatch).
+  size_t classIdCalls{0};
+  /// Call sites replaced by their compile-time result (see PartialEval.h).
+  size_t foldedCalls{0};
+  /// Methods not lowered because nothing reachable calls them (see Reachability.h).
+  size_t deadMethods{0};
+  /// Vtable slots not emitted: all slots of classes never instantiated, and
+  /// with shrunk vtables the slots no call reads.
+  size_t deadVtableSlots{0};
+  /// Vtables not emitted because an identical one is shared instead.
+  size_t foldedVtables{0};
+  size_t irInstructions{0};
+};
+
+/// Count declarations, statements, and expressions in `program`.
+size_t countAstNodes(const Program& program);
+
+/// Everything measured for one input.
+struct CompileReport {
+  std::string filename;
+  /// Present when phase timing was requested.
+  std::vector<PhaseTime> phases;
+  /// Present when statistics were requested.
+  std::optional<CompileStats> stats;
+};
+
+/// Print the report as aligned text tables (phases and/or stats).
+void printReportText(llvm::raw_ostream& os, const CompileReport& report);
+
+/// Print the report as a single line of JSON (JSON Lines), e.g.
+///   {"file":"a.fakelang","phases":[{"name":"lex","wall":0.001,"user":...,"sys":...}],
+///    "stats":{"tokens":42,...}}
+/// Keys are only present for the parts that were measured; phases also have
+/// "allocs", "allocBytes" and "peakLiveBytes" when kAllocProfiling.
+void printReportJSON(llvm::raw_ostream& os, const CompileReport& report);
+
+} // namespace fakelang
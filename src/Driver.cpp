@@ -0,0 +1,598 @@
+#include "Driver.h"
+
+#include "Bytecode.h"
+#include "CodeGen.h"
+#include "IRAnnotator.h"
+#include "Interpreter.h"
+#include "JIT.h"
+#include "Lexer.h"
+#include "ModuleInterface.h"
+#include "ObjectEmitter.h"
+#include "Optimizer.h"
+#include "PartialEval.h"
+#include "Parser.h"
+#include "Reachability.h"
+#include "Sema.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/AssemblyAnnotationWriter.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+
+namespace fakelang {
+
+std::optional<EmitKind> parseEmitKind(std::string_view s) {
+  if (s == "ll") return EmitKind::LL;
+  if (s == "obj") return EmitKind::Obj;
+  if (s == "bc") return EmitKind::BC;
+  return std::nullopt;
+}
+
+const char* extensionFor(EmitKind k) {
+  switch (k) {
+    case EmitKind::LL: return ".ll";
+    case EmitKind::Obj: return ".o";
+    case EmitKind::BC: return ".bc";
+    case EmitKind::Interface: return ".fli";
+  }
+  return "";
+}
+
+std::unique_ptr<llvm::MemoryBuffer> openInput(const std::string& path) {
+  auto buf = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                         /*RequiresNullTerminator=*/false);
+  if (!buf) throw std::runtime_error("Failed to open input file: " + path);
+  return std::move(*buf);
+}
+
+void printWithAnnotations(llvm::raw_ostream& os, llvm::Module& module,
+                          std::string_view source, const std::string& filename) {
+  // Section: Source (as comments), sliced straight out of the input buffer
+  os << "; === Source: " << filename << " ===\n";
+  size_t ln = 1;
+  for (size_t pos = 0; pos < source.size();) {
+    const size_t nl = source.find('\n', pos);
+    std::string_view line = source.substr(pos, nl == std::string_view::npos ? nl : nl - pos);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    os << "; " << ln++ << " | " << line << "\n";
+    if (nl == std::string_view::npos) break;
+    pos = nl + 1;
+  }
+  os << "; === LLVM Module IR ===\n";
+  FakelangAnnotationWriter annot;
+  module.print(os, &annot);
+}
+
+namespace {
+
+/// Timers and counters for one compilation, allocated only when requested.
+struct Instrumentation {
+  Instrumentation(const CompileOptions& opts, const std::string& filename) {
+    report.filename = filename;
+    if (opts.timePhases) timers = std::make_unique<PhaseTimers>();
+    if (opts.collectStats) report.stats.emplace();
+  }
+
+  PhaseTimers* phaseTimers() { return timers.get(); }
+  CompileStats* stats() { return report.stats ? &*report.stats : nullptr; }
+
+  /// Snapshot the timers into the report and return it.
+  CompileReport take() {
+    if (timers) report.phases = timers->results();
+    return std::move(report);
+  }
+
+  std::unique_ptr<PhaseTimers> timers;
+  CompileReport report;
+};
+
+/// Append the classes of each file in `opts.imports` to `prog`, marked
+/// imported and without method bodies. Their functions are dropped. An
+/// interface file is copied in without parsing anything.
+void importClasses(const std::string& filename, const CompileOptions& opts, Instrumentation& inst,
+                   Program& prog) {
+  PhaseTimers::Scope t(inst.phaseTimers(), "import");
+  for (const std::string& path : opts.imports) {
+    if (path == filename || llvm::sys::fs::equivalent(path, filename)) continue;
+    const std::unique_ptr<llvm::MemoryBuffer> buf = openInput(path);
+    if (isInterface(buf->getBuffer())) {
+      const ModuleInterface iface(buf->getMemBufferRef());
+      const std::string source(iface.sourcePath());
+      if (source == filename || llvm::sys::fs::equivalent(source, filename)) continue;
+      iface.importInto(prog);
+      continue;
+    }
+    Program other = Parser(Lexer(std::string_view(buf->getBufferStart(), buf->getBufferSize()), path).lexAll())
+                        .parseProgram();
+    for (ClassDecl& c : other.classes) {
+      c.imported = true;
+      for (MethodDecl& m : c.methods) std::vector<std::unique_ptr<Stmt>>().swap(m.body);
+      prog.classes.push_back(std::move(c));
+    }
+  }
+}
+
+/// Lex, parse, check, and partially evaluate (unless disabled) `source` into
+/// `prog` and `info`; throws on error. The token vector is released as soon
+/// as parsing finishes, before later phases allocate.
+void analyzeSource(std::string_view source, const std::string& filename, const CompileOptions& opts,
+                   Instrumentation& inst, Program& prog, ProgramInfo& info) {
+  PhaseTimers* timers = inst.phaseTimers();
+  CompileStats* stats = inst.stats();
+  {
+    std::vector<Token> tokens;
+    {
+      PhaseTimers::Scope t(timers, "lex");
+      tokens = Lexer(source, filename).lexAll();
+    }
+    if (stats) stats->tokens = tokens.size();
+    PhaseTimers::Scope t(timers, "parse");
+    prog = Parser(std::move(tokens)).parseProgram();
+  }
+  if (stats) stats->astNodes = countAstNodes(prog);
+  if (!opts.imports.empty()) importClasses(filename, opts, inst, prog);
+  {
+    PhaseTimers::Scope t(timers, "sema");
+    info = Sema(filename).analyze(prog);
+  }
+  if (opts.fold) {
+    PhaseTimers::Scope t(timers, "fold");
+    PartialEvaluator(info).run(prog);
+  }
+}
+
+/// What CodeGen should lower, or nothing (lower everything) without opts.dce
+/// or with separate compilation.
+std::optional<LiveSet> findLive(const Program& prog, const ProgramInfo& info, const CompileOptions& opts,
+                                Instrumentation& inst) {
+  // Other modules may call anything in this one
+  if (!opts.dce || opts.separateCompilation()) return std::nullopt;
+  PhaseTimers::Scope t(inst.phaseTimers(), "dce");
+  return ReachabilityAnalysis(info).run(prog, opts.shrinkVtables);
+}
+
+/// Analyze and lower `source` to an LLVM module; throws on error.
+std::unique_ptr<CodeGen> lowerSource(std::string_view source, const std::string& filename,
+                                     const CompileOptions& opts, Instrumentation& inst) {
+  Program prog;
+  ProgramInfo info;
+  analyzeSource(source, filename, opts, inst, prog, info);
+  const std::optional<LiveSet> live = findLive(prog, info, opts, inst);
+  auto cg = std::make_unique<CodeGen>();
+  cg->setSource(source, filename);
+  cg->setInstrumentation(inst.phaseTimers(), inst.stats());
+  cg->setDebugInfo(opts.debugInfo);
+  cg->setLiveSet(live ? &*live : nullptr);
+  cg->setRelativeVtables(opts.relativeVtables);
+  if (opts.classIdDispatch) cg->setClassIdDispatch(true, *opts.classIdDispatch);
+  cg->setSeparateCompilation(opts.separateCompilation());
+  cg->generate(prog, info, filename);
+  // The ThinLTO backends compile for the host; optimize for it already
+  if (opts.thinLTO) setHostTarget(*cg->getModule());
+  if (opts.optimize) {
+    PhaseTimers::Scope t(inst.phaseTimers(), "optimize");
+    optimizeModule(*cg->getModule(), opts.thinLTO);
+  }
+  return cg;
+}
+
+/// Check `source` and write the interface of its classes to `os`; throws on
+/// error.
+void emitInterface(llvm::raw_ostream& os, std::string_view source, const std::string& filename,
+                   const CompileOptions& opts, Instrumentation& inst) {
+  CompileOptions check = opts;
+  check.fold = false; // nothing of the bodies goes into the interface
+  Program prog;
+  ProgramInfo info;
+  analyzeSource(source, filename, check, inst, prog, info);
+  PhaseTimers::Scope t(inst.phaseTimers(), "emit-interface");
+  writeInterface(prog, filename, os);
+}
+
+/// Throw unless `opts` can be honored by a streamed compile.
+void checkStreamable(const CompileOptions& opts) {
+  if (opts.emit != EmitKind::LL && opts.emit != EmitKind::BC) throw std::runtime_error("Streaming supports --emit=ll and --emit=bc only");
+  if (opts.compression != BitcodeCompression::None) {
+    throw std::runtime_error("Compressed bitcode cannot be streamed");
+  }
+  if (opts.debugInfo) throw std::runtime_error("Debug info is not supported when streaming");
+  if (opts.optimize) throw std::runtime_error("Optimization is not supported when streaming");
+  if (opts.separateCompilation()) throw std::runtime_error("Imports and ThinLTO are not supported when streaming");
+}
+
+/// Forwards to FakelangAnnotationWriter while recording where each function
+/// starts and each global variable ends in Module::print output.
+class OffsetRecorder final : public llvm::AssemblyAnnotationWriter {
+public:
+  explicit OffsetRecorder(FakelangAnnotationWriter& annot) : annot_(annot) {}
+
+  void emitFunctionAnnot(const llvm::Function* F, llvm::formatted_raw_ostream& OS) override {
+    functions.emplace_back(F, OS.tell());
+    annot_.emitFunctionAnnot(F, OS);
+  }
+  void printInfoComment(const llvm::Value& V, llvm::formatted_raw_ostream& OS) override {
+    annot_.printInfoComment(V, OS);
+    if (auto* gv = llvm::dyn_cast<llvm::GlobalVariable>(&V)) globals.emplace_back(gv, OS.tell());
+  }
+
+  std::vector<std::pair<const llvm::Function*, uint64_t>> functions;
+  std::vector<std::pair<const llvm::GlobalVariable*, uint64_t>> globals;
+
+private:
+  FakelangAnnotationWriter& annot_;
+};
+
+/// Prints a streamed program as one annotated .ll: the source echo and type
+/// definitions first, then each part's global and function definitions as
+/// they arrive, and the C library declarations and attribute groups last.
+class StreamingIRPrinter final : public ModuleSink {
+public:
+  StreamingIRPrinter(llvm::raw_ostream& os, std::string_view source, const std::string& filename,
+                     PhaseTimers* timers)
+      : os_(os), source_(source), filename_(filename), timers_(timers) {}
+
+  void begin(llvm::Module& header, llvm::ArrayRef<llvm::StructType*> types) override {
+    PhaseTimers::Scope t(timers_, "print");
+    printWithAnnotations(os_, header, source_, filename_);
+    os_ << "\n";
+    for (llvm::StructType* ty : types) {
+      ty->print(os_);
+      os_ << "\n";
+    }
+  }
+
+  /// Print the whole part once and copy out its definitions. Printing each
+  /// global or function on its own rescans the module every time, which is
+  /// quadratic in the size of the part.
+  void part(llvm::Module& module) override {
+    PhaseTimers::Scope t(timers_, "print");
+    copy(module, /*definitions=*/true);
+  }
+
+  /// Print the C library declarations, then every attribute group the
+  /// program used.
+  void externals(llvm::Module& module) override {
+    PhaseTimers::Scope t(timers_, "print");
+    copy(module, /*definitions=*/false);
+    if (!groups_.empty()) os_ << "\n";
+    for (size_t i = 0; i < groups_.size(); ++i) os_ << "attributes #" << i << " = " << groups_[i] << "\n";
+  }
+
+private:
+  /// Print `module` into text_ and copy out either its global and function
+  /// definitions or its function declarations.
+  void copy(llvm::Module& module, bool definitions) {
+    annot_.detachSourceMapping(module);
+    checkNoMetadata(module);
+    OffsetRecorder offsets(annot_);
+    text_.clear();
+    {
+      llvm::raw_svector_ostream tos(text_);
+      module.print(tos, &offsets);
+    }
+    const llvm::StringRef text(text_.data(), text_.size());
+    // Attribute groups follow the last function
+    const size_t groups = std::min(text.find("\nattributes #"), text.size());
+    mapGroups(text.substr(groups));
+    os_ << "\n";
+    for (const auto& [gv, end] : offsets.globals) {
+      // A global prints on one line
+      if (definitions && !gv->isDeclaration()) os_ << text.slice(text.rfind('\n', end) + 1, end) << "\n";
+    }
+    for (size_t i = 0; i < offsets.functions.size(); ++i) {
+      const auto& [fn, start] = offsets.functions[i];
+      if (fn->isDeclaration() == definitions) continue;
+      const uint64_t end = i + 1 < offsets.functions.size() ? offsets.functions[i + 1].second : groups;
+      if (definitions) os_ << "\n";
+      copyRenumbered(text.slice(start, end).rtrim('\n'));
+    }
+  }
+
+  /// Throw if `module` still holds metadata once the source mapping is
+  /// detached. Only definitions are copied out, so metadata nodes would be
+  /// lost and references to them left dangling.
+  static void checkNoMetadata(const llvm::Module& module) {
+    if (!module.named_metadata_empty()) {
+      throw std::runtime_error("Cannot stream " + module.named_metadata_begin()->getName().str() + " metadata");
+    }
+    llvm::SmallVector<std::pair<unsigned, llvm::MDNode*>, 4> attached;
+    auto check = [&](const llvm::StringRef where) {
+      if (attached.empty()) return;
+      llvm::SmallVector<llvm::StringRef, 8> names;
+      module.getContext().getMDKindNames(names);
+      throw std::runtime_error("Cannot stream !" + names[attached.front().first].str() + " metadata on " +
+                               where.str());
+    };
+    for (const llvm::GlobalVariable& gv : module.globals()) {
+      gv.getAllMetadata(attached);
+      check(gv.getName());
+    }
+    for (const llvm::Function& fn : module) {
+      fn.getAllMetadata(attached);
+      check(fn.getName());
+      for (const llvm::BasicBlock& bb : fn) {
+        for (const llvm::Instruction& inst : bb) {
+          inst.getAllMetadata(attached);
+          check("an instruction in " + fn.getName().str());
+        }
+      }
+    }
+  }
+
+  /// Map the module's `attributes #N = { ... }` lines to program-wide numbers.
+  void mapGroups(llvm::StringRef lines) {
+    localGroups_.clear();
+    while (!lines.empty()) {
+      llvm::StringRef line;
+      std::tie(line, lines) = lines.split('\n');
+      if (!line.consume_front("attributes #")) continue;
+      unsigned local = 0;
+      if (line.consumeInteger(10, local) || !line.consume_front(" = ")) continue;
+      const auto [it, inserted] = groupIds_.try_emplace(line, static_cast<unsigned>(groups_.size()));
+      if (inserted) groups_.push_back(line.str());
+      if (localGroups_.size() <= local) localGroups_.resize(local + 1);
+      localGroups_[local] = it->second;
+    }
+  }
+
+  /// Copy `lines` to the output with attribute group references (`#N`)
+  /// renumbered. Only code is rewritten; comments are kept as printed.
+  void copyRenumbered(llvm::StringRef lines) {
+    while (!lines.empty()) {
+      llvm::StringRef line;
+      std::tie(line, lines) = lines.split('\n');
+      const size_t comment = std::min(line.find(';'), line.size());
+      llvm::StringRef code = line.take_front(comment);
+      for (size_t hash = code.find('#'); hash != llvm::StringRef::npos; hash = code.find('#')) {
+        os_ << code.take_front(hash + 1);
+        code = code.drop_front(hash + 1);
+        unsigned local = 0;
+        if (code.consumeInteger(10, local) || local >= localGroups_.size() || !localGroups_[local]) {
+          throw std::runtime_error("Streamed IR refers to an unknown attribute group: " + line.str());
+        }
+        os_ << *localGroups_[local];
+      }
+      os_ << code << line.drop_front(comment) << "\n";
+    }
+  }
+
+  llvm::raw_ostream& os_;
+  std::string_view source_;
+  const std::string& filename_;
+  PhaseTimers* timers_;
+  FakelangAnnotationWriter annot_;
+  /// Text of the current part
+  llvm::SmallVector<char, 0> text_;
+  /// Distinct attribute groups of all parts, by program-wide number
+  std::vector<std::string> groups_;
+  llvm::StringMap<unsigned> groupIds_;
+  /// Part-local group number -> program-wide number, if the part has it
+  std::vector<std::optional<unsigned>> localGroups_;
+};
+
+/// Writes a streamed program as multi-module bitcode, one module per part.
+class StreamingBitcodeWriter final : public ModuleSink {
+public:
+  StreamingBitcodeWriter(llvm::raw_ostream& os, PhaseTimers* timers) : writer_(os), timers_(timers) {}
+
+  void begin(llvm::Module&, llvm::ArrayRef<llvm::StructType*>) override {}
+  void part(llvm::Module& module) override {
+    PhaseTimers::Scope t(timers_, "emit-bitcode");
+    writer_.write(module);
+  }
+  /// Each part already declares what it calls.
+  void externals(llvm::Module&) override {}
+
+private:
+  BitcodeStreamWriter writer_;
+  PhaseTimers* timers_;
+};
+
+/// Analyze `source` and stream its lowered parts to `os` as `opts` selects;
+/// throws on error.
+void streamSource(llvm::raw_ostream& os, std::string_view source, const std::string& filename,
+                  const CompileOptions& opts, Instrumentation& inst) {
+  checkStreamable(opts);
+  Program prog;
+  ProgramInfo info;
+  analyzeSource(source, filename, opts, inst, prog, info);
+  const std::optional<LiveSet> live = findLive(prog, info, opts, inst);
+  CodeGen cg;
+  cg.setSource(source, filename);
+  cg.setInstrumentation(inst.phaseTimers(), inst.stats());
+  cg.setLiveSet(live ? &*live : nullptr);
+  cg.setRelativeVtables(opts.relativeVtables);
+  if (opts.classIdDispatch) cg.setClassIdDispatch(true, *opts.classIdDispatch);
+  if (opts.emit == EmitKind::LL) {
+    StreamingIRPrinter sink(os, source, filename, inst.phaseTimers());
+    cg.generateStreaming(prog, info, sink, filename);
+  } else {
+    StreamingBitcodeWriter sink(os, inst.phaseTimers());
+    cg.generateStreaming(prog, info, sink, filename);
+  }
+}
+
+/// Write the output selected by `opts` for an already lowered module.
+void writeResult(llvm::raw_ostream& os, CodeGen& cg, std::string_view source,
+                 const std::string& filename, const CompileOptions& opts,
+                 PhaseTimers* timers) {
+  switch (opts.emit) {
+    case EmitKind::LL: {
+      PhaseTimers::Scope t(timers, "print");
+      printWithAnnotations(os, *cg.getModule(), source, filename);
+      break;
+    }
+    case EmitKind::Obj: {
+      PhaseTimers::Scope t(timers, "emit-object");
+      llvm::SmallVector<char, 0> obj;
+      emitObjectFile(*cg.getModule(), obj);
+      os.write(obj.data(), obj.size());
+      break;
+    }
+    case EmitKind::BC: {
+      PhaseTimers::Scope t(timers, "emit-bitcode");
+      if (!opts.thinLTO) {
+        writeBitcode(*cg.getModule(), opts.compression, os);
+        break;
+      }
+      if (opts.compression != BitcodeCompression::None) {
+        throw std::runtime_error("ThinLTO bitcode cannot be compressed");
+      }
+      writeThinLTOBitcode(*cg.getModule(), os);
+      break;
+    }
+    case EmitKind::Interface: break; // written by emitInterface() without lowering
+  }
+}
+
+/// Stream `source` into `output` ("-" or empty for stdout). A file is
+/// written under a temporary name and only replaces `output` on success.
+void streamFile(std::string_view source, const std::string& input, const std::string& output,
+                const CompileOptions& opts, Instrumentation& inst) {
+  auto flush = [](llvm::raw_fd_ostream& os) {
+    os.flush();
+    if (os.has_error()) {
+      std::string msg = "Failed to write output: " + os.error().message();
+      os.clear_error();
+      throw std::runtime_error(msg);
+    }
+  };
+  if (output.empty() || output == "-") {
+    llvm::raw_fd_ostream& os = llvm::outs();
+    os.SetBufferSize(kOutputBufferSize);
+    streamSource(os, source, input, opts, inst);
+    flush(os);
+    return;
+  }
+  llvm::Expected<llvm::sys::fs::TempFile> tmp = llvm::sys::fs::TempFile::create(output + ".tmp-%%%%%%");
+  if (!tmp) throw std::runtime_error("Failed to open output: " + llvm::toString(tmp.takeError()));
+  try {
+    llvm::raw_fd_ostream os(tmp->FD, /*shouldClose=*/false);
+    os.SetBufferSize(kOutputBufferSize);
+    streamSource(os, source, input, opts, inst);
+    flush(os);
+  } catch (...) {
+    llvm::consumeError(tmp->discard());
+    throw;
+  }
+  if (llvm::Error err = tmp->keep(output)) {
+    throw std::runtime_error("Failed to write output: " + llvm::toString(std::move(err)));
+  }
+}
+
+} // namespace
+
+CompileResult compileSource(std::string_view source, const std::string& filename,
+                            const CompileOptions& opts) {
+  CompileResult res;
+  Instrumentation inst(opts, filename);
+  try {
+    llvm::raw_string_ostream os(res.output);
+    if (opts.stream) {
+      streamSource(os, source, filename, opts, inst);
+    } else if (opts.emit == EmitKind::Interface) {
+      emitInterface(os, source, filename, opts, inst);
+    } else {
+      auto cg = lowerSource(source, filename, opts, inst);
+      writeResult(os, *cg, source, filename, opts, inst.phaseTimers());
+    }
+    os.flush();
+    res.ok = true;
+  } catch (const std::exception& ex) {
+    res.output.clear();
+    res.error = ex.what();
+  }
+  res.report = inst.take();
+  return res;
+}
+
+CompileReport compileFile(const std::string& input, const std::string& output,
+                          const CompileOptions& opts) {
+  Instrumentation inst(opts, input);
+  std::unique_ptr<llvm::MemoryBuffer> buf;
+  {
+    PhaseTimers::Scope t(inst.phaseTimers(), "read");
+    buf = openInput(input);
+  }
+  const std::string_view source(buf->getBufferStart(), buf->getBufferSize());
+  if (opts.stream) {
+    streamFile(source, input, output, opts, inst);
+    return inst.take();
+  }
+  std::unique_ptr<CodeGen> cg;
+  std::string iface;
+  if (opts.emit == EmitKind::Interface) {
+    llvm::raw_string_ostream ios(iface);
+    emitInterface(ios, source, input, opts, inst);
+  } else {
+    cg = lowerSource(source, input, opts, inst);
+  }
+
+  // Open the output only once compilation succeeded so a failed compile
+  // never truncates an existing file.
+  std::error_code ec;
+  llvm::raw_fd_ostream os(output.empty() ? "-" : output, ec, llvm::sys::fs::OF_None);
+  if (ec) throw std::runtime_error("Failed to open output: " + ec.message());
+  os.SetBufferSize(kOutputBufferSize);
+  if (cg) writeResult(os, *cg, source, input, opts, inst.phaseTimers());
+  else os << iface;
+  os.close();
+  if (os.has_error()) {
+    std::string msg = "Failed to write output: " + os.error().message();
+    os.clear_error();
+    throw std::runtime_error(msg);
+  }
+  return inst.take();
+}
+
+int32_t runSource(std::string_view source, const std::string& filename, RunMode mode,
+                  llvm::raw_ostream& out, const CompileOptions& opts, CompileReport* report) {
+  if (opts.separateCompilation()) {
+    throw std::runtime_error("A program with imports must be compiled and linked; it cannot be run in-process");
+  }
+  Instrumentation inst(opts, filename);
+  PhaseTimers* timers = inst.phaseTimers();
+  int32_t result = 0;
+  switch (mode) {
+    case RunMode::Interp: {
+      Program prog;
+      ProgramInfo info;
+      analyzeSource(source, filename, opts, inst, prog, info);
+      BytecodeModule mod;
+      {
+        PhaseTimers::Scope t(timers, "bytecode");
+        mod = compileBytecode(prog, info);
+      }
+      PhaseTimers::Scope t(timers, "run");
+      result = VM(mod).run(out);
+      break;
+    }
+    case RunMode::JIT: {
+      auto cg = lowerSource(source, filename, opts, inst);
+      auto [context, module] = cg->takeModule();
+      PhaseTimers::Scope t(timers, "jit");
+      result = runInJIT(std::move(context), std::move(module));
+      break;
+    }
+  }
+  if (report) *report = inst.take();
+  return result;
+}
+
+} // namespace fakelang
@@ -0,0 +1,162 @@
+// Fakelang driver: the lex -> parse -> codegen -> print pipeline as a library.
+// Shared by the command-line tool for single-file and batch compilation, and
+// for running programs in-process (bytecode VM or JIT).
+#pragma once
+
+#include "BitcodeEmitter.h"
+#include "CodeGen.h"
+#include "CompileStats.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fakelang {
+
+/// Output formats the driver can produce.
+enum class EmitKind {
+  /// Annotated textual LLVM IR (source echo + per-instruction comments).
+  LL,
+  /// Native object file for the host target.
+  Obj,
+  /// LLVM bitcode, optionally in a compressed container (BitcodeEmitter.h).
+  BC,
+  /// The declarations of the input's classes, for other files to import
+  /// (ModuleInterface.h). Only lexing, parsing and Sema run.
+  Interface,
+};
+
+/// Parse an `--emit=` value ("ll", "obj", "bc"); returns std::nullopt if unknown.
+std::optional<EmitKind> parseEmitKind(std::string_view s);
+/// File extension (including the dot) conventionally used for `k`.
+const char* extensionFor(EmitKind k);
+
+/// Options controlling how a single input is compiled.
+struct CompileOptions {
+  EmitKind emit{EmitKind::LL};
+  /// Time each phase (read, lex, parse, codegen passes, print/emit).
+  bool timePhases{false};
+  /// Collect CompileStats counters.
+  bool collectStats{false};
+  /// Run the partial evaluator: fold calls to side-effect-free methods,
+  /// call exactly-typed receivers directly, and merge constant prints.
+  bool fold{true};
+  /// Lower only the classes, methods and functions reachable from `main`
+  /// (Reachability.h). Programs without `main` are always lowered whole.
+  bool dce{true};
+  /// With dce, drop the vtable slots no reachable call reads and renumber
+  /// the rest; vtables then no longer follow the Sema layout.
+  bool shrinkVtables{false};
+  /// Store vtable slots as 32-bit offsets (CodeGen::setRelativeVtables).
+  bool relativeVtables{false};
+  /// Store a class ID in objects and lower virtual calls by the number of
+  /// implementations they may reach, with these thresholds
+  /// (CodeGen::setClassIdDispatch). Not with separate compilation.
+  std::optional<DispatchPolicy> classIdDispatch;
+  /// Run LLVM's -O2 pipeline on the module before writing or running it
+  /// (Optimizer.h). Not available when streaming.
+  bool optimize{false};
+  /// Emit DWARF debug info (CodeGen::setDebugInfo).
+  bool debugInfo{false};
+  /// Container for EmitKind::BC output; ignored for other kinds.
+  BitcodeCompression compression{BitcodeCompression::None};
+  /// Lower and write a few classes at a time (CodeGen::generateStreaming) so
+  /// that peak memory follows the largest class, not the whole program.
+  /// EmitKind::LL or uncompressed EmitKind::BC only, without debugInfo.
+  bool stream{false};
+  /// Other files of the program, whose classes the input may use and extend:
+  /// their sources or, to skip parsing them, their interfaces
+  /// (EmitKind::Interface). Only their class and method declarations are read; their methods are
+  /// defined by their own modules, and the modules are linked (e.g. with
+  /// runThinLTO()). An entry naming the input itself, or its interface, is
+  /// skipped, so every file can be compiled with the same list.
+  std::vector<std::string> imports;
+  /// With EmitKind::BC, write plain bitcode with a ThinLTO module summary
+  /// (writeThinLTOBitcode()), and run the ThinLTO pre-link pipeline for
+  /// `optimize`.
+  bool thinLTO{false};
+
+  /// The input is one module of a program linked from several: set by
+  /// imports or thinLTO. The whole program is not visible, so dce is off and
+  /// CodeGen lowers in its separate compilation mode
+  /// (CodeGen::setSeparateCompilation). Such programs cannot be run in-process
+  /// or streamed.
+  bool separateCompilation() const { return !imports.empty() || thinLTO; }
+};
+
+/// Outcome of compiling one input. On failure `output` is empty and `error`
+/// holds the diagnostic; exceptions never escape the compile entry points.
+struct CompileResult {
+  bool ok{false};
+  /// Annotated textual IR, object file, or bitcode bytes, depending on the EmitKind.
+  std::string output;
+  /// Diagnostic message when !ok.
+  std::string error;
+  /// Timings and statistics requested through CompileOptions. Phases that
+  /// ran before a failure are still reported.
+  CompileReport report;
+};
+
+/// Size of the output stream buffer used by compileFile(); large enough that
+/// the source echo and module text are written in few, big syscalls.
+inline constexpr size_t kOutputBufferSize = size_t{1} << 20;
+
+/// Open `path` read-only, memory-mapping it when the OS allows (LLVM falls
+/// back to reading for small files and pipes), or throw on failure. The
+/// returned buffer is the single copy of the source: the lexer, CodeGen's
+/// annotations, and the source echo all work on views into it.
+std::unique_ptr<llvm::MemoryBuffer> openInput(const std::string& path);
+
+/// Print the annotated module: the source echoed as comments followed by the
+/// IR with per-instruction source comments.
+void printWithAnnotations(llvm::raw_ostream& os, llvm::Module& module,
+                          std::string_view source, const std::string& filename);
+
+/// Lex, parse, and lower `source` to the output selected by `opts`. Uses a
+/// fresh CodeGen (and therefore a fresh LLVMContext), so it is safe to call
+/// concurrently from multiple threads.
+CompileResult compileSource(std::string_view source, const std::string& filename,
+                            const CompileOptions& opts = {});
+
+/// Compile the file `input` and write the result to `output` ("-" or empty
+/// for stdout) through one kOutputBufferSize-buffered stream, without
+/// materializing the output in memory. The output is only opened once
+/// compilation succeeds. Throws std::runtime_error on failure. Returns the
+/// timings and statistics requested through `opts`.
+CompileReport compileFile(const std::string& input, const std::string& output,
+                          const CompileOptions& opts = {});
+
+/// How runSource() executes a program.
+enum class RunMode {
+  /// Bytecode VM (Interpreter.h); no LLVM code generation.
+  Interp,
+  /// LLVM IR compiled in-process with ORC (JIT.h).
+  JIT,
+};
+
+/// Compile `source` and run its `main`, returning main's result. The VM
+/// writes printed lines to `out`; JIT-compiled code calls the C library's
+/// puts, so its output goes to stdout instead. Fills `report` (if given) with
+/// what `opts` requested; `opts.emit` is ignored. Throws std::runtime_error on
+/// compile or run-time errors.
+int32_t runSource(std::string_view source, const std::string& filename, RunMode mode,
+                  llvm::raw_ostream& out, const CompileOptions& opts = {},
+                  CompileReport* report = nullptr);
+
+} // namespace fakelang
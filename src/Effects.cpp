@@ -0,0 +1,150 @@
+#include "Effects.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace fakelang {
+
+EffectAnalysis::EffectAnalysis(const Program& program, const ProgramInfo& info, const LiveSet* live)
+    : program_(program), info_(info), live_(live) {
+  const auto& classes = program.classes;
+  methodBase_.resize(classes.size());
+  subclasses_.resize(classes.size());
+  uint32_t next = 0;
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    methodBase_[id] = next;
+    next += static_cast<uint32_t>(classes[id].methods.size());
+    if (classes[id].baseId != kInvalidIndex) subclasses_[classes[id].baseId].push_back(id);
+  }
+  functionBase_ = next;
+  nodes_.resize(next + program.functions.size());
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    for (uint32_t m = 0; m < classes[id].methods.size(); ++m) {
+      nodes_[methodBase_[id] + m].body = &classes[id].methods[m].body;
+      // Defined in another module, where it may do anything
+      if (classes[id].imported) nodes_[methodBase_[id] + m].local = Effects{MemoryEffect::Any, false};
+    }
+  }
+  for (size_t f = 0; f < program.functions.size(); ++f) nodes_[functionBase_ + f].body = &program.functions[f].body;
+
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    for (uint32_t m = 0; m < classes[id].methods.size(); ++m) {
+      if (!live || live->live(MethodRef{id, m})) solve(methodBase_[id] + m);
+    }
+  }
+  for (size_t f = 0; f < program.functions.size(); ++f) {
+    if (!live || live->functions[f]) solve(functionBase_ + static_cast<uint32_t>(f));
+  }
+  tarjanStack_ = {};
+}
+
+const Effects& EffectAnalysis::virtualCall(ClassId cls, uint32_t slot) const {
+  const auto it = virtualNodes_.find(uint64_t{cls} << 32 | slot);
+  assert(it != virtualNodes_.end() && "virtual call was not analyzed");
+  return nodes_[it->second].effects;
+}
+
+uint32_t EffectAnalysis::virtualNode(ClassId cls, uint32_t slot) {
+  const auto [it, inserted] = virtualNodes_.try_emplace(uint64_t{cls} << 32 | slot, 0);
+  if (inserted) {
+    it->second = static_cast<uint32_t>(nodes_.size());
+    Node& n = nodes_.emplace_back();
+    n.cls = cls;
+    n.slot = slot;
+  }
+  return it->second;
+}
+
+void EffectAnalysis::expand(uint32_t node) {
+  if (const auto* body = nodes_[node].body) {
+    const ReturnStmt* r = forEachStmtBeforeReturn(*body, [&](const Stmt& s) {
+      if (auto* p = dynamic_cast<const PrintStmt*>(&s)) {
+        scanExpr(p->value.get(), node);
+        nodes_[node].local.join(Effects{MemoryEffect::Any, false});
+      } else if (auto* vd = dynamic_cast<const VarDeclStmt*>(&s)) {
+        scanExpr(vd->init.get(), node);
+      }
+    });
+    if (r) scanExpr(r->value.get(), node);
+    return;
+  }
+  // The targets of a virtual call: the implementation in the receiver's
+  // class, if objects of it exist, and the targets in each subclass
+  const ClassId cls = nodes_[node].cls;
+  const uint32_t slot = nodes_[node].slot;
+  if (!live_ || live_->instantiated[cls]) {
+    nodes_[node].callees.push_back(methodNode(info_.layouts.impl(cls)[slot]));
+  }
+  for (ClassId sub : subclasses_[cls]) {
+    const uint32_t target = virtualNode(sub, slot);
+    nodes_[node].callees.push_back(target);
+  }
+}
+
+void EffectAnalysis::scanExpr(const Expr* e, uint32_t node) {
+  auto* me = dynamic_cast<const MethodCallExpr*>(e);
+  if (!me || me->folded) return;
+  if (me->exactClassId != kInvalidIndex) {
+    nodes_[node].callees.push_back(methodNode(info_.layouts.impl(me->exactClassId)[me->vtableSlot]));
+    return;
+  }
+  // The caller loads the vptr and the slot
+  const uint32_t target = virtualNode(me->classId, me->vtableSlot);
+  nodes_[node].local.join(Effects{MemoryEffect::Read, true});
+  nodes_[node].callees.push_back(target);
+}
+
+void EffectAnalysis::solve(uint32_t root) {
+  if (nodes_[root].index != kUnvisited) return;
+  struct Frame {
+    uint32_t node;
+    size_t nextCallee;
+  };
+  std::vector<Frame> frames;
+  auto open = [&](uint32_t n) {
+    nodes_[n].index = nodes_[n].low = nextIndex_++;
+    nodes_[n].onStack = true;
+    tarjanStack_.push_back(n);
+    expand(n);
+    frames.push_back(Frame{n, 0});
+  };
+  open(root);
+  while (!frames.empty()) {
+    const uint32_t n = frames.back().node;
+    if (frames.back().nextCallee < nodes_[n].callees.size()) {
+      const uint32_t callee = nodes_[n].callees[frames.back().nextCallee++];
+      if (nodes_[callee].index == kUnvisited) open(callee);
+      else if (nodes_[callee].onStack) nodes_[n].low = std::min(nodes_[n].low, nodes_[callee].index);
+      continue;
+    }
+    frames.pop_back();
+    if (!frames.empty()) {
+      Node& parent = nodes_[frames.back().node];
+      parent.low = std::min(parent.low, nodes_[n].low);
+    }
+    if (nodes_[n].low != nodes_[n].index) continue;
+
+    // `n` roots a component: itself and the nodes above it on the stack.
+    // Callees still on the stack are exactly the component's own members.
+    const size_t begin = static_cast<size_t>(std::find(tarjanStack_.rbegin(), tarjanStack_.rend(), n).base() -
+                                             tarjanStack_.begin()) - 1;
+    Effects effects;
+    bool cyclic = tarjanStack_.size() - begin > 1;
+    for (size_t i = begin; i < tarjanStack_.size(); ++i) {
+      const Node& member = nodes_[tarjanStack_[i]];
+      effects.join(member.local);
+      for (uint32_t callee : member.callees) {
+        if (nodes_[callee].onStack) cyclic = cyclic || callee == tarjanStack_[i];
+        else effects.join(nodes_[callee].effects);
+      }
+    }
+    if (cyclic) effects.willReturn = false;
+    for (size_t i = begin; i < tarjanStack_.size(); ++i) {
+      nodes_[tarjanStack_[i]].onStack = false;
+      nodes_[tarjanStack_[i]].effects = effects;
+    }
+    tarjanStack_.resize(begin);
+  }
+}
+
+} // namespace fakelang
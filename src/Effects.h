@@ -0,0 +1,107 @@
+// Fakelang effect analysis: what calling each method, function or virtual
+// call site can do, for CodeGen's function and call-site attributes.
+//
+// Fakelang has no exceptions, so nothing unwinds. The only side effect is
+// print (a puts call, which writes stdout's buffer and may block), and the
+// only memory a body reads is the vptr and vtable slot loaded by a virtual
+// call; `new` writes the caller's own stack. A body's effects are therefore
+// its own plus those of everything it may call. Calls are found over the AST,
+// as CodeGen will lower them: folded calls are gone, exactly-typed calls go to
+// one method, and a virtual call through static class C may reach the
+// implementation in C and in every subclass (only instantiated ones, given a
+// LiveSet). Effects are joined over the strongly connected components of that
+// call graph; a component with a cycle may recurse forever, so its members are
+// not known to return. Methods of imported classes have no body here and may
+// do anything.
+#pragma once
+
+#include "AST.h"
+#include "Reachability.h"
+#include "Sema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace fakelang {
+
+/// What a call may do to memory visible to its caller, weakest first.
+enum class MemoryEffect : uint8_t {
+  None,
+  /// Reads only (vptrs and vtables).
+  Read,
+  /// May read and write (prints).
+  Any,
+};
+
+/// Everything a call may do. Calls never unwind.
+struct Effects {
+  MemoryEffect memory{MemoryEffect::None};
+  /// The call returns: it prints nothing and cannot recurse.
+  bool willReturn{true};
+
+  void join(const Effects& other) {
+    if (other.memory > memory) memory = other.memory;
+    willReturn = willReturn && other.willReturn;
+  }
+};
+
+/// Computes Effects for every method, free function and virtual call target
+/// of a Sema-checked (and possibly partially evaluated) Program.
+class EffectAnalysis {
+public:
+  /// Analyze `program`; with `live`, only its live functions and instantiated
+  /// classes are considered. `program`, `info` and `live` are only used by
+  /// the constructor.
+  EffectAnalysis(const Program& program, const ProgramInfo& info, const LiveSet* live = nullptr);
+
+  const Effects& method(const MethodRef& ref) const { return nodes_[methodNode(ref)].effects; }
+  const Effects& function(size_t index) const { return nodes_[functionBase_ + index].effects; }
+  /// Effects of a virtual call through static class `cls` and slot `slot`
+  /// that the program contains.
+  const Effects& virtualCall(ClassId cls, uint32_t slot) const;
+
+private:
+  /// A method or function body, or the set of targets of a virtual call.
+  struct Node {
+    const std::vector<std::unique_ptr<Stmt>>* body{nullptr};
+    ClassId cls{kInvalidIndex};
+    uint32_t slot{kInvalidIndex};
+    /// Effects of the node itself, excluding its callees.
+    Effects local;
+    std::vector<uint32_t> callees;
+    /// Tarjan state
+    uint32_t index{kUnvisited};
+    uint32_t low{0};
+    bool onStack{false};
+    /// Final effects, including callees.
+    Effects effects;
+  };
+  static constexpr uint32_t kUnvisited = UINT32_MAX;
+
+  uint32_t methodNode(const MethodRef& ref) const { return methodBase_[ref.cls] + ref.method; }
+  uint32_t virtualNode(ClassId cls, uint32_t slot);
+  /// Fill in the local effects and callees of a node on first visit.
+  void expand(uint32_t node);
+  void scanExpr(const Expr* e, uint32_t node);
+  /// Tarjan's algorithm from `root`, without recursion: hierarchies and call
+  /// chains can be far deeper than the stack.
+  void solve(uint32_t root);
+
+  const Program& program_;
+  const ProgramInfo& info_;
+  const LiveSet* live_;
+  std::vector<Node> nodes_;
+  /// Per class: index of the node of its first method.
+  std::vector<uint32_t> methodBase_;
+  uint32_t functionBase_{0};
+  /// (class << 32 | slot) -> node of that virtual call target set.
+  std::unordered_map<uint64_t, uint32_t> virtualNodes_;
+  /// Direct subclasses of each class.
+  std::vector<std::vector<ClassId>> subclasses_;
+  std::vector<uint32_t> tarjanStack_;
+  uint32_t nextIndex_{0};
+};
+
+} // namespace fakelang
@@ -0,0 +1,197 @@
+#include "HotSwap.h"
+
+#include "CodeGen.h"
+#include "JIT.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PartialEval.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace fakelang {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Byte offsets of the start of each line of a source, for slicing ranges.
+class LineTable {
+public:
+  explicit LineTable(std::string_view source) : source_(source) {
+    starts_.push_back(0);
+    for (size_t i = 0; i < source.size(); ++i) {
+      if (source[i] == '\n') starts_.push_back(i + 1);
+    }
+  }
+
+  std::string_view text(const SourceRange& r) const {
+    const size_t begin = offset(r.start), end = offset(r.end);
+    return source_.substr(begin, end > begin ? end - begin : 0);
+  }
+
+private:
+  size_t offset(SourcePos p) const {
+    const size_t line = std::min(starts_.size(), static_cast<size_t>(std::max(p.line, 1))) - 1;
+    return std::min(source_.size(), starts_[line] + static_cast<size_t>(std::max(p.column, 1) - 1));
+  }
+
+  std::string_view source_;
+  std::vector<size_t> starts_;
+};
+
+[[noreturn]] void needsRestart(const std::string& what) {
+  throw std::runtime_error("Reloading cannot change " + what + "; restart the program to pick it up");
+}
+
+/// Throw unless `after` declares the same classes, methods and functions as
+/// `before`, in the same order: then Sema lays them out the same way.
+void checkSameDeclarations(const Program& before, const Program& after) {
+  if (before.classes.size() != after.classes.size()) needsRestart("the number of classes");
+  for (size_t id = 0; id < before.classes.size(); ++id) {
+    const ClassDecl& b = before.classes[id];
+    const ClassDecl& a = after.classes[id];
+    if (b.name != a.name || b.baseName != a.baseName || b.methods.size() != a.methods.size()) {
+      needsRestart("the declaration of class '" + b.name + "'");
+    }
+    for (size_t i = 0; i < b.methods.size(); ++i) {
+      const MethodDecl& bm = b.methods[i];
+      const MethodDecl& am = a.methods[i];
+      if (bm.attr != am.attr || bm.name != am.name || bm.returnType.name != am.returnType.name) {
+        needsRestart("the declaration of method '" + b.name + "." + bm.name + "'");
+      }
+    }
+  }
+  if (before.functions.size() != after.functions.size()) needsRestart("the number of functions");
+  for (size_t i = 0; i < before.functions.size(); ++i) {
+    const FunctionDecl& b = before.functions[i];
+    const FunctionDecl& a = after.functions[i];
+    if (b.name != a.name || b.returnType.name != a.returnType.name) {
+      needsRestart("the declaration of function '" + b.name + "'");
+    }
+  }
+}
+
+} // namespace
+
+HotSwapSession::HotSwapSession(std::string source, std::string filename, bool fold)
+    : filename_(std::move(filename)), fold_(fold), source_(std::move(source)) {
+  ProgramInfo info;
+  analyze(source_, program_, info);
+  CodeGen cg;
+  cg.setSource(source_, filename_);
+  cg.setHotSwap(true);
+  cg.generate(program_, info, filename_);
+  auto [context, module] = cg.takeModule();
+  jit_ = createHostJIT();
+  addModule(*jit_, std::move(context), std::move(module));
+  main_.store(reinterpret_cast<int32_t (*)()>(lookupAddress(*jit_, "main")), std::memory_order_release);
+  vtables_.assign(program_.classes.size(), nullptr);
+  stubs_.resize(program_.classes.size());
+  for (ClassId id = 0; id < program_.classes.size(); ++id) {
+    stubs_[id].assign(program_.classes[id].methods.size(), nullptr);
+  }
+}
+
+void HotSwapSession::analyze(const std::string& source, Program& program, ProgramInfo& info) const {
+  program = Parser(Lexer(source, filename_).lexAll()).parseProgram();
+  info = Sema(filename_).analyze(program);
+  if (!fold_) return;
+  PartialEvaluator evaluator(info);
+  evaluator.setLocalOnly(true);
+  evaluator.run(program);
+}
+
+void** HotSwapSession::vtable(ClassId id) {
+  if (!vtables_[id]) {
+    vtables_[id] = static_cast<void**>(lookupAddress(*jit_, "vtable." + program_.classes[id].name));
+  }
+  return vtables_[id];
+}
+
+void** HotSwapSession::stub(const MethodRef& ref) {
+  void**& stub = stubs_[ref.cls][ref.method];
+  if (!stub) {
+    const ClassDecl& c = program_.classes[ref.cls];
+    stub = static_cast<void**>(lookupAddress(*jit_, "stub." + c.name + "." + c.methods[ref.method].name));
+  }
+  return stub;
+}
+
+ReloadReport HotSwapSession::reload(std::string source) {
+  ReloadReport report;
+  const Clock::time_point start = Clock::now();
+  Program program;
+  ProgramInfo info;
+  analyze(source, program, info);
+  checkSameDeclarations(program_, program);
+
+  // Whatever changed is within the text of a class or function
+  HotSwapPatch patch;
+  const LineTable before(source_), after(source);
+  for (ClassId id = 0; id < program.classes.size(); ++id) {
+    if (before.text(program_.classes[id].loc) == after.text(program.classes[id].loc)) continue;
+    patch.classes.push_back(id);
+    report.classes.push_back(program.classes[id].name);
+  }
+  for (size_t i = 0; i < program.functions.size(); ++i) {
+    if (before.text(program_.functions[i].loc) == after.text(program.functions[i].loc)) continue;
+    patch.functions.push_back(i);
+    report.functions.push_back(program.functions[i].name);
+  }
+  const Clock::time_point analyzed = Clock::now();
+  report.analyze = analyzed - start;
+
+  // Each address to store, and where: the stores are all that runs while
+  // old and new code are mixed
+  std::vector<std::pair<void**, void*>> stores;
+  int32_t (*newMain)() = nullptr;
+  if (!patch.classes.empty() || !patch.functions.empty()) {
+    patch.suffix = "." + std::to_string(++generation_);
+    CodeGen cg;
+    cg.setSource(source, filename_);
+    cg.setHotSwap(true, &patch);
+    cg.generate(program, info, filename_ + patch.suffix);
+    auto [context, module] = cg.takeModule();
+    addModule(*jit_, std::move(context), std::move(module));
+    // New versions of the methods of each changed class, indexed by ClassId
+    std::vector<std::vector<void*>> methods(program.classes.size());
+    for (ClassId id : patch.classes) {
+      const ClassDecl& c = program.classes[id];
+      for (uint32_t i = 0; i < c.methods.size(); ++i) {
+        methods[id].push_back(lookupAddress(*jit_, c.name + "." + c.methods[i].name + patch.suffix));
+      }
+    }
+    // Vtables follow the Sema layout, slot for slot
+    for (ClassId id = 0; id < program.classes.size(); ++id) {
+      const auto table = info.layouts.impl(id);
+      for (uint32_t slot = 0; slot < table.size(); ++slot) {
+        if (methods[table[slot].cls].empty()) continue;
+        stores.emplace_back(vtable(id) + slot, methods[table[slot].cls][table[slot].method]);
+      }
+    }
+    report.slotsPatched = stores.size();
+    for (ClassId id : patch.classes) {
+      for (uint32_t i = 0; i < methods[id].size(); ++i) stores.emplace_back(stub(MethodRef{id, i}), methods[id][i]);
+    }
+    report.stubsPatched = stores.size() - report.slotsPatched;
+    for (size_t i : patch.functions) {
+      if (program.functions[i].name != "main") continue;
+      newMain = reinterpret_cast<int32_t (*)()>(lookupAddress(*jit_, "main" + patch.suffix));
+    }
+  }
+  const Clock::time_point compiled = Clock::now();
+  report.compile = compiled - analyzed;
+
+  for (const auto& [slot, address] : stores) std::atomic_ref<void*>(*slot).store(address, std::memory_order_release);
+  if (newMain) main_.store(newMain, std::memory_order_release);
+  report.patch = Clock::now() - compiled;
+
+  // The old AST and source are only needed to tell what the next reload changes
+  source_ = std::move(source);
+  program_ = std::move(program);
+  return report;
+}
+
+} // namespace fakelang
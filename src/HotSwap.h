@@ -0,0 +1,107 @@
+// Fakelang hot swapping: a program running in an ORC JIT whose method bodies
+// can be edited without restarting it (`fakelangc --jit --watch`).
+//
+// The program is lowered with CodeGen::setHotSwap: each vtable is a mutable
+// global of its own, and exactly-typed calls load their target from a stub
+// pointer per method. A reload checks the whole new source, but lowers again
+// only the classes whose text changed (and free functions likewise), into a
+// small module of their methods under fresh names. Once the JIT has compiled
+// that module, the new addresses are stored into every vtable slot that held
+// an old version and into the methods' stubs, one atomic store each. A call
+// made after its slot was stored runs the new code; calls already running
+// finish in the old code, which is never freed. Calls are not folded across
+// bodies (PartialEvaluator::setLocalOnly), as a folded result would outlive
+// an edit of its callee, but calls on receivers created in the same body are
+// still direct; without `fold`, every call goes through a vtable.
+//
+// A reload may change bodies only. Adding, removing or redeclaring a class,
+// method or function changes vtable layouts that compiled code relies on, and
+// needs a restart.
+#pragma once
+
+#include "AST.h"
+#include "Sema.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+/// What one HotSwapSession::reload() changed, and how long each step took.
+struct ReloadReport {
+  /// Classes whose methods were recompiled, and free functions.
+  std::vector<std::string> classes;
+  std::vector<std::string> functions;
+  /// Vtable slots and stubs that now point at a new method.
+  size_t slotsPatched{0};
+  size_t stubsPatched{0};
+  /// Lexing, parsing and checking the new source, and comparing it with the
+  /// old.
+  std::chrono::nanoseconds analyze{};
+  /// Lowering the changed classes and functions, and JIT-compiling them.
+  std::chrono::nanoseconds compile{};
+  /// Storing the new addresses: the patch latency, during which calls may
+  /// still reach old versions of some of the changed methods.
+  std::chrono::nanoseconds patch{};
+};
+
+/// A program loaded into its own JIT, whose classes can be replaced.
+class HotSwapSession {
+public:
+  /// Compile `source` and load it; `fold` as in CompileOptions, within each
+  /// body. Throws std::runtime_error on errors.
+  explicit HotSwapSession(std::string source, std::string filename = "<input>", bool fold = true);
+
+  HotSwapSession(const HotSwapSession&) = delete;
+  HotSwapSession& operator=(const HotSwapSession&) = delete;
+
+  /// Run the current `main` and return its result. Safe to call from other
+  /// threads, including while a reload runs.
+  int32_t runMain() const { return main_.load(std::memory_order_acquire)(); }
+
+  /// Replace the program with `source`, recompiling the classes and
+  /// functions whose text changed. Throws std::runtime_error, and keeps
+  /// running the current version, if `source` does not compile or declares
+  /// anything differently. One reload at a time.
+  ReloadReport reload(std::string source);
+
+  /// The source the program was last loaded from.
+  const std::string& source() const { return source_; }
+
+private:
+  /// Lex, parse, check and locally evaluate `source`; throws on error.
+  void analyze(const std::string& source, Program& program, ProgramInfo& info) const;
+  /// Address of the vtable of class `id`, or of the stub of `ref`, in the
+  /// running program.
+  void** vtable(ClassId id);
+  void** stub(const MethodRef& ref);
+
+  std::string filename_;
+  bool fold_;
+  std::string source_;
+  Program program_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+  /// Looked up on first use; indexed by ClassId, then method.
+  std::vector<void**> vtables_;
+  std::vector<std::vector<void**>> stubs_;
+  std::atomic<int32_t (*)()> main_{nullptr};
+  /// Reloads that compiled something; names the methods of each.
+  unsigned generation_{0};
+};
+
+} // namespace fakelang
@@ -15,8 +15,14 @@ void FakelangAnnotationWriter::emitFunctionAnnot(const llvm::Function* F,
   OS << ";\n; === Function: " << F->getName() << " ===\n";
 }
 
-void FakelangAnnotationWriter::emitInstructionAnnot(const llvm::Instruction* I,
-                                                    llvm::formatted_raw_ostream& OS) {
+void FakelangAnnotationWriter::printInfoComment(const llvm::Value& V,
+                                                llvm::formatted_raw_ostream& OS) {
+  auto const* I = llvm::dyn_cast<llvm::Instruction>(&V);
+  if (!I) return;
+  if (auto it = detached_.find(I); it != detached_.end()) {
+    OS << " ; src: " << it->second;
+    return;
+  }
   if (auto const* md = I->getMetadata("fakelang.src")) {
     if (md->getNumOperands() > 0) {
       if (auto const* s = llvm::dyn_cast<llvm::MDString>(md->getOperand(0))) {
@@ -26,4 +32,23 @@ void FakelangAnnotationWriter::emitInstructionAnnot(const llvm::Instruction* I,
   }
 }
 
+void FakelangAnnotationWriter::detachSourceMapping(llvm::Module& M) {
+  detached_.clear();
+  const unsigned kind = M.getContext().getMDKindID("fakelang.src");
+  for (auto& fn : M) {
+    for (auto& bb : fn) {
+      for (auto& inst : bb) {
+        auto const* md = inst.getMetadata(kind);
+        if (!md) continue;
+        if (md->getNumOperands() > 0) {
+          if (auto const* s = llvm::dyn_cast<llvm::MDString>(md->getOperand(0))) {
+            detached_[&inst] = s->getString();
+          }
+        }
+        inst.setMetadata(kind, nullptr);
+      }
+    }
+  }
+}
+
 } // namespace fakelang
@@ -6,14 +6,18 @@
 #  pragma clang diagnostic push
 #  pragma clang diagnostic ignored "-Wdeprecated-declarations"
 #endif
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
 #include <llvm/IR/AssemblyAnnotationWriter.h>
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
 #if defined(__clang__)
 #  pragma clang diagnostic pop
 #endif
 
+
 namespace fakelang {
 
 class FakelangAnnotationWriter final : public llvm::AssemblyAnnotationWriter {
@@ -21,8 +25,19 @@ public:
   void emitFunctionAnnot(const llvm::Function* F,
                          llvm::formatted_raw_ostream& OS) override;
 
-  void emitInstructionAnnot(const llvm::Instruction* I,
-                            llvm::formatted_raw_ostream& OS) override;
+  /// Appends the `fakelang.src` mapping as a trailing comment. (The
+  /// emitInstructionAnnot hook prints before the instruction on the same
+  /// line, which would comment the instruction out.)
+  void printInfoComment(const llvm::Value& V, llvm::formatted_raw_ostream& OS) override;
+
+  /// Move the `fakelang.src` mappings of `M` into this writer, replacing any
+  /// detached earlier; they still print as comments. Lets pieces of the
+  /// printed module be copied out without the metadata nodes they refer to.
+  void detachSourceMapping(llvm::Module& M);
+
+private:
+  // Strings owned by the module's context, which outlives their use
+  llvm::DenseMap<const llvm::Instruction*, llvm::StringRef> detached_;
 };
 
 } // namespace fakelang
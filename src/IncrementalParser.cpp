@@ -0,0 +1,354 @@
+#include "IncrementalParser.h"
+
+#include "Lexer.h"
+#include "Parser.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+namespace fakelang {
+
+namespace {
+
+void shiftLines(SourceRange& r, int lines) {
+  r.start.line += lines;
+  r.end.line += lines;
+}
+
+void shiftLines(Expr* e, int lines) {
+  if (!e) return;
+  shiftLines(e->loc, lines);
+  if (auto* call = dynamic_cast<MethodCallExpr*>(e)) shiftLines(call->receiver.get(), lines);
+}
+
+void shiftLines(std::vector<std::unique_ptr<Stmt>>& body, int lines) {
+  for (auto& s : body) {
+    shiftLines(s->loc, lines);
+    if (auto* r = dynamic_cast<ReturnStmt*>(s.get())) shiftLines(r->value.get(), lines);
+    else if (auto* p = dynamic_cast<PrintStmt*>(s.get())) shiftLines(p->value.get(), lines);
+    else if (auto* v = dynamic_cast<VarDeclStmt*>(s.get())) shiftLines(v->init.get(), lines);
+  }
+}
+
+bool operator<(SourcePos a, SourcePos b) { return a.line != b.line ? a.line < b.line : a.column < b.column; }
+bool operator==(SourcePos a, SourcePos b) { return a.line == b.line && a.column == b.column; }
+
+/// Replace v[at, at + count) with `added`, moving the tail only if the
+/// number of elements changes.
+template <typename T>
+void replaceRange(std::vector<T>& v, size_t at, size_t count, std::vector<T>& added) {
+  if (count == added.size()) {
+    std::move(added.begin(), added.end(), v.begin() + static_cast<ptrdiff_t>(at));
+    return;
+  }
+  const auto pos = v.erase(v.begin() + static_cast<ptrdiff_t>(at), v.begin() + static_cast<ptrdiff_t>(at + count));
+  v.insert(pos, std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+}
+
+} // namespace
+
+IncrementalParser::IncrementalParser(std::string text) : text_(std::move(text)) {
+  lineStarts_.push_back(0);
+  for (size_t i = 0; i < text_.size(); ++i) {
+    if (text_[i] == '\n') lineStarts_.push_back(i + 1);
+  }
+  reparse(0, 0, 0, text_.size());
+  change_ = {};
+}
+
+SourcePos IncrementalParser::Change::map(SourcePos p) const {
+  if (p < oldEnd) return p;
+  if (p.line == oldEnd.line) return SourcePos{newEnd.line, p.column - oldEnd.column + newEnd.column};
+  return SourcePos{p.line + newEnd.line - oldEnd.line, p.column};
+}
+
+void IncrementalParser::edit(size_t begin, size_t end, std::string_view replacement) {
+  end = std::min(end, text_.size());
+  begin = std::min(begin, end);
+
+  // Touched: every declaration from the first that ends at or after `begin`
+  // to the last that starts at or before `end`, and any that start on the
+  // line the edit ends on, whose columns move. A parse error runs up to the
+  // next declaration, so one right before the edit may now run further.
+  size_t first = static_cast<size_t>(
+      std::partition_point(decls_.begin(), decls_.end(), [&](const Decl& d) { return d.end < begin; }) -
+      decls_.begin());
+  while (first > 0 && decls_[first - 1].kind == DeclKind::Error) --first;
+  size_t last = static_cast<size_t>(
+      std::partition_point(decls_.begin() + static_cast<ptrdiff_t>(first), decls_.end(),
+                           [&](const Decl& d) { return d.begin <= end; }) -
+      decls_.begin());
+  const int beginLine = lineOf(begin), endLine = lineOf(end);
+  change_ = {};
+  change_.begin = positionOf(begin);
+  change_.oldEnd = positionOf(end);
+  while (last < decls_.size() && lineOf(decls_[last].begin) == endLine) ++last;
+  const size_t rangeBegin = first > 0 ? decls_[first - 1].end : 0;
+  const size_t rangeEnd = last < decls_.size() ? decls_[last].begin : text_.size();
+
+  // Update the text, the line table and the offsets of later declarations
+  std::vector<size_t> newLines;
+  for (size_t i = 0; i < replacement.size(); ++i) {
+    if (replacement[i] == '\n') newLines.push_back(begin + i + 1);
+  }
+  const int lineDelta = static_cast<int>(newLines.size()) - (endLine - beginLine);
+  const size_t numNew = newLines.size();
+  replaceRange(lineStarts_, static_cast<size_t>(beginLine), static_cast<size_t>(endLine - beginLine), newLines);
+  text_.replace(begin, end - begin, replacement);
+  const size_t removed = end - begin;
+  auto move = [&](size_t& offset) { offset = offset - removed + replacement.size(); };
+  for (size_t i = static_cast<size_t>(beginLine) + numNew; i < lineStarts_.size(); ++i) move(lineStarts_[i]);
+  for (size_t i = last; i < decls_.size(); ++i) {
+    move(decls_[i].begin);
+    move(decls_[i].end);
+  }
+
+  change_.newEnd = positionOf(begin + replacement.size());
+  work_ = {};
+  size_t rangeEndNow = rangeEnd;
+  move(rangeEndNow);
+  const size_t after = reparse(first, last, rangeBegin, rangeEndNow);
+  if (lineDelta == 0) return;
+  for (size_t i = after; i < decls_.size(); ++i) {
+    Decl& d = decls_[i];
+    switch (d.kind) {
+      case DeclKind::Class: {
+        ClassDecl& c = program_.classes[d.index];
+        shiftLines(c.loc, lineDelta);
+        for (MethodDecl& m : c.methods) {
+          shiftLines(m.loc, lineDelta);
+          shiftLines(m.body, lineDelta);
+        }
+        break;
+      }
+      case DeclKind::Function: {
+        FunctionDecl& f = program_.functions[d.index];
+        shiftLines(f.loc, lineDelta);
+        shiftLines(f.body, lineDelta);
+        break;
+      }
+      case DeclKind::Error: shiftLines(d.error.loc, lineDelta); break;
+    }
+  }
+}
+
+size_t IncrementalParser::reparse(size_t first, size_t last, size_t begin, size_t end) {
+  // Grow by twice as many declarations each time, so that an edit which
+  // changes the meaning of the rest of the file relexes it only a few times
+  size_t grow = 1;
+  while (true) {
+    std::vector<Decl> decls;
+    Program parsed;
+    if (parseRange(begin, end, last == decls_.size(), decls, parsed)) {
+      const size_t count = decls.size();
+      splice(first, last, std::move(decls), std::move(parsed));
+      return first + count;
+    }
+    last += std::min(grow, decls_.size() - last);
+    grow *= 2;
+    end = last < decls_.size() ? decls_[last].begin : text_.size();
+  }
+}
+
+bool IncrementalParser::parseRange(size_t begin, size_t end, bool final, std::vector<Decl>& decls,
+                                   Program& parsed) {
+  work_.bytesLexed += end - begin;
+  // Lex around errors: skip a bad character, and end at an unterminated
+  // string. Either way the result does not depend on where the range starts.
+  struct LexError {
+    /// Bytes [begin, end) of text_: the character or the rest of the range.
+    size_t begin;
+    size_t end;
+    ParseError error;
+  };
+  std::vector<LexError> lexErrors;
+  std::vector<Token> tokens;
+  for (size_t from = begin;;) {
+    const std::string_view rest = std::string_view(text_).substr(from, end - from);
+    Lexer lexer(rest, "<input>", positionOf(from));
+    try {
+      std::vector<Token> more = lexer.lexAll();
+      tokens.insert(tokens.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+      break;
+    } catch (const std::exception& ex) {
+      // An unterminated string may end in the text that follows
+      if (lexer.atEnd() && !final) return false;
+      const size_t at = offsetOf(lexer.tokenStart());
+      const size_t errorEnd = lexer.atEnd() ? end : at + 1;
+      lexErrors.push_back(LexError{at, errorEnd, ParseError{{lexer.tokenStart(), positionOf(at + 1)}, ex.what()}});
+      std::vector<Token> before = Lexer(rest.substr(0, at - from), "<input>", positionOf(from)).lexAll();
+      tokens.insert(tokens.end(), std::make_move_iterator(before.begin()), std::make_move_iterator(before.end() - 1));
+      from = errorEnd;
+    }
+  }
+
+  // A declaration with a lex error in it is an error; one between
+  // declarations is an error of its own
+  size_t nextLexError = 0;
+  auto addLexErrors = [&](size_t before) {
+    for (; nextLexError < lexErrors.size() && lexErrors[nextLexError].begin < before; ++nextLexError) {
+      const LexError& e = lexErrors[nextLexError];
+      decls.push_back(Decl{e.begin, e.end, DeclKind::Error, 0, e.error});
+    }
+  };
+  auto addDecl = [&](Decl d) {
+    addLexErrors(d.begin);
+    if (nextLexError < lexErrors.size() && lexErrors[nextLexError].begin < d.end) {
+      if (d.kind == DeclKind::Class) parsed.classes.pop_back();
+      else if (d.kind == DeclKind::Function) parsed.functions.pop_back();
+      d.kind = DeclKind::Error;
+      d.index = 0;
+      d.error = lexErrors[nextLexError].error;
+      while (nextLexError < lexErrors.size() && lexErrors[nextLexError].begin < d.end) ++nextLexError;
+    }
+    decls.push_back(std::move(d));
+  };
+
+  Parser parser(std::move(tokens));
+  while (!parser.atEnd()) {
+    const size_t start = parser.position();
+    const size_t startOffset = offsetOf(parser.current().range.start);
+    const size_t numClasses = parsed.classes.size();
+    try {
+      parser.parseDecl(parsed);
+    } catch (const std::exception& ex) {
+      if (parser.current().kind == TokenKind::Eof && !final) return false;
+      ParseError error{parser.current().range, ex.what()};
+      parser.recover(start);
+      // Recovery may skip over what follows the range as well
+      if (parser.atEnd() && !final) return false;
+      const size_t errorEnd = parser.atEnd() ? end : offsetOf(parser.current().range.start);
+      addDecl(Decl{startOffset, errorEnd, DeclKind::Error, 0, std::move(error)});
+      continue;
+    }
+    ++work_.declsParsed;
+    if (parsed.classes.size() > numClasses) {
+      addDecl(Decl{startOffset, offsetOf(parsed.classes.back().loc.end), DeclKind::Class,
+                   static_cast<uint32_t>(numClasses), {}});
+    } else {
+      addDecl(Decl{startOffset, offsetOf(parsed.functions.back().loc.end), DeclKind::Function,
+                   static_cast<uint32_t>(parsed.functions.size() - 1), {}});
+    }
+  }
+  addLexErrors(end);
+  return true;
+}
+
+void IncrementalParser::splice(size_t first, size_t last, std::vector<Decl> decls, Program parsed) {
+  change_.declarations = !replaceBodies(first, last, decls, parsed);
+  if (!change_.declarations) return;
+  // Where the replaced declarations are in program_: after the nearest
+  // earlier declaration of the same kind
+  auto indexAfter = [&](DeclKind kind) -> uint32_t {
+    for (size_t i = first; i-- > 0;) {
+      if (decls_[i].kind == kind) return decls_[i].index + 1;
+    }
+    return 0;
+  };
+  const uint32_t classAt = indexAfter(DeclKind::Class), functionAt = indexAfter(DeclKind::Function);
+  size_t removedClasses = 0, removedFunctions = 0;
+  for (size_t i = first; i < last; ++i) {
+    removedClasses += decls_[i].kind == DeclKind::Class;
+    removedFunctions += decls_[i].kind == DeclKind::Function;
+  }
+  const auto classDelta = static_cast<ptrdiff_t>(parsed.classes.size()) - static_cast<ptrdiff_t>(removedClasses);
+  const auto functionDelta =
+      static_cast<ptrdiff_t>(parsed.functions.size()) - static_cast<ptrdiff_t>(removedFunctions);
+  replaceRange(program_.classes, classAt, removedClasses, parsed.classes);
+  replaceRange(program_.functions, functionAt, removedFunctions, parsed.functions);
+
+  for (Decl& d : decls) {
+    if (d.kind == DeclKind::Class) d.index += classAt;
+    else if (d.kind == DeclKind::Function) d.index += functionAt;
+  }
+  if (classDelta != 0 || functionDelta != 0) {
+    for (size_t i = last; i < decls_.size(); ++i) {
+      Decl& d = decls_[i];
+      if (d.kind == DeclKind::Class) d.index = static_cast<uint32_t>(d.index + classDelta);
+      else if (d.kind == DeclKind::Function) d.index = static_cast<uint32_t>(d.index + functionDelta);
+    }
+  }
+  replaceRange(decls_, first, last - first, decls);
+}
+
+bool IncrementalParser::replaceBodies(size_t first, size_t last, std::vector<Decl>& decls, Program& parsed) {
+  if (decls.size() != last - first) return false;
+  auto same = [&](const SourceRange& before, const SourceRange& now) {
+    return change_.map(before.start) == now.start && change_.map(before.end) == now.end;
+  };
+  for (size_t k = 0; k < decls.size(); ++k) {
+    const Decl& old = decls_[first + k];
+    if (old.kind != decls[k].kind) return false;
+    if (old.kind == DeclKind::Class) {
+      const ClassDecl& before = program_.classes[old.index];
+      const ClassDecl& now = parsed.classes[decls[k].index];
+      if (before.name != now.name || before.baseName != now.baseName || !same(before.loc, now.loc) ||
+          before.methods.size() != now.methods.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < now.methods.size(); ++i) {
+        const MethodDecl& m = before.methods[i];
+        const MethodDecl& n = now.methods[i];
+        if (m.attr != n.attr || m.name != n.name || m.returnType.name != n.returnType.name || !same(m.loc, n.loc)) {
+          return false;
+        }
+      }
+    } else if (old.kind == DeclKind::Function) {
+      const FunctionDecl& before = program_.functions[old.index];
+      const FunctionDecl& now = parsed.functions[decls[k].index];
+      if (before.name != now.name || before.returnType.name != now.returnType.name || !same(before.loc, now.loc)) {
+        return false;
+      }
+    }
+  }
+
+  for (size_t k = 0; k < decls.size(); ++k) {
+    Decl& old = decls_[first + k];
+    if (old.kind == DeclKind::Class) {
+      ClassDecl& c = program_.classes[old.index];
+      ClassDecl& now = parsed.classes[decls[k].index];
+      c.loc = now.loc;
+      for (size_t i = 0; i < c.methods.size(); ++i) {
+        c.methods[i].loc = now.methods[i].loc;
+        c.methods[i].body = std::move(now.methods[i].body);
+      }
+      change_.classes.push_back(old.index);
+    } else if (old.kind == DeclKind::Function) {
+      FunctionDecl& f = program_.functions[old.index];
+      f.loc = parsed.functions[decls[k].index].loc;
+      f.body = std::move(parsed.functions[decls[k].index].body);
+      change_.functions.push_back(old.index);
+    }
+    old.begin = decls[k].begin;
+    old.end = decls[k].end;
+    old.error = std::move(decls[k].error);
+  }
+  return true;
+}
+
+std::vector<ParseError> IncrementalParser::errors() const {
+  std::vector<ParseError> out;
+  for (const Decl& d : decls_) {
+    if (d.kind == DeclKind::Error) out.push_back(d.error);
+  }
+  return out;
+}
+
+int IncrementalParser::lineOf(size_t offset) const {
+  return static_cast<int>(std::upper_bound(lineStarts_.begin(), lineStarts_.end(), offset) - lineStarts_.begin());
+}
+
+size_t IncrementalParser::offsetOf(SourcePos pos) const {
+  const auto line = static_cast<size_t>(std::clamp<int>(pos.line, 1, static_cast<int>(lineStarts_.size())));
+  return std::min(lineStarts_[line - 1] + static_cast<size_t>(std::max(pos.column, 1) - 1), text_.size());
+}
+
+SourcePos IncrementalParser::positionOf(size_t offset) const {
+  offset = std::min(offset, text_.size());
+  const int line = lineOf(offset);
+  return SourcePos{line, static_cast<int>(offset - lineStarts_[static_cast<size_t>(line) - 1]) + 1};
+}
+
+} // namespace fakelang
@@ -0,0 +1,132 @@
+// Fakelang incremental front end: keeps the AST of a file being edited up to
+// date without relexing and reparsing the whole file on every change.
+//
+// A file is a sequence of top-level declarations (classes and functions)
+// with only whitespace and comments between them, and each declaration parses
+// the same wherever it appears. So an edit only needs to relex and reparse
+// the declarations it touches: from the end of the last untouched one before
+// it to the start of the first untouched one after it. The new declarations
+// replace the old ones in Program::classes and Program::functions, which stay
+// in source order; declarations further down keep their AST and only move
+// if the edit added or removed lines. When the edited text no longer ends
+// where it did (an unclosed brace or string), the range grows into the
+// following declarations until it does, which is what a full reparse would
+// have seen too.
+//
+// When an edit leaves every declaration it touched with the same names,
+// signatures and header positions (typing inside a body), the declarations
+// keep their AST nodes and only their bodies are replaced, so Sema results
+// for the declarations stay valid and only those bodies need rechecking; see
+// lastChange().
+//
+// Unlike Parser::parseProgram(), parsing recovers at the next 'class' or
+// 'function' keyword after an error, so a file can have several parse errors
+// and the declarations between them stay in the Program.
+#pragma once
+
+#include "AST.h"
+#include "Token.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fakelang {
+
+/// A syntax error in an IncrementalParser's text.
+struct ParseError {
+  /// The token or character that could not be parsed.
+  SourceRange loc{};
+  std::string message;
+};
+
+/// The text and AST of one file under edit.
+class IncrementalParser {
+public:
+  /// Parse all of `text`.
+  explicit IncrementalParser(std::string text);
+
+  /// Replace bytes [begin, end) of the text with `replacement` and update the
+  /// AST. Offsets past the end are clamped. Unless lastChange() says only
+  /// bodies changed, invalidates references into program() and any Sema
+  /// annotations.
+  void edit(size_t begin, size_t end, std::string_view replacement);
+
+  const std::string& text() const { return text_; }
+  /// The declarations that parsed, in source order, with their source
+  /// ranges valid for the current text.
+  Program& program() { return program_; }
+  const Program& program() const { return program_; }
+  /// Every parse error, in source order.
+  std::vector<ParseError> errors() const;
+
+  /// Byte offset of `pos` (1-based line and column, clamped to the text).
+  size_t offsetOf(SourcePos pos) const;
+  /// Line and column of byte `offset`.
+  SourcePos positionOf(size_t offset) const;
+
+  /// How much the last parse (construction or edit) redid.
+  struct Work {
+    size_t bytesLexed{0};
+    size_t declsParsed{0};
+  };
+  const Work& lastWork() const { return work_; }
+
+  /// What the last edit changed in program().
+  struct Change {
+    /// False if the edit only changed the bodies of `classes` and
+    /// `functions` (and whitespace and comments): every declaration kept its
+    /// AST node, its Sema annotations and the source range of its header and
+    /// of each method, after map(). True after construction.
+    bool declarations{true};
+    std::vector<ClassId> classes;
+    std::vector<uint32_t> functions;
+    /// The edited text was [begin, oldEnd) and is now [begin, newEnd).
+    SourcePos begin{}, oldEnd{}, newEnd{};
+
+    /// Where a position outside the edited text before the edit is now.
+    SourcePos map(SourcePos p) const;
+  };
+  const Change& lastChange() const { return change_; }
+
+private:
+  enum class DeclKind : uint8_t { Class, Function, Error };
+  /// A top-level declaration, or a stretch of text that failed to parse.
+  struct Decl {
+    /// Bytes [begin, end) of text_.
+    size_t begin{0};
+    size_t end{0};
+    DeclKind kind{DeclKind::Error};
+    /// Index in program_.classes or program_.functions.
+    uint32_t index{0};
+    /// For DeclKind::Error.
+    ParseError error;
+  };
+
+  /// Relex and reparse text_[begin, end), which replaces decls_[first, last),
+  /// growing it into later declarations while it ends mid-declaration.
+  /// Returns the index in decls_ of the first declaration after it.
+  size_t reparse(size_t first, size_t last, size_t begin, size_t end);
+  /// Parse text_[begin, end) into `decls` and `parsed`. Returns false,
+  /// without a result, if the text ends in the middle of a declaration.
+  bool parseRange(size_t begin, size_t end, bool final, std::vector<Decl>& decls, Program& parsed);
+  /// Replace decls_[first, last) and their AST with `decls` and `parsed`.
+  void splice(size_t first, size_t last, std::vector<Decl> decls, Program parsed);
+  /// If `decls` and `parsed` declare what decls_[first, last) did, in the
+  /// same places, move their bodies into the existing AST and return true.
+  bool replaceBodies(size_t first, size_t last, std::vector<Decl>& decls, Program& parsed);
+  /// Line number (1-based) of byte `offset`.
+  int lineOf(size_t offset) const;
+
+  std::string text_;
+  /// Byte offset of the start of each line.
+  std::vector<size_t> lineStarts_;
+  std::vector<Decl> decls_;
+  Program program_;
+  Work work_;
+  Change change_;
+};
+
+} // namespace fakelang
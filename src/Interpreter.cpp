@@ -0,0 +1,152 @@
+#include "Interpreter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace fakelang {
+
+VM::VM(const BytecodeModule& module) : mod_(module) {
+  constants_.reserve(mod_.constants.size());
+  for (const BytecodeConstant& c : mod_.constants) {
+    Value v{};
+    if (c.type.kind == SemaType::Kind::String) v.s = &mod_.strings[c.stringIndex];
+    else v.i = c.intValue;
+    constants_.push_back(v);
+  }
+  caches_.resize(mod_.callSites.size());
+}
+
+/// Slow path of CallVirtual: consult or extend the site's inline cache.
+uint32_t VM::lookupVirtual(uint32_t site, ClassId cls) {
+  InlineCache& ic = caches_[site];
+  for (uint32_t i = 0; i < ic.size; ++i) {
+    if (ic.classes[i] == cls) {
+      ++stats_.inlineCacheHits;
+      return ic.targets[i];
+    }
+  }
+  const uint32_t target = mod_.vtables[cls][mod_.callSites[site].slot];
+  if (ic.size < kInlineCacheEntries) {
+    ic.classes[ic.size] = cls;
+    ic.targets[ic.size] = target;
+    ++ic.size;
+    ++stats_.inlineCacheMisses;
+  } else {
+    ++stats_.megamorphicCalls;
+  }
+  return target;
+}
+
+// Labels as values are a GNU extension
+#if FAKELANG_VM_COMPUTED_GOTO && defined(__GNUC__)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+int32_t VM::run(llvm::raw_ostream& out) {
+  objects_.Reset();
+  frames_.clear();
+  const BytecodeFunction& mainFn = mod_.functions[mod_.mainFunction];
+  if (regs_.size() < mainFn.numRegs) regs_.resize(mainFn.numRegs);
+
+  const uint32_t* const code = mod_.code.data();
+  const Value* const consts = constants_.data();
+  const uint32_t* pc = code + mainFn.entry;
+  size_t base = 0;
+  uint32_t numRegs = mainFn.numRegs;
+  Value* regs = regs_.data();
+
+  // Push a frame for the current function and enter `fn`; `next` is where
+  // the caller resumes.
+  auto enter = [&](uint32_t fn, uint32_t dst, const uint32_t* next) {
+    if (frames_.size() >= kMaxCallDepth) {
+      throw std::runtime_error("Fakelang stack overflow in " + mod_.functions[fn].name);
+    }
+    ++stats_.calls;
+    frames_.push_back(Frame{next, base, numRegs, dst});
+    const BytecodeFunction& f = mod_.functions[fn];
+    base += numRegs;
+    numRegs = f.numRegs;
+    if (regs_.size() < base + numRegs) regs_.resize(std::max(regs_.size() * 2, base + numRegs));
+    regs = regs_.data() + base;
+    pc = code + f.entry;
+  };
+
+#if FAKELANG_VM_COMPUTED_GOTO
+  // Indexed by Op
+  static void* const kLabels[kNumOps] = {&&L_LoadConst, &&L_Move, &&L_New, &&L_CallVirtual,
+                                         &&L_CallDirect, &&L_Print, &&L_Ret};
+#  define VM_DISPATCH() goto *kLabels[*pc]
+#  define VM_CASE(name) L_##name:
+  VM_DISPATCH();
+#else
+#  define VM_DISPATCH() break
+#  define VM_CASE(name) case Op::name:
+  for (;;) switch (static_cast<Op>(*pc)) {
+#endif
+
+  VM_CASE(LoadConst) {
+    regs[pc[1]] = consts[pc[2]];
+    pc += 3;
+    VM_DISPATCH();
+  }
+  VM_CASE(Move) {
+    regs[pc[1]] = regs[pc[2]];
+    pc += 3;
+    VM_DISPATCH();
+  }
+  VM_CASE(New) {
+    Object* obj = objects_.Allocate<Object>();
+    obj->cls = pc[2];
+    regs[pc[1]].obj = obj;
+    pc += 3;
+    VM_DISPATCH();
+  }
+  VM_CASE(CallVirtual) {
+    const ClassId cls = regs[pc[2]].obj->cls;
+    const InlineCache& ic = caches_[pc[3]];
+    // Fast path: the first cache entry (the monomorphic case)
+    uint32_t target;
+    if (ic.size != 0 && ic.classes[0] == cls) {
+      ++stats_.inlineCacheHits;
+      target = ic.targets[0];
+    } else {
+      target = lookupVirtual(pc[3], cls);
+    }
+    enter(target, pc[1], pc + 4);
+    VM_DISPATCH();
+  }
+  VM_CASE(CallDirect) {
+    enter(pc[2], pc[1], pc + 3);
+    VM_DISPATCH();
+  }
+  VM_CASE(Print) {
+    out << *regs[pc[1]].s << '\n';
+    pc += 2;
+    VM_DISPATCH();
+  }
+  VM_CASE(Ret) {
+    const Value result = regs[pc[1]];
+    if (frames_.empty()) return static_cast<int32_t>(result.i);
+    const Frame f = frames_.back();
+    frames_.pop_back();
+    base = f.base;
+    numRegs = f.numRegs;
+    regs = regs_.data() + base;
+    regs[f.dst] = result;
+    pc = f.returnPc;
+    VM_DISPATCH();
+  }
+
+#if !FAKELANG_VM_COMPUTED_GOTO
+  }
+#endif
+#undef VM_DISPATCH
+#undef VM_CASE
+}
+
+#if FAKELANG_VM_COMPUTED_GOTO && defined(__GNUC__)
+#  pragma GCC diagnostic pop
+#endif
+
+} // namespace fakelang
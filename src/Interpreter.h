@@ -0,0 +1,106 @@
+// Fakelang bytecode interpreter.
+//
+// Runs a BytecodeModule without LLVM. The dispatch loop uses computed goto
+// where the compiler supports labels as values (GCC, Clang) and a switch
+// otherwise; define FAKELANG_VM_COMPUTED_GOTO=0 to force the switch.
+//
+// Objects carry their class ID. Each CallVirtual site has an inline cache
+// keyed on that ID: monomorphic after the first call, polymorphic up to
+// kInlineCacheEntries classes, and megamorphic (a plain vtable lookup) after
+// that.
+#pragma once
+
+#include "Bytecode.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef FAKELANG_VM_COMPUTED_GOTO
+#  if defined(__GNUC__)
+#    define FAKELANG_VM_COMPUTED_GOTO 1
+#  else
+#    define FAKELANG_VM_COMPUTED_GOTO 0
+#  endif
+#endif
+
+namespace fakelang {
+
+/// Classes remembered per call site before it goes megamorphic.
+inline constexpr size_t kInlineCacheEntries = 4;
+
+/// Execution counters, cumulative over run() calls.
+struct VMStats {
+  size_t calls{0};
+  /// Virtual calls resolved by the call site's inline cache.
+  size_t inlineCacheHits{0};
+  /// Virtual calls that filled a cache entry.
+  size_t inlineCacheMisses{0};
+  /// Virtual calls at sites whose cache is full.
+  size_t megamorphicCalls{0};
+};
+
+/// Executes a BytecodeModule.
+class VM {
+public:
+  /// `module` must outlive the VM.
+  explicit VM(const BytecodeModule& module);
+
+  /// Run `main`, writing printed strings to `out`, and return its result.
+  /// Throws std::runtime_error on a Fakelang stack overflow.
+  int32_t run(llvm::raw_ostream& out);
+
+  const VMStats& stats() const { return stats_; }
+
+  /// Maximum call depth before run() reports a stack overflow.
+  static constexpr size_t kMaxCallDepth = 1u << 16;
+
+private:
+  struct Object {
+    ClassId cls;
+  };
+  /// A register: Int, String, or object reference depending on the static type.
+  union Value {
+    int64_t i;
+    const std::string* s;
+    const Object* obj;
+  };
+  struct InlineCache {
+    uint32_t size{0};
+    ClassId classes[kInlineCacheEntries];
+    uint32_t targets[kInlineCacheEntries];
+  };
+  /// A suspended caller.
+  struct Frame {
+    const uint32_t* returnPc;
+    /// Offset of the caller's registers in regs_, and their count.
+    size_t base;
+    uint32_t numRegs;
+    /// Caller register receiving the result.
+    uint32_t dst;
+  };
+
+  uint32_t lookupVirtual(uint32_t site, ClassId cls);
+
+  const BytecodeModule& mod_;
+  std::vector<Value> constants_;
+  std::vector<InlineCache> caches_;
+  std::vector<Value> regs_;
+  std::vector<Frame> frames_;
+  llvm::BumpPtrAllocator objects_;
+  VMStats stats_;
+};
+
+} // namespace fakelang
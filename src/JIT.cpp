@@ -0,0 +1,59 @@
+#include "JIT.h"
+
+#include "ObjectEmitter.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <stdexcept>
+#include <string>
+
+namespace fakelang {
+
+/// Unwrap `value` or throw its error as a std::runtime_error.
+template <typename T>
+static T orThrow(llvm::Expected<T> value, const char* what) {
+  if (!value) throw std::runtime_error(std::string(what) + ": " + llvm::toString(value.takeError()));
+  return std::move(*value);
+}
+
+std::unique_ptr<llvm::orc::LLJIT> createHostJIT() {
+  initializeHostTarget();
+  auto jit = orThrow(llvm::orc::LLJITBuilder().create(), "Failed to create JIT");
+  const char prefix = jit->getDataLayout().getGlobalPrefix();
+  jit->getMainJITDylib().addGenerator(
+      orThrow(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(prefix),
+              "Failed to expose process symbols"));
+  return jit;
+}
+
+void addModule(llvm::orc::LLJIT& jit, std::unique_ptr<llvm::LLVMContext> context,
+               std::unique_ptr<llvm::Module> module) {
+  if (llvm::Error err = jit.addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+    throw std::runtime_error("Failed to add module to JIT: " + llvm::toString(std::move(err)));
+  }
+}
+
+void* lookupAddress(llvm::orc::LLJIT& jit, llvm::StringRef name) {
+  auto addr = orThrow(jit.lookup(name), "Failed to look up symbol");
+  return addr.toPtr<void*>();
+}
+
+int32_t runInJIT(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module) {
+  auto jit = createHostJIT();
+  addModule(*jit, std::move(context), std::move(module));
+  auto mainAddr = orThrow(jit->lookup("main"), "No main function");
+  return mainAddr.toPtr<int32_t (*)()>()();
+}
+
+} // namespace fakelang
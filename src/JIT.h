@@ -0,0 +1,46 @@
+// Fakelang JIT: runs a generated module in-process with ORC LLJIT.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/ADT/StringRef.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstdint>
+#include <memory>
+
+namespace llvm::orc {
+class LLJIT;
+} // namespace llvm::orc
+
+namespace fakelang {
+
+/// An ORC LLJIT for the host whose external symbols, such as `puts`, resolve
+/// against the current process, so prints go to the C stdout. Throws
+/// std::runtime_error on failure.
+std::unique_ptr<llvm::orc::LLJIT> createHostJIT();
+
+/// Add `module` (whose types live in `context`) to the main JITDylib of
+/// `jit`; it is compiled when first looked up. Throws std::runtime_error on
+/// failure.
+void addModule(llvm::orc::LLJIT& jit, std::unique_ptr<llvm::LLVMContext> context,
+               std::unique_ptr<llvm::Module> module);
+
+/// Address of the symbol `name` in `jit`, compiling its module if needed.
+/// Throws std::runtime_error if it is not defined or does not compile.
+void* lookupAddress(llvm::orc::LLJIT& jit, llvm::StringRef name);
+
+/// Compile `module` (whose types live in `context`) for the host with ORC
+/// LLJIT, run its `main`, and return the result. External symbols such as
+/// `puts` resolve against the current process, so prints go to the C stdout.
+/// Throws std::runtime_error if the module cannot be compiled or has no main.
+int32_t runInJIT(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module);
+
+} // namespace fakelang
@@ -0,0 +1,357 @@
+#include "LanguageServer.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/Error.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <exception>
+#include <string_view>
+
+namespace fakelang {
+
+namespace {
+
+using llvm::json::Array;
+using llvm::json::Object;
+using llvm::json::Value;
+
+// JSON-RPC error codes
+constexpr int kParseError = -32700;
+constexpr int kInvalidRequest = -32600;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInternalError = -32603;
+
+/// Bytes in the UTF-8 sequence led by `c` (1 for a stray continuation byte).
+size_t sequenceLength(unsigned char c) { return c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1; }
+
+/// UTF-16 code units encoding the UTF-8 text `s`: characters outside the
+/// Basic Multilingual Plane (4-byte sequences) take two.
+size_t utf16Length(std::string_view s) {
+  size_t units = 0;
+  for (size_t i = 0; i < s.size(); i += sequenceLength(static_cast<unsigned char>(s[i]))) {
+    units += sequenceLength(static_cast<unsigned char>(s[i])) == 4 ? 2 : 1;
+  }
+  return units;
+}
+
+/// Bytes at the start of `line` that its first `units` UTF-16 code units
+/// cover, stopping at the end of the line.
+size_t utf8Length(std::string_view line, size_t units) {
+  size_t i = 0;
+  while (i < line.size() && line[i] != '\n') {
+    const size_t bytes = sequenceLength(static_cast<unsigned char>(line[i]));
+    const size_t width = bytes == 4 ? 2 : 1;
+    if (width > units) break;
+    units -= width;
+    i = std::min(i + bytes, line.size());
+  }
+  return i;
+}
+
+Value diagnostic(Value range, const std::string& message) {
+  return Object{{"range", std::move(range)}, {"severity", 1}, {"source", "fakelang"}, {"message", message}};
+}
+
+/// The `uri` of params.textDocument, or "".
+std::string documentURI(const Object& params) {
+  const Object* doc = params.getObject("textDocument");
+  if (!doc) return "";
+  auto uri = doc->getString("uri");
+  return uri ? uri->str() : "";
+}
+
+bool isIdentChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+} // namespace
+
+int LanguageServer::run() {
+  while (!exit_) {
+    const std::optional<std::string> body = readMessage();
+    if (!body) break;
+    llvm::Expected<Value> message = llvm::json::parse(*body);
+    if (!message) {
+      replyError(nullptr, kParseError, llvm::toString(message.takeError()));
+      continue;
+    }
+    handle(*message);
+  }
+  return shutdown_ ? 0 : 1;
+}
+
+std::optional<std::string> LanguageServer::readMessage() {
+  constexpr std::string_view kLength = "Content-Length:";
+  std::optional<size_t> length;
+  std::string line;
+  while (std::getline(in_, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) {
+      if (length) break;
+      continue;
+    }
+    // Other headers (Content-Type) have one value we accept
+    if (!std::string_view(line).starts_with(kLength)) continue;
+    std::string_view value = std::string_view(line).substr(kLength.size());
+    while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+    size_t n = 0;
+    if (std::from_chars(value.data(), value.data() + value.size(), n).ec == std::errc()) length = n;
+  }
+  if (!length) return std::nullopt;
+  std::string body(*length, '\0');
+  if (!in_.read(body.data(), static_cast<std::streamsize>(body.size()))) return std::nullopt;
+  return body;
+}
+
+void LanguageServer::send(Value message) {
+  std::string body;
+  llvm::raw_string_ostream(body) << message;
+  out_ << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+  out_.flush();
+}
+
+void LanguageServer::reply(const Value& id, Value result) {
+  send(Object{{"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+}
+
+void LanguageServer::replyError(const Value& id, int code, const std::string& message) {
+  send(Object{{"jsonrpc", "2.0"}, {"id", id}, {"error", Object{{"code", code}, {"message", message}}}});
+}
+
+Value LanguageServer::toLSP(const Document& doc, SourcePos p) const {
+  int character = p.column - 1;
+  if (!utf8Positions_) {
+    const std::string& text = doc.parser.text();
+    const size_t lineStart = doc.parser.offsetOf(SourcePos{p.line, 1});
+    const size_t end = std::max(doc.parser.offsetOf(p), lineStart);
+    character = static_cast<int>(utf16Length(std::string_view(text).substr(lineStart, end - lineStart)));
+  }
+  return Object{{"line", p.line - 1}, {"character", character}};
+}
+
+Value LanguageServer::toLSP(const Document& doc, const SourceRange& r) const {
+  return Object{{"start", toLSP(doc, r.start)}, {"end", toLSP(doc, r.end)}};
+}
+
+SourcePos LanguageServer::fromLSP(const Document& doc, const Object* pos) const {
+  if (!pos) return SourcePos{};
+  auto line = pos->getInteger("line");
+  auto character = pos->getInteger("character");
+  SourcePos p{line ? static_cast<int>(*line) + 1 : 1, character ? static_cast<int>(*character) + 1 : 1};
+  if (!utf8Positions_ && character) {
+    const size_t lineStart = doc.parser.offsetOf(SourcePos{p.line, 1});
+    const std::string_view rest = std::string_view(doc.parser.text()).substr(lineStart);
+    p.column = static_cast<int>(utf8Length(rest, static_cast<size_t>(std::max<int64_t>(*character, 0)))) + 1;
+  }
+  return p;
+}
+
+void LanguageServer::handle(const Value& message) {
+  const Object* msg = message.getAsObject();
+  if (!msg) return;
+  auto method = msg->getString("method");
+  // We send no requests, so there are no responses to read
+  if (!method) return;
+  const Value* id = msg->get("id");
+  const Object noParams;
+  const Object* params = msg->getObject("params");
+  if (!params) params = &noParams;
+
+  const bool isRequest = *method == "initialize" || *method == "shutdown" ||
+                         *method == "textDocument/prepareTypeHierarchy" || *method == "typeHierarchy/supertypes" ||
+                         *method == "typeHierarchy/subtypes";
+  if (isRequest && !id) {
+    replyError(nullptr, kInvalidRequest, method->str() + " is a request and needs an id");
+    return;
+  }
+
+  try {
+    if (*method == "initialize") {
+      // Byte columns if the client can take them, else the default UTF-16
+      utf8Positions_ = false;
+      const Object* capabilities = params->getObject("capabilities");
+      const Object* general = capabilities ? capabilities->getObject("general") : nullptr;
+      if (const Array* encodings = general ? general->getArray("positionEncodings") : nullptr) {
+        for (const Value& e : *encodings) {
+          if (e.getAsString() && *e.getAsString() == "utf-8") utf8Positions_ = true;
+        }
+      }
+      Object serverCapabilities{{"positionEncoding", utf8Positions_ ? "utf-8" : "utf-16"},
+                                {"textDocumentSync", Object{{"openClose", true}, {"change", 2}}},
+                                {"typeHierarchyProvider", true}};
+      reply(*id, Object{{"capabilities", std::move(serverCapabilities)},
+                        {"serverInfo", Object{{"name", "fakelangc"}}}});
+    } else if (*method == "shutdown") {
+      shutdown_ = true;
+      reply(*id, nullptr);
+    } else if (*method == "exit") {
+      exit_ = true;
+    } else if (*method == "textDocument/didOpen") {
+      const Object* doc = params->getObject("textDocument");
+      const std::string uri = documentURI(*params);
+      if (!doc || uri.empty()) return;
+      auto text = doc->getString("text");
+      if (!text) return;
+      documents_.erase(uri);
+      auto it = documents_.emplace(uri, text->str()).first;
+      check(uri, it->second);
+      publish(uri, it->second);
+    } else if (*method == "textDocument/didChange") {
+      didChange(*params);
+    } else if (*method == "textDocument/didClose") {
+      const std::string uri = documentURI(*params);
+      documents_.erase(uri);
+      send(Object{{"jsonrpc", "2.0"},
+                  {"method", "textDocument/publishDiagnostics"},
+                  {"params", Object{{"uri", uri}, {"diagnostics", Array{}}}}});
+    } else if (*method == "textDocument/prepareTypeHierarchy") {
+      reply(*id, prepareTypeHierarchy(*params));
+    } else if (*method == "typeHierarchy/supertypes" || *method == "typeHierarchy/subtypes") {
+      reply(*id, relatedTypes(*params, *method == "typeHierarchy/supertypes"));
+    } else if (id) {
+      replyError(*id, kMethodNotFound, "Unknown method " + method->str());
+    }
+    // Other notifications (initialized, $/cancelRequest, ...) need no action
+  } catch (const std::exception& ex) {
+    if (id) replyError(*id, kInternalError, ex.what());
+  }
+}
+
+void LanguageServer::didChange(const Object& params) {
+  const std::string uri = documentURI(params);
+  auto it = documents_.find(uri);
+  const Array* changes = params.getArray("contentChanges");
+  if (it == documents_.end() || !changes) return;
+  IncrementalParser& parser = it->second.parser;
+  // Each change applies to the text the previous one left
+  for (const Value& change : *changes) {
+    const Object* c = change.getAsObject();
+    if (!c) continue;
+    auto text = c->getString("text");
+    if (!text) continue;
+    if (const Object* range = c->getObject("range")) {
+      parser.edit(parser.offsetOf(fromLSP(it->second, range->getObject("start"))),
+                  parser.offsetOf(fromLSP(it->second, range->getObject("end"))), *text);
+    } else {
+      parser.edit(0, parser.text().size(), *text);
+    }
+    check(uri, it->second);
+  }
+  publish(uri, it->second);
+}
+
+void LanguageServer::check(const std::string& uri, Document& doc) {
+  const IncrementalParser::Change& change = doc.parser.lastChange();
+  Program& program = doc.parser.program();
+  Sema sema(uri);
+  if (change.declarations) {
+    doc.declarationErrors = sema.checkDeclarations(program, doc.info);
+    doc.classErrors.resize(program.classes.size());
+    for (ClassId id = 0; id < program.classes.size(); ++id) {
+      doc.classErrors[id] = sema.checkClassBodies(program, doc.info, id);
+    }
+    doc.functionErrors.resize(program.functions.size());
+    for (size_t i = 0; i < program.functions.size(); ++i) {
+      doc.functionErrors[i] = sema.checkFunctionBody(program, doc.info, i);
+    }
+    return;
+  }
+  // Everything else is where it was, give or take the lines the edit added
+  auto move = [&](std::vector<SemaDiagnostic>& errors) {
+    for (SemaDiagnostic& e : errors) e.loc = SourceRange{change.map(e.loc.start), change.map(e.loc.end)};
+  };
+  move(doc.declarationErrors);
+  for (auto& errors : doc.classErrors) move(errors);
+  for (auto& errors : doc.functionErrors) move(errors);
+  for (ClassId id : change.classes) doc.classErrors[id] = sema.checkClassBodies(program, doc.info, id);
+  for (uint32_t i : change.functions) doc.functionErrors[i] = sema.checkFunctionBody(program, doc.info, i);
+}
+
+void LanguageServer::publish(const std::string& uri, const Document& doc) {
+  Array diagnostics;
+  for (const ParseError& e : doc.parser.errors()) diagnostics.push_back(diagnostic(toLSP(doc, e.loc), e.message));
+  auto add = [&](const std::vector<SemaDiagnostic>& errors) {
+    for (const SemaDiagnostic& e : errors) diagnostics.push_back(diagnostic(toLSP(doc, e.loc), e.message));
+  };
+  add(doc.declarationErrors);
+  for (const auto& errors : doc.classErrors) add(errors);
+  for (const auto& errors : doc.functionErrors) add(errors);
+  send(Object{{"jsonrpc", "2.0"},
+              {"method", "textDocument/publishDiagnostics"},
+              {"params", Object{{"uri", uri}, {"diagnostics", std::move(diagnostics)}}}});
+}
+
+Value LanguageServer::prepareTypeHierarchy(const Object& params) {
+  const std::string uri = documentURI(params);
+  auto it = documents_.find(uri);
+  if (it == documents_.end()) return nullptr;
+  const Document& doc = it->second;
+  const std::string& text = doc.parser.text();
+  const size_t offset = doc.parser.offsetOf(fromLSP(doc, params.getObject("position")));
+
+  // A class name under the cursor, else the class declaration around it
+  size_t begin = offset, end = offset;
+  while (begin > 0 && isIdentChar(text[begin - 1])) --begin;
+  while (end < text.size() && isIdentChar(text[end])) ++end;
+  if (auto found = doc.info.classIds.find(text.substr(begin, end - begin)); found != doc.info.classIds.end()) {
+    return Array{hierarchyItem(uri, doc, found->second)};
+  }
+  const std::vector<ClassDecl>& classes = doc.parser.program().classes;
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    if (doc.parser.offsetOf(classes[id].loc.start) <= offset && offset < doc.parser.offsetOf(classes[id].loc.end)) {
+      return Array{hierarchyItem(uri, doc, id)};
+    }
+  }
+  return nullptr;
+}
+
+Value LanguageServer::relatedTypes(const Object& params, bool supertypes) {
+  const Object* item = params.getObject("item");
+  const Object* data = item ? item->getObject("data") : nullptr;
+  Array result;
+  if (!data) return result;
+  auto uri = data->getString("uri");
+  auto name = data->getString("name");
+  if (!uri || !name) return result;
+  auto it = documents_.find(uri->str());
+  if (it == documents_.end()) return result;
+  const Document& doc = it->second;
+  auto found = doc.info.classIds.find(name->str());
+  if (found == doc.info.classIds.end()) return result;
+
+  const std::vector<ClassDecl>& classes = doc.parser.program().classes;
+  if (supertypes) {
+    if (classes[found->second].baseId != kInvalidIndex) {
+      result.push_back(hierarchyItem(it->first, doc, classes[found->second].baseId));
+    }
+    return result;
+  }
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    if (classes[id].baseId == found->second) result.push_back(hierarchyItem(it->first, doc, id));
+  }
+  return result;
+}
+
+Value LanguageServer::hierarchyItem(const std::string& uri, const Document& doc, ClassId id) const {
+  const ClassDecl& c = doc.parser.program().classes[id];
+  // The name is the identifier after `class`
+  const size_t nameAt = doc.parser.text().find(c.name, doc.parser.offsetOf(c.loc.start) + 5);
+  const SourceRange name{doc.parser.positionOf(nameAt), doc.parser.positionOf(nameAt + c.name.size())};
+  Object item{{"name", c.name},
+              {"kind", 5}, // SymbolKind.Class
+              {"uri", uri},
+              {"range", toLSP(doc, c.loc)},
+              {"selectionRange", toLSP(doc, name)},
+              {"data", Object{{"uri", uri}, {"name", c.name}}}};
+  if (c.baseName) item["detail"] = "extends " + *c.baseName;
+  return item;
+}
+
+} // namespace fakelang
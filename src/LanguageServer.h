@@ -0,0 +1,93 @@
+// Fakelang language server: a minimal Language Server Protocol server for
+// editors, speaking JSON-RPC over a pair of streams (`fakelangc --lsp` uses
+// stdin and stdout).
+//
+// It keeps each open file in an IncrementalParser, applies the editor's
+// incremental changes to it, and after every change publishes the file's
+// parse and Sema errors. When a change only touched bodies, Sema rechecks
+// just those bodies and keeps the other results. It also answers type hierarchy queries (the class a
+// position refers to, its base, and its direct subclasses). Positions are
+// byte columns ("positionEncoding": "utf-8") when the client offers that
+// encoding, else UTF-16 code units as the protocol defaults to. Each file is
+// checked on its own, as a whole program.
+#pragma once
+
+#include "IncrementalParser.h"
+#include "Sema.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <istream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+/// Serves one client until it sends `exit` or closes the input.
+class LanguageServer {
+public:
+  LanguageServer(std::istream& in, llvm::raw_ostream& out) : in_(in), out_(out) {}
+
+  /// Read and answer messages until `exit` or end of input. Returns the exit
+  /// code the protocol asks for: 0 if `shutdown` came first, else 1.
+  int run();
+
+  /// Handle one decoded message, writing any response and notifications.
+  void handle(const llvm::json::Value& message);
+
+private:
+  /// An open file and the results of checking its current text.
+  struct Document {
+    explicit Document(std::string text) : parser(std::move(text)) {}
+    IncrementalParser parser;
+    ProgramInfo info;
+    /// Sema errors in the declarations, and in the bodies of each class and
+    /// function.
+    std::vector<SemaDiagnostic> declarationErrors;
+    std::vector<std::vector<SemaDiagnostic>> classErrors;
+    std::vector<std::vector<SemaDiagnostic>> functionErrors;
+  };
+
+  /// Read one framed message body; returns std::nullopt at end of input.
+  std::optional<std::string> readMessage();
+  void send(llvm::json::Value message);
+  void reply(const llvm::json::Value& id, llvm::json::Value result);
+  void replyError(const llvm::json::Value& id, int code, const std::string& message);
+
+  /// Bring the Sema errors of `doc` up to date with its parser's last change.
+  void check(const std::string& uri, Document& doc);
+  /// Publish the diagnostics of `uri`.
+  void publish(const std::string& uri, const Document& doc);
+  void didChange(const llvm::json::Object& params);
+  llvm::json::Value prepareTypeHierarchy(const llvm::json::Object& params);
+  /// The direct base (`supertypes`) or subclasses of a hierarchy item.
+  llvm::json::Value relatedTypes(const llvm::json::Object& params, bool supertypes);
+  llvm::json::Value hierarchyItem(const std::string& uri, const Document& doc, ClassId id) const;
+
+  /// A 1-based byte position in `doc` as an LSP position (0-based line and
+  /// character in the negotiated encoding), and back.
+  llvm::json::Value toLSP(const Document& doc, SourcePos p) const;
+  llvm::json::Value toLSP(const Document& doc, const SourceRange& r) const;
+  SourcePos fromLSP(const Document& doc, const llvm::json::Object* pos) const;
+
+  std::istream& in_;
+  llvm::raw_ostream& out_;
+  std::map<std::string, Document> documents_;
+  /// Columns count bytes ("utf-8") rather than UTF-16 code units.
+  bool utf8Positions_{false};
+  bool shutdown_{false};
+  bool exit_{false};
+};
+
+} // namespace fakelang
@@ -114,7 +114,7 @@ std::vector<Token> Lexer::lexAll() {
   std::vector<Token> out;
   skipWhitespaceAndComments();
   while (true) {
-    const SourcePos start = cur_;
+    const SourcePos start = tokenStart_ = cur_;
     switch (const char c = get()) {
       case '\0':
         out.push_back(makeToken(TokenKind::Eof, "", start));
@@ -22,13 +22,20 @@ public:
   ///
   /// - input: full source buffer to lex
   /// - filename: used for diagnostics only
-  explicit Lexer(std::string_view input, std::string filename = "<input>")
-      : input_(input), filename_(std::move(filename)) {}
+  /// - start: position of input[0] in its file, when lexing a slice of it
+  explicit Lexer(std::string_view input, std::string filename = "<input>", SourcePos start = {})
+      : input_(input), filename_(std::move(filename)), cur_(start) {}
 
   /// Lex the full input into a vector of tokens (includes a final Eof token).
   /// Throws std::runtime_error on malformed lexemes (e.g., unterminated string).
   std::vector<Token> lexAll();
 
+  /// After a throw from lexAll(): where the bad character or the
+  /// unterminated string starts.
+  SourcePos tokenStart() const { return tokenStart_; }
+  /// True once all of the input has been consumed.
+  bool atEnd() const { return pos_ >= input_.size(); }
+
 private:
   /// Peek at the current character without consuming it; returns '\0' at end.
   char peek() const { return (pos_ < input_.size()) ? input_[pos_] : '\0'; }
@@ -61,6 +68,8 @@ private:
   size_t pos_{0};
   /// Current source position (1-based line/column).
   SourcePos cur_{1, 1};
+  /// Start of the token being lexed.
+  SourcePos tokenStart_{1, 1};
 };
 
 } // namespace fakelang
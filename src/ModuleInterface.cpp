@@ -0,0 +1,195 @@
+#include "ModuleInterface.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/EndianStream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fakelang {
+
+using llvm::support::ulittle32_t;
+
+namespace {
+
+constexpr llvm::StringLiteral kMagic = "FLI\0";
+constexpr uint32_t kVersion = 1;
+
+} // namespace
+
+// The on-disk records. Their fields have alignment 1, so they can be read
+// in place at any offset.
+struct ModuleInterface::Str {
+  ulittle32_t offset;
+  ulittle32_t size;
+};
+struct ModuleInterface::Header {
+  char magic[4];
+  ulittle32_t version;
+  ulittle32_t numClasses;
+  ulittle32_t numMethods;
+  ulittle32_t stringsSize;
+  Str sourcePath;
+};
+struct ModuleInterface::ClassRecord {
+  Str name;
+  Str baseName;
+  ulittle32_t firstMethod;
+  ulittle32_t numMethods;
+};
+struct ModuleInterface::MethodRecord {
+  Str name;
+  Str returnType;
+  ulittle32_t vtableSlot;
+  ulittle32_t attr;
+};
+
+namespace {
+
+/// Builds the string table; equal strings (type names, inherited method
+/// names) are stored once.
+class StringTable {
+public:
+  void add(llvm::support::endian::Writer& w, std::string_view s) {
+    auto [it, inserted] = offsets_.try_emplace(std::string(s), static_cast<uint32_t>(data_.size()));
+    if (inserted) data_ += s;
+    w.write<uint32_t>(it->second);
+    w.write<uint32_t>(static_cast<uint32_t>(s.size()));
+  }
+  const std::string& data() const { return data_; }
+
+private:
+  std::string data_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+};
+
+} // namespace
+
+void writeInterface(const Program& program, std::string_view sourcePath, llvm::raw_ostream& os) {
+  std::vector<const ClassDecl*> classes;
+  uint32_t numMethods = 0;
+  for (const ClassDecl& c : program.classes) {
+    if (c.imported) continue;
+    classes.push_back(&c);
+    numMethods += static_cast<uint32_t>(c.methods.size());
+  }
+
+  // Records go to a buffer first: the header needs the string table's size
+  std::string records;
+  StringTable strings;
+  {
+    llvm::raw_string_ostream ros(records);
+    llvm::support::endian::Writer w(ros, llvm::support::little);
+    uint32_t firstMethod = 0;
+    for (const ClassDecl* c : classes) {
+      strings.add(w, c->name);
+      strings.add(w, c->baseName ? std::string_view(*c->baseName) : std::string_view());
+      w.write<uint32_t>(firstMethod);
+      w.write<uint32_t>(static_cast<uint32_t>(c->methods.size()));
+      firstMethod += static_cast<uint32_t>(c->methods.size());
+    }
+    for (const ClassDecl* c : classes) {
+      for (const MethodDecl& m : c->methods) {
+        strings.add(w, m.name);
+        strings.add(w, m.returnType.name);
+        w.write<uint32_t>(m.vtableSlot);
+        w.write<uint32_t>(static_cast<uint32_t>(m.attr));
+      }
+    }
+  }
+  std::string source;
+  {
+    llvm::raw_string_ostream sos(source);
+    llvm::support::endian::Writer w(sos, llvm::support::little);
+    strings.add(w, sourcePath);
+  }
+
+  llvm::support::endian::Writer w(os, llvm::support::little);
+  os << kMagic;
+  w.write<uint32_t>(kVersion);
+  w.write<uint32_t>(static_cast<uint32_t>(classes.size()));
+  w.write<uint32_t>(numMethods);
+  w.write<uint32_t>(static_cast<uint32_t>(strings.data().size()));
+  os << source << records << strings.data();
+}
+
+bool isInterface(llvm::StringRef data) { return data.startswith(kMagic); }
+
+ModuleInterface::ModuleInterface(llvm::MemoryBufferRef buffer) : buffer_(buffer) {
+  const std::string name = buffer.getBufferIdentifier().str();
+  auto fail = [&](const std::string& why) { return std::runtime_error(name + ": " + why); };
+  const llvm::StringRef data = buffer.getBuffer();
+  if (!isInterface(data)) throw fail("not a Fakelang interface file");
+  if (data.size() < sizeof(Header)) throw fail("truncated interface file");
+  const Header& h = header();
+  if (h.version != kVersion) throw fail("unsupported interface version " + std::to_string(h.version));
+  // 64-bit arithmetic: the counts come from the file and may be anything
+  strings_ = sizeof(Header) + uint64_t{h.numClasses} * sizeof(ClassRecord) +
+             uint64_t{h.numMethods} * sizeof(MethodRecord);
+  if (strings_ + uint64_t{h.stringsSize} != data.size()) throw fail("corrupt interface file");
+  auto checkStr = [&](const Str& s) {
+    if (uint64_t{s.offset} + s.size > h.stringsSize) throw fail("corrupt interface file");
+  };
+  checkStr(h.sourcePath);
+  for (const ClassRecord* c = classes(); c != classes() + h.numClasses; ++c) {
+    checkStr(c->name);
+    checkStr(c->baseName);
+    if (uint64_t{c->firstMethod} + c->numMethods > h.numMethods) throw fail("corrupt interface file");
+  }
+  for (const MethodRecord* m = methods(); m != methods() + h.numMethods; ++m) {
+    checkStr(m->name);
+    checkStr(m->returnType);
+    if (m->attr > static_cast<uint32_t>(MethodAttr::Override)) throw fail("corrupt interface file");
+  }
+}
+
+std::string_view ModuleInterface::str(const Str& s) const {
+  return std::string_view(buffer_.getBufferStart() + strings_ + s.offset, s.size);
+}
+
+const ModuleInterface::Header& ModuleInterface::header() const {
+  return *reinterpret_cast<const Header*>(buffer_.getBufferStart());
+}
+
+const ModuleInterface::ClassRecord* ModuleInterface::classes() const {
+  return reinterpret_cast<const ClassRecord*>(buffer_.getBufferStart() + sizeof(Header));
+}
+
+const ModuleInterface::MethodRecord* ModuleInterface::methods() const {
+  return reinterpret_cast<const MethodRecord*>(classes() + header().numClasses);
+}
+
+std::string_view ModuleInterface::sourcePath() const { return str(header().sourcePath); }
+
+size_t ModuleInterface::numClasses() const { return header().numClasses; }
+
+void ModuleInterface::importInto(Program& program) const {
+  const MethodRecord* allMethods = methods();
+  for (const ClassRecord* c = classes(); c != classes() + numClasses(); ++c) {
+    ClassDecl& decl = program.classes.emplace_back();
+    decl.name = str(c->name);
+    if (c->baseName.size != 0) decl.baseName = std::string(str(c->baseName));
+    decl.imported = true;
+    decl.methods.reserve(c->numMethods);
+    for (const MethodRecord* m = allMethods + c->firstMethod; m != allMethods + c->firstMethod + c->numMethods; ++m) {
+      MethodDecl& method = decl.methods.emplace_back();
+      method.attr = static_cast<MethodAttr>(uint32_t{m->attr});
+      method.name = str(m->name);
+      method.returnType.name = str(m->returnType);
+      method.vtableSlot = m->vtableSlot;
+    }
+  }
+}
+
+} // namespace fakelang
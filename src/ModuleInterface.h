@@ -0,0 +1,83 @@
+// Fakelang module interfaces: the class declarations of one source file in a
+// compact binary form (`fakelangc --emit-interface`, conventionally `.fli`).
+//
+// Compiling a file that uses or extends classes of another file needs only
+// their declarations: names, bases, vtable slots, and method signatures.
+// Listing the other file's interface in CompileOptions::imports gives Sema
+// those without lexing or parsing the other file. The file is
+//   header  := "FLI\0" u32 version(1) u32 numClasses u32 numMethods
+//              u32 stringsSize str sourcePath
+//   class   := str name str baseName u32 firstMethod u32 numMethods
+//   method  := str name str returnType u32 vtableSlot u32 attr
+//   str     := u32 offset u32 size   (into the string table)
+//   file    := header class* method* strings
+// with every integer little-endian. The records have fixed sizes, so a
+// memory-mapped file is read in place: loading it checks the bounds once and
+// copies the declarations into the program's class table, with no decoding
+// step in between. An empty baseName means a root class. A method's
+// vtableSlot is kInvalidIndex for non-virtual methods; importing checks the
+// slots against the layout recomputed from the imported bases, so a stale
+// interface is reported instead of miscompiling the vtables.
+#pragma once
+
+#include "AST.h"
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBufferRef.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <string_view>
+
+namespace fakelang {
+
+/// Write the interface of the classes `program` defines itself (imported
+/// classes are left to their own files' interfaces). `sourcePath` is the
+/// file they were declared in. The program must have passed Sema, which
+/// assigns the vtable slots.
+void writeInterface(const Program& program, std::string_view sourcePath, llvm::raw_ostream& os);
+
+/// True if `data` starts with the interface magic.
+bool isInterface(llvm::StringRef data);
+
+/// A checked, read-only view of an interface file's bytes, which must stay
+/// alive (typically memory-mapped by openInput()) while it is used.
+class ModuleInterface {
+public:
+  /// Check the header and that every record and string lies inside
+  /// `buffer`. Throws std::runtime_error otherwise.
+  explicit ModuleInterface(llvm::MemoryBufferRef buffer);
+
+  /// The source file the interface was written for.
+  std::string_view sourcePath() const;
+  /// Number of classes declared.
+  size_t numClasses() const;
+
+  /// Append the declared classes to `program`, marked imported and with
+  /// bodiless methods that keep the recorded vtable slots for Sema to check.
+  void importInto(Program& program) const;
+
+private:
+  struct Header;
+  struct ClassRecord;
+  struct MethodRecord;
+  struct Str;
+
+  std::string_view str(const Str& s) const;
+  const Header& header() const;
+  const ClassRecord* classes() const;
+  const MethodRecord* methods() const;
+
+  llvm::MemoryBufferRef buffer_;
+  /// Offset of the string table in buffer_.
+  size_t strings_{0};
+};
+
+} // namespace fakelang
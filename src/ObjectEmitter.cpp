@@ -0,0 +1,73 @@
+#include "ObjectEmitter.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace fakelang {
+
+void initializeHostTarget() {
+  static std::once_flag initOnce;
+  std::call_once(initOnce, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+}
+
+namespace {
+
+/// A PIC target machine for the host, generic CPU.
+std::unique_ptr<llvm::TargetMachine> createHostTargetMachine() {
+  initializeHostTarget();
+
+  const std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string err;
+  const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, err);
+  if (!target) throw std::runtime_error("No target for " + triple + ": " + err);
+
+  std::unique_ptr<llvm::TargetMachine> tm(target->createTargetMachine(
+      triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+  if (!tm) throw std::runtime_error("Failed to create target machine for " + triple);
+  return tm;
+}
+
+void setTarget(llvm::Module& module, const llvm::TargetMachine& tm) {
+  module.setTargetTriple(tm.getTargetTriple().str());
+  module.setDataLayout(tm.createDataLayout());
+}
+
+} // namespace
+
+void setHostTarget(llvm::Module& module) { setTarget(module, *createHostTargetMachine()); }
+
+void emitObjectFile(llvm::Module& module, llvm::SmallVectorImpl<char>& out) {
+  const std::unique_ptr<llvm::TargetMachine> tm = createHostTargetMachine();
+  const std::string triple = tm->getTargetTriple().str();
+  setTarget(module, *tm);
+
+  llvm::raw_svector_ostream os(out);
+  llvm::legacy::PassManager pm;
+  if (tm->addPassesToEmitFile(pm, os, /*DwoOut=*/nullptr, llvm::CGFT_ObjectFile)) {
+    throw std::runtime_error("Target " + triple + " cannot emit object files");
+  }
+  pm.run(module);
+}
+
+} // namespace fakelang
@@ -0,0 +1,30 @@
+// Fakelang object emitter: lowers a finished module to a host object file.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Module.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+namespace fakelang {
+
+/// Register the host target with LLVM. Runs once per process; thread-safe.
+void initializeHostTarget();
+
+/// Set the host's target triple and data layout on `module`, as
+/// emitObjectFile() does, for modules compiled to objects later (ThinLTO).
+void setHostTarget(llvm::Module& module);
+
+/// Compile `module` for the host target (PIC, default CPU) and append the
+/// resulting object file bytes to `out`. Sets the module's target triple and
+/// data layout. Throws std::runtime_error if the host target is unavailable.
+/// Target initialization happens once per process; calls are thread-safe.
+void emitObjectFile(llvm::Module& module, llvm::SmallVectorImpl<char>& out);
+
+} // namespace fakelang
@@ -0,0 +1,24 @@
+// Fakelang optimizer: runs LLVM's standard optimization pipeline over a
+// finished module (`-O`).
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/Module.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+namespace fakelang {
+
+/// Optimize `module` in place with LLVM's default -O2 module pipeline. The
+/// attributes CodeGen infers (see Effects.h) let it remove and merge calls
+/// whose bodies it cannot see, such as virtual calls and declarations.
+/// With `thinLTOPreLink`, runs the shorter pipeline meant for modules that
+/// ThinLTO will optimize again after importing across modules (ThinLTO.h).
+void optimizeModule(llvm::Module& module, bool thinLTOPreLink = false);
+
+} // namespace fakelang
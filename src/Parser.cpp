@@ -1,5 +1,6 @@
 #include "Parser.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <stdexcept>
 
@@ -46,18 +47,28 @@ TypeRef Parser::parseType() {
 /// Parse a sequence of class/function declarations until Eof.
 Program Parser::parseProgram() {
   Program p;
-  while (!is(TokenKind::Eof)) {
-    if (is(TokenKind::KwClass)) {
-      p.classes.push_back(parseClassDecl());
-    } else if (is(TokenKind::KwFunction)) {
-      p.functions.push_back(parseFunctionDecl());
-    } else {
-      throw std::runtime_error("Expected 'class' or 'function'");
-    }
-  }
+  while (!atEnd()) parseDecl(p);
   return p;
 }
 
+/// Parse one top-level declaration, dispatching on its keyword.
+void Parser::parseDecl(Program& p) {
+  if (is(TokenKind::KwClass)) {
+    p.classes.push_back(parseClassDecl());
+  } else if (is(TokenKind::KwFunction)) {
+    p.functions.push_back(parseFunctionDecl());
+  } else {
+    throw std::runtime_error("Expected 'class' or 'function'");
+  }
+}
+
+/// Resume at the unexpected token if it starts a declaration; a missing '}'
+/// then costs only the declaration that lacks it.
+void Parser::recover(size_t declStart) {
+  pos_ = std::max(pos_, declStart + 1);
+  while (!atEnd() && !is(TokenKind::KwClass) && !is(TokenKind::KwFunction)) pos_++;
+}
+
 /// Parse a class declaration with optional 'extends Base'.
 ClassDecl Parser::parseClassDecl() {
   const Token& tClass = expect(TokenKind::KwClass, "'class'");
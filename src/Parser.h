@@ -35,6 +35,21 @@ public:
   /// Parse an entire program consisting of class and function declarations.
   Program parseProgram();
 
+  /// Parse the one class or function declaration at the current token and
+  /// append it to `program`. Lets a caller parse declaration by declaration
+  /// and recover from errors between them (IncrementalParser.h).
+  void parseDecl(Program& program);
+  /// True when only the Eof token is left.
+  bool atEnd() const { return is(TokenKind::Eof); }
+  /// The next token; after a throw, the one that was not expected.
+  const Token& current() const { return peek(); }
+  /// Index of the next token.
+  size_t position() const { return pos_; }
+  /// After parseDecl() threw for the declaration starting at token
+  /// `declStart`, skip to where the next one can start: the first 'class' or
+  /// 'function' keyword after `declStart`, or Eof.
+  void recover(size_t declStart);
+
 private:
   /// Lookahead accessor; returns the i-th token from current position.
   const Token& peek(size_t i = 0) const;
@@ -0,0 +1,100 @@
+#include "PartialEval.h"
+
+namespace fakelang {
+
+FoldStats PartialEvaluator::run(Program& program) {
+  program_ = &program;
+  stats_ = FoldStats{};
+  summaries_.clear();
+  summaries_.resize(program.classes.size());
+  for (ClassId id = 0; id < program.classes.size(); ++id) {
+    summaries_[id].resize(program.classes[id].methods.size());
+  }
+
+  // Methods are evaluated on demand from their callers; this visits the rest.
+  for (ClassId id = 0; id < program.classes.size(); ++id) {
+    for (uint32_t m = 0; m < program.classes[id].methods.size(); ++m) evalMethod(id, m);
+  }
+  for (auto& f : program.functions) {
+    bool pure = true;
+    evalBody(f.body, f.numLocals, pure);
+  }
+  return stats_;
+}
+
+/// Evaluate a method body once. A method reached again while its own body is
+/// being evaluated (recursion), or of an imported class, is treated as unknown
+/// and impure.
+const PartialEvaluator::Summary& PartialEvaluator::evalMethod(ClassId cls, uint32_t method) {
+  Summary& s = summaries_[cls][method];
+  if (s.state != Summary::State::NotVisited) return s;
+  if (program_->classes[cls].imported) {
+    // Defined in another module: unknown and impure
+    s.state = Summary::State::Done;
+    return s;
+  }
+  s.state = Summary::State::InProgress;
+  MethodDecl& m = program_->classes[cls].methods[method];
+  bool pure = true;
+  const Value result = evalBody(m.body, m.numLocals, pure);
+  s.pure = pure;
+  s.result = result;
+  s.state = Summary::State::Done;
+  return s;
+}
+
+PartialEvaluator::Value PartialEvaluator::evalBody(std::vector<std::unique_ptr<Stmt>>& body,
+                                                   uint32_t numLocals, bool& pure) {
+  std::vector<Value> locals(numLocals);
+  const ReturnStmt* r = forEachStmtBeforeReturn(body, [&](Stmt& s) {
+    if (auto* p = dynamic_cast<PrintStmt*>(&s)) {
+      const Value v = evalExpr(p->value.get(), locals, pure);
+      p->constant = dynamic_cast<const StringExpr*>(v.literal);
+      if (p->constant) ++stats_.constantPrints;
+      pure = false;
+    } else if (auto* vd = dynamic_cast<VarDeclStmt*>(&s)) {
+      locals[vd->slot] = evalExpr(vd->init.get(), locals, pure);
+    }
+  });
+  return r ? evalExpr(r->value.get(), locals, pure) : Value{};
+}
+
+PartialEvaluator::Value PartialEvaluator::evalExpr(Expr* e, std::vector<Value>& locals,
+                                                   bool& pure) {
+  if (dynamic_cast<StringExpr*>(e) || dynamic_cast<IntExpr*>(e)) return Value{e, kInvalidIndex};
+  if (auto* ve = dynamic_cast<VarExpr*>(e)) return locals[ve->slot];
+  if (auto* ne = dynamic_cast<NewExpr*>(e)) return Value{nullptr, ne->classId};
+  if (auto* me = dynamic_cast<MethodCallExpr*>(e)) {
+    me->exactClassId = evalExpr(me->receiver.get(), locals, pure).object;
+    me->folded = nullptr;
+    if (me->exactClassId == kInvalidIndex) {
+      pure = false; // unknown target
+      return Value{};
+    }
+    ++stats_.exactCalls;
+    if (localOnly_) {
+      pure = false; // the callee's body is not ours to look into
+      return Value{};
+    }
+    const MethodRef target = info_.layouts.impl(me->exactClassId)[me->vtableSlot];
+    const Summary& callee = evalMethod(target.cls, target.method);
+    if (callee.state != Summary::State::Done) {
+      pure = false;
+      return Value{};
+    }
+    if (!callee.pure) {
+      // The call must still run; only the class of its result is usable
+      pure = false;
+      return Value{nullptr, callee.result.object};
+    }
+    if (callee.result.literal) {
+      me->folded = callee.result.literal;
+      ++stats_.foldedCalls;
+    }
+    return callee.result;
+  }
+  pure = false;
+  return Value{};
+}
+
+} // namespace fakelang
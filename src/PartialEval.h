@@ -0,0 +1,79 @@
+// Fakelang partial evaluator: compile-time evaluation of side-effect-free
+// methods.
+//
+// Every local is initialized once and never reassigned, so the exact class of
+// an object-typed local is usually known statically, and so is the method a
+// call on it dispatches to. The evaluator interprets method bodies over the
+// AST with that knowledge: a method that prints nothing (directly or through
+// its callees) and returns a literal is pure, and calls to it are replaced by
+// that literal. It runs after Sema and records its results in the AST
+// (MethodCallExpr::exactClassId / folded, PrintStmt::constant); CodeGen then
+// emits folded calls as constants, other exactly-typed calls as direct calls,
+// and runs of constant prints as a single puts of a precomputed buffer.
+#pragma once
+
+#include "AST.h"
+#include "Sema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fakelang {
+
+/// Counts of what the partial evaluator resolved.
+struct FoldStats {
+  /// Calls whose receiver's exact class, and hence target, is known.
+  size_t exactCalls{0};
+  /// Calls replaced by their constant result.
+  size_t foldedCalls{0};
+  /// Prints whose string is known.
+  size_t constantPrints{0};
+};
+
+/// Annotates a Sema-checked Program with compile-time facts.
+class PartialEvaluator {
+public:
+  /// `info` must be the result of analyzing the Program passed to run().
+  explicit PartialEvaluator(const ProgramInfo& info) : info_(info) {}
+
+  /// Use only what each body shows by itself: a receiver created by `new` in
+  /// the same body is still exact, but no call is folded and call results are
+  /// unknown. For programs whose bodies may be replaced one at a time
+  /// (HotSwap.h), where a fact taken from another body could go stale. Off by
+  /// default.
+  void setLocalOnly(bool enabled) { localOnly_ = enabled; }
+
+  /// Evaluate every method and function body of `program`.
+  FoldStats run(Program& program);
+
+private:
+  /// What is known about a value: a literal, an object of an exact class, or
+  /// nothing.
+  struct Value {
+    const Expr* literal{nullptr};
+    ClassId object{kInvalidIndex};
+  };
+  /// Memoized result of evaluating one method body.
+  struct Summary {
+    enum class State : uint8_t { NotVisited, InProgress, Done };
+    State state{State::NotVisited};
+    /// True if running the method has no observable effect.
+    bool pure{false};
+    Value result;
+  };
+
+  const Summary& evalMethod(ClassId cls, uint32_t method);
+  /// Evaluate a body; returns the returned value and clears `pure` on side effects.
+  Value evalBody(std::vector<std::unique_ptr<Stmt>>& body, uint32_t numLocals, bool& pure);
+  Value evalExpr(Expr* e, std::vector<Value>& locals, bool& pure);
+
+  const ProgramInfo& info_;
+  Program* program_{nullptr};
+  /// Per class, per method.
+  std::vector<std::vector<Summary>> summaries_;
+  FoldStats stats_;
+  bool localOnly_{false};
+};
+
+} // namespace fakelang
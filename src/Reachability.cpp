@@ -0,0 +1,172 @@
+#include "Reachability.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace fakelang {
+
+uint32_t LiveSet::slotIndex(ClassId id, uint32_t slot) const {
+  const std::vector<uint32_t>& kept = vtableSlots[id];
+  const auto it = std::lower_bound(kept.begin(), kept.end(), slot);
+  assert(it != kept.end() && *it == slot && "slot was dropped from the vtable");
+  return static_cast<uint32_t>(it - kept.begin());
+}
+
+size_t LiveSet::numLiveMethods() const {
+  size_t n = 0;
+  for (const auto& perClass : methods) n += static_cast<size_t>(std::count(perClass.begin(), perClass.end(), true));
+  return n;
+}
+
+LiveSet ReachabilityAnalysis::run(const Program& program, bool shrinkVtables) {
+  program_ = &program;
+  const size_t n = program.classes.size();
+  live_ = LiveSet{};
+  live_.instantiated.assign(n, false);
+  live_.referenced.assign(n, false);
+  live_.methods.resize(n);
+  for (ClassId id = 0; id < n; ++id) live_.methods[id].assign(program.classes[id].methods.size(), false);
+  live_.functions.assign(program.functions.size(), false);
+  worklist_.clear();
+  instantiatedByPre_.clear();
+  calledSlots_.assign(n, {});
+  calls_.clear();
+
+  const auto main = std::find_if(program.functions.begin(), program.functions.end(),
+                                 [](const FunctionDecl& f) { return f.name == "main"; });
+  if (main == program.functions.end()) {
+    live_.instantiated.assign(n, true);
+    live_.referenced.assign(n, true);
+    for (auto& perClass : live_.methods) perClass.assign(perClass.size(), true);
+    live_.functions.assign(program.functions.size(), true);
+    return std::move(live_);
+  }
+
+  numbering_ = numberClasses(program);
+  live_.functions[static_cast<size_t>(main - program.functions.begin())] = true;
+  scanBody(main->body);
+  while (!worklist_.empty()) {
+    const MethodRef ref = worklist_.back();
+    worklist_.pop_back();
+    scanBody(program.classes[ref.cls].methods[ref.method].body);
+  }
+  if (shrinkVtables) layoutVtables();
+  return std::move(live_);
+}
+
+/// Depth-first over the class forest; a class is visited again after its
+/// subclasses to close its range.
+ClassNumbering numberClasses(const Program& program) {
+  const auto& classes = program.classes;
+  std::vector<std::vector<ClassId>> subclasses(classes.size());
+  std::vector<std::pair<ClassId, bool>> stack;
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    if (classes[id].baseId == kInvalidIndex) stack.emplace_back(id, false);
+    else subclasses[classes[id].baseId].push_back(id);
+  }
+  ClassNumbering n;
+  n.number.assign(classes.size(), 0);
+  n.subtreeEnd.assign(classes.size(), 0);
+  n.byNumber.assign(classes.size(), kInvalidIndex);
+  uint32_t next = 0;
+  while (!stack.empty()) {
+    const auto [id, done] = stack.back();
+    stack.pop_back();
+    if (done) {
+      n.subtreeEnd[id] = next;
+      continue;
+    }
+    n.byNumber[next] = id;
+    n.number[id] = next++;
+    stack.emplace_back(id, true);
+    for (ClassId sub : subclasses[id]) stack.emplace_back(sub, false);
+  }
+  return n;
+}
+
+void ReachabilityAnalysis::instantiate(ClassId id) {
+  if (live_.instantiated[id]) return;
+  live_.instantiated[id] = true;
+  live_.referenced[id] = true;
+  instantiatedByPre_.emplace(numbering_.number[id], id);
+  // Calls already seen through this class or one of its bases now reach it
+  const auto table = info_.layouts.impl(id);
+  for (ClassId c = id; c != kInvalidIndex; c = program_->classes[c].baseId) {
+    for (uint32_t slot : calledSlots_[c]) markLive(table[slot]);
+  }
+}
+
+void ReachabilityAnalysis::call(ClassId cls, uint32_t slot) {
+  if (!calls_.insert(uint64_t{cls} << 32 | slot).second) return;
+  live_.referenced[cls] = true;
+  calledSlots_[cls].push_back(slot);
+  for (auto it = instantiatedByPre_.lower_bound(numbering_.number[cls]);
+       it != instantiatedByPre_.end() && it->first < numbering_.subtreeEnd[cls]; ++it) {
+    markLive(info_.layouts.impl(it->second)[slot]);
+  }
+}
+
+void ReachabilityAnalysis::markLive(const MethodRef& ref) {
+  std::vector<bool>::reference live = live_.methods[ref.cls][ref.method];
+  if (live) return;
+  live = true;
+  worklist_.push_back(ref);
+}
+
+void ReachabilityAnalysis::scanBody(const std::vector<std::unique_ptr<Stmt>>& body) {
+  const ReturnStmt* r = forEachStmtBeforeReturn(body, [&](const Stmt& s) {
+    if (auto* p = dynamic_cast<const PrintStmt*>(&s)) scanExpr(p->value.get());
+    else if (auto* vd = dynamic_cast<const VarDeclStmt*>(&s)) scanExpr(vd->init.get());
+  });
+  if (r) scanExpr(r->value.get());
+}
+
+void ReachabilityAnalysis::scanExpr(const Expr* e) {
+  if (auto* ne = dynamic_cast<const NewExpr*>(e)) {
+    instantiate(ne->classId);
+  } else if (auto* me = dynamic_cast<const MethodCallExpr*>(e)) {
+    // Receivers are variables, whose initializers were scanned already
+    if (me->folded) return;
+    if (me->exactClassId != kInvalidIndex) markLive(info_.layouts.impl(me->exactClassId)[me->vtableSlot]);
+    else call(me->classId, me->vtableSlot);
+  }
+}
+
+/// A slot belongs to the class that introduces it and is kept in that class
+/// and all its subclasses if a call through any of them reads it. Each class
+/// then keeps its base's slots followed by its own kept slots.
+void ReachabilityAnalysis::layoutVtables() {
+  const auto& classes = program_->classes;
+  const ClassLayoutTable& layouts = info_.layouts;
+  auto firstSlot = [&](ClassId id) {
+    const ClassId base = classes[id].baseId;
+    return base == kInvalidIndex ? 0 : layouts.numSlots(base);
+  };
+  // Per class: which of its own slots are read
+  std::vector<std::vector<bool>> read(classes.size());
+  for (ClassId cls = 0; cls < classes.size(); ++cls) {
+    for (uint32_t slot : calledSlots_[cls]) {
+      ClassId owner = cls;
+      while (slot < firstSlot(owner)) owner = classes[owner].baseId;
+      std::vector<bool>& own = read[owner];
+      if (own.empty()) own.assign(layouts.numSlots(owner) - firstSlot(owner), false);
+      own[slot - firstSlot(owner)] = true;
+    }
+  }
+
+  std::vector<ClassId> baseOf(classes.size());
+  for (ClassId id = 0; id < classes.size(); ++id) baseOf[id] = classes[id].baseId;
+  std::vector<ClassId> cycleBreaks; // none after Sema
+  live_.vtableSlots.assign(classes.size(), {});
+  for (ClassId id : inheritanceOrder(baseOf, cycleBreaks)) {
+    std::vector<uint32_t>& kept = live_.vtableSlots[id];
+    if (classes[id].baseId != kInvalidIndex) kept = live_.vtableSlots[classes[id].baseId];
+    const uint32_t first = firstSlot(id);
+    for (uint32_t i = 0; i < read[id].size(); ++i) {
+      if (read[id][i]) kept.push_back(first + i);
+    }
+  }
+}
+
+} // namespace fakelang
@@ -0,0 +1,104 @@
+// Fakelang reachability analysis: which classes, methods and vtable slots a
+// program can use, found by rapid type analysis (RTA) from `main`.
+//
+// A class is instantiated if a reachable body contains `new` of it. A virtual
+// call through static class C and slot s can reach the implementation of s in
+// every instantiated subclass of C (C included), so such a method becomes live
+// when both the call and the instantiation are reachable, in whichever order
+// the worklist finds them. Calls the partial evaluator resolved to an exact
+// class reach only that class's implementation, and folded calls reach
+// nothing. CodeGen then lowers only live methods and emits vtables only for
+// instantiated classes; optionally, vtables keep only the slots some virtual
+// call reads.
+#pragma once
+
+#include "AST.h"
+#include "Sema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+namespace fakelang {
+
+/// What a program can use at run time, as computed by ReachabilityAnalysis.
+struct LiveSet {
+  /// Per class: a reachable `new` creates objects of exactly this class.
+  std::vector<bool> instantiated;
+  /// Per class: the class or vtable type is used by live code (the class is
+  /// instantiated or is the static receiver type of a live virtual call).
+  std::vector<bool> referenced;
+  /// Per class, per method: the method can be called.
+  std::vector<std::vector<bool>> methods;
+  /// Per free function, parallel to Program::functions.
+  std::vector<bool> functions;
+  /// Shrunk vtable layouts: per class, the Sema slots its vtable keeps, in
+  /// ascending order. Empty unless the analysis was asked to shrink vtables.
+  std::vector<std::vector<uint32_t>> vtableSlots;
+
+  bool live(const MethodRef& ref) const { return methods[ref.cls][ref.method]; }
+  /// True if vtables keep only called slots; see slotIndex().
+  bool shrunk() const { return !vtableSlots.empty(); }
+  /// Index of Sema slot `slot` in the shrunk vtable of `id`. The slot must be
+  /// kept, which it is if any live virtual call reads it.
+  uint32_t slotIndex(ClassId id, uint32_t slot) const;
+  /// Number of live methods.
+  size_t numLiveMethods() const;
+};
+
+/// The classes of a program numbered depth-first over the class forest, so
+/// that the numbers of a class's subclasses directly follow its own.
+struct ClassNumbering {
+  /// Per class: its number, and one past the last number in its subtree.
+  std::vector<uint32_t> number;
+  std::vector<uint32_t> subtreeEnd;
+  /// The class with each number.
+  std::vector<ClassId> byNumber;
+};
+
+/// Number the classes of a Sema-checked `program` in preorder. Roots, and
+/// the subclasses of each class, are visited in reverse declaration order.
+ClassNumbering numberClasses(const Program& program);
+
+/// Runs rapid type analysis over a Sema-checked (and possibly partially
+/// evaluated) Program.
+class ReachabilityAnalysis {
+public:
+  /// `info` must be the result of analyzing the Program passed to run().
+  explicit ReachabilityAnalysis(const ProgramInfo& info) : info_(info) {}
+
+  /// Find everything reachable from `main`. A program without `main` has no
+  /// entry point to start from and is reported entirely live. With
+  /// `shrinkVtables`, also lay out vtables of only the slots that live virtual
+  /// calls read; a slot is kept or dropped consistently down a hierarchy, so a
+  /// call through a base class indexes every subclass's vtable alike.
+  LiveSet run(const Program& program, bool shrinkVtables = false);
+
+private:
+  void instantiate(ClassId id);
+  /// Record a virtual call through static class `cls` and slot `slot`.
+  void call(ClassId cls, uint32_t slot);
+  void markLive(const MethodRef& ref);
+  void scanBody(const std::vector<std::unique_ptr<Stmt>>& body);
+  void scanExpr(const Expr* e);
+  void layoutVtables();
+
+  const ProgramInfo& info_;
+  const Program* program_{nullptr};
+  LiveSet live_;
+  /// Live methods whose bodies are not scanned yet.
+  std::vector<MethodRef> worklist_;
+  /// Preorder numbers, by which subclasses form ranges.
+  ClassNumbering numbering_;
+  /// Instantiated classes by preorder number.
+  std::map<uint32_t, ClassId> instantiatedByPre_;
+  /// Per class: slots called virtually with it as the static receiver type.
+  std::vector<std::vector<uint32_t>> calledSlots_;
+  /// (class << 32 | slot) of every call in calledSlots_.
+  std::unordered_set<uint64_t> calls_;
+};
+
+} // namespace fakelang
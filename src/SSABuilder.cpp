@@ -0,0 +1,107 @@
+#include "SSABuilder.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+namespace fakelang {
+
+void SSABuilder::reset(uint32_t numVars) {
+  currentDef_.clear();
+  currentDef_.resize(numVars);
+  sealed_.clear();
+  incompletePhis_.clear();
+}
+
+void SSABuilder::writeVariable(uint32_t var, llvm::BasicBlock* block, llvm::Value* value) {
+  currentDef_[var][block] = value;
+}
+
+llvm::Value* SSABuilder::readVariable(uint32_t var, llvm::Type* type, llvm::BasicBlock* block) {
+  auto it = currentDef_[var].find(block);
+  if (it != currentDef_[var].end() && it->second) return it->second;
+  return readVariableRecursive(var, type, block);
+}
+
+/// Create an operandless phi at the top of `block`.
+static llvm::PHINode* newPhi(llvm::Type* type, llvm::BasicBlock* block) {
+  if (block->empty()) return llvm::PHINode::Create(type, 0, "", block);
+  return llvm::PHINode::Create(type, 0, "", &block->front());
+}
+
+llvm::Value* SSABuilder::readVariableRecursive(uint32_t var, llvm::Type* type,
+                                               llvm::BasicBlock* block) {
+  llvm::Value* val = nullptr;
+  if (!sealed_.contains(block)) {
+    // Predecessors may still be added: complete the phi in sealBlock()
+    llvm::PHINode* phi = newPhi(type, block);
+    incompletePhis_[block].emplace_back(var, phi);
+    val = phi;
+  } else if (llvm::BasicBlock* pred = block->getSinglePredecessor()) {
+    // No phi needed for a single predecessor
+    val = readVariable(var, type, pred);
+  } else if (llvm::pred_empty(block)) {
+    // Entry block without a definition: the variable is uninitialized
+    val = llvm::UndefValue::get(type);
+  } else {
+    // Break potential cycles with an operandless phi
+    llvm::PHINode* phi = newPhi(type, block);
+    writeVariable(var, block, phi);
+    val = addPhiOperands(var, phi);
+  }
+  writeVariable(var, block, val);
+  return val;
+}
+
+llvm::Value* SSABuilder::addPhiOperands(uint32_t var, llvm::PHINode* phi) {
+  llvm::BasicBlock* block = phi->getParent();
+  for (llvm::BasicBlock* pred : llvm::predecessors(block)) {
+    phi->addIncoming(readVariable(var, phi->getType(), pred), pred);
+  }
+  return tryRemoveTrivialPhi(phi);
+}
+
+/// A phi is trivial if it merges only itself and one other value; replace it
+/// by that value, then recheck the phis that used it.
+llvm::Value* SSABuilder::tryRemoveTrivialPhi(llvm::PHINode* phi) {
+  llvm::Value* same = nullptr;
+  for (llvm::Value* op : phi->incoming_values()) {
+    if (op == same || op == phi) continue;
+    if (same) return phi; // merges at least two values
+    same = op;
+  }
+  if (!same) same = llvm::UndefValue::get(phi->getType()); // unreachable or in the entry block
+
+  // Handles go null if a user is itself removed while recursing
+  llvm::SmallVector<llvm::WeakTrackingVH, 4> users;
+  for (llvm::User* u : phi->users()) {
+    if (u != phi && llvm::isa<llvm::PHINode>(u)) users.emplace_back(u);
+  }
+  phi->replaceAllUsesWith(same);
+  phi->eraseFromParent();
+  for (llvm::WeakTrackingVH& u : users) {
+    if (auto* userPhi = llvm::dyn_cast_or_null<llvm::PHINode>(u)) tryRemoveTrivialPhi(userPhi);
+  }
+  return same;
+}
+
+void SSABuilder::sealBlock(llvm::BasicBlock* block) {
+  auto it = incompletePhis_.find(block);
+  if (it != incompletePhis_.end()) {
+    // addPhiOperands may create phis in other blocks; take the list first
+    auto phis = std::move(it->second);
+    incompletePhis_.erase(it);
+    for (auto& [var, phi] : phis) addPhiOperands(var, phi);
+  }
+  sealed_.insert(block);
+}
+
+} // namespace fakelang
@@ -0,0 +1,65 @@
+// Fakelang SSA construction for local variables.
+//
+// Implements the on-the-fly algorithm of Braun et al., "Simple and Efficient
+// Construction of Static Single Assignment Form" (CC 2013). CodeGen records
+// each assignment with writeVariable() and each use with readVariable();
+// reads in blocks with several predecessors create phis, and phis that turn
+// out to merge a single value are removed again. Locals therefore never touch
+// memory, and unoptimized IR needs no mem2reg.
+//
+// Blocks must be sealed once all of their predecessors are known (their
+// terminators emitted). Straight-line code only ever uses the sealed entry
+// block, where a read is a single map lookup.
+#pragma once
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ValueHandle.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fakelang {
+
+/// Tracks the reaching definition of each variable per basic block.
+class SSABuilder {
+public:
+  /// Start a new function with variables 0..numVars-1.
+  void reset(uint32_t numVars);
+
+  /// Record that `var` holds `value` at the end of `block` so far.
+  void writeVariable(uint32_t var, llvm::BasicBlock* block, llvm::Value* value);
+  /// Return the value of `var` (of LLVM type `type`) reaching the current
+  /// end of `block`, inserting phis as needed. Reading a variable with no
+  /// reaching definition yields undef.
+  llvm::Value* readVariable(uint32_t var, llvm::Type* type, llvm::BasicBlock* block);
+  /// Declare that all predecessors of `block` are known, completing any phis
+  /// created while it was unsealed.
+  void sealBlock(llvm::BasicBlock* block);
+  bool isSealed(llvm::BasicBlock* block) const { return sealed_.contains(block); }
+
+private:
+  llvm::Value* readVariableRecursive(uint32_t var, llvm::Type* type, llvm::BasicBlock* block);
+  llvm::Value* addPhiOperands(uint32_t var, llvm::PHINode* phi);
+  llvm::Value* tryRemoveTrivialPhi(llvm::PHINode* phi);
+
+  /// Per variable: block -> current definition. Handles follow RAUW, so
+  /// definitions stay valid when a trivial phi is replaced.
+  std::vector<llvm::DenseMap<llvm::BasicBlock*, llvm::WeakTrackingVH>> currentDef_;
+  llvm::DenseSet<llvm::BasicBlock*> sealed_;
+  /// Phis created in unsealed blocks, completed by sealBlock().
+  llvm::DenseMap<llvm::BasicBlock*, std::vector<std::pair<uint32_t, llvm::PHINode*>>> incompletePhis_;
+};
+
+} // namespace fakelang
@@ -0,0 +1,308 @@
+#include "Sema.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace fakelang {
+
+void Sema::error(const SourceRange& loc, const std::string& msg) {
+  if (checking_ && checking_->imported) {
+    errors_.push_back(SemaDiagnostic{loc, false, "in imported class '" + checking_->name + "': " + msg});
+    return;
+  }
+  errors_.push_back(SemaDiagnostic{loc, true, msg});
+}
+
+ProgramInfo Sema::analyze(Program& program) {
+  ProgramInfo info;
+  const std::vector<SemaDiagnostic> errors = check(program, info);
+  if (!errors.empty()) {
+    std::string msg;
+    for (const SemaDiagnostic& e : errors) {
+      if (!msg.empty()) msg += '\n';
+      msg += filename_;
+      if (e.located) msg += ":" + std::to_string(e.loc.start.line) + ":" + std::to_string(e.loc.start.column);
+      msg += ": error: " + e.message;
+    }
+    throw std::runtime_error(msg);
+  }
+  return info;
+}
+
+/// Run all checks in dependency order: class names and bases, signatures,
+/// layouts (which need signatures for override checks), then bodies (which
+/// need layouts to resolve calls).
+std::vector<SemaDiagnostic> Sema::check(Program& program, ProgramInfo& info) {
+  std::vector<SemaDiagnostic> errors = checkDeclarations(program, info);
+  for (ClassId id = 0; id < program.classes.size(); ++id) {
+    std::vector<SemaDiagnostic> more = checkClassBodies(program, info, id);
+    errors.insert(errors.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+  }
+  for (size_t i = 0; i < program.functions.size(); ++i) {
+    std::vector<SemaDiagnostic> more = checkFunctionBody(program, info, i);
+    errors.insert(errors.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+  }
+  return errors;
+}
+
+std::vector<SemaDiagnostic> Sema::checkDeclarations(Program& program, ProgramInfo& info) {
+  program_ = &program;
+  info = ProgramInfo{};
+  info_ = &info;
+  errors_.clear();
+  checking_ = nullptr;
+
+  declareClasses();
+
+  for (auto& c : program.classes) {
+    checking_ = &c;
+    for (auto& m : c.methods) resolveType(m.returnType, m.loc);
+  }
+  checking_ = nullptr;
+  for (auto& f : program.functions) resolveType(f.returnType, f.loc);
+
+  layoutClasses();
+  checking_ = nullptr;
+
+  std::unordered_set<std::string_view> functionNames;
+  for (auto& f : program.functions) {
+    if (!functionNames.insert(f.name).second) error(f.loc, "redefinition of function '" + f.name + "'");
+  }
+  return std::move(errors_);
+}
+
+std::vector<SemaDiagnostic> Sema::checkClassBodies(Program& program, ProgramInfo& info, ClassId id) {
+  program_ = &program;
+  info_ = &info;
+  errors_.clear();
+  checking_ = nullptr;
+  for (auto& m : program.classes[id].methods) checkBody(m.body, m.returnType.resolved, m.numLocals);
+  return std::move(errors_);
+}
+
+std::vector<SemaDiagnostic> Sema::checkFunctionBody(Program& program, ProgramInfo& info, size_t index) {
+  program_ = &program;
+  info_ = &info;
+  errors_.clear();
+  checking_ = nullptr;
+  FunctionDecl& f = program.functions[index];
+  checkBody(f.body, f.returnType.resolved, f.numLocals);
+  return std::move(errors_);
+}
+
+/// Assign ClassIds and resolve base class names.
+void Sema::declareClasses() {
+  auto& classes = program_->classes;
+  info_->classIds.reserve(classes.size());
+  for (ClassId id = 0; id < classes.size(); ++id) {
+    checking_ = &classes[id];
+    if (!info_->classIds.emplace(classes[id].name, id).second) {
+      error(classes[id].loc, "redefinition of class '" + classes[id].name + "'");
+    }
+  }
+  for (auto& c : classes) {
+    checking_ = &c;
+    c.baseId = kInvalidIndex;
+    if (!c.baseName) continue;
+    auto it = info_->classIds.find(*c.baseName);
+    if (it == info_->classIds.end()) {
+      error(c.loc, "Unknown base class: " + *c.baseName);
+      continue;
+    }
+    c.baseId = it->second;
+  }
+}
+
+/// Lay out every class in base-before-derived order, so each class only
+/// appends to its finished base layout.
+void Sema::layoutClasses() {
+  auto& classes = program_->classes;
+  std::vector<ClassId> baseOf(classes.size());
+  for (ClassId id = 0; id < classes.size(); ++id) baseOf[id] = classes[id].baseId;
+  std::vector<ClassId> cycleBreaks;
+  const std::vector<ClassId> order = inheritanceOrder(baseOf, cycleBreaks);
+  for (ClassId id : cycleBreaks) {
+    checking_ = &classes[id];
+    error(classes[id].loc, "inheritance cycle involving class '" + classes[id].name + "'");
+    classes[id].baseId = kInvalidIndex;
+  }
+  info_->layouts.reset(classes.size());
+  for (ClassId id : order) layoutClass(id);
+}
+
+/// Compute the vtable layout of `id`; its base must already be laid out.
+void Sema::layoutClass(ClassId id) {
+  ClassDecl& c = program_->classes[id];
+  checking_ = &c;
+  ClassLayoutTable& layouts = info_->layouts;
+  layouts.begin(id, c.baseId);
+  std::unordered_set<std::string_view> seen;
+  for (uint32_t i = 0; i < c.methods.size(); ++i) {
+    MethodDecl& m = c.methods[i];
+    // Set only by ModuleInterface: the slot the declaring file was compiled with
+    const uint32_t recorded = m.vtableSlot;
+    m.vtableSlot = kInvalidIndex;
+    if (!seen.insert(m.name).second) {
+      error(m.loc, "redefinition of method '" + m.name + "' in class '" + c.name + "'");
+      continue;
+    }
+    // Only inherited slots can match: this class's own names are unique so far
+    const auto slot = c.baseId != kInvalidIndex ? layouts.findSlot(c.baseId, m.name) : std::nullopt;
+    if (m.attr == MethodAttr::Override) {
+      if (!slot) {
+        error(m.loc, "Method '" + m.name + "' marked override but no base method");
+        continue;
+      }
+      const MethodRef base = layouts.impl(c.baseId)[*slot];
+      const TypeRef& baseRet = program_->classes[base.cls].methods[base.method].returnType;
+      if (m.returnType.resolved != baseRet.resolved &&
+          m.returnType.resolved.kind != SemaType::Kind::Unresolved &&
+          baseRet.resolved.kind != SemaType::Kind::Unresolved) {
+        error(m.loc, "override '" + c.name + "." + m.name + "' returns " +
+                         typeName(m.returnType.resolved) + " but the overridden method returns " +
+                         typeName(baseRet.resolved));
+      }
+      m.vtableSlot = *slot;
+      layouts.overrideSlot(*slot, MethodRef{id, i});
+    } else if (m.attr == MethodAttr::Virtual) {
+      if (slot) {
+        error(m.loc, "virtual method '" + m.name + "' redeclares an inherited method; use override");
+        continue;
+      }
+      m.vtableSlot = layouts.addSlot(m.name, MethodRef{id, i});
+    }
+    // Non-virtual methods are not part of the vtable
+    if (c.imported && recorded != kInvalidIndex && m.vtableSlot != recorded) {
+      error(m.loc, "vtable slot of '" + c.name + "." + m.name + "' is " + std::to_string(m.vtableSlot) +
+                       " here but " + std::to_string(recorded) + " in its interface; rebuild the interface");
+    }
+  }
+}
+
+SemaType Sema::resolveType(TypeRef& t, const SourceRange& loc) {
+  if (t.name == "Int") t.resolved = SemaType::intTy();
+  else if (t.name == "String") t.resolved = SemaType::stringTy();
+  else if (auto it = info_->classIds.find(t.name); it != info_->classIds.end()) {
+    t.resolved = SemaType::classTy(it->second);
+  } else {
+    t.resolved = SemaType{};
+    error(loc, "Unknown type: " + t.name);
+  }
+  return t.resolved;
+}
+
+void Sema::checkBody(std::vector<std::unique_ptr<Stmt>>& body, SemaType retTy,
+                     uint32_t& numLocals) {
+  Scope scope;
+  numLocals = 0;
+  for (auto& s : body) checkStmt(s.get(), scope, retTy, numLocals);
+}
+
+void Sema::checkStmt(Stmt* s, Scope& scope, SemaType retTy, uint32_t& numLocals) {
+  const auto unresolved = SemaType::Kind::Unresolved;
+  if (auto* r = dynamic_cast<ReturnStmt*>(s)) {
+    if (!r->value) {
+      error(r->loc, "return without a value");
+      return;
+    }
+    const SemaType t = checkExpr(r->value.get(), scope);
+    if (t.kind != unresolved && retTy.kind != unresolved && !assignable(t, retTy)) {
+      error(r->loc, "cannot return " + typeName(t) + " from a function returning " + typeName(retTy));
+    }
+    return;
+  }
+  if (auto* p = dynamic_cast<PrintStmt*>(s)) {
+    const SemaType t = checkExpr(p->value.get(), scope);
+    if (t.kind != unresolved && t.kind != SemaType::Kind::String) {
+      error(p->loc, "print expects a String, got " + typeName(t));
+    }
+    return;
+  }
+  if (auto* vd = dynamic_cast<VarDeclStmt*>(s)) {
+    const SemaType declared = resolveType(vd->type, vd->loc);
+    const SemaType init = checkExpr(vd->init.get(), scope);
+    if (declared.kind != unresolved && init.kind != unresolved && !assignable(init, declared)) {
+      error(vd->loc, "cannot initialize '" + vd->name + "' of type " + typeName(declared) +
+                         " with " + typeName(init));
+    }
+    vd->slot = numLocals++;
+    if (!scope.emplace(vd->name, Local{vd->slot, declared}).second) {
+      error(vd->loc, "redeclaration of variable '" + vd->name + "'");
+    }
+    return;
+  }
+  error(s->loc, "Unhandled statement node");
+}
+
+SemaType Sema::checkExpr(Expr* e, Scope& scope) {
+  e->type = SemaType{};
+  if (dynamic_cast<StringExpr*>(e)) {
+    e->type = SemaType::stringTy();
+  } else if (dynamic_cast<IntExpr*>(e)) {
+    e->type = SemaType::intTy();
+  } else if (auto* ve = dynamic_cast<VarExpr*>(e)) {
+    auto it = scope.find(ve->name);
+    if (it == scope.end()) {
+      error(ve->loc, "Unknown variable: " + ve->name);
+    } else {
+      ve->slot = it->second.slot;
+      ve->type = it->second.type;
+    }
+  } else if (auto* ne = dynamic_cast<NewExpr*>(e)) {
+    auto it = info_->classIds.find(ne->className);
+    if (it == info_->classIds.end()) {
+      error(ne->loc, "Unknown class: " + ne->className);
+    } else {
+      ne->classId = it->second;
+      ne->type = SemaType::classTy(it->second);
+    }
+  } else if (auto* me = dynamic_cast<MethodCallExpr*>(e)) {
+    if (!dynamic_cast<VarExpr*>(me->receiver.get())) {
+      error(me->loc, "Unsupported method receiver expression");
+      return e->type;
+    }
+    const SemaType recv = checkExpr(me->receiver.get(), scope);
+    if (recv.kind == SemaType::Kind::Unresolved) return e->type;
+    if (!recv.isClass()) {
+      error(me->loc, "cannot call '" + me->methodName + "' on a value of type " + typeName(recv));
+      return e->type;
+    }
+    const auto slot = info_->layouts.findSlot(recv.classId, me->methodName);
+    if (!slot) {
+      error(me->loc, "No virtual method '" + me->methodName + "' in class '" + typeName(recv) + "'");
+      return e->type;
+    }
+    const MethodRef impl = info_->layouts.impl(recv.classId)[*slot];
+    me->classId = recv.classId;
+    me->vtableSlot = *slot;
+    me->type = program_->classes[impl.cls].methods[impl.method].returnType.resolved;
+  } else {
+    error(e->loc, "Unhandled expression node");
+  }
+  return e->type;
+}
+
+bool Sema::assignable(SemaType from, SemaType to) const {
+  if (from == to) return true;
+  if (!from.isClass() || !to.isClass()) return false;
+  // Walk the base chain; bounded by the class count in case of a broken cycle
+  ClassId c = from.classId;
+  for (size_t steps = 0; c != kInvalidIndex && steps <= program_->classes.size(); ++steps) {
+    if (c == to.classId) return true;
+    c = program_->classes[c].baseId;
+  }
+  return false;
+}
+
+std::string Sema::typeName(SemaType t) const {
+  switch (t.kind) {
+    case SemaType::Kind::Int: return "Int";
+    case SemaType::Kind::String: return "String";
+    case SemaType::Kind::Class: return program_->classes[t.classId].name;
+    case SemaType::Kind::Unresolved: break;
+  }
+  return "<unresolved>";
+}
+
+} // namespace fakelang
@@ -0,0 +1,97 @@
+// Fakelang semantic analysis: resolves names and checks types between the
+// parser and codegen.
+//
+// Sema annotates the AST in place (see the "Semantic annotations" fields in
+// AST.h): every type becomes a builtin or a ClassId, every local a dense slot
+// index, and every method call a (classId, vtable slot) pair. It also computes
+// the vtable layout of each class. All errors are collected and reported
+// together, so CodeGen can assume a well-formed program and lower it purely
+// by indexing.
+#pragma once
+
+#include "AST.h"
+#include "ClassLayout.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace fakelang {
+
+/// Whole-program results of semantic analysis. Borrows method names from the
+/// analyzed Program, which must outlive it.
+struct ProgramInfo {
+  /// Vtable layout and implementation table of each class.
+  ClassLayoutTable layouts;
+  /// Class name -> ClassId.
+  std::unordered_map<std::string, ClassId> classIds;
+};
+
+/// An error found by Sema.
+struct SemaDiagnostic {
+  /// Where the error is; meaningless when !located.
+  SourceRange loc{};
+  /// False for errors in imported classes, whose locations are in another
+  /// file. Their message names the class instead.
+  bool located{true};
+  std::string message;
+};
+
+/// Resolves and checks a parsed Program.
+class Sema {
+public:
+  /// - filename: used as the prefix of diagnostics ("file:line:col: ...")
+  explicit Sema(std::string filename = "<input>") : filename_(std::move(filename)) {}
+
+  /// Annotate `program` in place and compute class layouts. Throws
+  /// std::runtime_error listing every error found, one per line.
+  ProgramInfo analyze(Program& program);
+
+  /// Like analyze(), but return the errors instead of throwing, for tools
+  /// that show them in place. `info` is filled in even when there are errors;
+  /// names that did not resolve are left unresolved.
+  std::vector<SemaDiagnostic> check(Program& program, ProgramInfo& info);
+
+  /// check() in two parts, so that an editor can recheck only the bodies an
+  /// edit changed. checkDeclarations() resolves class names and bases, method
+  /// and function signatures, and class layouts into `info`. The body checks
+  /// then read `info`; one body's result does not depend on any other body.
+  std::vector<SemaDiagnostic> checkDeclarations(Program& program, ProgramInfo& info);
+  /// Check the method bodies of class `id`.
+  std::vector<SemaDiagnostic> checkClassBodies(Program& program, ProgramInfo& info, ClassId id);
+  /// Check the body of program.functions[index].
+  std::vector<SemaDiagnostic> checkFunctionBody(Program& program, ProgramInfo& info, size_t index);
+
+private:
+  /// Locals visible in the current body: name -> (slot, type).
+  struct Local {
+    uint32_t slot;
+    SemaType type;
+  };
+  using Scope = std::unordered_map<std::string_view, Local>;
+
+  void error(const SourceRange& loc, const std::string& msg);
+
+  void declareClasses();
+  void layoutClasses();
+  void layoutClass(ClassId id);
+  SemaType resolveType(TypeRef& t, const SourceRange& loc);
+  void checkBody(std::vector<std::unique_ptr<Stmt>>& body, SemaType retTy, uint32_t& numLocals);
+  void checkStmt(Stmt* s, Scope& scope, SemaType retTy, uint32_t& numLocals);
+  SemaType checkExpr(Expr* e, Scope& scope);
+  /// True if a value of type `from` may be used where `to` is expected.
+  bool assignable(SemaType from, SemaType to) const;
+  std::string typeName(SemaType t) const;
+
+  std::string filename_;
+  std::vector<SemaDiagnostic> errors_;
+  /// Class whose declaration is being checked, if any. Locations in an
+  /// imported class refer to another file and are not reported.
+  const ClassDecl* checking_{nullptr};
+  Program* program_{nullptr};
+  ProgramInfo* info_{nullptr};
+};
+
+} // namespace fakelang
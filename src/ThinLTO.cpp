@@ -0,0 +1,87 @@
+#include "ThinLTO.h"
+
+#include "ObjectEmitter.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/IR/Module.h>
+#include <llvm/LTO/LTO.h>
+#include <llvm/Support/Caching.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <memory>
+#include <stdexcept>
+
+namespace fakelang {
+
+std::vector<std::string> runThinLTO(const std::vector<llvm::MemoryBufferRef>& inputs, const ThinLTOOptions& opts) {
+  initializeHostTarget();
+  // Each task writes only its own entry, so the backends need no lock
+  std::vector<llvm::SmallString<0>> outputs;
+
+  llvm::lto::Config conf;
+  conf.DefaultTriple = llvm::sys::getDefaultTargetTriple();
+  conf.RelocModel = llvm::Reloc::PIC_;
+  conf.OptLevel = opts.optLevel;
+  // Every class of the program is in one of the inputs
+  conf.HasWholeProgramVisibility = true;
+  if (opts.emitIR) {
+    conf.PreCodeGenModuleHook = [&outputs](unsigned task, const llvm::Module& module) {
+      llvm::raw_svector_ostream os(outputs[task]);
+      module.print(os, nullptr);
+      return false; // stop before code generation
+    };
+  }
+  llvm::lto::LTO lto(std::move(conf),
+                     llvm::lto::createInProcessThinBackend(llvm::heavyweight_hardware_concurrency(opts.jobs)));
+
+  llvm::StringSet<> defined;
+  for (const llvm::MemoryBufferRef& input : inputs) {
+    llvm::Expected<std::unique_ptr<llvm::lto::InputFile>> file = llvm::lto::InputFile::create(input);
+    if (!file) {
+      throw std::runtime_error(input.getBufferIdentifier().str() + ": " + llvm::toString(file.takeError()));
+    }
+    std::vector<llvm::lto::SymbolResolution> resolutions;
+    for (const llvm::lto::InputFile::Symbol& sym : (*file)->symbols()) {
+      llvm::lto::SymbolResolution& res = resolutions.emplace_back();
+      // The C runtime calls main; nothing else is used outside the program
+      res.VisibleToRegularObj = sym.getName() == "main";
+      if (sym.isUndefined()) continue;
+      res.Prevailing = defined.insert(sym.getName()).second;
+      if (!res.Prevailing && !sym.isWeak()) {
+        throw std::runtime_error(input.getBufferIdentifier().str() + ": duplicate definition of '" +
+                                 sym.getName().str() + "'");
+      }
+      res.FinalDefinitionInLinkageUnit = true;
+    }
+    if (llvm::Error err = lto.add(std::move(*file), resolutions)) {
+      throw std::runtime_error(input.getBufferIdentifier().str() + ": " + llvm::toString(std::move(err)));
+    }
+  }
+
+  outputs.resize(lto.getMaxTasks());
+  auto addStream = [&outputs](unsigned task, const llvm::Twine&)
+      -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+    return std::make_unique<llvm::CachedFileStream>(std::make_unique<llvm::raw_svector_ostream>(outputs[task]));
+  };
+  if (llvm::Error err = lto.run(addStream)) throw std::runtime_error("ThinLTO: " + llvm::toString(std::move(err)));
+
+  std::vector<std::string> result;
+  for (const llvm::SmallString<0>& out : outputs) {
+    if (!out.empty()) result.emplace_back(out.str());
+  }
+  return result;
+}
+
+} // namespace fakelang
@@ -0,0 +1,49 @@
+// Fakelang ThinLTO link: optimizes and compiles the modules of a program
+// whose files were compiled separately (CompileOptions::imports, thinLTO).
+//
+// The thin link reads only the module summaries. From them it decides, for
+// the whole program, which functions each module imports from the others so
+// they can be inlined, and which virtual calls have a single possible target;
+// whole-program devirtualization finds those through the `!type` metadata
+// CodeGen puts on vtables and virtual calls. The backends then optimize and
+// compile each module in parallel, one task per module, each in its own
+// LLVMContext. Modules written without a summary are merged into one regular
+// LTO module instead.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/MemoryBufferRef.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <string>
+#include <vector>
+
+namespace fakelang {
+
+/// Options of runThinLTO().
+struct ThinLTOOptions {
+  /// Backend threads; 0 uses one per hardware core.
+  unsigned jobs{0};
+  /// Level (0-3) of the optimization pipelines run after the thin link.
+  unsigned optLevel{2};
+  /// Return each task's optimized module as textual IR instead of compiling
+  /// it to an object file.
+  bool emitIR{false};
+};
+
+/// Link the bitcode modules `inputs` as one program, like a linker with LTO:
+/// `main` is the only symbol used from outside, and the first of several
+/// linkonce_odr definitions (vtables) is kept. Returns a host object file
+/// (or IR) per backend task that produced one, to be linked with the C
+/// library. Throws std::runtime_error on unreadable input or duplicate
+/// definitions. The buffers must stay alive until it returns.
+std::vector<std::string> runThinLTO(const std::vector<llvm::MemoryBufferRef>& inputs,
+                                    const ThinLTOOptions& opts = {});
+
+} // namespace fakelang
@@ -0,0 +1,249 @@
+#include "WorkloadGen.h"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <vector>
+
+namespace fakelang {
+
+namespace {
+
+/// splitmix64: tiny, fast, and fully specified, so output does not depend on
+/// the standard library's distribution implementations.
+class Rng {
+public:
+  explicit Rng(uint64_t seed) : state_(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  /// In [0, n); n must be non-zero. The modulo bias is irrelevant here.
+  size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+  /// True with probability p.
+  bool chance(double p) {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53 < p;
+  }
+
+private:
+  uint64_t state_;
+};
+
+constexpr std::string_view kFiller =
+    "the quick brown fox jumps over the lazy dog while the compiler lexes "
+    "every byte of this comment and throws it away again ";
+
+/// Streams one program; see generateWorkload().
+class Generator {
+public:
+  Generator(const WorkloadParams& p, llvm::raw_ostream& os)
+      : p_(p), os_(os), rng_(p.seed), start_(os.tell()) {
+    // Class names are padded to a fixed width so that lexicographic order
+    // matches emission order (and thus bases sort before subclasses).
+    size_t maxIndex = p.targetBytes ? size_t{9999999999} : (p.classes ? p.classes - 1 : 0);
+    for (width_ = 1; maxIndex >= 10; maxIndex /= 10) ++width_;
+  }
+
+  void run() {
+    for (size_t i = 0; more(i); ++i) emitClass(i);
+    emitMain();
+  }
+
+private:
+  /// A class on the current inheritance path that may still get subclasses.
+  struct Open {
+    uint32_t index;
+    uint32_t depth;
+    size_t childrenLeft;
+    std::vector<uint32_t> vtable; // method ids, in slot order
+  };
+  /// What `main` needs to know about every emitted class.
+  struct ClassRef {
+    uint32_t root;
+    uint32_t method; // some method in this class's vtable (or none)
+  };
+  static constexpr uint32_t kNoMethod = ~uint32_t{0};
+
+  bool more(size_t i) const {
+    if (p_.targetBytes) return os_.tell() - start_ < p_.targetBytes;
+    return i < p_.classes;
+  }
+
+  void className(uint64_t i) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* q = end;
+    do { *--q = static_cast<char>('0' + i % 10); i /= 10; } while (i);
+    while (end - q < static_cast<ptrdiff_t>(width_)) *--q = '0';
+    os_ << 'C';
+    os_.write(q, end - q);
+  }
+
+  void comments(std::string_view indent) {
+    double d = p_.commentDensity;
+    for (; d >= 1.0; d -= 1.0) comment(indent);
+    if (d > 0 && rng_.chance(d)) comment(indent);
+  }
+  void comment(std::string_view indent) {
+    const size_t len = 8 + rng_.below(kFiller.size() - 8);
+    const size_t off = rng_.below(kFiller.size() - len + 1);
+    os_ << indent << "// " << kFiller.substr(off, len) << '\n';
+  }
+
+  /// Emit a string literal, reusing a recent one with probability stringDup.
+  void literal() {
+    uint64_t id;
+    if (recentCount_ && rng_.chance(p_.stringDup)) {
+      id = recent_[rng_.below(std::min(recentCount_, recent_.size()))];
+    } else {
+      id = nextLiteral_++;
+      recent_[recentCount_++ % recent_.size()] = id;
+    }
+    os_ << "\"str" << id << '"';
+  }
+
+  void emitClass(size_t i) {
+    while (!path_.empty() && path_.back().childrenLeft == 0) path_.pop_back();
+    Open* parent = path_.empty() ? nullptr : &path_.back();
+    const uint32_t index = static_cast<uint32_t>(i);
+    const uint32_t depth = parent ? parent->depth + 1 : 0;
+    std::vector<uint32_t> vtable = parent ? parent->vtable : std::vector<uint32_t>{};
+    const size_t inherited = vtable.size();
+    if (parent) --parent->childrenLeft;
+
+    comments("");
+    os_ << "class ";
+    className(index);
+    if (parent) {
+      os_ << " extends ";
+      className(parent->index);
+    }
+    os_ << " {\n";
+
+    overridden_.clear();
+    uint32_t callable = kNoMethod;
+    for (size_t k = 0; k < p_.methodsPerClass; ++k) {
+      uint32_t id = kNoMethod;
+      if (inherited > overridden_.size() && rng_.chance(p_.overrideRatio)) {
+        // Pick an inherited slot this class has not overridden yet.
+        size_t slot = rng_.below(inherited);
+        while (std::find(overridden_.begin(), overridden_.end(), slot) != overridden_.end()) {
+          slot = (slot + 1) % inherited;
+        }
+        overridden_.push_back(slot);
+        id = vtable[slot];
+      }
+      comments("  ");
+      if (id == kNoMethod) {
+        id = nextMethod_++;
+        vtable.push_back(id);
+        os_ << "  virtual m" << id;
+      } else {
+        os_ << "  override m" << id;
+      }
+      os_ << "(): String { return ";
+      literal();
+      os_ << "; }\n";
+      if (callable == kNoMethod || rng_.chance(0.5)) callable = id;
+    }
+    os_ << "}\n";
+
+    const uint32_t root = parent ? refs_[parent->index].root : index;
+    refs_.push_back(ClassRef{root, callable == kNoMethod && !vtable.empty() ? vtable[0] : callable});
+    if (depth + 1 < p_.depth && p_.fanOut > 0) {
+      path_.push_back(Open{index, depth, 1 + rng_.below(p_.fanOut), std::move(vtable)});
+    }
+  }
+
+  void emitMain() {
+    comments("");
+    os_ << "function main(): Int {\n";
+    size_t objects = 0;
+    for (size_t s = 0; s < p_.mainStmts;) {
+      comments("  ");
+      const ClassRef* ref = nullptr;
+      uint32_t cls = 0;
+      if (!refs_.empty()) {
+        cls = static_cast<uint32_t>(rng_.below(refs_.size()));
+        ref = &refs_[cls];
+      }
+      // Declare an object (statically typed as itself or its root) and call
+      // one of its methods; fall back to printing a literal.
+      if (ref && s + 2 <= p_.mainStmts) {
+        const bool viaRoot = rng_.chance(0.5) && refs_[ref->root].method != kNoMethod;
+        const uint32_t staticTy = viaRoot ? ref->root : cls;
+        const uint32_t method = refs_[staticTy].method;
+        if (method != kNoMethod) {
+          const size_t obj = objects++;
+          os_ << "  var o" << obj << ": ";
+          className(staticTy);
+          os_ << " = new ";
+          className(cls);
+          os_ << "();\n";
+          comments("  ");
+          os_ << "  print(o" << obj << ".m" << method << "());\n";
+          s += 2;
+          continue;
+        }
+      }
+      os_ << "  print(";
+      literal();
+      os_ << ");\n";
+      ++s;
+    }
+    os_ << "  return 0;\n}\n";
+  }
+
+  const WorkloadParams& p_;
+  llvm::raw_ostream& os_;
+  Rng rng_;
+  uint64_t start_;
+  size_t width_{1};
+  std::vector<Open> path_;       // current inheritance path (root first)
+  std::vector<ClassRef> refs_;   // one per emitted class
+  std::vector<size_t> overridden_;
+  uint32_t nextMethod_{0};
+  uint64_t nextLiteral_{0};
+  std::array<uint64_t, 64> recent_{};
+  size_t recentCount_{0};
+};
+
+} // namespace
+
+void generateWorkload(const WorkloadParams& params, llvm::raw_ostream& os) {
+  Generator(params, os).run();
+}
+
+std::string generateWorkload(const WorkloadParams& params) {
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  generateWorkload(params, os);
+  os.flush();
+  return out;
+}
+
+std::string generateDispatchWorkload(const DispatchParams& params) {
+  const size_t calls = std::max<size_t>(params.calls, 1);
+  const size_t targets = std::max<size_t>(params.targets, 1);
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  for (size_t i = 0; i < calls; ++i) {
+    const size_t group = i / targets;
+    if (i % targets == 0) os << "class G" << group << " { virtual step(): Int { return 0; } }\n";
+    os << "class C" << i << " extends G" << group << " { override step(): Int { ";
+    if (i + 1 < calls) {
+      os << "var next: G" << (i + 1) / targets << " = new C" << i + 1 << "(); return next.step();";
+    } else {
+      os << "return 1;";
+    }
+    os << " } }\n";
+  }
+  os << "function main(): Int { var first: G0 = new C0(); return first.step(); }\n";
+  os.flush();
+  return out;
+}
+
+} // namespace fakelang
@@ -0,0 +1,78 @@
+// Fakelang workload generator: deterministic synthetic programs for scaling
+// and stress tests of the lexer, parser, and codegen, and call chains for
+// measuring how fast generated code dispatches.
+#pragma once
+
+// Suppress deprecation warnings originating from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fakelang {
+
+/// Parameters of a generated program. The same parameters (including the
+/// seed) always produce byte-identical output on every platform.
+struct WorkloadParams {
+  uint64_t seed{1};
+  /// Number of classes to emit. Ignored when targetBytes is set.
+  size_t classes{100};
+  /// Keep emitting classes until the class section reaches this many bytes
+  /// (0 = use `classes`). Useful for multi-GB inputs.
+  uint64_t targetBytes{0};
+  /// Longest inheritance chain, counting the root (1 = no inheritance).
+  size_t depth{4};
+  /// Each class that may have subclasses gets between 1 and `fanOut` of them.
+  size_t fanOut{2};
+  /// Methods declared by each class.
+  size_t methodsPerClass{4};
+  /// Probability that a method of a derived class overrides an inherited
+  /// virtual method rather than introducing a new one.
+  double overrideRatio{0.5};
+  /// Statements in `main` (object declarations, virtual calls, and prints).
+  size_t mainStmts{100};
+  /// Probability that a string literal repeats a recently used literal.
+  double stringDup{0.0};
+  /// Expected number of comment lines per line of code.
+  double commentDensity{0.0};
+};
+
+/// Write a valid Fakelang program described by `params` to `os`.
+///
+/// Classes are emitted depth-first, so only the current inheritance path and
+/// eight bytes per class (for `main` to pick from) are kept in memory. Output
+/// goes straight to `os`, so give it a large buffer for big workloads. Class
+/// names are zero-padded so a base always sorts before its subclasses.
+void generateWorkload(const WorkloadParams& params, llvm::raw_ostream& os);
+
+/// Convenience wrapper returning the program as a string.
+std::string generateWorkload(const WorkloadParams& params);
+
+/// Parameters of a dispatch workload (bench/DispatchBench.cpp): `main` starts
+/// a chain of virtual calls, each made by the previous callee on an object it
+/// creates.
+struct DispatchParams {
+  /// Virtual calls one run of `main` makes.
+  size_t calls{16};
+  /// Concrete classes the static type of each receiver has: 1 (monomorphic),
+  /// 2 (bimorphic) or more (megamorphic). A Fakelang local is always created
+  /// in the body that calls it, so each call site reaches one of them at run
+  /// time; the others are what any dispatch but a direct call must allow for.
+  size_t targets{1};
+};
+
+/// The program: classes C0 ... C<calls - 1>, in consecutive groups of
+/// `targets` that extend a base G<group>. C<i>.step() creates a C<i + 1>,
+/// typed as its group's base, and returns its step(); the last returns 1, and
+/// so does `main`.
+std::string generateDispatchWorkload(const DispatchParams& params);
+
+} // namespace fakelang
@@ -0,0 +1,112 @@
+#include "Driver.h"
+#include "WorkloadGen.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace fakelang;
+
+/// Print a short usage message to stderr.
+static void usage(const char* argv0) {
+  const WorkloadParams d;
+  std::cerr << "Usage: " << argv0 << " [options] [-o <output|->]\n"
+            << "Generate a synthetic, valid Fakelang program.\n"
+            << "\n"
+            << "  --seed=N              random seed (default " << d.seed << ")\n"
+            << "  --classes=N           number of classes (default " << d.classes << ")\n"
+            << "  --size=N[K|M|G]       emit classes until the output reaches N bytes\n"
+            << "                        (overrides --classes)\n"
+            << "  --depth=N             longest inheritance chain (default " << d.depth << ")\n"
+            << "  --fanout=N            max subclasses per class (default " << d.fanOut << ")\n"
+            << "  --methods=N           methods per class (default " << d.methodsPerClass << ")\n"
+            << "  --override-ratio=P    share of derived methods that override (default "
+            << d.overrideRatio << ")\n"
+            << "  --main-stmts=N        statements in main (default " << d.mainStmts << ")\n"
+            << "  --string-dup=P        probability a literal repeats (default " << d.stringDup << ")\n"
+            << "  --comment-density=D   comment lines per code line (default "
+            << d.commentDensity << ")\n";
+}
+
+/// Parse an unsigned integer with an optional K/M/G (binary) suffix.
+static uint64_t parseCount(std::string_view s) {
+  uint64_t scale = 1;
+  if (!s.empty()) {
+    switch (s.back()) {
+      case 'K': case 'k': scale = uint64_t{1} << 10; break;
+      case 'M': case 'm': scale = uint64_t{1} << 20; break;
+      case 'G': case 'g': scale = uint64_t{1} << 30; break;
+      default: break;
+    }
+    if (scale != 1) s.remove_suffix(1);
+  }
+  size_t idx = 0;
+  const std::string str(s);
+  const unsigned long long n = std::stoull(str, &idx);
+  if (idx != str.size()) throw std::invalid_argument(str);
+  return n * scale;
+}
+
+/// Parse a probability in [0, 1] (or a non-negative density when !unit).
+static double parseFraction(std::string_view s, bool unit = true) {
+  size_t idx = 0;
+  const std::string str(s);
+  const double v = std::stod(str, &idx);
+  if (idx != str.size() || v < 0 || (unit && v > 1)) throw std::invalid_argument(str);
+  return v;
+}
+
+/// CLI entrypoint: parse the generator parameters and stream the program.
+int main(int argc, char** argv) {
+  WorkloadParams params;
+  std::string output = "-";
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    auto value = [&](std::string_view flag) -> std::optional<std::string_view> {
+      if (!arg.starts_with(flag) || arg.size() <= flag.size() || arg[flag.size()] != '=') {
+        return std::nullopt;
+      }
+      return arg.substr(flag.size() + 1);
+    };
+    try {
+      if (arg == "-o" && i + 1 < argc) output = argv[++i];
+      else if (arg == "-h" || arg == "--help") { usage(argv[0]); return 0; }
+      else if (auto v = value("--seed")) params.seed = parseCount(*v);
+      else if (auto v = value("--classes")) params.classes = parseCount(*v);
+      else if (auto v = value("--size")) params.targetBytes = parseCount(*v);
+      else if (auto v = value("--depth")) params.depth = parseCount(*v);
+      else if (auto v = value("--fanout")) params.fanOut = parseCount(*v);
+      else if (auto v = value("--methods")) params.methodsPerClass = parseCount(*v);
+      else if (auto v = value("--override-ratio")) params.overrideRatio = parseFraction(*v);
+      else if (auto v = value("--main-stmts")) params.mainStmts = parseCount(*v);
+      else if (auto v = value("--string-dup")) params.stringDup = parseFraction(*v);
+      else if (auto v = value("--comment-density")) params.commentDensity = parseFraction(*v, false);
+      else { std::cerr << "Unknown argument: " << arg << "\n"; usage(argv[0]); return 1; }
+    } catch (const std::exception&) {
+      std::cerr << "Invalid value: " << arg << "\n";
+      return 1;
+    }
+  }
+
+  std::error_code ec;
+  llvm::raw_fd_ostream os(output, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    std::cerr << "error: cannot open " << output << ": " << ec.message() << "\n";
+    return 2;
+  }
+  os.SetBufferSize(kOutputBufferSize);
+  generateWorkload(params, os);
+  os.close();
+  if (os.has_error()) {
+    std::cerr << "error: write failed: " << os.error().message() << "\n";
+    os.clear_error();
+    return 2;
+  }
+  return 0;
+}
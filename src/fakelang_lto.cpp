@@ -0,0 +1,74 @@
+#include "Driver.h"
+#include "ThinLTO.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace fakelang;
+
+/// Print a short usage message to stderr.
+static void usage(const char* argv0) {
+  std::cerr << "Usage: " << argv0 << " <input.bc>... -o <prefix> [-j <N>] [-O0|-O1|-O2|-O3] [--emit=obj|ll]\n"
+            << "Link bitcode written by `fakelangc --emit=bc --thinlto` with ThinLTO: import and\n"
+            << "devirtualize across modules, then optimize and compile the modules on N threads\n"
+            << "(default: one per core). Writes <prefix>.<task>.o (or .ll) per module; link the\n"
+            << "objects with `cc <prefix>.*.o -o <program>`.\n";
+}
+
+/// CLI entrypoint: run the thin link and the parallel backends.
+int main(int argc, char** argv) {
+  std::vector<std::string> inputs;
+  std::string prefix;
+  ThinLTOOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) { prefix = argv[++i]; }
+    else if (arg.starts_with("-j")) {
+      const std::string n(arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : ""));
+      size_t idx = 0;
+      try { opts.jobs = static_cast<unsigned>(std::stoul(n, &idx)); } catch (const std::exception&) { idx = 0; }
+      if (n.empty() || idx != n.size()) { std::cerr << "Invalid job count: " << n << "\n"; return 1; }
+    }
+    else if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' && arg[2] <= '3') { opts.optLevel = arg[2] - '0'; }
+    else if (arg == "--emit=obj") { opts.emitIR = false; }
+    else if (arg == "--emit=ll") { opts.emitIR = true; }
+    else if (arg == "-h" || arg == "--help") { usage(argv[0]); return 0; }
+    else if (!arg.empty() && arg[0] == '-') { std::cerr << "Unknown argument: " << arg << "\n"; usage(argv[0]); return 1; }
+    else { inputs.emplace_back(arg); }
+  }
+  if (inputs.empty() || prefix.empty()) { usage(argv[0]); return 1; }
+
+  try {
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> buffers;
+    std::vector<llvm::MemoryBufferRef> refs;
+    for (const std::string& in : inputs) {
+      buffers.push_back(openInput(in));
+      refs.push_back(buffers.back()->getMemBufferRef());
+    }
+    const std::vector<std::string> outputs = runThinLTO(refs, opts);
+    for (size_t task = 0; task < outputs.size(); ++task) {
+      const std::string path = prefix + "." + std::to_string(task) + (opts.emitIR ? ".ll" : ".o");
+      std::error_code ec;
+      llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+      if (ec) throw std::runtime_error("cannot open " + path + ": " + ec.message());
+      os << outputs[task];
+      os.close();
+      if (os.has_error()) {
+        std::string msg = "write failed: " + path + ": " + os.error().message();
+        os.clear_error();
+        throw std::runtime_error(msg);
+      }
+    }
+    return 0;
+  } catch (const std::exception& ex) {
+    std::cerr << "error: " << ex.what() << "\n";
+    return 2;
+  }
+}
@@ -1,78 +1,394 @@
-#include "Lexer.h"
-#include "Parser.h"
-#include "CodeGen.h"
-#include "IRAnnotator.h"
+#include "BatchCompiler.h"
+#include "CompileServer.h"
+#include "Driver.h"
+#include "HotSwap.h"
+#include "LanguageServer.h"
 
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
 
-#include <fstream>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
-#include <sstream>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace fakelang;
 
-/// Read the entire contents of `path` into a string or throw on failure.
-static std::string readFile(const std::string& path) {
-  std::ifstream in(path);
-  if (!in) throw std::runtime_error("Failed to open input file: " + path);
-  std::ostringstream ss; ss << in.rdbuf();
-  return ss.str();
-}
-
 /// Print a short usage message to stderr.
 static void usage(const char* argv0) {
-  std::cerr << "Usage: " << argv0 << " <input.fakelang> [-o <output.ll|->]\n";
+  std::cerr << "Usage: " << argv0 << " <input.fakelang> [--emit=ll|obj|bc] [-o <output|->]\n"
+            << "       " << argv0 << " <input.fakelang>... [-j <N>] [--emit=ll|obj|bc] [-o <output-dir>]\n"
+            << "       " << argv0 << " <input.fakelang> --interp|--jit\n"
+            << "       " << argv0 << " <input.fakelang> --jit --watch\n"
+            << "       " << argv0 << " --serve <socket> [-j <N>]\n"
+            << "       " << argv0 << " --connect <socket> <input.fakelang>... [--emit=ll|obj|bc] [-o <output>]\n"
+            << "       " << argv0 << " --lsp\n"
+            << "\n"
+            << "With several inputs, each <name>.fakelang is compiled to <name>.ll (or .o, .bc)\n"
+            << "next to the input, or inside <output-dir>, using N parallel workers.\n"
+            << "--serve runs a compile daemon on a Unix socket; --connect sends the\n"
+            << "inputs, with the compile options given, to that daemon instead of\n"
+            << "compiling in-process.\n"
+            << "--lsp serves the Language Server Protocol on stdin/stdout for editors.\n"
+            << "--interp runs the program in the bytecode interpreter and --jit runs it in\n"
+            << "an in-process JIT; either exits with the status main returns.\n"
+            << "--jit --watch keeps the program loaded and runs main again whenever the\n"
+            << "input changes, recompiling only the classes that changed (method bodies only).\n"
+            << "\n"
+            << "--time-phases[=json]  report wall/user/sys time per compiler phase\n"
+            << "--stats[=json]        report token, AST, class, vtable, call, and IR counts\n"
+            << "--no-fold             keep every call and print as written (no compile-time evaluation)\n"
+            << "--no-dce              also lower classes and methods unreachable from main\n"
+            << "--shrink-vtables      drop vtable slots that no reachable call reads\n"
+            << "--relative-vtables    store vtable slots as 32-bit offsets instead of pointers\n"
+            << "--class-id-dispatch[=<compare>,<switch>]\n"
+            << "                      store a class ID in objects; a virtual call with one reachable\n"
+            << "                      implementation is direct, with up to <compare> (default 2) it\n"
+            << "                      compares the class ID, up to <switch> (default 8) it switches\n"
+            << "                      on it, and with more it uses the vtable\n"
+            << "-O                    optimize the generated IR with LLVM's -O2 pipeline\n"
+            << "--compress[=zlib|zstd] with --emit=bc, write a compressed bitcode container\n"
+            << "-g                    emit DWARF debug info (line tables for debuggers and profilers)\n"
+            << "--stream              with --emit=ll or bc, lower and write a few classes at a time\n"
+            << "                      (bounded memory; bitcode holds several modules)\n"
+            << "--import <file>       use and extend the classes of another file of the program\n"
+            << "                      (repeatable; the input itself is skipped, so every file can\n"
+            << "                      share one list); link the outputs, e.g. with fakelang-lto\n"
+            << "--emit-interface      write only the input's class declarations (<name>.fli), which\n"
+            << "                      --import reads without parsing the file\n"
+            << "--thinlto             with --emit=bc, add a ThinLTO summary for fakelang-lto\n"
+            << "Reports go to stderr; with =json, one JSON object per input file.\n";
+}
+
+/// How --time-phases / --stats output is rendered.
+enum class ReportFormat { None, Text, JSON };
+
+/// Parse the optional "=text" / "=json" suffix of a report flag.
+static bool parseReportFlag(std::string_view arg, std::string_view flag, ReportFormat& fmt) {
+  if (!arg.starts_with(flag)) return false;
+  std::string_view rest = arg.substr(flag.size());
+  if (rest.empty() || rest == "=text") { if (fmt != ReportFormat::JSON) fmt = ReportFormat::Text; }
+  else if (rest == "=json") fmt = ReportFormat::JSON;
+  else return false;
+  return true;
+}
+
+/// Print the requested reports to stderr.
+static void printReports(const std::vector<CompileReport>& reports, ReportFormat fmt) {
+  for (const auto& r : reports) {
+    if (fmt == ReportFormat::JSON) printReportJSON(llvm::errs(), r);
+    else printReportText(llvm::errs(), r);
+  }
+}
+
+/// Parse a non-negative job count or throw.
+static unsigned parseJobs(const std::string& s) {
+  size_t idx = 0;
+  const unsigned long n = std::stoul(s, &idx);
+  if (idx != s.size()) throw std::invalid_argument(s);
+  return static_cast<unsigned>(n);
+}
+
+/// Parse the "<compare>,<switch>" thresholds of --class-id-dispatch=.
+static DispatchPolicy parseDispatchPolicy(const std::string& s) {
+  const size_t comma = s.find(',');
+  if (comma == std::string::npos) throw std::invalid_argument(s);
+  DispatchPolicy policy;
+  policy.maxCompare = parseJobs(s.substr(0, comma));
+  policy.maxSwitch = parseJobs(s.substr(comma + 1));
+  return policy;
+}
+
+/// Write `data` to `path`, or to stdout when `path` is empty or "-".
+static void writeOutput(const std::string& path, const std::string& data) {
+  if (path == "-" || path.empty()) {
+    llvm::outs() << data;
+    return;
+  }
+  std::error_code ec;
+  llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+  if (ec) throw std::runtime_error("Failed to open output: " + ec.message());
+  os << data;
+}
+
+/// Run `--interp` / `--jit`: execute the program and exit with main's result.
+static int runProgram(const std::string& input, RunMode mode, const CompileOptions& opts,
+                      ReportFormat reportFormat) {
+  try {
+    auto buf = openInput(input);
+    CompileReport report;
+    const int32_t result = runSource(buf->getBuffer(), input, mode, llvm::outs(), opts, &report);
+    llvm::outs().flush();
+    if (reportFormat != ReportFormat::None) printReports({report}, reportFormat);
+    return result;
+  } catch (const std::exception& ex) {
+    llvm::outs().flush();
+    std::cerr << "error: " << ex.what() << "\n";
+    return 2;
+  }
+}
+
+/// Run `--jit --watch`: run main, then wait for the input to change,
+/// hot-swap the classes that changed, and run main again, until interrupted.
+static int watchProgram(const std::string& input, bool fold) {
+  auto read = [&] { return openInput(input)->getBuffer().str(); };
+  std::optional<HotSwapSession> session;
+  try {
+    session.emplace(read(), input, fold);
+  } catch (const std::exception& ex) {
+    std::cerr << "error: " << ex.what() << "\n";
+    return 2;
+  }
+  auto run = [&] {
+    const int32_t result = session->runMain();
+    std::fflush(stdout);
+    std::cerr << "main returned " << result << "\n";
+  };
+  run();
+  std::error_code ec;
+  auto stamp = std::filesystem::last_write_time(input, ec);
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const auto now = std::filesystem::last_write_time(input, ec);
+    if (ec || now == stamp) continue;
+    stamp = now;
+    try {
+      const ReloadReport r = session->reload(read());
+      auto us = [](std::chrono::nanoseconds d) { return std::chrono::duration<double, std::micro>(d).count(); };
+      std::cerr << "reloaded " << r.classes.size() << " classes and " << r.functions.size() << " functions: "
+                << r.slotsPatched << " vtable slots and " << r.stubsPatched << " stubs patched in " << us(r.patch)
+                << " us (checked in " << us(r.analyze) << " us, compiled in " << us(r.compile) << " us)\n";
+      run();
+    } catch (const std::exception& ex) {
+      std::cerr << "error: " << ex.what() << " (still running the previous version)\n";
+    }
+  }
 }
 
-/// CLI entrypoint: lex, parse, and lower the input program to LLVM IR.
+/// The running daemon, for the SIGINT/SIGTERM handler.
+static CompileServer* g_server = nullptr;
+
+static void onStopSignal(int) {
+  if (g_server) g_server->requestStop();
+}
+
+/// Run `--serve`: block serving requests until interrupted.
+static int runServer(const std::string& socketPath, unsigned jobs) {
+  CompileServer server(socketPath, jobs);
+  g_server = &server;
+  struct sigaction sa{};
+  sa.sa_handler = onStopSignal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  try {
+    std::cerr << "fakelangc: serving on " << socketPath << "\n";
+    server.serve();
+  } catch (const std::exception& ex) {
+    g_server = nullptr;
+    std::cerr << "error: " << ex.what() << "\n";
+    return 2;
+  }
+  g_server = nullptr;
+  std::cerr << "fakelangc: server stopped (cache hits " << server.cache().hits()
+            << ", misses " << server.cache().misses() << ")\n";
+  return 0;
+}
+
+/// `path` made absolute against the current directory.
+static std::string absolutePath(const std::string& path) {
+  llvm::SmallString<256> abs(path);
+  llvm::sys::fs::make_absolute(abs);
+  return std::string(abs);
+}
+
+/// Run `--connect`: send each input to the daemon and write the replies.
+static int runClient(const std::string& socketPath, const std::vector<std::string>& inputs,
+                     const std::string& output, const CompileOptions& opts) {
+  if (inputs.size() > 1 && output == "-") {
+    std::cerr << "error: cannot write several outputs to stdout; use -o <output-dir>\n";
+    return 1;
+  }
+  // The daemon resolves paths from its own working directory.
+  CompileOptions sent = opts;
+  for (std::string& path : sent.imports) path = absolutePath(path);
+  try {
+    CompileClient client(socketPath);
+    size_t failed = 0;
+    for (const auto& input : inputs) {
+      try {
+        const std::string filename = sent.imports.empty() ? input : absolutePath(input);
+        CompileResult res = client.compile(openInput(input)->getBuffer(), filename, sent);
+        if (!res.ok) throw std::runtime_error(res.error);
+        writeOutput(inputs.size() == 1 ? output
+                                       : BatchCompiler::outputPathFor(input, output, extensionFor(opts.emit)),
+                    res.output);
+      } catch (const std::runtime_error& ex) {
+        ++failed;
+        std::cerr << "error: " << input << ": " << ex.what() << "\n";
+      }
+    }
+    return failed == 0 ? 0 : 2;
+  } catch (const std::exception& ex) {
+    std::cerr << "error: " << ex.what() << "\n";
+    return 2;
+  }
+}
+
+/// CLI entrypoint: lex, parse, and lower the input program(s) to LLVM IR, or run one.
 int main(int argc, char** argv) {
   if (argc < 2) { usage(argv[0]); return 1; }
-  std::string input = argv[1];
-  std::string output = "-"; // default to stdout
-  for (int i = 2; i < argc; ++i) {
+  if (argc == 2 && std::string_view(argv[1]) == "--lsp") return LanguageServer(std::cin, llvm::outs()).run();
+  std::vector<std::string> inputs;
+  std::string output; // empty = stdout (single input) / next to input (batch)
+  std::string serveSocket, connectSocket;
+  CompileOptions opts;
+  ReportFormat reportFormat = ReportFormat::None;
+  bool batchMode = false;
+  std::optional<RunMode> runMode;
+  bool watch = false;
+  unsigned jobs = 0;  // 0 = one worker per hardware thread
+  for (int i = 1; i < argc; ++i) {
     std::string arg = argv[i];
     if (arg == "-o" && i + 1 < argc) { output = argv[++i]; }
+    else if (arg.starts_with("-j")) {
+      std::string n = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+      try { jobs = parseJobs(n); }
+      catch (const std::exception&) { std::cerr << "Invalid job count: " << n << "\n"; return 1; }
+      batchMode = true;
+    }
+    else if (arg.starts_with("--emit=")) {
+      auto kind = parseEmitKind(std::string_view(arg).substr(7));
+      if (!kind) { std::cerr << "Unknown output kind: " << arg << "\n"; return 1; }
+      opts.emit = *kind;
+    }
+    else if (arg == "--emit-interface") { opts.emit = EmitKind::Interface; }
+    else if (parseReportFlag(arg, "--time-phases", reportFormat)) { opts.timePhases = true; }
+    else if (parseReportFlag(arg, "--stats", reportFormat)) { opts.collectStats = true; }
+    else if (arg == "--no-fold") { opts.fold = false; }
+    else if (arg == "--no-dce") { opts.dce = false; }
+    else if (arg == "--shrink-vtables") { opts.shrinkVtables = true; }
+    else if (arg == "--relative-vtables") { opts.relativeVtables = true; }
+    else if (arg == "--class-id-dispatch") { opts.classIdDispatch = DispatchPolicy{}; }
+    else if (arg.starts_with("--class-id-dispatch=")) {
+      const std::string thresholds = arg.substr(20);
+      try { opts.classIdDispatch = parseDispatchPolicy(thresholds); }
+      catch (const std::exception&) { std::cerr << "Invalid dispatch thresholds: " << thresholds << "\n"; return 1; }
+    }
+    else if (arg == "-O") { opts.optimize = true; }
+    else if (arg == "-g") { opts.debugInfo = true; }
+    else if (arg == "--stream") { opts.stream = true; }
+    else if (arg == "--import" && i + 1 < argc) { opts.imports.push_back(argv[++i]); }
+    else if (arg == "--thinlto") { opts.thinLTO = true; }
+    else if (arg == "--compress") {
+      opts.compression = defaultBitcodeCompression();
+      if (opts.compression == BitcodeCompression::None) { std::cerr << "error: LLVM was built without zlib or zstd\n"; return 1; }
+    }
+    else if (arg.starts_with("--compress=")) {
+      auto c = parseBitcodeCompression(std::string_view(arg).substr(11));
+      if (!c) { std::cerr << "Unknown compression: " << arg << "\n"; return 1; }
+      opts.compression = *c;
+    }
+    else if (arg == "--interp") { runMode = RunMode::Interp; }
+    else if (arg == "--jit") { runMode = RunMode::JIT; }
+    else if (arg == "--watch") { watch = true; }
+    else if (arg == "--serve" && i + 1 < argc) { serveSocket = argv[++i]; }
+    else if (arg == "--connect" && i + 1 < argc) { connectSocket = argv[++i]; }
     else if (arg == "-h" || arg == "--help") { usage(argv[0]); return 0; }
-    else { std::cerr << "Unknown argument: " << arg << "\n"; usage(argv[0]); return 1; }
+    else if (!arg.empty() && arg[0] == '-') { std::cerr << "Unknown argument: " << arg << "\n"; usage(argv[0]); return 1; }
+    else { inputs.push_back(std::move(arg)); }
   }
 
-  try {
-    std::string src = readFile(input);
-
-    Lexer lex(src, input);
-    auto tokens = lex.lexAll();
-
-    Parser parser(std::move(tokens));
-    Program prog = parser.parseProgram();
-
-    CodeGen cg;
-    cg.setSource(src, input);
-    cg.generate(prog, input);
-
-    auto printWithAnnotations = [&](llvm::raw_ostream& os){
-      // Section: Source (as comments)
-      os << "; === Source: " << input << " ===\n";
-      std::istringstream iss(src);
-      std::string line; size_t ln = 1;
-      while (std::getline(iss, line)) {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        os << "; " << ln++ << " | " << line << "\n";
+  if (reportFormat != ReportFormat::None && !(serveSocket.empty() && connectSocket.empty())) {
+    std::cerr << "error: --time-phases and --stats are not supported with --serve/--connect\n";
+    return 1;
+  }
+  if (opts.separateCompilation() && (runMode || opts.stream || opts.shrinkVtables || opts.classIdDispatch)) {
+    std::cerr << "error: --import and --thinlto exclude --interp, --jit, --stream, --shrink-vtables and "
+                 "--class-id-dispatch\n";
+    return 1;
+  }
+  if (opts.thinLTO && (opts.emit != EmitKind::BC || opts.compression != BitcodeCompression::None)) {
+    std::cerr << "error: --thinlto requires --emit=bc without --compress\n";
+    return 1;
+  }
+  if (opts.emit == EmitKind::Interface && (runMode || opts.stream)) {
+    std::cerr << "error: --emit-interface excludes --interp, --jit and --stream\n";
+    return 1;
+  }
+  if (opts.shrinkVtables && !opts.dce) {
+    std::cerr << "error: --shrink-vtables requires dead code elimination (drop --no-dce)\n";
+    return 1;
+  }
+  if (opts.stream && (opts.emit == EmitKind::Obj || opts.debugInfo || opts.optimize || runMode)) {
+    std::cerr << "error: --stream requires --emit=ll or --emit=bc and excludes -O, -g, --interp and --jit\n";
+    return 1;
+  }
+  if (opts.compression != BitcodeCompression::None) {
+    if (opts.emit != EmitKind::BC) {
+      std::cerr << "error: --compress requires --emit=bc\n";
+      return 1;
+    }
+    if (opts.stream) {
+      std::cerr << "error: --compress is not supported with --stream\n";
+      return 1;
+    }
+  }
+  if (runMode) {
+    if (!(serveSocket.empty() && connectSocket.empty()) || batchMode || inputs.size() != 1 || !output.empty()) {
+      std::cerr << "error: --interp and --jit take a single input and no -o, -j, --serve or --connect\n";
+      return 1;
+    }
+    if (watch) {
+      if (*runMode != RunMode::JIT || reportFormat != ReportFormat::None || !opts.dce || opts.shrinkVtables ||
+          opts.relativeVtables || opts.classIdDispatch || opts.optimize || opts.debugInfo) {
+        std::cerr << "error: --watch requires --jit and, of the other options, takes only --no-fold\n";
+        return 1;
       }
-      os << "; === LLVM Module IR ===\n";
-      fakelang::FakelangAnnotationWriter annot;
-      cg.getModule()->print(os, &annot);
-    };
-
-    if (output == "-" || output.empty()) {
-      printWithAnnotations(llvm::outs());
-    } else {
-      std::error_code ec;
-      llvm::raw_fd_ostream os(output, ec, llvm::sys::fs::OF_None);
-      if (ec) throw std::runtime_error("Failed to open output: " + ec.message());
-      printWithAnnotations(os);
+      return watchProgram(inputs.front(), opts.fold);
     }
+    return runProgram(inputs.front(), *runMode, opts, reportFormat);
+  }
+  if (watch) {
+    std::cerr << "error: --watch requires --jit\n";
+    return 1;
+  }
+  if (!serveSocket.empty()) return runServer(serveSocket, jobs);
+  if (inputs.empty()) { usage(argv[0]); return 1; }
+  if (!connectSocket.empty()) return runClient(connectSocket, inputs, output, opts);
+
+  if (batchMode || inputs.size() > 1) {
+    if (output == "-") {
+      std::cerr << "error: cannot write several outputs to stdout; use -o <output-dir>\n";
+      return 1;
+    }
+    if (!output.empty()) {
+      if (std::error_code ec = llvm::sys::fs::create_directories(output)) {
+        std::cerr << "error: cannot create output directory " << output << ": " << ec.message() << "\n";
+        return 2;
+      }
+    }
+    std::vector<BatchJob> batch;
+    batch.reserve(inputs.size());
+    for (const auto& in : inputs) {
+      batch.push_back(BatchJob{in, BatchCompiler::outputPathFor(in, output, extensionFor(opts.emit))});
+    }
+    BatchCompiler compiler(jobs, opts, llvm::errs());
+    const size_t failed = compiler.run(batch);
+    printReports(compiler.reports(), reportFormat);
+    return failed == 0 ? 0 : 2;
+  }
+
+  try {
+    CompileReport report = compileFile(inputs.front(), output, opts);
+    if (reportFormat != ReportFormat::None) printReports({report}, reportFormat);
     return 0;
   } catch (const std::exception& ex) {
     std::cerr << "error: " << ex.what() << "\n";
@@ -0,0 +1,155 @@
+#include "BitcodeEmitter.h"
+#include "Driver.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/Instructions.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace fakelang;
+
+static const char* kSource = R"(
+class Animal { virtual speak(): String { return "Animal"; } }
+class Dog extends Animal { override speak(): String { return "Woof"; } }
+function main(): Int { var d: Animal = new Dog(); print(d.speak()); return 0; }
+)";
+
+/// Load `bytes` and return the number of instructions carrying a source mapping.
+static size_t countMappedInstructions(const std::string& bytes) {
+  llvm::LLVMContext ctx;
+  auto module = loadModule(llvm::MemoryBufferRef(bytes, "t.bc"), ctx);
+  size_t mapped = 0;
+  for (const auto& f : *module) {
+    for (const auto& bb : f) {
+      for (const auto& inst : bb) mapped += inst.getMetadata("fakelang.src") != nullptr;
+    }
+  }
+  return mapped;
+}
+
+TEST(BitcodeEmitter, PlainBitcodeKeepsSourceMapping) {
+  CompileOptions opts;
+  opts.fold = false;
+  CompileResult ll = compileSource(kSource, "t.fakelang", opts);
+  opts.emit = EmitKind::BC;
+  CompileResult bc = compileSource(kSource, "t.fakelang", opts);
+  ASSERT_TRUE(ll.ok) << ll.error;
+  ASSERT_TRUE(bc.ok) << bc.error;
+  EXPECT_EQ(bc.output.substr(0, 4), "BC\xC0\xDE");
+  EXPECT_FALSE(isCompressedBitcode(bc.output));
+
+  const size_t mapped = countMappedInstructions(bc.output);
+  EXPECT_GT(mapped, 0u);
+  EXPECT_EQ(mapped, countMappedInstructions(ll.output));
+}
+
+TEST(BitcodeEmitter, CompressedContainerRoundTrips) {
+  const BitcodeCompression compression = defaultBitcodeCompression();
+  if (compression == BitcodeCompression::None) GTEST_SKIP() << "LLVM built without zlib and zstd";
+  CompileOptions opts;
+  opts.emit = EmitKind::BC;
+  CompileResult plain = compileSource(kSource, "t.fakelang", opts);
+  opts.compression = compression;
+  CompileResult packed = compileSource(kSource, "t.fakelang", opts);
+  ASSERT_TRUE(plain.ok) << plain.error;
+  ASSERT_TRUE(packed.ok) << packed.error;
+  EXPECT_TRUE(isCompressedBitcode(packed.output));
+  EXPECT_EQ(countMappedInstructions(packed.output), countMappedInstructions(plain.output));
+
+  // A damaged payload is an error, not a crash
+  std::string damaged = packed.output.substr(0, packed.output.size() / 2);
+  llvm::LLVMContext ctx;
+  EXPECT_THROW(loadModule(llvm::MemoryBufferRef(damaged, "bad.bc"), ctx), std::runtime_error);
+}
+
+TEST(BitcodeEmitter, StreamedOutputsMatchWholeModule) {
+  CompileOptions opts;
+  CompileResult whole = compileSource(kSource, "t.fakelang", opts);
+  opts.stream = true;
+  CompileResult ll = compileSource(kSource, "t.fakelang", opts);
+  opts.emit = EmitKind::BC;
+  CompileResult bc = compileSource(kSource, "t.fakelang", opts);
+  ASSERT_TRUE(whole.ok) << whole.error;
+  ASSERT_TRUE(ll.ok) << ll.error;
+  ASSERT_TRUE(bc.ok) << bc.error;
+
+  // The .ll is one module; the bitcode holds a module per part, linked on load
+  auto definitions = [](const std::string& bytes) {
+    llvm::LLVMContext ctx;
+    auto module = loadModule(llvm::MemoryBufferRef(bytes, "t"), ctx);
+    std::string names;
+    for (const auto& f : *module) {
+      if (!f.isDeclaration()) names += f.getName().str() + " ";
+    }
+    return names;
+  };
+  EXPECT_EQ(definitions(ll.output), definitions(whole.output));
+  EXPECT_EQ(definitions(bc.output), definitions(whole.output));
+  // Streamed text keeps the source mapping as comments only
+  auto comments = [](const std::string& text) {
+    size_t n = 0;
+    for (size_t pos = text.find(" ; src: "); pos != std::string::npos; pos = text.find(" ; src: ", pos + 1)) ++n;
+    return n;
+  };
+  EXPECT_EQ(comments(ll.output), comments(whole.output));
+  EXPECT_EQ(countMappedInstructions(bc.output), countMappedInstructions(whole.output));
+
+  opts.compression = BitcodeCompression::Zlib;
+  EXPECT_FALSE(compileSource(kSource, "t.fakelang", opts).ok);
+}
+
+TEST(BitcodeEmitter, StreamedClassIdDispatchIsValidIR) {
+  CompileOptions opts;
+  opts.fold = false; // keep the virtual call
+  opts.classIdDispatch = DispatchPolicy{};
+  // Both classes are live, so d.speak() compares the loaded class ID
+  const char* src = R"(
+class Animal { virtual speak(): String { return "Animal"; } }
+class Dog extends Animal { override speak(): String { return "Woof"; } }
+function main(): Int { var a: Animal = new Animal(); var d: Animal = new Dog(); print(a.speak()); print(d.speak()); return 0; }
+)";
+  CompileResult whole = compileSource(src, "t.fakelang", opts);
+  opts.stream = true;
+  CompileResult ll = compileSource(src, "t.fakelang", opts);
+  ASSERT_TRUE(whole.ok) << whole.error;
+  ASSERT_TRUE(ll.ok) << ll.error;
+  EXPECT_NE(whole.output.find("!range"), std::string::npos);
+
+  llvm::LLVMContext ctx;
+  auto module = loadModule(llvm::MemoryBufferRef(ll.output, "t.ll"), ctx);
+  EXPECT_NE(module->getFunction("main"), nullptr);
+}
+
+TEST(BitcodeEmitter, StreamedPartsEachCreateSingletons) {
+  // `new Dog()` in a method of Kennel and in main: the two parts each get a
+  // constant Dog, which the streamed text must not define twice
+  const char* src = R"(
+class Animal { virtual speak(): String { return "Animal"; } }
+class Dog extends Animal { override speak(): String { return "Woof"; } }
+class Kennel { virtual adopt(): String { var d: Animal = new Dog(); return d.speak(); } }
+function main(): Int { var k: Kennel = new Kennel(); var d: Animal = new Dog(); print(k.adopt()); print(d.speak()); return 0; }
+)";
+  CompileOptions opts;
+  opts.fold = false;
+  opts.stream = true;
+  CompileResult ll = compileSource(src, "t.fakelang", opts);
+  ASSERT_TRUE(ll.ok) << ll.error;
+  size_t copies = 0;
+  for (size_t pos = ll.output.find("\n@Dog.instance."); pos != std::string::npos;
+       pos = ll.output.find("\n@Dog.instance.", pos + 1)) {
+    ++copies;
+  }
+  EXPECT_EQ(copies, 2u) << ll.output;
+
+  llvm::LLVMContext ctx;
+  auto module = loadModule(llvm::MemoryBufferRef(ll.output, "t.ll"), ctx);
+  EXPECT_NE(module->getFunction("Kennel.adopt"), nullptr);
+}
@@ -0,0 +1,48 @@
+#include "ClassLayout.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace fakelang;
+
+TEST(ClassLayout, OrdersBasesFirstAndBreaksCycles) {
+  // 0 extends 2 extends 1; 3 and 4 extend each other.
+  const std::vector<ClassId> baseOf{2, kInvalidIndex, 1, 4, 3};
+  std::vector<ClassId> breaks;
+  const std::vector<ClassId> order = inheritanceOrder(baseOf, breaks);
+  ASSERT_EQ(order.size(), baseOf.size());
+  std::vector<size_t> pos(order.size());
+  for (size_t i = 0; i < order.size(); ++i) pos[order[i]] = i;
+  EXPECT_LT(pos[1], pos[2]);
+  EXPECT_LT(pos[2], pos[0]);
+  ASSERT_EQ(breaks.size(), 1u);
+  EXPECT_EQ(breaks[0], 3u);
+  EXPECT_LT(pos[3], pos[4]);
+}
+
+TEST(ClassLayout, SharesBasePrefixAndResolvesOverrides) {
+  // 0: virtual a, b   1 extends 0: override b, virtual c   2 extends 1: override a
+  ClassLayoutTable t;
+  t.reset(3);
+  t.begin(0, kInvalidIndex);
+  EXPECT_EQ(t.addSlot("a", {0, 0}), 0u);
+  EXPECT_EQ(t.addSlot("b", {0, 1}), 1u);
+  t.begin(1, 0);
+  ASSERT_EQ(t.findSlot(1, "b"), 1u);
+  t.overrideSlot(1, {1, 0});
+  EXPECT_EQ(t.addSlot("c", {1, 1}), 2u);
+  t.begin(2, 1);
+  t.overrideSlot(*t.findSlot(2, "a"), {2, 0});
+
+  EXPECT_EQ(t.numSlots(0), 2u);
+  EXPECT_EQ(t.numSlots(2), 3u);
+  EXPECT_EQ(t.slotName(2, 0), "a");
+  EXPECT_EQ(t.slotName(2, 2), "c");
+  EXPECT_FALSE(t.findSlot(0, "c"));
+  // Base tables are unaffected by subclass overrides.
+  EXPECT_EQ(t.impl(0)[1].cls, 0u);
+  const auto leaf = t.impl(2);
+  EXPECT_EQ(leaf[0].cls, 2u);
+  EXPECT_EQ(leaf[1].cls, 1u);
+  EXPECT_EQ(leaf[2].cls, 1u);
+}
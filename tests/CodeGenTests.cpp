@@ -1,6 +1,17 @@
 #include "Lexer.h"
 #include "Parser.h"
 #include "CodeGen.h"
+#include "Driver.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/DebugInfoMetadata.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
 
 #include <gtest/gtest.h>
 #include <string>
@@ -32,3 +43,197 @@ TEST(CodeGen, EmitsVTablesAndMethods) {
   EXPECT_NE(ir.find("declare i32 @puts"), std::string::npos);
 }
 
+// B and D override nothing, so they can use the vtables of A and C
+static const char* kFoldableSource = R"(
+  class A { virtual f(): Int { return 1; } virtual g(): Int { return 2; } }
+  class B extends A { }
+  class C extends A { override g(): Int { return 30; } }
+  class D extends C { }
+  function main(): Int {
+    var a: A = new A(); var b: A = new B(); var d: A = new D();
+    return d.g();
+  }
+)";
+
+TEST(CodeGen, ClassesWithIdenticalVtablesShareOne) {
+  Lexer lex(kFoldableSource);
+  Program prog = Parser(lex.lexAll()).parseProgram();
+  CompileStats stats;
+  CodeGen cg;
+  cg.setInstrumentation(nullptr, &stats);
+  cg.generate(prog, "fold");
+  const std::string ir = toString(cg.getModule());
+  EXPECT_NE(ir.find("@vtable.A ="), std::string::npos);
+  EXPECT_NE(ir.find("@vtable.C ="), std::string::npos);
+  EXPECT_EQ(ir.find("@vtable.B"), std::string::npos) << ir;
+  EXPECT_EQ(ir.find("@vtable.D"), std::string::npos);
+  EXPECT_EQ(stats.foldedVtables, 2u);
+}
+
+TEST(CodeGen, RelativeVtablesHoldOffsetsFromTheVtable) {
+  Lexer lex(kFoldableSource);
+  Program prog = Parser(lex.lexAll()).parseProgram();
+  CodeGen cg;
+  cg.setRelativeVtables(true);
+  cg.generate(prog, "rel");
+  const std::string ir = toString(cg.getModule());
+  EXPECT_NE(ir.find("%vtable.A = type { i32, i32 }"), std::string::npos) << ir;
+  EXPECT_NE(ir.find("sub (i64 ptrtoint (ptr @C.g to i64), i64 ptrtoint (ptr @vtable.C to i64))"), std::string::npos);
+  EXPECT_NE(ir.find("@llvm.load.relative.i32(ptr"), std::string::npos);
+  EXPECT_TRUE(cg.getModule()->getFunction("A.f")->isDSOLocal());
+
+  // D's vtable is C's, whose offsets the JIT's linker resolves
+  CompileOptions opts;
+  opts.fold = false;
+  opts.relativeVtables = true;
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  EXPECT_EQ(runSource(kFoldableSource, "rel.fakelang", RunMode::JIT, os, opts), 30);
+}
+
+TEST(CodeGen, DebugInfoGivesEveryInstructionALine) {
+  const char* src = "class Animal {\n"
+                    "  virtual speak(): String { return \"Animal\"; }\n"
+                    "}\n"
+                    "function main(): Int {\n"
+                    "  var a: Animal = new Animal();\n"
+                    "  print(a.speak());\n"
+                    "  return 0;\n"
+                    "}\n";
+  Lexer lex(src);
+  Program prog = Parser(lex.lexAll()).parseProgram();
+  CodeGen cg;
+  cg.setSource(src, "dir/dbg.fakelang");
+  cg.setDebugInfo(true);
+  cg.generate(prog, "dbg");
+
+  llvm::Module* m = cg.getModule();
+  ASSERT_NE(m->getModuleFlag("Debug Info Version"), nullptr);
+  for (const llvm::Function& f : *m) {
+    if (f.isDeclaration()) continue;
+    const llvm::DISubprogram* sp = f.getSubprogram();
+    ASSERT_NE(sp, nullptr) << f.getName().str();
+    EXPECT_EQ(sp->getFilename(), "dbg.fakelang");
+    EXPECT_EQ(sp->getDirectory(), "dir");
+    EXPECT_EQ(sp->getLine(), f.getName() == "main" ? 4u : 2u);
+    for (const llvm::BasicBlock& bb : f) {
+      for (const llvm::Instruction& inst : bb) {
+        if (llvm::isa<llvm::PHINode>(inst)) continue;
+        ASSERT_TRUE(inst.getDebugLoc()) << f.getName().str();
+        EXPECT_EQ(inst.getDebugLoc()->getScope(), sp);
+      }
+    }
+  }
+  // The print in main is on line 6
+  const llvm::Instruction* print = nullptr;
+  for (const llvm::Instruction& inst : m->getFunction("main")->getEntryBlock()) {
+    if (auto* call = llvm::dyn_cast<llvm::CallInst>(&inst); call && call->getCalledFunction() &&
+                                                             call->getCalledFunction()->getName() == "puts") {
+      print = call;
+    }
+  }
+  ASSERT_NE(print, nullptr);
+  EXPECT_EQ(print->getDebugLoc().getLine(), 6u);
+}
+
+// Through Shape, area() has three implementations (Blob inherits Shape's)
+// and name() one
+static std::string dispatchSource(const std::string& receiver) {
+  return R"(
+    class Shape { virtual area(): Int { return 1; } virtual name(): String { return "shape"; } }
+    class Square extends Shape { override area(): Int { return 4; } }
+    class Circle extends Shape { override area(): Int { return 3; } }
+    class Blob extends Shape { }
+    function main(): Int {
+      var shape: Shape = new Shape(); var square: Shape = new Square();
+      var circle: Shape = new Circle(); var blob: Shape = new Blob();
+      print()" + receiver + R"(.name());
+      return )" + receiver + R"(.area();
+    }
+  )";
+}
+
+TEST(CodeGen, ClassIdDispatchChoosesALoweringPerCall) {
+  auto lower = [](const DispatchPolicy& policy, CompileStats& stats) {
+    Program prog = Parser(Lexer(dispatchSource("circle")).lexAll()).parseProgram();
+    CodeGen cg;
+    cg.setInstrumentation(nullptr, &stats);
+    cg.setClassIdDispatch(true, policy);
+    cg.generate(prog, "dispatch");
+    return toString(cg.getModule());
+  };
+  CompileStats stats;
+  std::string ir = lower(DispatchPolicy{}, stats);
+  EXPECT_NE(ir.find("%class.Shape = type { ptr, i32 }"), std::string::npos) << ir;
+  EXPECT_NE(ir.find("%class.Circle { ptr @vtable.Circle, i32 2 }"), std::string::npos);
+  EXPECT_NE(ir.find("switch i32 %Shape.id"), std::string::npos);
+  EXPECT_NE(ir.find("call ptr @Shape.name(ptr"), std::string::npos);
+  EXPECT_EQ(stats.classIdCalls, 1u);
+  EXPECT_EQ(stats.devirtualizedCalls, 1u);
+  EXPECT_EQ(stats.virtualCalls, 0u);
+
+  // In preorder (subclasses in reverse declaration order) Shape is 0, Blob 1,
+  // Circle 2 and Square 3: the classes with Shape.area form one range, left
+  // when the compares for the others fail
+  stats = CompileStats{};
+  ir = lower(DispatchPolicy{3, 8}, stats);
+  EXPECT_EQ(ir.find("switch"), std::string::npos);
+  EXPECT_NE(ir.find("icmp eq i32 %Shape.id, 2"), std::string::npos) << ir;
+  EXPECT_NE(ir.find("icmp eq i32 %Shape.id, 3"), std::string::npos);
+  EXPECT_EQ(ir.find("icmp eq i32 %Shape.id, 0"), std::string::npos);
+  EXPECT_EQ(stats.classIdCalls, 1u);
+
+  stats = CompileStats{};
+  ir = lower(DispatchPolicy{2, 2}, stats);
+  EXPECT_EQ(ir.find("%Shape.id ="), std::string::npos);
+  EXPECT_EQ(stats.virtualCalls, 1u);
+  EXPECT_EQ(stats.devirtualizedCalls, 1u);
+}
+
+TEST(CodeGen, ClassIdDispatchCallsTheReceiversImplementation) {
+  const std::pair<const char*, int32_t> receivers[] = {{"shape", 1}, {"square", 4}, {"circle", 3}, {"blob", 1}};
+  for (const DispatchPolicy policy : {DispatchPolicy{3, 8}, DispatchPolicy{0, 8}, DispatchPolicy{}}) {
+    for (const auto& [receiver, area] : receivers) {
+      CompileOptions opts;
+      opts.fold = false;
+      opts.classIdDispatch = policy;
+      std::string out;
+      llvm::raw_string_ostream os(out);
+      EXPECT_EQ(runSource(dispatchSource(receiver), "dispatch.fakelang", RunMode::JIT, os, opts), area)
+          << receiver << " with " << policy.maxCompare << "," << policy.maxSwitch;
+    }
+  }
+
+  // Another module could add subclasses
+  CompileOptions opts;
+  opts.classIdDispatch = DispatchPolicy{};
+  opts.thinLTO = true;
+  opts.emit = EmitKind::BC;
+  const CompileResult res = compileSource(dispatchSource("blob"), "dispatch.fakelang", opts);
+  EXPECT_FALSE(res.ok);
+  EXPECT_NE(res.error.find("whole program"), std::string::npos) << res.error;
+}
+
+TEST(CodeGen, NewOfAStatelessClassYieldsOneConstantObject) {
+  const char* src = R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    class Dog extends Animal { override speak(): String { return "Woof"; } }
+    function main(): Int { var a: Animal = new Dog(); var b: Animal = new Dog(); print(a.speak()); print(b.speak()); return 0; }
+  )";
+  Program prog = Parser(Lexer(src).lexAll()).parseProgram();
+  CodeGen cg;
+  cg.generate(prog, "singletons");
+  const std::string ir = toString(cg.getModule());
+  EXPECT_NE(ir.find("@Dog.instance = private unnamed_addr constant %class.Dog { ptr @vtable.Dog }"), std::string::npos)
+      << ir;
+  EXPECT_EQ(ir.find("@Animal.instance"), std::string::npos);
+  EXPECT_EQ(ir.find("alloca"), std::string::npos);
+  EXPECT_EQ(ir.find("store"), std::string::npos);
+
+  // With class IDs the object holds its class's ID, so the constant has one
+  prog = Parser(Lexer(src).lexAll()).parseProgram();
+  CodeGen withIds;
+  withIds.setClassIdDispatch(true);
+  withIds.generate(prog, "singletons");
+  EXPECT_NE(toString(withIds.getModule()).find("constant %class.Dog { ptr @vtable.Dog, i32 1 }"), std::string::npos);
+}
@@ -0,0 +1,151 @@
+#include "CompileServer.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace fakelang;
+
+/// Connect to `path`, retrying while the server thread is still binding.
+static std::unique_ptr<CompileClient> connectWithRetry(const std::string& path) {
+  for (int attempt = 0;; ++attempt) {
+    try {
+      return std::make_unique<CompileClient>(path);
+    } catch (const std::runtime_error&) {
+      if (attempt > 200) throw;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+TEST(CompileServer, ServesConcurrentClientsAndCachesResults) {
+  llvm::SmallString<128> sock;
+  llvm::sys::fs::createUniquePath("fakelang-%%%%%%.sock", sock, /*MakeAbsolute=*/true);
+
+  CompileServer server(std::string(sock), /*jobs=*/2);
+  std::thread serving([&] { server.serve(); });
+
+  const char* src = R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    function main(): Int { var a: Animal = new Animal(); print(a.speak()); return 0; }
+  )";
+  auto c1 = connectWithRetry(std::string(sock));
+  auto c2 = connectWithRetry(std::string(sock));
+
+  CompileResult r1 = c1->compile(src, "a.fakelang");
+  ASSERT_TRUE(r1.ok) << r1.error;
+  EXPECT_NE(r1.output.find("@vtable.Animal"), std::string::npos);
+
+  // The same request on another connection is answered from the cache.
+  CompileResult r2 = c2->compile(src, "a.fakelang");
+  ASSERT_TRUE(r2.ok);
+  EXPECT_EQ(r1.output, r2.output);
+  EXPECT_GE(server.cache().hits(), 1u);
+
+  // Diagnostics come back as failed results on a still-usable connection.
+  CompileResult bad = c1->compile("class {", "bad.fakelang");
+  EXPECT_FALSE(bad.ok);
+  EXPECT_FALSE(bad.error.empty());
+  EXPECT_TRUE(c1->compile(src, "b.fakelang").ok);
+
+  server.requestStop();
+  serving.join();
+  EXPECT_FALSE(llvm::sys::fs::exists(sock));
+}
+
+TEST(CompileServer, CompilesWithTheOptionsOfEachRequest) {
+  llvm::SmallString<128> sock;
+  llvm::sys::fs::createUniquePath("fakelang-%%%%%%.sock", sock, /*MakeAbsolute=*/true);
+
+  CompileServer server(std::string(sock), /*jobs=*/1);
+  std::thread serving([&] { server.serve(); });
+
+  const char* src = R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    class Dog extends Animal { override speak(): String { return "Woof"; } }
+    function main(): Int { var a: Animal = new Dog(); print(a.speak()); return 0; }
+  )";
+  auto client = connectWithRetry(std::string(sock));
+
+  CompileResult plain = client->compile(src, "a.fakelang");
+  ASSERT_TRUE(plain.ok) << plain.error;
+  EXPECT_EQ(plain.output.find("llvm.load.relative"), std::string::npos);
+
+  CompileOptions opts;
+  opts.fold = false; // keep the virtual call
+  opts.relativeVtables = true;
+  CompileResult relative = client->compile(src, "a.fakelang", opts);
+  ASSERT_TRUE(relative.ok) << relative.error;
+  EXPECT_NE(relative.output.find("llvm.load.relative"), std::string::npos);
+  // Different options are different cache entries.
+  EXPECT_EQ(server.cache().hits(), 0u);
+
+  // Options the driver rejects come back as diagnostics.
+  opts.stream = true;
+  opts.debugInfo = true;
+  EXPECT_FALSE(client->compile(src, "a.fakelang", opts).ok);
+
+  server.requestStop();
+  serving.join();
+}
+
+/// Connect a raw socket to `path` and send `bytes`; returns the fd.
+static int sendRaw(const std::string& path, const std::string& bytes) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  EXPECT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)), 0);
+  EXPECT_EQ(::send(fd, bytes.data(), bytes.size(), 0), static_cast<ssize_t>(bytes.size()));
+  return fd;
+}
+
+/// A request header declaring the given part lengths.
+static std::string header(uint32_t optsLen, uint32_t nameLen, uint64_t srcLen) {
+  std::string h = "FLQ2";
+  for (int i = 0; i < 4; ++i) h.push_back(static_cast<char>(optsLen >> (8 * i)));
+  for (int i = 0; i < 4; ++i) h.push_back(static_cast<char>(nameLen >> (8 * i)));
+  for (int i = 0; i < 8; ++i) h.push_back(static_cast<char>(srcLen >> (8 * i)));
+  return h;
+}
+
+TEST(CompileServer, SurvivesOversizedAndTruncatedRequests) {
+  llvm::SmallString<128> sock;
+  llvm::sys::fs::createUniquePath("fakelang-%%%%%%.sock", sock, /*MakeAbsolute=*/true);
+
+  CompileServer server(std::string(sock), /*jobs=*/1);
+  std::thread serving([&] { server.serve(); });
+  auto client = connectWithRetry(std::string(sock));
+
+  // A source declared far over the limit is refused with status 1
+  int fd = sendRaw(std::string(sock), header(0, 1, uint64_t{4} << 30));
+  char reply[16];
+  ASSERT_EQ(::recv(fd, reply, sizeof(reply), MSG_WAITALL), 16);
+  EXPECT_EQ(std::string(reply, 4), "FLR1");
+  EXPECT_EQ(reply[4], 1);
+  ::close(fd);
+
+  // One declaring a large source and then hanging up costs only what it sent
+  ::close(sendRaw(std::string(sock), header(0, 1, uint64_t{200} << 20) + "a" + "class"));
+
+  // Options that do not decode are a failed result, not a dropped connection
+  CompileResult ok = client->compile("function main(): Int { return 0; }", "a.fakelang");
+  EXPECT_TRUE(ok.ok) << ok.error;
+  fd = sendRaw(std::string(sock), header(3, 1, 0) + "xyz" + "a");
+  ASSERT_EQ(::recv(fd, reply, sizeof(reply), MSG_WAITALL), 16);
+  EXPECT_EQ(reply[4], 1);
+  ::close(fd);
+  EXPECT_TRUE(client->compile("function main(): Int { return 0; }", "b.fakelang").ok);
+
+  server.requestStop();
+  serving.join();
+}
@@ -0,0 +1,106 @@
+#include "CompileStats.h"
+#include "Driver.h"
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <gtest/gtest.h>
+#include <new>
+#include <string>
+
+using namespace fakelang;
+
+static const char* kSrc = R"(
+  class Animal { virtual speak(): String { return "Animal"; } }
+  class Dog extends Animal { override speak(): String { return "Woof"; } }
+  function main(): Int {
+    var a: Animal = new Dog();
+    print(a.speak());
+    print(a.speak());
+    return 0;
+  }
+)";
+
+TEST(CompileStats, CountsAndTimesEachPhase) {
+  CompileOptions opts;
+  opts.timePhases = true;
+  opts.collectStats = true;
+  CompileResult res = compileSource(kSrc, "stats.fakelang", opts);
+  ASSERT_TRUE(res.ok) << res.error;
+
+  ASSERT_TRUE(res.report.stats);
+  const CompileStats& s = *res.report.stats;
+  EXPECT_GT(s.tokens, 0u);
+  EXPECT_GT(s.astNodes, 0u);
+  EXPECT_EQ(s.classes, 2u);
+  EXPECT_EQ(s.vtableSlots, 2u);
+  // `a` is known to be a Dog, so both calls fold to "Woof".
+  EXPECT_EQ(s.virtualCalls, 0u);
+  EXPECT_EQ(s.foldedCalls, 2u);
+  EXPECT_GT(s.irInstructions, 0u);
+
+  std::vector<std::string> names;
+  for (const auto& p : res.report.phases) names.push_back(p.name);
+  const std::vector<std::string> expected{"lex", "parse", "sema", "fold", "dce", "infer-attributes", "declare-types",
+                                          "define-methods", "emit-vtables",
+                                          "define-functions", "verify", "print"};
+  EXPECT_EQ(names, expected);
+}
+
+TEST(CompileStats, JSONReportIsOneLinePerFile) {
+  CompileOptions opts;
+  opts.collectStats = true;
+  opts.fold = false;
+  CompileResult res = compileSource(kSrc, "stats.fakelang", opts);
+  ASSERT_TRUE(res.ok) << res.error;
+  EXPECT_TRUE(res.report.phases.empty());
+
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  printReportJSON(os, res.report);
+  os.flush();
+  EXPECT_EQ(out.find('\n'), out.size() - 1);
+  EXPECT_NE(out.find("\"file\":\"stats.fakelang\""), std::string::npos);
+  EXPECT_NE(out.find("\"virtualCalls\":2"), std::string::npos);
+  EXPECT_EQ(out.find("\"phases\""), std::string::npos);
+}
+
+TEST(CompileStats, CountsAllocationsPerPhase) {
+  if (!kAllocProfiling) GTEST_SKIP() << "built without FAKELANG_ALLOC_PROFILE";
+  PhaseTimers timers;
+  // Create both phases first, so that doing so is not counted
+  { PhaseTimers::Scope s(&timers, "outer"); }
+  { PhaseTimers::Scope s(&timers, "inner"); }
+  {
+    // Calls the optimizer cannot drop, unlike unused new-expressions
+    static void* volatile sink;
+    auto allocate = [](size_t n) {
+      void* p = ::operator new(n);
+      sink = p;
+      return p;
+    };
+    PhaseTimers::Scope outer(&timers, "outer");
+    void* kept = allocate(1000);
+    {
+      PhaseTimers::Scope inner(&timers, "inner");
+      ::operator delete(allocate(5000));
+      ::operator delete(allocate(100));
+    }
+    ::operator delete(kept);
+  }
+  const std::vector<PhaseTime> phases = timers.results();
+  ASSERT_EQ(phases.size(), 2u);
+  EXPECT_EQ(phases[0].allocs.allocations, 1u);
+  EXPECT_EQ(phases[0].allocs.bytes, 1000u);
+  EXPECT_EQ(phases[0].allocs.peakLiveBytes, 6000u); // including the inner phase
+  EXPECT_EQ(phases[1].allocs.allocations, 2u);
+  EXPECT_EQ(phases[1].allocs.bytes, 5100u);
+  EXPECT_EQ(phases[1].allocs.peakLiveBytes, 5000u);
+
+  CompileOptions opts;
+  opts.timePhases = true;
+  CompileResult res = compileSource(kSrc, "stats.fakelang", opts);
+  ASSERT_TRUE(res.ok) << res.error;
+  for (const auto& p : res.report.phases) {
+    if (p.name == "parse") EXPECT_GT(p.allocs.allocations, 0u);
+  }
+}
@@ -0,0 +1,101 @@
+#include "BatchCompiler.h"
+#include "Driver.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace fakelang;
+
+static const char* kGoodSrc = R"(
+  class Animal { virtual speak(): String { return "Animal"; } }
+  function main(): Int { var a: Animal = new Animal(); print(a.speak()); return 0; }
+)";
+
+TEST(Driver, CompileSourceReportsErrorsWithoutThrowing) {
+  CompileResult ok = compileSource(kGoodSrc, "good.fakelang");
+  ASSERT_TRUE(ok.ok) << ok.error;
+  EXPECT_NE(ok.output.find("; === Source: good.fakelang ==="), std::string::npos);
+  EXPECT_NE(ok.output.find("@vtable.Animal"), std::string::npos);
+
+  CompileResult bad = compileSource("class {", "bad.fakelang");
+  EXPECT_FALSE(bad.ok);
+  EXPECT_TRUE(bad.output.empty());
+  EXPECT_FALSE(bad.error.empty());
+}
+
+TEST(Driver, BatchContinuesPastFailingInputs) {
+  llvm::SmallString<128> dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("fakelang-batch", dir));
+  auto write = [&](const char* name, const char* text) {
+    llvm::SmallString<128> p(dir);
+    llvm::sys::path::append(p, name);
+    std::error_code ec;
+    llvm::raw_fd_ostream os(p, ec);
+    os << text;
+    return std::string(p.str());
+  };
+
+  std::vector<BatchJob> batch;
+  for (const char* name : {"a.fakelang", "bad.fakelang", "b.fakelang"}) {
+    std::string in = write(name, std::string(name) == "bad.fakelang" ? "class {" : kGoodSrc);
+    batch.push_back(BatchJob{in, BatchCompiler::outputPathFor(in, "")});
+  }
+  batch.push_back(BatchJob{std::string(dir) + "/missing.fakelang", std::string(dir) + "/missing.ll"});
+
+  std::string diag;
+  llvm::raw_string_ostream ds(diag);
+  BatchCompiler compiler(2, CompileOptions{}, ds);
+  EXPECT_EQ(compiler.run(batch), 2u);
+  ds.flush();
+  EXPECT_NE(diag.find("bad.fakelang"), std::string::npos);
+  EXPECT_NE(diag.find("missing.fakelang"), std::string::npos);
+  EXPECT_TRUE(llvm::sys::fs::exists(batch[0].output));
+  EXPECT_TRUE(llvm::sys::fs::exists(batch[2].output));
+  EXPECT_FALSE(llvm::sys::fs::exists(batch[1].output));
+
+  llvm::sys::fs::remove_directories(dir);
+}
+
+TEST(Driver, BatchRejectsInputsThatShareAnOutput) {
+  llvm::SmallString<128> dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("fakelang-batch", dir));
+  auto write = [&](const char* sub, const char* name) {
+    llvm::SmallString<128> p(dir);
+    llvm::sys::path::append(p, sub);
+    llvm::sys::fs::create_directories(p);
+    llvm::sys::path::append(p, name);
+    std::error_code ec;
+    llvm::raw_fd_ostream os(p, ec);
+    os << kGoodSrc;
+    return std::string(p.str());
+  };
+  llvm::SmallString<128> out(dir);
+  llvm::sys::path::append(out, "out");
+  llvm::sys::fs::create_directories(out);
+
+  std::vector<BatchJob> batch;
+  for (const auto& [sub, name] : {std::pair{"a", "main.fakelang"}, {"b", "main.fakelang"}, {"a", "other.fakelang"}}) {
+    const std::string in = write(sub, name);
+    batch.push_back(BatchJob{in, BatchCompiler::outputPathFor(in, std::string(out))});
+  }
+  ASSERT_EQ(batch[0].output, batch[1].output);
+
+  std::string diag;
+  llvm::raw_string_ostream ds(diag);
+  BatchCompiler compiler(2, CompileOptions{}, ds);
+  EXPECT_EQ(compiler.run(batch), 2u);
+  ds.flush();
+  EXPECT_NE(diag.find(batch[0].input + ": output " + batch[0].output + " is also the output of " + batch[1].input),
+            std::string::npos)
+      << diag;
+  EXPECT_NE(diag.find(batch[1].input + ": output"), std::string::npos);
+  EXPECT_FALSE(llvm::sys::fs::exists(batch[0].output));
+  EXPECT_TRUE(llvm::sys::fs::exists(batch[2].output));
+
+  llvm::sys::fs::remove_directories(dir);
+}
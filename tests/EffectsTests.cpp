@@ -0,0 +1,124 @@
+#include "CodeGen.h"
+#include "Effects.h"
+#include "Optimizer.h"
+#include "Sema.h"
+#include "TestUtil.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace fakelang;
+
+// A.name and B.name only return; A.loud prints; A.spin may recurse forever;
+// A.ask only makes a virtual call that reaches A.name or B.name.
+static const char* kSource = R"(
+  class A {
+    virtual name(): String { return "A"; }
+    virtual loud(): String { print("!"); return "L"; }
+    virtual spin(): String { var a: A = new A(); return a.spin(); }
+    virtual ask(): String { var a: A = new B(); return a.name(); }
+  }
+  class B extends A { override name(): String { return "B"; } }
+  function main(): Int {
+    var a: A = new B();
+    print(a.name()); print(a.loud()); print(a.spin()); print(a.ask());
+    return 0;
+  }
+)";
+
+TEST(Effects, JoinsCalleesAndRejectsRecursion) {
+  Program prog = parse(kSource);
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const EffectAnalysis effects(prog, info);
+
+  auto check = [&](const Effects& e, MemoryEffect memory, bool willReturn) {
+    EXPECT_EQ(e.memory, memory);
+    EXPECT_EQ(e.willReturn, willReturn);
+  };
+  check(effects.method(MethodRef{0, 0}), MemoryEffect::None, true);
+  check(effects.method(MethodRef{0, 1}), MemoryEffect::Any, false);
+  check(effects.method(MethodRef{0, 2}), MemoryEffect::Read, false);
+  check(effects.method(MethodRef{0, 3}), MemoryEffect::Read, true);
+  check(effects.method(MethodRef{1, 0}), MemoryEffect::None, true);
+  check(effects.virtualCall(0, 0), MemoryEffect::None, true);
+  check(effects.virtualCall(0, 2), MemoryEffect::Read, false);
+  check(effects.function(0), MemoryEffect::Any, false);
+}
+
+TEST(Effects, CodeGenAddsFunctionAndCallSiteAttributes) {
+  Program prog = parse(kSource);
+  CodeGen cg;
+  cg.generate(prog, "t");
+  llvm::Module& m = *cg.getModule();
+
+  llvm::Function* name = m.getFunction("A.name");
+  ASSERT_NE(name, nullptr);
+  EXPECT_TRUE(name->doesNotAccessMemory());
+  EXPECT_TRUE(name->willReturn());
+  EXPECT_TRUE(name->hasParamAttribute(0, llvm::Attribute::NoAlias));
+  EXPECT_TRUE(name->hasParamAttribute(0, llvm::Attribute::NonNull));
+  EXPECT_TRUE(m.getFunction("A.ask")->onlyReadsMemory());
+  EXPECT_FALSE(m.getFunction("A.spin")->willReturn());
+  EXPECT_FALSE(m.getFunction("A.loud")->onlyReadsMemory());
+  for (const llvm::Function& f : m) EXPECT_TRUE(f.doesNotThrow()) << f.getName().str();
+
+  // Indirect calls carry the effects of every possible target
+  size_t pureCalls = 0;
+  for (const llvm::Instruction& inst : llvm::instructions(*m.getFunction("main"))) {
+    auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+    if (call && call->isIndirectCall() && call->doesNotAccessMemory() && call->hasFnAttr(llvm::Attribute::WillReturn)) {
+      ++pureCalls;
+    }
+  }
+  EXPECT_EQ(pureCalls, 1u); // a.name()
+}
+
+TEST(Effects, OptimizerMergesCallsItCannotSee) {
+  const char* src = R"(
+    class A { virtual name(): String { return "A"; } virtual loud(): String { print("!"); return "L"; } }
+    function main(): Int {
+      var a: A = new A();
+      print(a.name()); print(a.name());
+      print(a.loud()); print(a.loud());
+      return 0;
+    }
+  )";
+  // Methods become declarations, as if defined in another module, so only
+  // their attributes tell the optimizer what calling them does
+  auto callsAfterOptimizing = [&](bool keepAttributes) {
+    Program prog = parse(src);
+    CodeGen cg;
+    cg.generate(prog, "t");
+    llvm::Module& m = *cg.getModule();
+    for (llvm::Function& f : m) {
+      if (f.getName().startswith("A.")) f.deleteBody();
+      if (keepAttributes) continue;
+      f.setAttributes({});
+      for (llvm::Instruction& inst : llvm::instructions(f)) {
+        if (auto* call = llvm::dyn_cast<llvm::CallBase>(&inst)) call->setAttributes({});
+      }
+    }
+    optimizeModule(m);
+    size_t calls = 0;
+    for (const llvm::Instruction& inst : llvm::instructions(*m.getFunction("main"))) {
+      auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+      if (call && call->getCalledOperand() != m.getFunction("puts")) ++calls;
+    }
+    return calls;
+  };
+  // name() touches no memory, so the print between its calls cannot change
+  // its result; loud() prints, so both of its calls must stay
+  EXPECT_EQ(callsAfterOptimizing(true), 3u);
+  EXPECT_EQ(callsAfterOptimizing(false), 4u);
+}
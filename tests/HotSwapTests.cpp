@@ -0,0 +1,98 @@
+#include "HotSwap.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace fakelang;
+
+static const char* kShapes = R"(class Shape { virtual area(): Int { return 1; } }
+class Square extends Shape { override area(): Int { return 4; } }
+class Blob extends Shape { }
+function main(): Int { var s: Shape = new Square(); return s.area(); }
+)";
+
+/// `text` with its first `from` replaced by `to`.
+static std::string replaced(std::string text, const std::string& from, const std::string& to) {
+  const size_t at = text.find(from);
+  EXPECT_NE(at, std::string::npos) << from;
+  return text.replace(at, from.size(), to);
+}
+
+TEST(HotSwap, RedirectsDirectCallsThroughStubs) {
+  // The receiver's class is known, so the call is direct
+  HotSwapSession session(kShapes);
+  EXPECT_EQ(session.runMain(), 4);
+  const ReloadReport r = session.reload(replaced(kShapes, "return 4;", "return 40;"));
+  EXPECT_EQ(r.classes, std::vector<std::string>{"Square"});
+  EXPECT_TRUE(r.functions.empty());
+  EXPECT_EQ(r.stubsPatched, 1u);
+  EXPECT_EQ(session.runMain(), 40);
+
+  // Changing main itself swaps in a new main
+  const ReloadReport m = session.reload(replaced(session.source(), "new Square()", "new Blob()"));
+  EXPECT_TRUE(m.classes.empty());
+  EXPECT_EQ(m.functions, std::vector<std::string>{"main"});
+  EXPECT_EQ(session.runMain(), 1);
+}
+
+TEST(HotSwap, PatchesTheVtableSlotsOfAChangedClass) {
+  // Without folding every call is virtual
+  HotSwapSession session(kShapes, "shapes.fakelang", /*fold=*/false);
+  EXPECT_EQ(session.runMain(), 4);
+  ReloadReport r = session.reload(replaced(kShapes, "return 4;", "return 40;"));
+  EXPECT_EQ(r.slotsPatched, 1u);
+  EXPECT_EQ(session.runMain(), 40);
+
+  // Shape's method is also Blob's, but not Square's
+  std::string text = replaced(session.source(), "return 1;", "return 10;");
+  r = session.reload(replaced(text, "new Square()", "new Blob()"));
+  EXPECT_EQ(r.classes, std::vector<std::string>{"Shape"});
+  EXPECT_EQ(r.functions, std::vector<std::string>{"main"});
+  EXPECT_EQ(r.slotsPatched, 2u);
+  EXPECT_EQ(r.stubsPatched, 1u);
+  EXPECT_EQ(session.runMain(), 10);
+}
+
+TEST(HotSwap, KeepsRunningTheOldVersionWhenAReloadFails) {
+  HotSwapSession session(kShapes);
+  EXPECT_THROW(session.reload(replaced(kShapes, "area(): Int { return 4; }", "area(): String { return \"4\"; }")),
+               std::runtime_error);
+  EXPECT_THROW(session.reload(replaced(kShapes, "class Blob extends Shape { }", "")), std::runtime_error);
+  EXPECT_THROW(session.reload(replaced(kShapes, "return 4;", "return nothing;")), std::runtime_error);
+  EXPECT_EQ(session.runMain(), 4);
+  EXPECT_EQ(session.source(), kShapes);
+
+  // Moving declarations around without changing them recompiles nothing
+  const ReloadReport r = session.reload("\n\n" + std::string(kShapes));
+  EXPECT_TRUE(r.classes.empty());
+  EXPECT_TRUE(r.functions.empty());
+  EXPECT_EQ(r.slotsPatched + r.stubsPatched, 0u);
+  EXPECT_EQ(session.runMain(), 4);
+}
+
+TEST(HotSwap, CallsRunningDuringAReloadSeeTheOldOrTheNewMethod) {
+  HotSwapSession session(kShapes, "shapes.fakelang", /*fold=*/false);
+  std::atomic<bool> done{false};
+  std::atomic<int> unexpected{0};
+  std::thread caller([&] {
+    while (!done.load()) {
+      const int32_t v = session.runMain();
+      if (v != 4 && v != 5 && v != 6) unexpected.fetch_add(1);
+    }
+  });
+  std::string text = kShapes;
+  int32_t current = 4;
+  for (int i = 0; i < 30; ++i) {
+    const int32_t next = 4 + (current - 3) % 3;
+    text = replaced(text, "return " + std::to_string(current) + ";", "return " + std::to_string(next) + ";");
+    session.reload(text);
+    current = next;
+  }
+  done = true;
+  caller.join();
+  EXPECT_EQ(unexpected.load(), 0);
+  EXPECT_EQ(session.runMain(), current);
+}
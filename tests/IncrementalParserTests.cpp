@@ -0,0 +1,162 @@
+#include "IncrementalParser.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "WorkloadGen.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using namespace fakelang;
+
+static std::string where(const SourceRange& r) {
+  return std::to_string(r.start.line) + ":" + std::to_string(r.start.column) + "-" + std::to_string(r.end.line) +
+         ":" + std::to_string(r.end.column);
+}
+
+static std::string dumpBody(const std::vector<std::unique_ptr<Stmt>>& body) {
+  std::string out;
+  for (const auto& s : body) {
+    out += " " + where(s->loc);
+    const Expr* e = nullptr;
+    if (auto* r = dynamic_cast<const ReturnStmt*>(s.get())) e = r->value.get();
+    else if (auto* p = dynamic_cast<const PrintStmt*>(s.get())) e = p->value.get();
+    else if (auto* v = dynamic_cast<const VarDeclStmt*>(s.get())) e = v->init.get();
+    if (e) out += "(" + where(e->loc) + ")";
+  }
+  return out;
+}
+
+/// Names and source ranges of every declaration, statement and expression.
+static std::string dump(const Program& prog) {
+  std::string out;
+  for (const ClassDecl& c : prog.classes) {
+    out += "class " + c.name + (c.baseName ? " : " + *c.baseName : "") + " " + where(c.loc) + "\n";
+    for (const MethodDecl& m : c.methods) out += "  " + m.name + " " + where(m.loc) + dumpBody(m.body) + "\n";
+  }
+  for (const FunctionDecl& f : prog.functions) out += "function " + f.name + " " + where(f.loc) + dumpBody(f.body) + "\n";
+  return out;
+}
+
+static std::string parseWhole(const std::string& text) { return dump(Parser(Lexer(text).lexAll()).parseProgram()); }
+
+static const char* kSource = R"(class A { virtual f(): String { return "a"; } }
+// a comment
+class B extends A { override f(): String { return "b"; } }
+
+function main(): Int {
+  var b: A = new B();
+  print(b.f());
+  return 0;
+}
+)";
+
+TEST(IncrementalParser, ReparsesOnlyTheEditedDeclaration) {
+  IncrementalParser doc(kSource);
+  ASSERT_TRUE(doc.errors().empty());
+  ASSERT_EQ(doc.program().classes.size(), 2u);
+
+  // Rename B's method's result, on B's own line
+  const size_t at = doc.text().find("\"b\"");
+  doc.edit(at + 1, at + 2, "bee");
+  EXPECT_EQ(doc.lastWork().declsParsed, 1u);
+  EXPECT_LT(doc.lastWork().bytesLexed, 80u); // B and the comment before it
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+
+  // A new line at the top moves every declaration down
+  doc.edit(0, 0, "\n\n");
+  EXPECT_EQ(doc.lastWork().declsParsed, 1u);
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+  EXPECT_EQ(doc.program().functions[0].loc.start.line, 7);
+}
+
+TEST(IncrementalParser, KeepsDeclarationsWhenOnlyABodyChanges) {
+  IncrementalParser doc(kSource);
+  const MethodDecl* f = &doc.program().classes[1].methods[0];
+  const size_t at = doc.text().find("\"b\"");
+  doc.edit(at, at + 3, "\"a much longer string\"");
+  EXPECT_FALSE(doc.lastChange().declarations);
+  ASSERT_EQ(doc.lastChange().classes, std::vector<ClassId>{1});
+  EXPECT_TRUE(doc.lastChange().functions.empty());
+  // The same node, with the new body and range
+  EXPECT_EQ(&doc.program().classes[1].methods[0], f);
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+
+  // A new line in main's body moves only what follows it
+  const size_t print = doc.text().find("print");
+  doc.edit(print, print, "\n");
+  EXPECT_FALSE(doc.lastChange().declarations);
+  EXPECT_EQ(doc.lastChange().functions, std::vector<uint32_t>{0});
+  EXPECT_EQ(doc.lastChange().map(SourcePos{6, 3}).line, 6);
+  EXPECT_EQ(doc.lastChange().map(SourcePos{7, 3}).line, 8);
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+
+  // Renaming a method is a declaration change
+  const size_t name = doc.text().find("f()");
+  doc.edit(name, name + 1, "g");
+  EXPECT_TRUE(doc.lastChange().declarations);
+}
+
+TEST(IncrementalParser, RecoversAndGrowsOverUnclosedDeclarations) {
+  IncrementalParser doc(kSource);
+  // Dropping A's closing brace makes `class B` unexpected inside it
+  const size_t close = doc.text().find("} }");
+  doc.edit(close + 1, close + 3, "");
+  ASSERT_EQ(doc.errors().size(), 1u);
+  EXPECT_EQ(doc.errors()[0].message, "Expected method name, found class");
+  EXPECT_EQ(doc.errors()[0].loc.start.line, 3);
+  // B and main still parse
+  EXPECT_EQ(doc.program().classes.size(), 1u);
+  EXPECT_EQ(doc.program().functions.size(), 1u);
+
+  doc.edit(close + 1, close + 1, " }");
+  EXPECT_TRUE(doc.errors().empty());
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+
+  // An opening quote swallows the rest of the file until it is closed
+  const size_t ret = doc.text().find("return 0;");
+  doc.edit(ret, ret, "\"");
+  ASSERT_EQ(doc.errors().size(), 1u);
+  EXPECT_EQ(doc.program().functions.size(), 0u);
+  doc.edit(ret, ret + 1, "");
+  EXPECT_TRUE(doc.errors().empty());
+  EXPECT_EQ(dump(doc.program()), parseWhole(doc.text()));
+}
+
+TEST(IncrementalParser, MatchesAFullParseUnderRandomEdits) {
+  WorkloadParams params;
+  params.classes = 30;
+  params.mainStmts = 20;
+  params.commentDensity = 0.3;
+  const std::string original = generateWorkload(params);
+  IncrementalParser doc(original);
+  std::mt19937 rng(7);
+  const char* snippets[] = {"", "}", "{", "\n", "x", "\"", "class C { }", "// c\n", " ", "function g(): Int { return 1; }"};
+  auto check = [&](int i) {
+    std::string expected;
+    try {
+      expected = parseWhole(doc.text());
+    } catch (const std::exception&) {
+      EXPECT_FALSE(doc.errors().empty()) << "edit " << i;
+      return;
+    }
+    ASSERT_TRUE(doc.errors().empty()) << "edit " << i << ": " << doc.errors()[0].message;
+    ASSERT_EQ(dump(doc.program()), expected) << "edit " << i;
+  };
+  for (int i = 0; i < 300; ++i) {
+    // Make a random edit, then undo it half of the time
+    const size_t size = doc.text().size();
+    const size_t begin = std::uniform_int_distribution<size_t>(0, size)(rng);
+    const size_t end = std::min(size, begin + std::uniform_int_distribution<size_t>(0, 8)(rng));
+    const std::string removed = doc.text().substr(begin, end - begin);
+    const std::string added = snippets[std::uniform_int_distribution<size_t>(0, std::size(snippets) - 1)(rng)];
+    doc.edit(begin, end, added);
+    check(i);
+    if (rng() % 2) {
+      doc.edit(begin, begin + added.size(), removed);
+      check(i);
+    }
+  }
+  doc.edit(0, doc.text().size(), original);
+  EXPECT_EQ(dump(doc.program()), parseWhole(original));
+}
@@ -0,0 +1,78 @@
+#include "Bytecode.h"
+#include "Driver.h"
+#include "Interpreter.h"
+#include "Sema.h"
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+using namespace fakelang;
+
+TEST(Interpreter, RunsDemoLikeCompiledCode) {
+  const char* src = R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    class Dog extends Animal { override speak(): String { return "Woof"; } }
+    function main(): Int { var a: Animal = new Animal(); var d: Animal = new Dog(); print(a.speak()); print(d.speak()); return 3; }
+  )";
+  for (bool fold : {true, false}) {
+    CompileOptions opts;
+    opts.fold = fold;
+    std::string out;
+    llvm::raw_string_ostream os(out);
+    EXPECT_EQ(runSource(src, "demo.fakelang", RunMode::Interp, os, opts), 3);
+    EXPECT_EQ(os.str(), "Animal\nWoof\n");
+  }
+}
+
+TEST(Interpreter, InlineCachesVirtualCallSites) {
+  Program prog = parse(R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    class Dog extends Animal { override speak(): String { return "Woof"; } }
+    class Kennel { virtual bark(): String { var d: Animal = new Dog(); return d.speak(); } }
+    function main(): Int {
+      var k: Kennel = new Kennel();
+      print(k.bark()); print(k.bark()); print(k.bark());
+      return 0;
+    }
+  )");
+  // Without the partial evaluator every call is virtual
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const BytecodeModule mod = compileBytecode(prog, info);
+  ASSERT_EQ(mod.callSites.size(), 4u);
+
+  VM vm(mod);
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  EXPECT_EQ(vm.run(os), 0);
+  EXPECT_EQ(os.str(), "Woof\nWoof\nWoof\n");
+  EXPECT_EQ(vm.stats().calls, 6u);
+  // Each site misses once; the site in bark() then hits twice
+  EXPECT_EQ(vm.stats().inlineCacheMisses, 4u);
+  EXPECT_EQ(vm.stats().inlineCacheHits, 2u);
+  EXPECT_EQ(vm.stats().megamorphicCalls, 0u);
+}
+
+TEST(Interpreter, ReportsUnboundedRecursion) {
+  const char* src = R"(
+    class A { virtual f(): Int { var a: A = new A(); return a.f(); } }
+    function main(): Int { var a: A = new A(); return a.f(); }
+  )";
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  EXPECT_THROW(runSource(src, "r.fakelang", RunMode::Interp, os), std::runtime_error);
+}
+
+TEST(JIT, ReturnsMainResult) {
+  const char* src = R"(
+    class A { virtual n(): Int { return 7; } }
+    class B extends A { override n(): Int { return 42; } }
+    function main(): Int { var a: A = new B(); return a.n(); }
+  )";
+  CompileOptions opts;
+  opts.fold = false;
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  EXPECT_EQ(runSource(src, "j.fakelang", RunMode::JIT, os, opts), 42);
+}
@@ -0,0 +1,262 @@
+#include "LanguageServer.h"
+#include "WorkloadGen.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace fakelang;
+using llvm::json::Array;
+using llvm::json::Object;
+using llvm::json::Value;
+
+/// Frame `messages` as a client would send them.
+static std::string frame(const std::vector<Value>& messages) {
+  std::string out;
+  for (const Value& m : messages) {
+    std::string body;
+    llvm::raw_string_ostream(body) << m;
+    out += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  }
+  return out;
+}
+
+/// Decode the framed messages a server wrote.
+static std::vector<Value> unframe(const std::string& out) {
+  std::vector<Value> messages;
+  size_t at = 0;
+  while ((at = out.find("Content-Length: ", at)) != std::string::npos) {
+    const size_t headerEnd = out.find("\r\n\r\n", at);
+    const size_t length = std::stoul(out.substr(at + 16, headerEnd - at - 16));
+    auto parsed = llvm::json::parse(out.substr(headerEnd + 4, length));
+    EXPECT_TRUE(static_cast<bool>(parsed));
+    if (parsed) messages.push_back(std::move(*parsed));
+    at = headerEnd + 4 + length;
+  }
+  return messages;
+}
+
+static Value request(int id, const char* method, Object params) {
+  return Object{{"jsonrpc", "2.0"}, {"id", id}, {"method", method}, {"params", std::move(params)}};
+}
+
+static Value notification(const char* method, Object params) {
+  return Object{{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}};
+}
+
+/// A member as a string or an integer, or ""/-1 when missing.
+static std::string str(const Object* o, llvm::StringRef key) {
+  if (o) {
+    if (auto v = o->getString(key)) return v->str();
+  }
+  return "";
+}
+static int64_t num(const Object* o, llvm::StringRef key) {
+  if (o) {
+    if (auto v = o->getInteger(key)) return *v;
+  }
+  return -1;
+}
+
+static Value position(int line, int character) { return Object{{"line", line}, {"character", character}}; }
+
+/// Handle each message in turn, returning everything the server wrote.
+struct Session {
+  std::istringstream in;
+  std::string out;
+  llvm::raw_string_ostream os{out};
+  LanguageServer server{in, os};
+
+  std::vector<Value> send(const Value& message) {
+    out.clear();
+    server.handle(message);
+    os.flush();
+    return unframe(out);
+  }
+};
+
+static const char* kURI = "file:///shapes.fakelang";
+static const char* kSource = R"(class Shape { virtual name(): String { return "shape"; } }
+class Square extends Shape { override name(): String { return "square"; } }
+class Circle extends Shape { override name(): String { return "circle"; } }
+function main(): Int { var s: Shape = new Square(); print(s.name()); return 0; }
+)";
+
+static const Array& diagnosticsOf(const Value& message) {
+  return *message.getAsObject()->getObject("params")->getArray("diagnostics");
+}
+
+TEST(LanguageServer, RunsAFramedSessionOverStreams) {
+  std::istringstream in(frame({request(1, "initialize", Object{}), notification("initialized", Object{}),
+                               request(2, "textDocument/hover", Object{}), request(3, "shutdown", Object{}),
+                               notification("exit", Object{})}));
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  EXPECT_EQ(LanguageServer(in, os).run(), 0);
+  os.flush();
+
+  const std::vector<Value> replies = unframe(out);
+  ASSERT_EQ(replies.size(), 3u);
+  const Object* caps = replies[0].getAsObject()->getObject("result")->getObject("capabilities");
+  ASSERT_NE(caps, nullptr);
+  EXPECT_EQ(num(caps->getObject("textDocumentSync"), "change"), 2);
+  EXPECT_TRUE(static_cast<bool>(caps->getBoolean("typeHierarchyProvider")));
+  EXPECT_EQ(num(replies[1].getAsObject()->getObject("error"), "code"), -32601);
+  EXPECT_EQ(num(replies[2].getAsObject(), "id"), 3);
+}
+
+TEST(LanguageServer, PublishesDiagnosticsAfterIncrementalChanges) {
+  Session s;
+  Object doc{{"uri", kURI}, {"languageId", "fakelang"}, {"version", 1}, {"text", kSource}};
+  std::vector<Value> out = s.send(notification("textDocument/didOpen", Object{{"textDocument", std::move(doc)}}));
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_TRUE(diagnosticsOf(out[0]).empty());
+
+  // Call a method Shape does not have: a Sema error at the call
+  const std::string text = kSource;
+  const size_t call = text.find("s.name()") + 2;
+  const int line = 3, column = static_cast<int>(call - text.rfind('\n', call) - 1);
+  Object change{{"range", Object{{"start", position(line, column)}, {"end", position(line, column + 4)}}},
+                {"text", "area"}};
+  out = s.send(notification("textDocument/didChange",
+                            Object{{"textDocument", Object{{"uri", kURI}, {"version", 2}}},
+                                   {"contentChanges", Array{std::move(change)}}}));
+  ASSERT_EQ(out.size(), 1u);
+  ASSERT_EQ(diagnosticsOf(out[0]).size(), 1u);
+  const Object* diag = diagnosticsOf(out[0])[0].getAsObject();
+  EXPECT_NE(str(diag, "message").find("area"), std::string::npos);
+  EXPECT_EQ(num(diag->getObject("range")->getObject("start"), "line"), 3);
+
+  // Then break the syntax of the first class, on its own line
+  Object brace{{"range", Object{{"start", position(0, 12)}, {"end", position(0, 13)}}}, {"text", ""}};
+  out = s.send(notification("textDocument/didChange",
+                            Object{{"textDocument", Object{{"uri", kURI}, {"version", 3}}},
+                                   {"contentChanges", Array{std::move(brace)}}}));
+  ASSERT_EQ(out.size(), 1u);
+  ASSERT_FALSE(diagnosticsOf(out[0]).empty());
+  EXPECT_EQ(num(diagnosticsOf(out[0])[0].getAsObject()->getObject("range")->getObject("start"), "line"), 0);
+
+  out = s.send(notification("textDocument/didClose", Object{{"textDocument", Object{{"uri", kURI}}}}));
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_TRUE(diagnosticsOf(out[0]).empty());
+}
+
+TEST(LanguageServer, AnswersTypeHierarchyQueries) {
+  Session s;
+  s.send(notification("textDocument/didOpen",
+                      Object{{"textDocument", Object{{"uri", kURI}, {"version", 1}, {"text", kSource}}}}));
+
+  // The cursor on `Shape` in `class Square extends Shape`
+  std::vector<Value> out = s.send(request(
+      1, "textDocument/prepareTypeHierarchy",
+      Object{{"textDocument", Object{{"uri", kURI}}}, {"position", position(1, 24)}}));
+  ASSERT_EQ(out.size(), 1u);
+  const Array* items = out[0].getAsObject()->getArray("result");
+  ASSERT_NE(items, nullptr);
+  ASSERT_EQ(items->size(), 1u);
+  Value shape = (*items)[0];
+  EXPECT_EQ(str(shape.getAsObject(), "name"), "Shape");
+  EXPECT_EQ(num(shape.getAsObject()->getObject("selectionRange")->getObject("start"), "character"), 6);
+
+  out = s.send(request(2, "typeHierarchy/subtypes", Object{{"item", shape}}));
+  ASSERT_EQ(out.size(), 1u);
+  const Array* subtypes = out[0].getAsObject()->getArray("result");
+  ASSERT_EQ(subtypes->size(), 2u);
+  EXPECT_EQ(str((*subtypes)[0].getAsObject(), "name"), "Square");
+  EXPECT_EQ(str((*subtypes)[1].getAsObject(), "name"), "Circle");
+
+  out = s.send(request(3, "typeHierarchy/supertypes", Object{{"item", (*subtypes)[1]}}));
+  const Array* supertypes = out[0].getAsObject()->getArray("result");
+  ASSERT_EQ(supertypes->size(), 1u);
+  EXPECT_EQ(str((*supertypes)[0].getAsObject(), "name"), "Shape");
+}
+
+TEST(LanguageServer, NegotiatesThePositionEncoding) {
+  auto initialize = [](Session& s, Object capabilities) {
+    std::vector<Value> out = s.send(request(1, "initialize", Object{{"capabilities", std::move(capabilities)}}));
+    return str(out.at(0).getAsObject()->getObject("result")->getObject("capabilities"), "positionEncoding");
+  };
+  // `é` is two UTF-8 bytes but one UTF-16 code unit
+  const std::string text =
+      "class A { virtual f(): String { return \"\xC3\xA9\"; } } class B extends A { } class C extends Q { }\n";
+  // The error is reported on the declaration of C
+  const int byteColumn = static_cast<int>(text.find("class C"));
+  auto errorColumn = [&](Session& s) {
+    std::vector<Value> out = s.send(notification(
+        "textDocument/didOpen", Object{{"textDocument", Object{{"uri", kURI}, {"version", 1}, {"text", text}}}}));
+    return num(diagnosticsOf(out.at(0)).front().getAsObject()->getObject("range")->getObject("start"), "character");
+  };
+
+  Session utf16;
+  EXPECT_EQ(initialize(utf16, Object{}), "utf-16");
+  EXPECT_EQ(errorColumn(utf16), byteColumn - 1);
+
+  Session utf8;
+  EXPECT_EQ(initialize(utf8, Object{{"general", Object{{"positionEncodings", Array{"utf-16", "utf-8"}}}}}),
+            "utf-8");
+  EXPECT_EQ(errorColumn(utf8), byteColumn);
+
+  // A UTF-16 position past the `é` maps back to the right byte: the `A` of
+  // `extends A`, not the space before it
+  const int base = static_cast<int>(text.find("A {", text.find("class B"))) - 1;
+  std::vector<Value> out = utf16.send(request(
+      2, "textDocument/prepareTypeHierarchy",
+      Object{{"textDocument", Object{{"uri", kURI}}}, {"position", position(0, base)}}));
+  const Array* items = out.at(0).getAsObject()->getArray("result");
+  ASSERT_NE(items, nullptr);
+  EXPECT_EQ(str((*items)[0].getAsObject(), "name"), "A");
+}
+
+TEST(LanguageServer, RejectsRequestsWithoutAnId) {
+  Session s;
+  for (const char* method : {"initialize", "shutdown", "textDocument/prepareTypeHierarchy", "typeHierarchy/subtypes"}) {
+    std::vector<Value> out = s.send(notification(method, Object{}));
+    ASSERT_EQ(out.size(), 1u) << method;
+    EXPECT_EQ(num(out[0].getAsObject()->getObject("error"), "code"), -32600);
+    EXPECT_EQ(out[0].getAsObject()->get("id")->kind(), Value::Null);
+  }
+}
+
+/// Open `text` in a new session and return the diagnostics it publishes.
+static std::string freshDiagnostics(const std::string& text) {
+  Session s;
+  std::vector<Value> out = s.send(notification(
+      "textDocument/didOpen", Object{{"textDocument", Object{{"uri", kURI}, {"version", 1}, {"text", text}}}}));
+  std::string json;
+  llvm::raw_string_ostream(json) << *out.at(0).getAsObject()->get("params");
+  return json;
+}
+
+TEST(LanguageServer, IncrementalDiagnosticsMatchAFreshCheck) {
+  WorkloadParams params;
+  params.classes = 12;
+  params.mainStmts = 10;
+  std::string text = generateWorkload(params);
+  Session s;
+  s.send(notification("textDocument/didOpen",
+                      Object{{"textDocument", Object{{"uri", kURI}, {"version", 1}, {"text", text}}}}));
+
+  auto positionOf = [&](size_t offset) {
+    const size_t lineStart = text.rfind('\n', offset == 0 ? 0 : offset - 1);
+    const size_t start = lineStart == std::string::npos || offset == 0 ? 0 : lineStart + 1;
+    return position(static_cast<int>(std::count(text.begin(), text.begin() + static_cast<ptrdiff_t>(start), '\n')),
+                    static_cast<int>(offset - start));
+  };
+  std::mt19937 rng(11);
+  const char* snippets[] = {"", "x", "Int", "String", "\n", "var q: Int = \"s\"; ", "}", "override ", " ", "C1", "@"};
+  for (int i = 0; i < 150; ++i) {
+    const size_t begin = std::uniform_int_distribution<size_t>(0, text.size())(rng);
+    const size_t end = std::min(text.size(), begin + std::uniform_int_distribution<size_t>(0, 6)(rng));
+    const std::string added = snippets[std::uniform_int_distribution<size_t>(0, std::size(snippets) - 1)(rng)];
+    Object change{{"range", Object{{"start", positionOf(begin)}, {"end", positionOf(end)}}}, {"text", added}};
+    std::vector<Value> out = s.send(notification(
+        "textDocument/didChange", Object{{"textDocument", Object{{"uri", kURI}, {"version", i + 2}}},
+                                         {"contentChanges", Array{std::move(change)}}}));
+    text.replace(begin, end - begin, added);
+    std::string got;
+    llvm::raw_string_ostream(got) << *out.at(0).getAsObject()->get("params");
+    ASSERT_EQ(got, freshDiagnostics(text)) << "edit " << i;
+  }
+}
@@ -0,0 +1,125 @@
+#include "BitcodeEmitter.h"
+#include "Driver.h"
+#include "ModuleInterface.h"
+#include "Sema.h"
+#include "TestUtil.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+using namespace fakelang;
+
+/// Parse and check `src` and return its interface.
+static std::string interfaceOf(const char* src, const char* path) {
+  Program prog = parse(src);
+  Sema(path).analyze(prog);
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  writeInterface(prog, path, os);
+  return out;
+}
+
+static const char* kShapes = R"(
+class Shape { virtual name(): String { return "shape"; } virtual sides(): String { return "many"; } }
+class Circle extends Shape { override name(): String { return "circle"; } helper(): Int { return 1; } }
+)";
+
+TEST(ModuleInterface, RoundTripsClassDeclarations) {
+  const std::string data = interfaceOf(kShapes, "shapes.fakelang");
+  ASSERT_TRUE(isInterface(data));
+  const ModuleInterface iface(llvm::MemoryBufferRef(data, "shapes.fli"));
+  EXPECT_EQ(iface.sourcePath(), "shapes.fakelang");
+  ASSERT_EQ(iface.numClasses(), 2u);
+
+  Program prog;
+  iface.importInto(prog);
+  ASSERT_EQ(prog.classes.size(), 2u);
+  const ClassDecl& circle = prog.classes[1];
+  EXPECT_TRUE(circle.imported);
+  EXPECT_EQ(circle.name, "Circle");
+  ASSERT_TRUE(circle.baseName);
+  EXPECT_EQ(*circle.baseName, "Shape");
+  EXPECT_FALSE(prog.classes[0].baseName);
+  ASSERT_EQ(circle.methods.size(), 2u);
+  EXPECT_EQ(circle.methods[0].attr, MethodAttr::Override);
+  EXPECT_EQ(circle.methods[0].vtableSlot, 0u);
+  EXPECT_EQ(circle.methods[1].name, "helper");
+  EXPECT_EQ(circle.methods[1].returnType.name, "Int");
+  EXPECT_EQ(circle.methods[1].vtableSlot, kInvalidIndex);
+  EXPECT_TRUE(circle.methods[1].body.empty());
+
+  // The recorded layout is what Sema computes again
+  ProgramInfo info = Sema("main.fakelang").analyze(prog);
+  EXPECT_EQ(info.layouts.numSlots(1), 2u);
+}
+
+TEST(ModuleInterface, RejectsCorruptAndStaleInterfaces) {
+  std::string data = interfaceOf(kShapes, "shapes.fakelang");
+  data.pop_back();
+  EXPECT_THROW(ModuleInterface(llvm::MemoryBufferRef(data, "short.fli")), std::runtime_error);
+  EXPECT_THROW(ModuleInterface(llvm::MemoryBufferRef(kShapes, "shapes.fakelang")), std::runtime_error);
+
+  // Square's interface was written when Shape had one slot
+  const std::string square = interfaceOf(R"(
+    class Shape { virtual name(): String { return "shape"; } }
+    class Square extends Shape { virtual area(): Int { return 4; } }
+  )", "square.fakelang");
+  Program prog = parse("class Shape { virtual name(): String { return \"shape\"; } virtual sides(): Int { return 0; } }");
+  Program squareProg;
+  ModuleInterface(llvm::MemoryBufferRef(square, "square.fli")).importInto(squareProg);
+  prog.classes.push_back(std::move(squareProg.classes[1]));
+  try {
+    Sema("main.fakelang").analyze(prog);
+    FAIL() << "expected a stale interface error";
+  } catch (const std::runtime_error& ex) {
+    EXPECT_STREQ(ex.what(), "main.fakelang: error: in imported class 'Square': vtable slot of 'Square.area' is 2 "
+                            "here but 1 in its interface; rebuild the interface");
+  }
+}
+
+TEST(ModuleInterface, ImportsWithoutTheSourceFile) {
+  llvm::SmallString<128> dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("fakelang-fli", dir));
+  auto path = [&](const char* name) {
+    llvm::SmallString<128> p(dir);
+    llvm::sys::path::append(p, name);
+    return std::string(p.str());
+  };
+  const std::string shapes = path("shapes.fakelang"), shapesFli = path("shapes.fli");
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(shapes, ec);
+    os << kShapes;
+  }
+  CompileOptions opts;
+  opts.emit = EmitKind::Interface;
+  compileFile(shapes, shapesFli, opts);
+  ASSERT_FALSE(llvm::sys::fs::remove(shapes));
+
+  const std::string main = R"(
+    class Square extends Circle { override name(): String { return "square"; } }
+    function main(): Int { var s: Shape = new Square(); print(s.sides()); return 0; }
+  )";
+  opts.emit = EmitKind::BC;
+  opts.imports = {shapesFli};
+  CompileResult res = compileSource(main, path("main.fakelang"), opts);
+  llvm::sys::fs::remove_directories(dir);
+  ASSERT_TRUE(res.ok) << res.error;
+  llvm::LLVMContext ctx;
+  auto m = loadModule(llvm::MemoryBufferRef(res.output, "main.bc"), ctx);
+  EXPECT_TRUE(m->getFunction("Shape.sides")->isDeclaration());
+  EXPECT_FALSE(m->getFunction("Square.name")->isDeclaration());
+}
@@ -0,0 +1,72 @@
+#include "Driver.h"
+#include "PartialEval.h"
+#include "Sema.h"
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace fakelang;
+
+TEST(PartialEval, FoldsPureCallsOnExactReceivers) {
+  Program prog = parse(R"(
+    class Animal { virtual speak(): String { return "Animal"; } virtual loud(): String { print("!"); return "LOUD"; } }
+    class Dog extends Animal { override speak(): String { var a: Animal = new Animal(); return a.speak(); } }
+    function main(): Int { var d: Animal = new Dog(); print(d.speak()); print(d.loud()); return 0; }
+  )");
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const FoldStats stats = PartialEvaluator(info).run(prog);
+
+  const FunctionDecl& main = prog.functions[0];
+  auto* speak = static_cast<MethodCallExpr*>(static_cast<PrintStmt*>(main.body[1].get())->value.get());
+  auto* loud = static_cast<MethodCallExpr*>(static_cast<PrintStmt*>(main.body[2].get())->value.get());
+  // Dog.speak is pure: it calls Animal.speak on an object it created.
+  EXPECT_EQ(speak->exactClassId, 1u);
+  ASSERT_NE(speak->folded, nullptr);
+  EXPECT_EQ(static_cast<const StringExpr*>(speak->folded)->value, "Animal");
+  EXPECT_NE(static_cast<PrintStmt*>(main.body[1].get())->constant, nullptr);
+  // loud() prints, so it must still be called (directly).
+  EXPECT_EQ(loud->exactClassId, 1u);
+  EXPECT_EQ(loud->folded, nullptr);
+  EXPECT_EQ(static_cast<PrintStmt*>(main.body[2].get())->constant, nullptr);
+  EXPECT_EQ(stats.foldedCalls, 2u); // a.speak() inside Dog.speak, and d.speak()
+}
+
+TEST(PartialEval, LocalOnlyKeepsExactReceiversButFoldsNothing) {
+  Program prog = parse(R"(
+    class A { virtual name(): String { return "A"; } }
+    function main(): Int { var a: A = new A(); print(a.name()); print("literal"); return 0; }
+  )");
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  PartialEvaluator evaluator(info);
+  evaluator.setLocalOnly(true);
+  const FoldStats stats = evaluator.run(prog);
+
+  const FunctionDecl& main = prog.functions[0];
+  auto* call = static_cast<MethodCallExpr*>(static_cast<PrintStmt*>(main.body[1].get())->value.get());
+  EXPECT_EQ(call->exactClassId, 0u);
+  EXPECT_EQ(call->folded, nullptr);
+  EXPECT_EQ(static_cast<PrintStmt*>(main.body[1].get())->constant, nullptr);
+  EXPECT_NE(static_cast<PrintStmt*>(main.body[2].get())->constant, nullptr);
+  EXPECT_EQ(stats.foldedCalls, 0u);
+}
+
+TEST(PartialEval, MergesConstantPrintsWithoutChangingOutput) {
+  const char* src = R"(
+    class A { virtual name(): String { return "A"; } }
+    function main(): Int { var a: A = new A(); print(a.name()); print("and"); print(a.name()); return 0; }
+  )";
+  CompileOptions opts;
+  opts.collectStats = true;
+  CompileResult folded = compileSource(src, "m.fakelang", opts);
+  ASSERT_TRUE(folded.ok) << folded.error;
+  EXPECT_NE(folded.output.find("c\"A\\0Aand\\0AA\\00\""), std::string::npos) << folded.output;
+  EXPECT_EQ(folded.report.stats->foldedCalls, 2u);
+  EXPECT_EQ(folded.output.find("%name.slot"), std::string::npos); // no vtable dispatch left
+
+  opts.fold = false;
+  CompileResult plain = compileSource(src, "m.fakelang", opts);
+  ASSERT_TRUE(plain.ok) << plain.error;
+  EXPECT_EQ(plain.report.stats->foldedCalls, 0u);
+  EXPECT_EQ(plain.report.stats->virtualCalls, 2u);
+}
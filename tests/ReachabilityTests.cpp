@@ -0,0 +1,88 @@
+#include "Driver.h"
+#include "Reachability.h"
+#include "Sema.h"
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace fakelang;
+
+TEST(Reachability, FollowsNewAndVirtualCallsFromMain) {
+  // Classes: A=0, B=1, C=2, D=3. C is only created inside B.f, after the call
+  // through A has been seen; D and the non-virtual A.helper are never used.
+  Program prog = parse(R"(
+    class A { virtual f(): String { return "A"; } helper(): Int { return 1; } }
+    class B extends A { override f(): String { var c: A = new C(); return c.f(); } }
+    class C extends A { override f(): String { return "C"; } }
+    class D { virtual f(): String { return "D"; } }
+    function main(): Int { var a: A = new B(); print(a.f()); return 0; }
+  )");
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const LiveSet live = ReachabilityAnalysis(info).run(prog);
+
+  EXPECT_EQ(live.instantiated, (std::vector<bool>{false, true, true, false}));
+  EXPECT_EQ(live.referenced, (std::vector<bool>{true, true, true, false}));
+  EXPECT_FALSE(live.live(MethodRef{0, 0})); // A is never instantiated
+  EXPECT_FALSE(live.live(MethodRef{0, 1}));
+  EXPECT_TRUE(live.live(MethodRef{1, 0}));
+  EXPECT_TRUE(live.live(MethodRef{2, 0}));
+  EXPECT_FALSE(live.live(MethodRef{3, 0}));
+  EXPECT_EQ(live.numLiveMethods(), 2u);
+  EXPECT_FALSE(live.shrunk());
+}
+
+TEST(Reachability, ProgramWithoutMainIsEntirelyLive) {
+  Program prog = parse(R"(
+    class A { virtual f(): String { return "A"; } }
+    class B extends A { override f(): String { return "B"; } }
+  )");
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const LiveSet live = ReachabilityAnalysis(info).run(prog, /*shrinkVtables=*/true);
+  EXPECT_EQ(live.numLiveMethods(), 2u);
+  EXPECT_EQ(live.instantiated, (std::vector<bool>{true, true}));
+  EXPECT_FALSE(live.shrunk());
+}
+
+TEST(Reachability, ShrunkVtablesKeepOnlyCalledSlots) {
+  const char* src = R"(
+    class A { virtual f(): String { return "A.f"; } virtual g(): String { return "A.g"; } }
+    class B extends A { override g(): String { return "B.g"; } virtual h(): String { return "B.h"; } }
+    function main(): Int { var a: A = new B(); print(a.g()); return 0; }
+  )";
+  Program prog = parse(src);
+  const ProgramInfo info = Sema("t.fakelang").analyze(prog);
+  const LiveSet live = ReachabilityAnalysis(info).run(prog, /*shrinkVtables=*/true);
+  ASSERT_TRUE(live.shrunk());
+  // Only g (slot 1) is read, through A; B inherits A's layout
+  EXPECT_EQ(live.vtableSlots[0], (std::vector<uint32_t>{1}));
+  EXPECT_EQ(live.vtableSlots[1], (std::vector<uint32_t>{1}));
+  EXPECT_EQ(live.slotIndex(1, 1), 0u);
+
+  CompileOptions opts;
+  opts.fold = false;
+  opts.collectStats = true;
+  opts.shrinkVtables = true;
+  CompileResult shrunk = compileSource(src, "t.fakelang", opts);
+  ASSERT_TRUE(shrunk.ok) << shrunk.error;
+  EXPECT_NE(shrunk.output.find("%vtable.A = type { ptr }"), std::string::npos) << shrunk.output;
+  EXPECT_NE(shrunk.output.find("@vtable.B = private constant %vtable.B { ptr @B.g }"), std::string::npos);
+  EXPECT_EQ(shrunk.output.find("@vtable.A ="), std::string::npos);
+  EXPECT_EQ(shrunk.output.find("define ptr @A."), std::string::npos);
+  EXPECT_EQ(shrunk.output.find("@B.h"), std::string::npos);
+  EXPECT_EQ(shrunk.report.stats->deadMethods, 3u);
+  EXPECT_EQ(shrunk.report.stats->deadVtableSlots, 2u + 2u); // all of A's, and f and h of B's
+
+  // Without shrinking, B's vtable keeps its layout with the dead slots null
+  opts.shrinkVtables = false;
+  CompileResult full = compileSource(src, "t.fakelang", opts);
+  ASSERT_TRUE(full.ok) << full.error;
+  EXPECT_NE(full.output.find("%vtable.B { ptr null, ptr @B.g, ptr null }"), std::string::npos) << full.output;
+  EXPECT_EQ(full.report.stats->deadVtableSlots, 2u);
+
+  opts.dce = false;
+  CompileResult whole = compileSource(src, "t.fakelang", opts);
+  ASSERT_TRUE(whole.ok) << whole.error;
+  EXPECT_NE(whole.output.find("define ptr @B.h"), std::string::npos);
+  EXPECT_EQ(whole.report.stats->deadMethods, 0u);
+}
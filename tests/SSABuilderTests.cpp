@@ -0,0 +1,125 @@
+#include "Lexer.h"
+#include "Parser.h"
+#include "CodeGen.h"
+#include "SSABuilder.h"
+
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace fakelang;
+
+namespace {
+
+/// A function `i32 f(i1 %c)` with an entry block, for building CFGs by hand.
+struct TestFunction {
+  llvm::LLVMContext ctx;
+  llvm::Module module{"ssa", ctx};
+  llvm::IRBuilder<> b{ctx};
+  llvm::Function* fn;
+  llvm::BasicBlock* entry;
+
+  TestFunction() {
+    auto* fty = llvm::FunctionType::get(b.getInt32Ty(), {b.getInt1Ty()}, false);
+    fn = llvm::Function::Create(fty, llvm::GlobalValue::ExternalLinkage, "f", module);
+    entry = block("entry");
+  }
+  llvm::BasicBlock* block(const char* name) { return llvm::BasicBlock::Create(ctx, name, fn); }
+  llvm::Value* cond() { return fn->getArg(0); }
+};
+
+} // namespace
+
+TEST(SSABuilder, DiamondMergesWithPhi) {
+  TestFunction t;
+  SSABuilder ssa;
+  ssa.reset(2);
+  auto* then = t.block("then");
+  auto* other = t.block("else");
+  auto* join = t.block("join");
+
+  t.b.SetInsertPoint(t.entry);
+  ssa.sealBlock(t.entry);
+  ssa.writeVariable(0, t.entry, t.b.getInt32(1));
+  ssa.writeVariable(1, t.entry, t.b.getInt32(7));
+  t.b.CreateCondBr(t.cond(), then, other);
+  ssa.sealBlock(then);
+  ssa.sealBlock(other);
+
+  t.b.SetInsertPoint(then);
+  ssa.writeVariable(0, then, t.b.getInt32(2));
+  t.b.CreateBr(join);
+  t.b.SetInsertPoint(other);
+  t.b.CreateBr(join);
+  ssa.sealBlock(join);
+
+  t.b.SetInsertPoint(join);
+  llvm::Value* x = ssa.readVariable(0, t.b.getInt32Ty(), join);
+  llvm::Value* y = ssa.readVariable(1, t.b.getInt32Ty(), join);
+  t.b.CreateRet(t.b.CreateAdd(x, y));
+
+  auto* phi = llvm::dyn_cast<llvm::PHINode>(x);
+  ASSERT_NE(phi, nullptr);
+  EXPECT_EQ(phi->getNumIncomingValues(), 2u);
+  EXPECT_EQ(y, t.b.getInt32(7)); // same value on both paths: no phi
+  EXPECT_FALSE(llvm::verifyFunction(*t.fn, &llvm::errs()));
+}
+
+TEST(SSABuilder, LoopWithoutReassignmentNeedsNoPhi) {
+  TestFunction t;
+  SSABuilder ssa;
+  ssa.reset(1);
+  auto* loop = t.block("loop");
+  auto* exit = t.block("exit");
+
+  t.b.SetInsertPoint(t.entry);
+  ssa.sealBlock(t.entry);
+  ssa.writeVariable(0, t.entry, t.b.getInt32(5));
+  t.b.CreateBr(loop);
+
+  // The loop header is read before its back edge exists
+  t.b.SetInsertPoint(loop);
+  llvm::Value* inLoop = ssa.readVariable(0, t.b.getInt32Ty(), loop);
+  EXPECT_TRUE(llvm::isa<llvm::PHINode>(inLoop));
+  t.b.CreateCondBr(t.cond(), loop, exit);
+  ssa.sealBlock(loop);
+  ssa.sealBlock(exit);
+
+  t.b.SetInsertPoint(exit);
+  llvm::Value* after = ssa.readVariable(0, t.b.getInt32Ty(), exit);
+  t.b.CreateRet(after);
+
+  EXPECT_EQ(after, t.b.getInt32(5));
+  EXPECT_TRUE(loop->phis().empty()); // the incomplete phi was trivial
+  EXPECT_FALSE(llvm::verifyFunction(*t.fn, &llvm::errs()));
+}
+
+TEST(SSABuilder, CodeGenKeepsLocalsOutOfMemory) {
+  const char* src = R"(
+    class Animal { virtual speak(): String { return "Animal"; } }
+    function main(): Int { var a: Animal = new Animal(); print(a.speak()); print(a.speak()); return 0; }
+  )";
+  Lexer lex(src);
+  Parser p(lex.lexAll());
+  Program prog = p.parseProgram();
+  CodeGen cg;
+  cg.generate(prog, "test");
+
+  // The locals are SSA values, and the object, which has no fields, is a
+  // constant global rather than stack-allocated.
+  unsigned allocas = 0;
+  for (const auto& inst : llvm::instructions(*cg.getModule()->getFunction("main"))) {
+    if (llvm::isa<llvm::AllocaInst>(inst)) ++allocas;
+  }
+  EXPECT_EQ(allocas, 0u);
+}
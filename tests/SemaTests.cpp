@@ -0,0 +1,77 @@
+#include "Sema.h"
+#include "TestUtil.h"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+using namespace fakelang;
+
+TEST(Sema, ResolvesSlotsAndCallTargets) {
+  // Dog is declared before its base on purpose.
+  Program prog = parse(R"(
+    class Dog extends Animal { override speak(): String { return "Woof"; } virtual fetch(): String { return "ball"; } }
+    class Animal { virtual speak(): String { return "Animal"; } }
+    function main(): Int { var a: Animal = new Dog(); var d: Dog = new Dog(); print(d.fetch()); print(a.speak()); return 0; }
+  )");
+  ProgramInfo info = Sema("t.fakelang").analyze(prog);
+
+  ASSERT_EQ(info.layouts.size(), 2u);
+  EXPECT_EQ(prog.classes[0].baseId, 1u);
+  ASSERT_EQ(info.layouts.numSlots(0), 2u);
+  EXPECT_EQ(info.layouts.slotName(0, 0), "speak");
+  EXPECT_EQ(info.layouts.slotName(0, 1), "fetch");
+  EXPECT_EQ(info.layouts.impl(0)[0].cls, 0u); // Dog.speak overrides Animal.speak
+  EXPECT_EQ(prog.classes[0].methods[0].vtableSlot, 0u);
+
+  const FunctionDecl& main = prog.functions[0];
+  EXPECT_EQ(main.numLocals, 2u);
+  auto* fetch = dynamic_cast<PrintStmt*>(main.body[2].get());
+  auto* call = dynamic_cast<MethodCallExpr*>(fetch->value.get());
+  ASSERT_NE(call, nullptr);
+  EXPECT_EQ(call->classId, 0u);
+  EXPECT_EQ(call->vtableSlot, 1u);
+  EXPECT_EQ(call->type, SemaType::stringTy());
+  EXPECT_EQ(dynamic_cast<VarExpr*>(call->receiver.get())->slot, 1u);
+}
+
+TEST(Sema, ReportsAllErrorsTogether) {
+  Program prog = parse(R"(
+    class A extends Missing { override nope(): String { return "x"; } }
+    function main(): Int { var a: A = new B(); print(c.speak()); return 0; }
+  )");
+  try {
+    Sema("bad.fakelang").analyze(prog);
+    FAIL() << "expected errors";
+  } catch (const std::runtime_error& ex) {
+    const std::string msg = ex.what();
+    EXPECT_NE(msg.find("bad.fakelang:2:5: error: Unknown base class: Missing"), std::string::npos) << msg;
+    EXPECT_NE(msg.find("marked override but no base method"), std::string::npos) << msg;
+    EXPECT_NE(msg.find("Unknown class: B"), std::string::npos) << msg;
+    EXPECT_NE(msg.find("Unknown variable: c"), std::string::npos) << msg;
+  }
+}
+
+TEST(Sema, RejectsIncompatibleInitializer) {
+  Program prog = parse(R"(
+    class A { virtual f(): String { return "a"; } }
+    class B { virtual f(): String { return "b"; } }
+    function main(): Int { var a: A = new B(); return 0; }
+  )");
+  EXPECT_THROW(Sema().analyze(prog), std::runtime_error);
+}
+
+TEST(Sema, ErrorsInImportedClassesNameTheClass) {
+  Program prog = parse(R"(
+    class A { virtual f(): String { return "a"; } }
+    class B extends A { override g(): String { return "b"; } }
+  )");
+  prog.classes[1].imported = true; // its locations are in another file
+  try {
+    Sema("main.fakelang").analyze(prog);
+    FAIL() << "expected errors";
+  } catch (const std::runtime_error& ex) {
+    EXPECT_STREQ(ex.what(),
+                 "main.fakelang: error: in imported class 'B': Method 'g' marked override but no base method");
+  }
+}
@@ -0,0 +1,13 @@
+// Fakelang test helpers shared by the unit tests.
+#pragma once
+
+#include "AST.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+namespace fakelang {
+
+/// Lex and parse `src`; throws on syntax errors like the parser does.
+inline Program parse(const char* src) { return Parser(Lexer(src).lexAll()).parseProgram(); }
+
+} // namespace fakelang
@@ -0,0 +1,140 @@
+#include "BitcodeEmitter.h"
+#include "Driver.h"
+#include "ThinLTO.h"
+
+// Suppress deprecation warnings from LLVM headers under C++23
+#if defined(__clang__)
+#  pragma clang diagnostic push
+#  pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+#include <llvm/IR/Comdat.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#if defined(__clang__)
+#  pragma clang diagnostic pop
+#endif
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace fakelang;
+
+// Shape.sides is implemented once in the whole program; name is overridden
+// in both files
+static const char* kShapes = R"(
+class Shape { virtual name(): String { return "shape"; } virtual sides(): String { return "many"; } }
+class Circle extends Shape { override name(): String { return "circle"; } }
+)";
+static const char* kMain = R"(
+class Square extends Shape { override name(): String { return "square"; } }
+function main(): Int { var s: Shape = new Square(); print(s.sides()); print(s.name()); return 0; }
+)";
+
+/// The two files in a fresh directory, removed with the fixture.
+class SeparateCompilation : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("fakelang-lto", dir_));
+    shapes_ = write("shapes.fakelang", kShapes);
+    main_ = write("main.fakelang", kMain);
+  }
+  void TearDown() override { llvm::sys::fs::remove_directories(dir_); }
+
+  std::string write(const char* name, const char* text) {
+    llvm::SmallString<128> p(dir_);
+    llvm::sys::path::append(p, name);
+    std::error_code ec;
+    llvm::raw_fd_ostream os(p, ec);
+    os << text;
+    return std::string(p.str());
+  }
+
+  /// Compile `file` with both files as imports, as a build would.
+  CompileResult compile(const std::string& file, CompileOptions opts) {
+    opts.imports = {shapes_, main_};
+    auto buf = openInput(file);
+    return compileSource(buf->getBuffer(), file, opts);
+  }
+
+  llvm::SmallString<128> dir_;
+  std::string shapes_, main_;
+};
+
+TEST_F(SeparateCompilation, DeclaresImportedMethodsAndEmitsVtablesAsComdats) {
+  CompileOptions opts;
+  opts.emit = EmitKind::BC;
+  opts.fold = false;
+  CompileResult res = compile(main_, opts);
+  ASSERT_TRUE(res.ok) << res.error;
+  llvm::LLVMContext ctx;
+  auto m = loadModule(llvm::MemoryBufferRef(res.output, "main.bc"), ctx);
+
+  EXPECT_TRUE(m->getFunction("Shape.sides")->isDeclaration());
+  EXPECT_FALSE(m->getFunction("Square.name")->isDeclaration());
+  // Only the vtable main creates objects with; Shape's is Shapes.fakelang's
+  EXPECT_EQ(m->getNamedGlobal("vtable.Shape"), nullptr);
+  llvm::GlobalVariable* vt = m->getNamedGlobal("vtable.Square");
+  ASSERT_NE(vt, nullptr);
+  EXPECT_EQ(vt->getLinkage(), llvm::GlobalValue::LinkOnceODRLinkage);
+  ASSERT_NE(vt->getComdat(), nullptr);
+  EXPECT_EQ(vt->getComdat()->getName(), "vtable.Square");
+  llvm::SmallVector<llvm::MDNode*, 2> types;
+  vt->getMetadata(llvm::LLVMContext::MD_type, types);
+  EXPECT_EQ(types.size(), 2u); // Square and Shape
+
+  size_t typeTests = 0;
+  for (const llvm::Instruction& inst : llvm::instructions(*m->getFunction("main"))) {
+    auto* ii = llvm::dyn_cast<llvm::IntrinsicInst>(&inst);
+    if (ii && ii->getIntrinsicID() == llvm::Intrinsic::type_test) ++typeTests;
+  }
+  EXPECT_EQ(typeTests, 2u);
+
+  // The library file defines its methods and no main
+  res = compile(shapes_, opts);
+  ASSERT_TRUE(res.ok) << res.error;
+  m = loadModule(llvm::MemoryBufferRef(res.output, "shapes.bc"), ctx);
+  EXPECT_FALSE(m->getFunction("Shape.sides")->isDeclaration());
+  EXPECT_EQ(m->getFunction("main"), nullptr);
+}
+
+TEST_F(SeparateCompilation, ThinLTOInlinesAcrossModules) {
+  CompileOptions opts;
+  opts.emit = EmitKind::BC;
+  opts.fold = false;
+  opts.thinLTO = true;
+  std::vector<std::string> bitcode;
+  for (const std::string& file : {shapes_, main_}) {
+    CompileResult res = compile(file, opts);
+    ASSERT_TRUE(res.ok) << res.error;
+    bitcode.push_back(std::move(res.output));
+  }
+  ThinLTOOptions lto;
+  lto.jobs = 2;
+  lto.emitIR = true;
+  const std::vector<std::string> modules =
+      runThinLTO({llvm::MemoryBufferRef(bitcode[0], "shapes.bc"), llvm::MemoryBufferRef(bitcode[1], "main.bc")}, lto);
+  ASSERT_EQ(modules.size(), 2u);
+
+  // Both virtual calls in main, one to the other module, end up inlined
+  const std::string& ir = modules[0].find("@main(") != std::string::npos ? modules[0] : modules[1];
+  const size_t mainStart = ir.find("i32 @main(");
+  ASSERT_NE(mainStart, std::string::npos);
+  const std::string mainBody = ir.substr(mainStart, ir.find("\n}", mainStart) - mainStart);
+  EXPECT_EQ(mainBody.find("call ptr"), std::string::npos) << mainBody;
+  EXPECT_NE(mainBody.find("@puts"), std::string::npos) << mainBody;
+}
+
+TEST_F(SeparateCompilation, ThinLTORejectsDuplicateDefinitions) {
+  CompileOptions opts;
+  opts.emit = EmitKind::BC;
+  opts.thinLTO = true;
+  CompileResult res = compile(main_, opts);
+  ASSERT_TRUE(res.ok) << res.error;
+  EXPECT_THROW(runThinLTO({llvm::MemoryBufferRef(res.output, "a.bc"), llvm::MemoryBufferRef(res.output, "b.bc")}),
+               std::runtime_error);
+}
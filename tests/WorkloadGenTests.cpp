@@ -0,0 +1,58 @@
+#include "Driver.h"
+#include "WorkloadGen.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace fakelang;
+
+TEST(WorkloadGen, SameSeedSameProgram) {
+  WorkloadParams p;
+  p.classes = 50;
+  p.stringDup = 0.5;
+  p.commentDensity = 0.3;
+  EXPECT_EQ(generateWorkload(p), generateWorkload(p));
+  WorkloadParams q = p;
+  q.seed = 2;
+  EXPECT_NE(generateWorkload(p), generateWorkload(q));
+}
+
+TEST(WorkloadGen, GeneratedProgramsCompile) {
+  for (uint64_t seed : {1, 2, 3}) {
+    WorkloadParams p;
+    p.seed = seed;
+    p.classes = 200;
+    p.depth = 6;
+    p.fanOut = 3;
+    p.methodsPerClass = 5;
+    p.overrideRatio = 0.7;
+    p.mainStmts = 300;
+    p.stringDup = 0.5;
+    p.commentDensity = 1.5;
+    const std::string src = generateWorkload(p);
+    CompileResult res = compileSource(src, "gen.fakelang");
+    EXPECT_TRUE(res.ok) << "seed " << seed << ": " << res.error;
+  }
+}
+
+TEST(WorkloadGen, TargetSizeBoundsOutput) {
+  WorkloadParams p;
+  p.targetBytes = 64 * 1024;
+  p.mainStmts = 0;
+  const std::string src = generateWorkload(p);
+  EXPECT_GE(src.size(), p.targetBytes);
+  EXPECT_LT(src.size(), p.targetBytes + 4096);
+}
+
+TEST(WorkloadGen, DispatchWorkloadsReturnOne) {
+  for (size_t targets : {1, 2, 5, 40}) {
+    DispatchParams p;
+    p.calls = 20;
+    p.targets = targets;
+    const std::string src = generateDispatchWorkload(p);
+    EXPECT_EQ(runSource(src, "dispatch.fakelang", RunMode::Interp, llvm::nulls()), 1) << "targets " << targets;
+    CompileOptions opts;
+    opts.fold = false;
+    EXPECT_EQ(runSource(src, "dispatch.fakelang", RunMode::Interp, llvm::nulls(), opts), 1) << "targets " << targets;
+  }
+}